@@ -39,6 +39,7 @@ __weak HAL_StatusTypeDef MX_I2C1_Init(I2C_HandleTypeDef* hi2c);
   */
 
 I2C_HandleTypeDef hi2c1;
+DMA_HandleTypeDef hdma_i2c1_rx;
 /**
   * @}
   */
@@ -51,6 +52,7 @@ I2C_HandleTypeDef hi2c1;
 static uint32_t IsI2C1MspCbValid = 0;
 #endif /* USE_HAL_I2C_REGISTER_CALLBACKS */
 static uint32_t I2C1InitCounter = 0;
+static volatile uint8_t I2C1ReadPending = 0;
 
 /**
   * @}
@@ -278,6 +280,105 @@ int32_t  BSP_I2C1_ReadReg16(uint16_t DevAddr, uint16_t Reg, uint8_t *pData, uint
   return ret;
 }
 
+/**
+  * @brief  Start reading registers through a bus (16 bits) with DMA
+  * @note   The register address is sent in polling mode, the data phase runs
+  *         on DMA1 Stream0 and BSP_I2C1_ReadCpltCallback() is called from the
+  *         interrupt once it is done. The bus must not be used until then.
+  * @param  DevAddr: Device address on BUS
+  * @param  Reg: The target register address to read
+  * @param  pData: Destination, must stay valid until the callback
+  * @param  Length Data Length
+  * @retval BSP status
+  */
+int32_t BSP_I2C1_ReadReg16_DMA(uint16_t DevAddr, uint16_t Reg, uint8_t *pData, uint16_t Length)
+{
+  int32_t ret = BSP_ERROR_NONE;
+
+  I2C1ReadPending = 1U;
+  if (HAL_I2C_Mem_Read_DMA(&hi2c1, DevAddr, Reg, I2C_MEMADD_SIZE_16BIT, pData, Length) != HAL_OK)
+  {
+    I2C1ReadPending = 0U;
+    if (HAL_I2C_GetState(&hi2c1) != HAL_I2C_STATE_READY)
+    {
+      ret = BSP_ERROR_BUSY;
+    }
+    else if (HAL_I2C_GetError(&hi2c1) != HAL_I2C_ERROR_AF)
+    {
+      ret =  BSP_ERROR_BUS_ACKNOWLEDGE_FAILURE;
+    }
+    else
+    {
+      ret =  BSP_ERROR_PERIPH_FAILURE;
+    }
+  }
+  return ret;
+}
+
+/**
+  * @brief  Abort the BSP_I2C1_ReadReg16_DMA() transfer in flight
+  * @note   BSP_I2C1_ReadCpltCallback() is called with BSP_ERROR_PERIPH_FAILURE,
+  *         from the interrupt once the DMA stopped, or from here when the
+  *         peripheral had no transfer left to abort.
+  * @retval BSP status
+  */
+int32_t BSP_I2C1_AbortRead(void)
+{
+  uint8_t pending;
+
+  if (HAL_I2C_Master_Abort_IT(&hi2c1, 0U) != HAL_OK)
+  {
+    /* the transfer may have ended meanwhile, its callback then ran */
+    __disable_irq();
+    pending = I2C1ReadPending;
+    I2C1ReadPending = 0U;
+    __enable_irq();
+    if (pending != 0U)
+    {
+      BSP_I2C1_ReadCpltCallback(BSP_ERROR_PERIPH_FAILURE);
+    }
+  }
+  return BSP_ERROR_NONE;
+}
+
+/**
+  * @brief  Called from the interrupt when a BSP_I2C1_ReadReg16_DMA() transfer
+  *         is over.
+  * @param  Status: BSP_ERROR_NONE or the bus error
+  */
+__weak void BSP_I2C1_ReadCpltCallback(int32_t Status)
+{
+  /* Prevent unused argument(s) compilation warning */
+  UNUSED(Status);
+}
+
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+  if ((hi2c->Instance == I2C1) && (I2C1ReadPending != 0U))
+  {
+    I2C1ReadPending = 0U;
+    BSP_I2C1_ReadCpltCallback(BSP_ERROR_NONE);
+  }
+}
+
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
+{
+  if ((hi2c->Instance == I2C1) && (I2C1ReadPending != 0U))
+  {
+    I2C1ReadPending = 0U;
+    BSP_I2C1_ReadCpltCallback(BSP_ERROR_PERIPH_FAILURE);
+  }
+}
+
+void HAL_I2C_AbortCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+  if ((hi2c->Instance == I2C1) && (I2C1ReadPending != 0U))
+  {
+    I2C1ReadPending = 0U;
+    BSP_I2C1_ReadCpltCallback(BSP_ERROR_PERIPH_FAILURE);
+  }
+}
+
 /**
   * @brief  Send an amount width data through bus (Simplex)
   * @param  DevAddr: Device address on Bus.
@@ -442,6 +543,30 @@ static void I2C1_MspInit(I2C_HandleTypeDef* i2cHandle)
     __HAL_RCC_I2C1_CLK_ENABLE();
   /* USER CODE BEGIN I2C1_MspInit 1 */
 
+    /* I2C1_RX on DMA1 Stream0 channel 1, used by BSP_I2C1_ReadReg16_DMA */
+    __HAL_RCC_DMA1_CLK_ENABLE();
+
+    hdma_i2c1_rx.Instance = DMA1_Stream0;
+    hdma_i2c1_rx.Init.Channel = DMA_CHANNEL_1;
+    hdma_i2c1_rx.Init.Direction = DMA_PERIPH_TO_MEMORY;
+    hdma_i2c1_rx.Init.PeriphInc = DMA_PINC_DISABLE;
+    hdma_i2c1_rx.Init.MemInc = DMA_MINC_ENABLE;
+    hdma_i2c1_rx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    hdma_i2c1_rx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    hdma_i2c1_rx.Init.Mode = DMA_NORMAL;
+    hdma_i2c1_rx.Init.Priority = DMA_PRIORITY_HIGH;
+    hdma_i2c1_rx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+    (void)HAL_DMA_Init(&hdma_i2c1_rx);
+
+    __HAL_LINKDMA(i2cHandle, hdmarx, hdma_i2c1_rx);
+
+    HAL_NVIC_SetPriority(DMA1_Stream0_IRQn, 0, 0);
+    HAL_NVIC_EnableIRQ(DMA1_Stream0_IRQn);
+    HAL_NVIC_SetPriority(I2C1_EV_IRQn, 0, 0);
+    HAL_NVIC_EnableIRQ(I2C1_EV_IRQn);
+    HAL_NVIC_SetPriority(I2C1_ER_IRQn, 0, 0);
+    HAL_NVIC_EnableIRQ(I2C1_ER_IRQn);
+
   /* USER CODE END I2C1_MspInit 1 */
 }
 
@@ -463,6 +588,11 @@ static void I2C1_MspDeInit(I2C_HandleTypeDef* i2cHandle)
 
   /* USER CODE BEGIN I2C1_MspDeInit 1 */
 
+    HAL_NVIC_DisableIRQ(DMA1_Stream0_IRQn);
+    HAL_NVIC_DisableIRQ(I2C1_EV_IRQn);
+    HAL_NVIC_DisableIRQ(I2C1_ER_IRQn);
+    (void)HAL_DMA_DeInit(i2cHandle->hdmarx);
+
   /* USER CODE END I2C1_MspDeInit 1 */
 }
 
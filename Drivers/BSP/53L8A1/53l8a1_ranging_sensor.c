@@ -56,7 +56,7 @@ static RANGING_SENSOR_Capabilities_t VL53L8A1_RANGING_SENSOR_Cap;
 /** @defgroup XNUCLEO_53L8A1_RANGING_SENSOR_Private_Functions_Prototypes Private Functions Prototypes
   * @{
   */
-static int32_t VL53L8CX_Probe(uint32_t Instance);
+static int32_t VL53L8CX_Probe(uint32_t Instance, uint32_t Address);
 /**
   * @}
   */
@@ -76,7 +76,31 @@ int32_t VL53L8A1_RANGING_SENSOR_Init(uint32_t Instance)
   }
   else
   {
-    ret = VL53L8CX_Probe(Instance);
+    ret = VL53L8CX_Probe(Instance, RANGING_SENSOR_VL53L8CX_ADDRESS);
+  }
+
+  return ret;
+}
+
+/**
+  * @brief Initializes a ranging sensor that does not answer at the default
+  *        address, e.g. one left powered across a host reset with the address
+  *        given by VL53L8A1_RANGING_SENSOR_SetAddress().
+  * @param Instance    Ranging sensor instance.
+  * @param Address     Current I2C address of the device.
+  * @retval BSP status
+  */
+int32_t VL53L8A1_RANGING_SENSOR_InitAtAddress(uint32_t Instance, uint32_t Address)
+{
+  int32_t ret;
+
+  if (Instance >= RANGING_SENSOR_INSTANCES_NBR)
+  {
+    ret = BSP_ERROR_WRONG_PARAM;
+  }
+  else
+  {
+    ret = VL53L8CX_Probe(Instance, Address);
   }
 
   return ret;
@@ -272,6 +296,61 @@ int32_t VL53L8A1_RANGING_SENSOR_GetDistance(uint32_t Instance, RANGING_SENSOR_Re
   return ret;
 }
 
+/**
+  * @brief Start reading the measurement the data ready interrupt announced
+  *        (VL53L8A1_I2C_READREG_ASYNC), without waiting for it.
+  * @note Call VL53L8A1_RANGING_SENSOR_GetDistanceComplete() once the bus
+  *       reports the end of the transfer. The bus must not be used until then.
+  * @param Instance    Ranging sensor instance.
+  * @retval BSP status
+  */
+int32_t VL53L8A1_RANGING_SENSOR_GetDistanceStart(uint32_t Instance)
+{
+  int32_t ret;
+
+  if (Instance >= RANGING_SENSOR_INSTANCES_NBR)
+  {
+    ret = BSP_ERROR_WRONG_PARAM;
+  }
+  else if (VL53L8CX_GetDistanceStart(VL53L8A1_RANGING_SENSOR_CompObj[Instance]) < 0)
+  {
+    ret = BSP_ERROR_COMPONENT_FAILURE;
+  }
+  else
+  {
+    ret = BSP_ERROR_NONE;
+  }
+
+  return ret;
+}
+
+/**
+  * @brief Get the measurement read by VL53L8A1_RANGING_SENSOR_GetDistanceStart().
+  * @param Instance    Ranging sensor instance.
+  * @param pResult    Pointer to the result struct.
+  * @retval BSP status
+  */
+int32_t VL53L8A1_RANGING_SENSOR_GetDistanceComplete(uint32_t Instance, RANGING_SENSOR_Result_t *pResult)
+{
+  int32_t ret;
+
+  if (Instance >= RANGING_SENSOR_INSTANCES_NBR)
+  {
+    ret = BSP_ERROR_WRONG_PARAM;
+  }
+  else if (VL53L8CX_GetDistanceComplete(VL53L8A1_RANGING_SENSOR_CompObj[Instance],
+                                        (VL53L8CX_Result_t *)pResult) < 0)
+  {
+    ret = BSP_ERROR_COMPONENT_FAILURE;
+  }
+  else
+  {
+    ret = BSP_ERROR_NONE;
+  }
+
+  return ret;
+}
+
 /**
   * @brief Start ranging.
   * @param Instance    Ranging sensor instance.
@@ -454,6 +533,11 @@ int32_t VL53L8A1_RANGING_SENSOR_XTalkCalibration(uint32_t Instance, uint16_t Ref
   }
   else
   {
+#ifdef VL53L8A1_CALIB_SAVE
+    /* Keep the new Xtalk across resets */
+    (void)VL53L8A1_CALIB_SAVE(Instance,
+                              &(((VL53L8CX_Object_t *)VL53L8A1_RANGING_SENSOR_CompObj[Instance])->Dev));
+#endif
     ret = BSP_ERROR_NONE;
   }
 
@@ -467,9 +551,10 @@ int32_t VL53L8A1_RANGING_SENSOR_XTalkCalibration(uint32_t Instance, uint16_t Ref
 /**
   * @brief Register Bus IOs if component ID is OK.
   * @param Instance    Ranging sensor instance.
+  * @param Address     I2C address the device answers at.
   * @retval BSP status
   */
-static int32_t VL53L8CX_Probe(uint32_t Instance)
+static int32_t VL53L8CX_Probe(uint32_t Instance, uint32_t Address)
 {
   int32_t ret;
   VL53L8CX_IO_t              IOCtx;
@@ -477,11 +562,16 @@ static int32_t VL53L8CX_Probe(uint32_t Instance)
   static VL53L8CX_Object_t   VL53L8CXObj[RANGING_SENSOR_INSTANCES_NBR];
 
   /* Configure the ranging sensor driver */
-  IOCtx.Address     = RANGING_SENSOR_VL53L8CX_ADDRESS;
+  IOCtx.Address     = (uint16_t)Address;
   IOCtx.Init        = VL53L8A1_I2C_INIT;
   IOCtx.DeInit      = VL53L8A1_I2C_DEINIT;
   IOCtx.WriteReg    = VL53L8A1_I2C_WRITEREG;
   IOCtx.ReadReg     = VL53L8A1_I2C_READREG;
+#ifdef VL53L8A1_I2C_READREG_ASYNC
+  IOCtx.ReadRegAsync = VL53L8A1_I2C_READREG_ASYNC;
+#else
+  IOCtx.ReadRegAsync = NULL;
+#endif
   IOCtx.GetTick     = VL53L8A1_GETTICK;
 
   if (VL53L8CX_RegisterBusIO(&(VL53L8CXObj[Instance]), &IOCtx) != VL53L8CX_OK)
@@ -501,18 +591,30 @@ static int32_t VL53L8CX_Probe(uint32_t Instance)
     {
       ret = BSP_ERROR_UNKNOWN_COMPONENT;
     }
-    else if (VL53L8A1_RANGING_SENSOR_Drv->Init(VL53L8A1_RANGING_SENSOR_CompObj[Instance]) != VL53L8CX_OK)
-    {
-      ret = BSP_ERROR_COMPONENT_FAILURE;
-    }
-    else if (VL53L8A1_RANGING_SENSOR_Drv->GetCapabilities(VL53L8A1_RANGING_SENSOR_CompObj[Instance],
-                                                          &VL53L8A1_RANGING_SENSOR_Cap) != VL53L8CX_OK)
-    {
-      ret = BSP_ERROR_COMPONENT_FAILURE;
-    }
     else
     {
-      ret = BSP_ERROR_NONE;
+#ifdef VL53L8A1_CALIB_LOAD
+      /* Restore the stored calibration, the init only checks it against the NVM */
+      (void)VL53L8A1_CALIB_LOAD(Instance, &(VL53L8CXObj[Instance].Dev));
+#endif
+
+      if (VL53L8A1_RANGING_SENSOR_Drv->Init(VL53L8A1_RANGING_SENSOR_CompObj[Instance]) != VL53L8CX_OK)
+      {
+        ret = BSP_ERROR_COMPONENT_FAILURE;
+      }
+      else if (VL53L8A1_RANGING_SENSOR_Drv->GetCapabilities(VL53L8A1_RANGING_SENSOR_CompObj[Instance],
+                                                            &VL53L8A1_RANGING_SENSOR_Cap) != VL53L8CX_OK)
+      {
+        ret = BSP_ERROR_COMPONENT_FAILURE;
+      }
+      else
+      {
+#ifdef VL53L8A1_CALIB_SAVE
+        /* No write when the store already holds this calibration */
+        (void)VL53L8A1_CALIB_SAVE(Instance, &(VL53L8CXObj[Instance].Dev));
+#endif
+        ret = BSP_ERROR_NONE;
+      }
     }
   }
 
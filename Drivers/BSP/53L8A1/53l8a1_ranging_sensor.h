@@ -142,6 +142,7 @@ extern void *VL53L8A1_RANGING_SENSOR_CompObj[RANGING_SENSOR_INSTANCES_NBR];
   * @{
   */
 int32_t VL53L8A1_RANGING_SENSOR_Init(uint32_t Instance);
+int32_t VL53L8A1_RANGING_SENSOR_InitAtAddress(uint32_t Instance, uint32_t Address);
 int32_t VL53L8A1_RANGING_SENSOR_DeInit(uint32_t Instance);
 int32_t VL53L8A1_RANGING_SENSOR_ReadID(uint32_t Instance, uint32_t *pId);
 int32_t VL53L8A1_RANGING_SENSOR_GetCapabilities(uint32_t Instance, RANGING_SENSOR_Capabilities_t *pCapabilities);
@@ -149,6 +150,8 @@ int32_t VL53L8A1_RANGING_SENSOR_ConfigProfile(uint32_t Instance, RANGING_SENSOR_
 int32_t VL53L8A1_RANGING_SENSOR_ConfigROI(uint32_t Instance, RANGING_SENSOR_ROIConfig_t *pConfig);
 int32_t VL53L8A1_RANGING_SENSOR_ConfigIT(uint32_t Instance, RANGING_SENSOR_ITConfig_t *pConfig);
 int32_t VL53L8A1_RANGING_SENSOR_GetDistance(uint32_t Instance, RANGING_SENSOR_Result_t *pResult);
+int32_t VL53L8A1_RANGING_SENSOR_GetDistanceStart(uint32_t Instance);
+int32_t VL53L8A1_RANGING_SENSOR_GetDistanceComplete(uint32_t Instance, RANGING_SENSOR_Result_t *pResult);
 int32_t VL53L8A1_RANGING_SENSOR_Start(uint32_t Instance, uint32_t Mode);
 int32_t VL53L8A1_RANGING_SENSOR_Stop(uint32_t Instance);
 int32_t VL53L8A1_RANGING_SENSOR_SetAddress(uint32_t Instance, uint32_t Address);
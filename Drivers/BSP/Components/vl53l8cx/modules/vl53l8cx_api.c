@@ -29,14 +29,16 @@ static uint8_t _vl53l8cx_poll_for_answer(
 		uint8_t					expected_value)
 {
 	uint8_t status = VL53L8CX_STATUS_OK;
-	uint8_t timeout = 0;
+	uint16_t timeout = 0;
 
 	do {
 		status |= VL53L8CX_RdMulti(&(p_dev->platform), address,
 				p_dev->temp_buffer, size);
-		status |= VL53L8CX_WaitMs(&(p_dev->platform), 10);
+		status |= VL53L8CX_WaitMs(&(p_dev->platform),
+				VL53L8CX_POLL_PERIOD_MS);
 
-		if(timeout >= (uint8_t)200)	/* 2s timeout */
+		/* 2s timeout */
+		if(timeout >= (uint16_t)(2000U / VL53L8CX_POLL_PERIOD_MS))
 		{
 			status |= (uint8_t)VL53L8CX_STATUS_TIMEOUT_ERROR;
 			break;
@@ -55,6 +57,65 @@ static uint8_t _vl53l8cx_poll_for_answer(
 	return status;
 }
 
+/*
+ * Inner function, not available outside this file. This function returns the
+ * VL53L8CX_SHADOW_* bit of a DCI index, 0 if the index has no shadow.
+ */
+
+static uint8_t _vl53l8cx_shadow_bit(
+		uint32_t				index)
+{
+	uint8_t bit;
+
+	switch(index)
+	{
+		case VL53L8CX_DCI_ZONE_CONFIG:
+			bit = VL53L8CX_SHADOW_RESOLUTION;
+			break;
+		case VL53L8CX_DCI_FREQ_HZ:
+			bit = VL53L8CX_SHADOW_FREQ_HZ;
+			break;
+		case VL53L8CX_DCI_INT_TIME:
+			bit = VL53L8CX_SHADOW_INT_TIME;
+			break;
+		case VL53L8CX_DCI_SHARPENER:
+			bit = VL53L8CX_SHADOW_SHARPENER;
+			break;
+		case VL53L8CX_DCI_TARGET_ORDER:
+			bit = VL53L8CX_SHADOW_TARGET_ORDER;
+			break;
+		case VL53L8CX_DCI_RANGING_MODE:
+			bit = VL53L8CX_SHADOW_RANGING_MODE;
+			break;
+		default:
+			bit = 0;
+			break;
+	}
+
+	return bit;
+}
+
+/*
+ * Inner function, not available outside this file. This function validates a
+ * shadow field after a successful DCI access, and drops it after a failure as
+ * the sensor value is then unknown.
+ */
+
+static void _vl53l8cx_shadow_update(
+		VL53L8CX_Configuration	*p_dev,
+		uint8_t					status,
+		uint8_t					bit)
+{
+	if(status == VL53L8CX_STATUS_OK)
+	{
+		p_dev->dci_shadow.valid |= bit;
+	}
+	else
+	{
+		p_dev->dci_shadow.valid &= (uint8_t)~bit;
+	}
+}
+
 /*
  * Inner function, not available outside this file. This function is used to
  * wait for the MCU to boot.
@@ -96,12 +157,8 @@ static uint8_t _vl53l8cx_send_offset_data(
 		uint8_t						resolution)
 {
 	uint8_t status = VL53L8CX_STATUS_OK;
-	uint32_t signal_grid[64];
-	int16_t range_grid[64];
 	uint8_t dss_4x4[] = {0x0F, 0x04, 0x04, 0x00, 0x08, 0x10, 0x10, 0x07};
 	uint8_t footer[] = {0x00, 0x00, 0x00, 0x0F, 0x03, 0x01, 0x01, 0xE4};
-	int8_t i, j;
-	uint16_t k;
 
 	(void)memcpy(p_dev->temp_buffer,
                p_dev->offset_data, VL53L8CX_OFFSET_BUFFER_SIZE);
@@ -109,43 +166,13 @@ static uint8_t _vl53l8cx_send_offset_data(
 	/* Data extrapolation is required for 4X4 offset */
 	if(resolution == (uint8_t)VL53L8CX_RESOLUTION_4X4){
 		(void)memcpy(&(p_dev->temp_buffer[0x10]), dss_4x4, sizeof(dss_4x4));
-		VL53L8CX_SwapBuffer(p_dev->temp_buffer, VL53L8CX_OFFSET_BUFFER_SIZE);
-		(void)memcpy(signal_grid,&(p_dev->temp_buffer[0x3C]),
-			sizeof(signal_grid));
-		(void)memcpy(range_grid,&(p_dev->temp_buffer[0x140]),
-			sizeof(range_grid));
-
-		for (j = 0; j < (int8_t)4; j++)
-		{
-			for (i = 0; i < (int8_t)4 ; i++)
-			{
-				signal_grid[i+(4*j)] =
-				(signal_grid[(2*i)+(16*j)+ (int8_t)0]
-				+ signal_grid[(2*i)+(16*j)+(int8_t)1]
-				+ signal_grid[(2*i)+(16*j)+(int8_t)8]
-				+ signal_grid[(2*i)+(16*j)+(int8_t)9])
-                                  /(uint32_t)4;
-				range_grid[i+(4*j)] =
-				(range_grid[(2*i)+(16*j)]
-				+ range_grid[(2*i)+(16*j)+1]
-				+ range_grid[(2*i)+(16*j)+8]
-				+ range_grid[(2*i)+(16*j)+9])
-                                  /(int16_t)4;
-			}
-		}
-	    (void)memset(&range_grid[0x10], 0, (uint16_t)96);
-	    (void)memset(&signal_grid[0x10], 0, (uint16_t)192);
-            (void)memcpy(&(p_dev->temp_buffer[0x3C]),
-		signal_grid, sizeof(signal_grid));
-            (void)memcpy(&(p_dev->temp_buffer[0x140]),
-		range_grid, sizeof(range_grid));
-            VL53L8CX_SwapBuffer(p_dev->temp_buffer, VL53L8CX_OFFSET_BUFFER_SIZE);
+		/* Only the grids change, no need to swap the whole buffer */
+		VL53L8CX_Decimate4x4_u32(&(p_dev->temp_buffer[0x3C]));
+		VL53L8CX_Decimate4x4_i16(&(p_dev->temp_buffer[0x140]));
 	}
 
-	for(k = 0; k < (VL53L8CX_OFFSET_BUFFER_SIZE - (uint16_t)4); k++)
-	{
-		p_dev->temp_buffer[k] = p_dev->temp_buffer[k + (uint16_t)8];
-	}
+	(void)memmove(p_dev->temp_buffer, &(p_dev->temp_buffer[8]),
+		VL53L8CX_OFFSET_BUFFER_SIZE - (uint16_t)8);
 
 	(void)memcpy(&(p_dev->temp_buffer[0x1E0]), footer, 8);
 	status |= VL53L8CX_WrMulti(&(p_dev->platform), 0x2e18, p_dev->temp_buffer,
@@ -169,8 +196,6 @@ static uint8_t _vl53l8cx_send_xtalk_data(
 	uint8_t res4x4[] = {0x0F, 0x04, 0x04, 0x17, 0x08, 0x10, 0x10, 0x07};
 	uint8_t dss_4x4[] = {0x00, 0x78, 0x00, 0x08, 0x00, 0x00, 0x00, 0x08};
 	uint8_t profile_4x4[] = {0xA0, 0xFC, 0x01, 0x00};
-	uint32_t signal_grid[64];
-	int8_t i, j;
 
 	(void)memcpy(p_dev->temp_buffer, &(p_dev->xtalk_data[0]),
 		VL53L8CX_XTALK_BUFFER_SIZE);
@@ -183,25 +208,7 @@ static uint8_t _vl53l8cx_send_xtalk_data(
 		(void)memcpy(&(p_dev->temp_buffer[0x020]),
 			dss_4x4, sizeof(dss_4x4));
 
-		VL53L8CX_SwapBuffer(p_dev->temp_buffer, VL53L8CX_XTALK_BUFFER_SIZE);
-		(void)memcpy(signal_grid, &(p_dev->temp_buffer[0x34]),
-			sizeof(signal_grid));
-
-		for (j = 0; j < (int8_t)4; j++)
-		{
-			for (i = 0; i < (int8_t)4 ; i++)
-			{
-				signal_grid[i+(4*j)] =
-				(signal_grid[(2*i)+(16*j)+0]
-				+ signal_grid[(2*i)+(16*j)+1]
-				+ signal_grid[(2*i)+(16*j)+8]
-				+ signal_grid[(2*i)+(16*j)+9])/(uint32_t)4;
-			}
-		}
-	    (void)memset(&signal_grid[0x10], 0, (uint32_t)192);
-	    (void)memcpy(&(p_dev->temp_buffer[0x34]),
-                  signal_grid, sizeof(signal_grid));
-	    VL53L8CX_SwapBuffer(p_dev->temp_buffer, VL53L8CX_XTALK_BUFFER_SIZE);
+		VL53L8CX_Decimate4x4_u32(&(p_dev->temp_buffer[0x34]));
 	    (void)memcpy(&(p_dev->temp_buffer[0x134]),
 	    profile_4x4, sizeof(profile_4x4));
 	    (void)memset(&(p_dev->temp_buffer[0x078]),0 ,
@@ -216,6 +223,252 @@ static uint8_t _vl53l8cx_send_xtalk_data(
 	return status;
 }
 
+/**
+ * @brief Inner function, not available outside this file. This function sets
+ * the number of targets computed by the firmware. It computes two when a single
+ * one is sent, as in its default configuration.
+ */
+
+static uint8_t _vl53l8cx_send_fw_nb_target(
+		VL53L8CX_Configuration		*p_dev,
+		uint8_t				nb_target_per_zone)
+{
+	uint8_t fw_nb_target = nb_target_per_zone;
+
+	if(fw_nb_target == (uint8_t)1)
+	{
+		fw_nb_target = (uint8_t)2;
+	}
+
+	return vl53l8cx_dci_replace_data(p_dev, p_dev->temp_buffer,
+		VL53L8CX_DCI_FW_NB_TARGET, 16,
+	(uint8_t*)&fw_nb_target, 1, 0x0C);
+}
+
+/**
+ * @brief Inner function, not available outside this file. This function checks
+ * the firmware checksum, then sends the NVM offsets, the default Xtalk and the
+ * default configuration. It is the part of the init shared by the cold and the
+ * warm start.
+ */
+
+static uint8_t _vl53l8cx_configure_fw(
+		VL53L8CX_Configuration		*p_dev)
+{
+	uint8_t status = VL53L8CX_STATUS_OK;
+	uint8_t pipe_ctrl[] = {p_dev->nb_target_per_zone, 0x00, 0x01, 0x00};
+	uint32_t single_range = 0x01;
+	uint32_t crc_checksum = 0x00;
+
+	/* Firmware checksum */
+	status |= VL53L8CX_RdMulti(&(p_dev->platform), (uint16_t)(0x812FFC & 0xFFFF),
+			p_dev->temp_buffer, 4);
+	VL53L8CX_SwapBuffer(p_dev->temp_buffer, 4);
+	memcpy((uint8_t*)&crc_checksum, &(p_dev->temp_buffer[0]), 4);
+	if (crc_checksum != (uint32_t)0xc0b6c9e)
+	{
+		return status | VL53L8CX_STATUS_FW_CHECKSUM_FAIL;
+	}
+
+	/* Get offset NVM data and store them into the offset buffer. Offsets
+	 * the user restored from its own storage are kept if the range offsets
+	 * of the NVM match them, another module in the same slot is read in full
+	 * and its Xtalk is not the preloaded one either */
+	status |= VL53L8CX_WrMulti(&(p_dev->platform), 0x2fd8,
+		(uint8_t*)VL53L8CX_GET_NVM_CMD,
+		sizeof(VL53L8CX_GET_NVM_CMD));
+	status |= _vl53l8cx_poll_for_answer(p_dev, 4, 0,
+		VL53L8CX_UI_CMD_STATUS, 0xff, 2);
+	if(p_dev->offset_preloaded != (uint8_t)0)
+	{
+		status |= VL53L8CX_RdMulti(&(p_dev->platform),
+			VL53L8CX_UI_CMD_START + VL53L8CX_NVM_UNIT_START,
+			p_dev->temp_buffer, VL53L8CX_NVM_UNIT_SIZE);
+		if((status != (uint8_t)0) || (memcmp(p_dev->temp_buffer,
+			&(p_dev->offset_data[VL53L8CX_NVM_UNIT_START]),
+			VL53L8CX_NVM_UNIT_SIZE) != 0))
+		{
+			p_dev->offset_preloaded = 0;
+			p_dev->xtalk_preloaded = 0;
+		}
+	}
+	if(p_dev->offset_preloaded == (uint8_t)0)
+	{
+		status |= VL53L8CX_RdMulti(&(p_dev->platform),
+			VL53L8CX_UI_CMD_START, p_dev->temp_buffer,
+			VL53L8CX_NVM_DATA_SIZE);
+		(void)memcpy(p_dev->offset_data, p_dev->temp_buffer,
+			VL53L8CX_OFFSET_BUFFER_SIZE);
+	}
+	status |= _vl53l8cx_send_offset_data(p_dev, VL53L8CX_RESOLUTION_4X4);
+
+	/* Set default Xtalk shape, or keep the preloaded one. Send Xtalk to
+	 * sensor */
+	if(p_dev->xtalk_preloaded == (uint8_t)0)
+	{
+		(void)memcpy(p_dev->xtalk_data, (uint8_t*)VL53L8CX_DEFAULT_XTALK,
+			VL53L8CX_XTALK_BUFFER_SIZE);
+	}
+	status |= _vl53l8cx_send_xtalk_data(p_dev, VL53L8CX_RESOLUTION_4X4);
+
+	/* Send default configuration to VL53L8CX firmware */
+	status |= VL53L8CX_WrMulti(&(p_dev->platform), 0x2c34,
+		p_dev->default_configuration,
+		sizeof(VL53L8CX_DEFAULT_CONFIGURATION));
+	status |= _vl53l8cx_poll_for_answer(p_dev, 4, 1,
+		VL53L8CX_UI_CMD_STATUS, 0xff, 0x03);
+
+	status |= vl53l8cx_dci_write_data(p_dev, (uint8_t*)&pipe_ctrl,
+		VL53L8CX_DCI_PIPE_CONTROL, (uint16_t)sizeof(pipe_ctrl));
+#if VL53L8CX_NB_TARGET_PER_ZONE != 1
+	status |= _vl53l8cx_send_fw_nb_target(p_dev,
+		p_dev->nb_target_per_zone);
+#endif
+
+	status |= vl53l8cx_dci_write_data(p_dev, (uint8_t*)&single_range,
+			VL53L8CX_DCI_SINGLE_RANGE,
+			(uint16_t)sizeof(single_range));
+
+	return status;
+}
+
+/**
+ * @brief Inner function, not available outside this file. This function
+ * returns the outputs not disabled in the 'platform.h' file.
+ */
+
+static uint32_t _vl53l8cx_available_outputs(void)
+{
+	uint32_t outputs = 0;
+
+#ifndef VL53L8CX_DISABLE_AMBIENT_PER_SPAD
+	outputs |= VL53L8CX_OUTPUT_AMBIENT_PER_SPAD;
+#endif
+#ifndef VL53L8CX_DISABLE_NB_SPADS_ENABLED
+	outputs |= VL53L8CX_OUTPUT_NB_SPADS_ENABLED;
+#endif
+#ifndef VL53L8CX_DISABLE_NB_TARGET_DETECTED
+	outputs |= VL53L8CX_OUTPUT_NB_TARGET_DETECTED;
+#endif
+#ifndef VL53L8CX_DISABLE_SIGNAL_PER_SPAD
+	outputs |= VL53L8CX_OUTPUT_SIGNAL_PER_SPAD;
+#endif
+#ifndef VL53L8CX_DISABLE_RANGE_SIGMA_MM
+	outputs |= VL53L8CX_OUTPUT_RANGE_SIGMA_MM;
+#endif
+#ifndef VL53L8CX_DISABLE_DISTANCE_MM
+	outputs |= VL53L8CX_OUTPUT_DISTANCE_MM;
+#endif
+#ifndef VL53L8CX_DISABLE_REFLECTANCE_PERCENT
+	outputs |= VL53L8CX_OUTPUT_REFLECTANCE_PERCENT;
+#endif
+#ifndef VL53L8CX_DISABLE_TARGET_STATUS
+	outputs |= VL53L8CX_OUTPUT_TARGET_STATUS;
+#endif
+#ifndef VL53L8CX_DISABLE_MOTION_INDICATOR
+	outputs |= VL53L8CX_OUTPUT_MOTION_INDICATOR;
+#endif
+
+	return outputs;
+}
+
+/**
+ * @brief Inner function, not available outside this file. This function fills
+ * the list of possible outputs with the block sizes of the given resolution,
+ * the enables with the mandatory and the selected outputs, and returns the
+ * number of bytes read at each frame.
+ */
+
+static uint32_t _vl53l8cx_build_output(
+		VL53L8CX_Configuration		*p_dev,
+		uint8_t				resolution,
+		uint32_t			*p_output,
+		uint32_t			*p_output_bh_enable)
+{
+	uint32_t i, data_read_size = 0;
+	union Block_header *bh_ptr;
+
+	/* Addresses of possible output */
+	const uint32_t output[VL53L8CX_NB_OUTPUT_BH] = {VL53L8CX_START_BH,
+		VL53L8CX_METADATA_BH,
+		VL53L8CX_COMMONDATA_BH,
+		VL53L8CX_AMBIENT_RATE_BH,
+		VL53L8CX_SPAD_COUNT_BH,
+		VL53L8CX_NB_TARGET_DETECTED_BH,
+		VL53L8CX_SIGNAL_RATE_BH,
+		VL53L8CX_RANGE_SIGMA_MM_BH,
+		VL53L8CX_DISTANCE_BH,
+		VL53L8CX_REFLECTANCE_BH,
+		VL53L8CX_TARGET_STATUS_BH,
+		VL53L8CX_MOTION_DETECT_BH};
+#if VL53L8CX_NB_TARGET_PER_ZONE != 1
+	const uint32_t output_mt[VL53L8CX_NB_OUTPUT_BH] = {VL53L8CX_START_BH,
+		VL53L8CX_METADATA_BH,
+		VL53L8CX_COMMONDATA_BH,
+		VL53L8CX_AMBIENT_RATE_BH,
+		VL53L8CX_SPAD_COUNT_BH,
+		VL53L8CX_MT_NB_TARGET_DETECTED_BH,
+		VL53L8CX_MT_SIGNAL_RATE_BH,
+		VL53L8CX_MT_RANGE_SIGMA_MM_BH,
+		VL53L8CX_MT_DISTANCE_BH,
+		VL53L8CX_MT_REFLECTANCE_BH,
+		VL53L8CX_MT_TARGET_STATUS_BH,
+		VL53L8CX_MT_MOTION_DETECT_BH};
+
+	if(p_dev->nb_target_per_zone > (uint8_t)1)
+	{
+		(void)memcpy(p_output, output_mt, sizeof(output_mt));
+	}
+	else
+#endif
+	{
+		(void)memcpy(p_output, output, sizeof(output));
+	}
+
+	/* Enable mandatory output (meta and common data) and the selected ones */
+	p_output_bh_enable[0] = 0x00000007U | (p_dev->output_enable
+			& _vl53l8cx_available_outputs());
+	p_output_bh_enable[1] = 0x00000000U;
+	p_output_bh_enable[2] = 0x00000000U;
+	p_output_bh_enable[3] = 0xC0000000U;
+
+	/* Update data size */
+	for (i = 0; i < (uint32_t)VL53L8CX_NB_OUTPUT_BH; i++)
+	{
+		if ((p_output[i] == (uint8_t)0) 
+                    || ((p_output_bh_enable[i/(uint32_t)32]
+                         &((uint32_t)1 << (i%(uint32_t)32))) == (uint32_t)0))
+		{
+			continue;
+		}
+
+		bh_ptr = (union Block_header *)&(p_output[i]);
+		if (((uint8_t)bh_ptr->type >= (uint8_t)0x1) 
+                    && ((uint8_t)bh_ptr->type < (uint8_t)0x0d))
+		{
+			if ((bh_ptr->idx >= (uint16_t)0x54d0) 
+                            && (bh_ptr->idx < (uint16_t)(0x54d0 + 960)))
+			{
+				bh_ptr->size = resolution;
+			}
+			else
+			{
+				bh_ptr->size = (uint16_t)((uint16_t)resolution
+                                  * (uint16_t)p_dev->nb_target_per_zone);
+			}
+			data_read_size += bh_ptr->type * bh_ptr->size;
+		}
+		else
+		{
+			data_read_size += bh_ptr->size;
+		}
+		data_read_size += (uint32_t)4;
+	}
+	data_read_size += (uint32_t)24;
+
+	return data_read_size;
+}
+
 uint8_t vl53l8cx_is_alive(
 		VL53L8CX_Configuration		*p_dev,
 		uint8_t				*p_is_alive)
@@ -244,13 +497,14 @@ uint8_t vl53l8cx_init(
 		VL53L8CX_Configuration		*p_dev)
 {
 	uint8_t tmp, status = VL53L8CX_STATUS_OK;
-	uint8_t pipe_ctrl[] = {VL53L8CX_NB_TARGET_PER_ZONE, 0x00, 0x01, 0x00};
-	uint32_t single_range = 0x01;
-	uint32_t crc_checksum = 0x00;
 
 	p_dev->default_xtalk = (uint8_t*)VL53L8CX_DEFAULT_XTALK;
 	p_dev->default_configuration = (uint8_t*)VL53L8CX_DEFAULT_CONFIGURATION;
 	p_dev->is_auto_stop_enabled = (uint8_t)0x0;
+	p_dev->output_enable = _vl53l8cx_available_outputs();
+	/* The default configuration is sent again, forget the shadow */
+	p_dev->dci_shadow.valid = 0;
+	p_dev->nb_target_per_zone = (uint8_t)VL53L8CX_NB_TARGET_PER_ZONE;
 
 	/* SW reboot sequence */
 	status |= VL53L8CX_WrByte(&(p_dev->platform), 0x7fff, 0x00);
@@ -356,55 +610,29 @@ uint8_t vl53l8cx_init(
 	}
 
 	status |= VL53L8CX_WrByte(&(p_dev->platform), 0x7fff, 0x02);
+	status |= _vl53l8cx_configure_fw(p_dev);
 
-	/* Firmware checksum */
-	status |= VL53L8CX_RdMulti(&(p_dev->platform), (uint16_t)(0x812FFC & 0xFFFF),
-			p_dev->temp_buffer, 4);
-	VL53L8CX_SwapBuffer(p_dev->temp_buffer, 4);
-	memcpy((uint8_t*)&crc_checksum, &(p_dev->temp_buffer[0]), 4);
-	if (crc_checksum != (uint32_t)0xc0b6c9e)
-	{
-		status |= VL53L8CX_STATUS_FW_CHECKSUM_FAIL;
-		goto exit;
-	}
-
-	/* Get offset NVM data and store them into the offset buffer */
-	status |= VL53L8CX_WrMulti(&(p_dev->platform), 0x2fd8,
-		(uint8_t*)VL53L8CX_GET_NVM_CMD, sizeof(VL53L8CX_GET_NVM_CMD));
-	status |= _vl53l8cx_poll_for_answer(p_dev, 4, 0,
-		VL53L8CX_UI_CMD_STATUS, 0xff, 2);
-	status |= VL53L8CX_RdMulti(&(p_dev->platform), VL53L8CX_UI_CMD_START,
-		p_dev->temp_buffer, VL53L8CX_NVM_DATA_SIZE);
-	(void)memcpy(p_dev->offset_data, p_dev->temp_buffer,
-		VL53L8CX_OFFSET_BUFFER_SIZE);
-	status |= _vl53l8cx_send_offset_data(p_dev, VL53L8CX_RESOLUTION_4X4);
-
-	/* Set default Xtalk shape. Send Xtalk to sensor */
-	(void)memcpy(p_dev->xtalk_data, (uint8_t*)VL53L8CX_DEFAULT_XTALK,
-		VL53L8CX_XTALK_BUFFER_SIZE);
-	status |= _vl53l8cx_send_xtalk_data(p_dev, VL53L8CX_RESOLUTION_4X4);
+exit:
+	return status;
+}
 
-	/* Send default configuration to VL53L8CX firmware */
-	status |= VL53L8CX_WrMulti(&(p_dev->platform), 0x2c34,
-		p_dev->default_configuration,
-		sizeof(VL53L8CX_DEFAULT_CONFIGURATION));
-	status |= _vl53l8cx_poll_for_answer(p_dev, 4, 1,
-		VL53L8CX_UI_CMD_STATUS, 0xff, 0x03);
+uint8_t vl53l8cx_init_warm(
+		VL53L8CX_Configuration		*p_dev)
+{
+	uint8_t status = VL53L8CX_STATUS_OK;
 
-	status |= vl53l8cx_dci_write_data(p_dev, (uint8_t*)&pipe_ctrl,
-		VL53L8CX_DCI_PIPE_CONTROL, (uint16_t)sizeof(pipe_ctrl));
-#if VL53L8CX_NB_TARGET_PER_ZONE != 1
-	tmp = VL53L8CX_NB_TARGET_PER_ZONE;
-	status |= vl53l8cx_dci_replace_data(p_dev, p_dev->temp_buffer,
-		VL53L8CX_DCI_FW_NB_TARGET, 16,
-	(uint8_t*)&tmp, 1, 0x0C);
-#endif
+	p_dev->default_xtalk = (uint8_t*)VL53L8CX_DEFAULT_XTALK;
+	p_dev->default_configuration = (uint8_t*)VL53L8CX_DEFAULT_CONFIGURATION;
+	p_dev->is_auto_stop_enabled = (uint8_t)0x0;
+	p_dev->output_enable = _vl53l8cx_available_outputs();
+	/* The default configuration is sent again, forget the shadow */
+	p_dev->dci_shadow.valid = 0;
+	p_dev->nb_target_per_zone = (uint8_t)VL53L8CX_NB_TARGET_PER_ZONE;
 
-	status |= vl53l8cx_dci_write_data(p_dev, (uint8_t*)&single_range,
-			VL53L8CX_DCI_SINGLE_RANGE,
-			(uint16_t)sizeof(single_range));
+	/* The checksum is only readable while the firmware is loaded and idle */
+	status |= VL53L8CX_WrByte(&(p_dev->platform), 0x7fff, 0x02);
+	status |= _vl53l8cx_configure_fw(p_dev);
 
-exit:
 	return status;
 }
 
@@ -511,111 +739,107 @@ uint8_t vl53l8cx_set_power_mode(
 	return status;
 }
 
-uint8_t vl53l8cx_start_ranging(
-		VL53L8CX_Configuration		*p_dev)
+uint8_t vl53l8cx_set_output_enable(
+		VL53L8CX_Configuration		*p_dev,
+		uint32_t			output_enable)
 {
-	uint8_t resolution, status = VL53L8CX_STATUS_OK;
-	uint16_t tmp;
-	uint32_t i;
-	uint32_t header_config[2] = {0, 0};
+	uint8_t status = VL53L8CX_STATUS_OK;
 
-	union Block_header *bh_ptr;
-	uint8_t cmd[] = {0x00, 0x03, 0x00, 0x00};
+	if((output_enable & ~_vl53l8cx_available_outputs()) != (uint32_t)0)
+	{
+		status = VL53L8CX_STATUS_INVALID_PARAM;
+	}
+	else
+	{
+		p_dev->output_enable = output_enable;
+	}
 
-	status |= vl53l8cx_get_resolution(p_dev, &resolution);
-	p_dev->data_read_size = 0;
-	p_dev->streamcount = 255;
+	return status;
+}
 
-	/* Enable mandatory output (meta and common data) */
-	uint32_t output_bh_enable[] = {
-		0x00000007U,
-		0x00000000U,
-		0x00000000U,
-		0xC0000000U};
+uint8_t vl53l8cx_get_output_enable(
+		VL53L8CX_Configuration		*p_dev,
+		uint32_t			*p_output_enable)
+{
+	*p_output_enable = p_dev->output_enable;
 
-	/* Send addresses of possible output */
-	uint32_t output[] ={VL53L8CX_START_BH,
-		VL53L8CX_METADATA_BH,
-		VL53L8CX_COMMONDATA_BH,
-		VL53L8CX_AMBIENT_RATE_BH,
-		VL53L8CX_SPAD_COUNT_BH,
-		VL53L8CX_NB_TARGET_DETECTED_BH,
-		VL53L8CX_SIGNAL_RATE_BH,
-		VL53L8CX_RANGE_SIGMA_MM_BH,
-		VL53L8CX_DISTANCE_BH,
-		VL53L8CX_REFLECTANCE_BH,
-		VL53L8CX_TARGET_STATUS_BH,
-		VL53L8CX_MOTION_DETECT_BH};
+	return VL53L8CX_STATUS_OK;
+}
 
-	/* Enable selected outputs in the 'platform.h' file */
-#ifndef VL53L8CX_DISABLE_AMBIENT_PER_SPAD
-	output_bh_enable[0] += (uint32_t)8;
-#endif
-#ifndef VL53L8CX_DISABLE_NB_SPADS_ENABLED
-	output_bh_enable[0] += (uint32_t)16;
-#endif
-#ifndef VL53L8CX_DISABLE_NB_TARGET_DETECTED
-	output_bh_enable[0] += (uint32_t)32;
-#endif
-#ifndef VL53L8CX_DISABLE_SIGNAL_PER_SPAD
-	output_bh_enable[0] += (uint32_t)64;
-#endif
-#ifndef VL53L8CX_DISABLE_RANGE_SIGMA_MM
-	output_bh_enable[0] += (uint32_t)128;
-#endif
-#ifndef VL53L8CX_DISABLE_DISTANCE_MM
-	output_bh_enable[0] += (uint32_t)256;
-#endif
-#ifndef VL53L8CX_DISABLE_REFLECTANCE_PERCENT
-	output_bh_enable[0] += (uint32_t)512;
-#endif
-#ifndef VL53L8CX_DISABLE_TARGET_STATUS
-	output_bh_enable[0] += (uint32_t)1024;
-#endif
-#ifndef VL53L8CX_DISABLE_MOTION_INDICATOR
-	output_bh_enable[0] += (uint32_t)2048;
-#endif
+uint8_t vl53l8cx_set_nb_target_per_zone(
+		VL53L8CX_Configuration		*p_dev,
+		uint8_t				nb_target_per_zone)
+{
+	uint8_t status = VL53L8CX_STATUS_OK;
+	uint8_t nb_target = nb_target_per_zone;
 
-	/* Update data size */
-	for (i = 0; i < (uint32_t)(sizeof(output)/sizeof(uint32_t)); i++)
+	if((nb_target < (uint8_t)1)
+		|| (nb_target > (uint8_t)VL53L8CX_NB_TARGET_PER_ZONE))
 	{
-		if ((output[i] == (uint8_t)0) 
-                    || ((output_bh_enable[i/(uint32_t)32]
-                         &((uint32_t)1 << (i%(uint32_t)32))) == (uint32_t)0))
-		{
-			continue;
-		}
-
-		bh_ptr = (union Block_header *)&(output[i]);
-		if (((uint8_t)bh_ptr->type >= (uint8_t)0x1) 
-                    && ((uint8_t)bh_ptr->type < (uint8_t)0x0d))
-		{
-			if ((bh_ptr->idx >= (uint16_t)0x54d0) 
-                            && (bh_ptr->idx < (uint16_t)(0x54d0 + 960)))
-			{
-				bh_ptr->size = resolution;
-			}
-			else
-			{
-				bh_ptr->size = (uint16_t)((uint16_t)resolution
-                                  * (uint16_t)VL53L8CX_NB_TARGET_PER_ZONE);
-			}
-			p_dev->data_read_size += bh_ptr->type * bh_ptr->size;
-		}
-		else
+		status = VL53L8CX_STATUS_INVALID_PARAM;
+	}
+	else
+	{
+		status |= vl53l8cx_dci_replace_data(p_dev, p_dev->temp_buffer,
+			VL53L8CX_DCI_PIPE_CONTROL, 4,
+		(uint8_t*)&nb_target, 1, 0x00);
+		status |= _vl53l8cx_send_fw_nb_target(p_dev, nb_target);
+		if(status == VL53L8CX_STATUS_OK)
 		{
-			p_dev->data_read_size += bh_ptr->size;
+			p_dev->nb_target_per_zone = nb_target;
 		}
-		p_dev->data_read_size += (uint32_t)4;
 	}
-	p_dev->data_read_size += (uint32_t)24;
+
+	return status;
+}
+
+uint8_t vl53l8cx_get_nb_target_per_zone(
+		VL53L8CX_Configuration		*p_dev,
+		uint8_t				*p_nb_target_per_zone)
+{
+	*p_nb_target_per_zone = p_dev->nb_target_per_zone;
+
+	return VL53L8CX_STATUS_OK;
+}
+
+uint8_t vl53l8cx_get_output_size(
+		VL53L8CX_Configuration		*p_dev,
+		uint32_t			*p_data_read_size)
+{
+	uint8_t resolution, status = VL53L8CX_STATUS_OK;
+	uint32_t output[VL53L8CX_NB_OUTPUT_BH];
+	uint32_t output_bh_enable[4];
+
+	status |= vl53l8cx_get_resolution(p_dev, &resolution);
+	*p_data_read_size = _vl53l8cx_build_output(p_dev, resolution,
+			output, output_bh_enable);
+
+	return status;
+}
+
+uint8_t vl53l8cx_start_ranging(
+		VL53L8CX_Configuration		*p_dev)
+{
+	uint8_t resolution, status = VL53L8CX_STATUS_OK;
+	uint16_t tmp;
+	uint32_t header_config[2] = {0, 0};
+	uint32_t output[VL53L8CX_NB_OUTPUT_BH];
+	uint32_t output_bh_enable[4];
+	uint8_t cmd[] = {0x00, 0x03, 0x00, 0x00};
+
+	status |= vl53l8cx_get_resolution(p_dev, &resolution);
+	p_dev->streamcount = 255;
+
+	/* Send addresses of possible output, and enable the selected ones */
+	p_dev->data_read_size = _vl53l8cx_build_output(p_dev, resolution,
+			output, output_bh_enable);
 
 	status |= vl53l8cx_dci_write_data(p_dev,
 			(uint8_t*)&(output), VL53L8CX_DCI_OUTPUT_LIST,
 			(uint16_t)sizeof(output));
 
 	header_config[0] = p_dev->data_read_size;
-	header_config[1] = i + (uint32_t)1;
+	header_config[1] = (uint32_t)VL53L8CX_NB_OUTPUT_BH + (uint32_t)1;
 
 	status |= vl53l8cx_dci_write_data(p_dev,
 			(uint8_t*)&(header_config), VL53L8CX_DCI_OUTPUT_CONFIG,
@@ -678,10 +902,15 @@ uint8_t vl53l8cx_stop_ranging(
 	        while(((tmp & (uint8_t)0x80) >> 7) == (uint8_t)0x00)
 	        {
 	        	status |= VL53L8CX_RdByte(&(p_dev->platform), 0x6, &tmp);
-	        	status |= VL53L8CX_WaitMs(&(p_dev->platform), 10);
+	        	if((tmp & (uint8_t)0x80) != (uint8_t)0)
+	        	{
+	        		break;
+	        	}
+	        	status |= VL53L8CX_WaitMs(&(p_dev->platform),
+	        			VL53L8CX_POLL_PERIOD_MS);
 	        	timeout++;	/* Timeout reached after 5 seconds */
 
-	        	if(timeout > (uint16_t)500)
+	        	if(timeout > (uint16_t)(5000U / VL53L8CX_POLL_PERIOD_MS))
 				{
 					status |= tmp;
 					break;
@@ -746,11 +975,30 @@ uint8_t vl53l8cx_get_ranging_data(
 		VL53L8CX_ResultsData		*p_results)
 {
 	uint8_t status = VL53L8CX_STATUS_OK;
+
+	status |= VL53L8CX_RdMulti(&(p_dev->platform), 0x0,
+			p_dev->temp_buffer, p_dev->data_read_size);
+	status |= vl53l8cx_parse_ranging_data(p_dev, p_results);
+
+	return status;
+}
+
+uint8_t vl53l8cx_start_ranging_data(
+		VL53L8CX_Configuration		*p_dev)
+{
+	return VL53L8CX_RdMultiAsync(&(p_dev->platform), 0x0,
+			p_dev->temp_buffer, p_dev->data_read_size);
+}
+
+uint8_t vl53l8cx_parse_ranging_data(
+		VL53L8CX_Configuration		*p_dev,
+		VL53L8CX_ResultsData		*p_results)
+{
+	uint8_t status = VL53L8CX_STATUS_OK;
 	uint16_t header_id, footer_id;
 	union Block_header *bh_ptr;
 	uint32_t i, j, msize;
-	status |= VL53L8CX_RdMulti(&(p_dev->platform), 0x0,
-			p_dev->temp_buffer, p_dev->data_read_size);
+
 	p_dev->streamcount = p_dev->temp_buffer[0];
 	VL53L8CX_SwapBuffer(p_dev->temp_buffer, (uint16_t)p_dev->data_read_size);
 
@@ -789,42 +1037,63 @@ uint8_t vl53l8cx_get_ranging_data(
 #endif
 #ifndef VL53L8CX_DISABLE_NB_TARGET_DETECTED
 			case VL53L8CX_NB_TARGET_DETECTED_IDX:
+#if VL53L8CX_NB_TARGET_PER_ZONE != 1
+			case VL53L8CX_MT_NB_TARGET_DETECTED_IDX:
+#endif
 				(void)memcpy(p_results->nb_target_detected,
 				&(p_dev->temp_buffer[i + (uint32_t)4]), msize);
 				break;
 #endif
 #ifndef VL53L8CX_DISABLE_SIGNAL_PER_SPAD
 			case VL53L8CX_SIGNAL_RATE_IDX:
+#if VL53L8CX_NB_TARGET_PER_ZONE != 1
+			case VL53L8CX_MT_SIGNAL_RATE_IDX:
+#endif
 				(void)memcpy(p_results->signal_per_spad,
 				&(p_dev->temp_buffer[i + (uint32_t)4]), msize);
 				break;
 #endif
 #ifndef VL53L8CX_DISABLE_RANGE_SIGMA_MM
 			case VL53L8CX_RANGE_SIGMA_MM_IDX:
+#if VL53L8CX_NB_TARGET_PER_ZONE != 1
+			case VL53L8CX_MT_RANGE_SIGMA_MM_IDX:
+#endif
 				(void)memcpy(p_results->range_sigma_mm,
 				&(p_dev->temp_buffer[i + (uint32_t)4]), msize);
 				break;
 #endif
 #ifndef VL53L8CX_DISABLE_DISTANCE_MM
 			case VL53L8CX_DISTANCE_IDX:
+#if VL53L8CX_NB_TARGET_PER_ZONE != 1
+			case VL53L8CX_MT_DISTANCE_IDX:
+#endif
 				(void)memcpy(p_results->distance_mm,
 				&(p_dev->temp_buffer[i + (uint32_t)4]), msize);
 				break;
 #endif
 #ifndef VL53L8CX_DISABLE_REFLECTANCE_PERCENT
 			case VL53L8CX_REFLECTANCE_EST_PC_IDX:
+#if VL53L8CX_NB_TARGET_PER_ZONE != 1
+			case VL53L8CX_MT_REFLECTANCE_EST_PC_IDX:
+#endif
 				(void)memcpy(p_results->reflectance,
 				&(p_dev->temp_buffer[i + (uint32_t)4]), msize);
 				break;
 #endif
 #ifndef VL53L8CX_DISABLE_TARGET_STATUS
 			case VL53L8CX_TARGET_STATUS_IDX:
+#if VL53L8CX_NB_TARGET_PER_ZONE != 1
+			case VL53L8CX_MT_TARGET_STATUS_IDX:
+#endif
 				(void)memcpy(p_results->target_status,
 				&(p_dev->temp_buffer[i + (uint32_t)4]), msize);
 				break;
 #endif
 #ifndef VL53L8CX_DISABLE_MOTION_INDICATOR
 			case VL53L8CX_MOTION_DETEC_IDX:
+#if VL53L8CX_NB_TARGET_PER_ZONE != 1
+			case VL53L8CX_MT_MOTION_DETEC_IDX:
+#endif
 				(void)memcpy(&p_results->motion_indicator,
 				&(p_dev->temp_buffer[i + (uint32_t)4]), msize);
 				break;
@@ -868,11 +1137,11 @@ uint8_t vl53l8cx_get_ranging_data(
 	{
 		if(p_results->nb_target_detected[i] == (uint8_t)0){
 			for(j = 0; j < (uint32_t)
-				VL53L8CX_NB_TARGET_PER_ZONE; j++)
+				p_dev->nb_target_per_zone; j++)
 			{
 #ifndef VL53L8CX_DISABLE_TARGET_STATUS
 				p_results->target_status
-				[((uint32_t)VL53L8CX_NB_TARGET_PER_ZONE
+				[((uint32_t)p_dev->nb_target_per_zone
 					*(uint32_t)i) + j]=(uint8_t)255;
 #endif
 			}
@@ -913,9 +1182,16 @@ uint8_t vl53l8cx_get_resolution(
 {
 	uint8_t status = VL53L8CX_STATUS_OK;
 
-	status |= vl53l8cx_dci_read_data(p_dev, p_dev->temp_buffer,
-			VL53L8CX_DCI_ZONE_CONFIG, 8);
-	*p_resolution = p_dev->temp_buffer[0x00]*p_dev->temp_buffer[0x01];
+	if((p_dev->dci_shadow.valid & VL53L8CX_SHADOW_RESOLUTION) == (uint8_t)0)
+	{
+		status |= vl53l8cx_dci_read_data(p_dev, p_dev->temp_buffer,
+				VL53L8CX_DCI_ZONE_CONFIG, 8);
+		p_dev->dci_shadow.resolution = p_dev->temp_buffer[0x00]
+				*p_dev->temp_buffer[0x01];
+		_vl53l8cx_shadow_update(p_dev, status,
+				VL53L8CX_SHADOW_RESOLUTION);
+	}
+	*p_resolution = p_dev->dci_shadow.resolution;
 
 	return status;
 }
@@ -984,6 +1260,9 @@ uint8_t vl53l8cx_set_resolution(
 	status |= _vl53l8cx_send_offset_data(p_dev, resolution);
 	status |= _vl53l8cx_send_xtalk_data(p_dev, resolution);
 
+	p_dev->dci_shadow.resolution = resolution;
+	_vl53l8cx_shadow_update(p_dev, status, VL53L8CX_SHADOW_RESOLUTION);
+
 	return status;
 }
 
@@ -993,9 +1272,15 @@ uint8_t vl53l8cx_get_ranging_frequency_hz(
 {
 	uint8_t status = VL53L8CX_STATUS_OK;
 
-	status |= vl53l8cx_dci_read_data(p_dev, (uint8_t*)p_dev->temp_buffer,
-			VL53L8CX_DCI_FREQ_HZ, 4);
-	*p_frequency_hz = p_dev->temp_buffer[0x01];
+	if((p_dev->dci_shadow.valid & VL53L8CX_SHADOW_FREQ_HZ) == (uint8_t)0)
+	{
+		status |= vl53l8cx_dci_read_data(p_dev,
+				(uint8_t*)p_dev->temp_buffer,
+				VL53L8CX_DCI_FREQ_HZ, 4);
+		p_dev->dci_shadow.frequency_hz = p_dev->temp_buffer[0x01];
+		_vl53l8cx_shadow_update(p_dev, status, VL53L8CX_SHADOW_FREQ_HZ);
+	}
+	*p_frequency_hz = p_dev->dci_shadow.frequency_hz;
 
 	return status;
 }
@@ -1010,6 +1295,9 @@ uint8_t vl53l8cx_set_ranging_frequency_hz(
 					VL53L8CX_DCI_FREQ_HZ, 4,
 					(uint8_t*)&frequency_hz, 1, 0x01);
 
+	p_dev->dci_shadow.frequency_hz = frequency_hz;
+	_vl53l8cx_shadow_update(p_dev, status, VL53L8CX_SHADOW_FREQ_HZ);
+
 	return status;
 }
 
@@ -1019,11 +1307,17 @@ uint8_t vl53l8cx_get_integration_time_ms(
 {
 	uint8_t status = VL53L8CX_STATUS_OK;
 
-	status |= vl53l8cx_dci_read_data(p_dev, (uint8_t*)p_dev->temp_buffer,
-			VL53L8CX_DCI_INT_TIME, 20);
-
-	(void)memcpy(p_time_ms, &(p_dev->temp_buffer[0x0]), 4);
-	*p_time_ms /= (uint32_t)1000;
+	if((p_dev->dci_shadow.valid & VL53L8CX_SHADOW_INT_TIME) == (uint8_t)0)
+	{
+		status |= vl53l8cx_dci_read_data(p_dev,
+				(uint8_t*)p_dev->temp_buffer,
+				VL53L8CX_DCI_INT_TIME, 20);
+		(void)memcpy(&(p_dev->dci_shadow.integration_time_ms),
+				&(p_dev->temp_buffer[0x0]), 4);
+		p_dev->dci_shadow.integration_time_ms /= (uint32_t)1000;
+		_vl53l8cx_shadow_update(p_dev, status, VL53L8CX_SHADOW_INT_TIME);
+	}
+	*p_time_ms = p_dev->dci_shadow.integration_time_ms;
 
 	return status;
 }
@@ -1047,6 +1341,9 @@ uint8_t vl53l8cx_set_integration_time_ms(
 		status |= vl53l8cx_dci_replace_data(p_dev, p_dev->temp_buffer,
 				VL53L8CX_DCI_INT_TIME, 20,
 				(uint8_t*)&integration, 4, 0x00);
+
+		p_dev->dci_shadow.integration_time_ms = integration_time_ms;
+		_vl53l8cx_shadow_update(p_dev, status, VL53L8CX_SHADOW_INT_TIME);
 	}
 
 	return status;
@@ -1058,10 +1355,15 @@ uint8_t vl53l8cx_get_sharpener_percent(
 {
 	uint8_t status = VL53L8CX_STATUS_OK;
 
-	status |= vl53l8cx_dci_read_data(p_dev,p_dev->temp_buffer,
-			VL53L8CX_DCI_SHARPENER, 16);
+	if((p_dev->dci_shadow.valid & VL53L8CX_SHADOW_SHARPENER) == (uint8_t)0)
+	{
+		status |= vl53l8cx_dci_read_data(p_dev,p_dev->temp_buffer,
+				VL53L8CX_DCI_SHARPENER, 16);
+		p_dev->dci_shadow.sharpener = p_dev->temp_buffer[0xD];
+		_vl53l8cx_shadow_update(p_dev, status, VL53L8CX_SHADOW_SHARPENER);
+	}
 
-	*p_sharpener_percent = (p_dev->temp_buffer[0xD]
+	*p_sharpener_percent = (p_dev->dci_shadow.sharpener
                                 *(uint8_t)100)/(uint8_t)255;
 
 	return status;
@@ -1084,6 +1386,9 @@ uint8_t vl53l8cx_set_sharpener_percent(
 		status |= vl53l8cx_dci_replace_data(p_dev, p_dev->temp_buffer,
 				VL53L8CX_DCI_SHARPENER, 16,
                                 (uint8_t*)&sharpener, 1, 0xD);
+
+		p_dev->dci_shadow.sharpener = sharpener;
+		_vl53l8cx_shadow_update(p_dev, status, VL53L8CX_SHADOW_SHARPENER);
 	}
 
 	return status;
@@ -1095,9 +1400,18 @@ uint8_t vl53l8cx_get_target_order(
 {
 	uint8_t status = VL53L8CX_STATUS_OK;
 
-	status |= vl53l8cx_dci_read_data(p_dev, (uint8_t*)p_dev->temp_buffer,
-			VL53L8CX_DCI_TARGET_ORDER, 4);
-	*p_target_order = (uint8_t)p_dev->temp_buffer[0x0];
+	if((p_dev->dci_shadow.valid & VL53L8CX_SHADOW_TARGET_ORDER)
+		== (uint8_t)0)
+	{
+		status |= vl53l8cx_dci_read_data(p_dev,
+				(uint8_t*)p_dev->temp_buffer,
+				VL53L8CX_DCI_TARGET_ORDER, 4);
+		p_dev->dci_shadow.target_order =
+				(uint8_t)p_dev->temp_buffer[0x0];
+		_vl53l8cx_shadow_update(p_dev, status,
+				VL53L8CX_SHADOW_TARGET_ORDER);
+	}
+	*p_target_order = p_dev->dci_shadow.target_order;
 
 	return status;
 }
@@ -1114,6 +1428,10 @@ uint8_t vl53l8cx_set_target_order(
 		status |= vl53l8cx_dci_replace_data(p_dev, p_dev->temp_buffer,
 				VL53L8CX_DCI_TARGET_ORDER, 4,
                                 (uint8_t*)&target_order, 1, 0x0);
+
+		p_dev->dci_shadow.target_order = target_order;
+		_vl53l8cx_shadow_update(p_dev, status,
+				VL53L8CX_SHADOW_TARGET_ORDER);
 	}else
 	{
 		status |= VL53L8CX_STATUS_INVALID_PARAM;
@@ -1128,17 +1446,26 @@ uint8_t vl53l8cx_get_ranging_mode(
 {
 	uint8_t status = VL53L8CX_STATUS_OK;
 
-	status |= vl53l8cx_dci_read_data(p_dev, p_dev->temp_buffer,
-			VL53L8CX_DCI_RANGING_MODE, 8);
-
-	if(p_dev->temp_buffer[0x01] == (uint8_t)0x1)
+	if((p_dev->dci_shadow.valid & VL53L8CX_SHADOW_RANGING_MODE)
+		== (uint8_t)0)
 	{
-		*p_ranging_mode = VL53L8CX_RANGING_MODE_CONTINUOUS;
-	}
-	else
-	{
-		*p_ranging_mode = VL53L8CX_RANGING_MODE_AUTONOMOUS;
+		status |= vl53l8cx_dci_read_data(p_dev, p_dev->temp_buffer,
+				VL53L8CX_DCI_RANGING_MODE, 8);
+
+		if(p_dev->temp_buffer[0x01] == (uint8_t)0x1)
+		{
+			p_dev->dci_shadow.ranging_mode =
+				VL53L8CX_RANGING_MODE_CONTINUOUS;
+		}
+		else
+		{
+			p_dev->dci_shadow.ranging_mode =
+				VL53L8CX_RANGING_MODE_AUTONOMOUS;
+		}
+		_vl53l8cx_shadow_update(p_dev, status,
+				VL53L8CX_SHADOW_RANGING_MODE);
 	}
+	*p_ranging_mode = p_dev->dci_shadow.ranging_mode;
 
 	return status;
 }
@@ -1179,6 +1506,9 @@ uint8_t vl53l8cx_set_ranging_mode(
 			VL53L8CX_DCI_SINGLE_RANGE,
                         (uint16_t)sizeof(single_range));
 
+	p_dev->dci_shadow.ranging_mode = ranging_mode;
+	_vl53l8cx_shadow_update(p_dev, status, VL53L8CX_SHADOW_RANGING_MODE);
+
 	return status;
 }
 
@@ -1265,7 +1595,6 @@ uint8_t vl53l8cx_dci_read_data(
 		uint32_t			index,
 		uint16_t			data_size)
 {
-	int16_t i;
 	uint8_t status = VL53L8CX_STATUS_OK;
         uint32_t rd_size = (uint32_t) data_size + (uint32_t)12;
 	uint8_t cmd[] = {0x00, 0x00, 0x00, 0x00,
@@ -1296,10 +1625,9 @@ uint8_t vl53l8cx_dci_read_data(
 			p_dev->temp_buffer, rd_size);
 		VL53L8CX_SwapBuffer(p_dev->temp_buffer, data_size + (uint16_t)12);
 
-	/* Copy data from FW into input structure (-4 bytes to remove header) */
-		for(i = 0 ; i < (int16_t)data_size;i++){
-			data[i] = p_dev->temp_buffer[i + 4];
-		}
+	/* Copy data from FW into input structure (-4 bytes to remove header),
+	 * data may be temp_buffer itself */
+		(void)memmove(data, &(p_dev->temp_buffer[4]), data_size);
 	}
 
 	return status;
@@ -1312,7 +1640,6 @@ uint8_t vl53l8cx_dci_write_data(
 		uint16_t			data_size)
 {
 	uint8_t status = VL53L8CX_STATUS_OK;
-	int16_t i;
 
 	uint8_t headers[] = {0x00, 0x00, 0x00, 0x00};
 	uint8_t footer[] = {0x00, 0x00, 0x00, 0x0f, 0x05, 0x01,
@@ -1337,16 +1664,16 @@ uint8_t vl53l8cx_dci_write_data(
 
 	/* Copy data from structure to FW format (+4 bytes to add header) */
 		VL53L8CX_SwapBuffer(data, data_size);
-		for(i = (int16_t)data_size - (int16_t)1 ; i >= 0; i--)
-		{
-			p_dev->temp_buffer[i + 4] = data[i];
-		}
+		(void)memmove(&(p_dev->temp_buffer[4]), data, data_size);
 
 	/* Add headers and footer */
 		(void)memcpy(&p_dev->temp_buffer[0], headers, sizeof(headers));
 		(void)memcpy(&p_dev->temp_buffer[data_size + (uint16_t)4],
 			footer, sizeof(footer));
 
+	/* The setting may differ from its shadow from now on */
+		p_dev->dci_shadow.valid &= (uint8_t)~_vl53l8cx_shadow_bit(index);
+
 	/* Send data to FW */
 		status |= VL53L8CX_WrMulti(&(p_dev->platform),address,
 			p_dev->temp_buffer,
@@ -98,7 +98,10 @@
  * @brief Definitions for Range results block headers
  */
 
-#if VL53L8CX_NB_TARGET_PER_ZONE == 1
+/*
+ * The per target blocks move when more than one target per zone is sent, the
+ * VL53L8CX_MT_* headers below are used when nb_target_per_zone is above 1.
+ */
 
 #define VL53L8CX_START_BH				((uint32_t)0x0000000DU)
 #define VL53L8CX_METADATA_BH			((uint32_t)0x54B400C0U)
@@ -124,31 +127,37 @@
 #define VL53L8CX_TARGET_STATUS_IDX		((uint16_t)0xE084U)
 #define VL53L8CX_MOTION_DETEC_IDX		((uint16_t)0xD858U)
 
-#else
-#define VL53L8CX_START_BH				((uint32_t)0x0000000DU)
-#define VL53L8CX_METADATA_BH			((uint32_t)0x54B400C0U)
-#define VL53L8CX_COMMONDATA_BH			((uint32_t)0x54C00040U)
-#define VL53L8CX_AMBIENT_RATE_BH		((uint32_t)0x54D00104U)
-#define VL53L8CX_NB_TARGET_DETECTED_BH	((uint32_t)0x57D00401U)
-#define VL53L8CX_SPAD_COUNT_BH			((uint32_t)0x55D00404U)
-#define VL53L8CX_SIGNAL_RATE_BH			((uint32_t)0x58900404U)
-#define VL53L8CX_RANGE_SIGMA_MM_BH		((uint32_t)0x64900402U)
-#define VL53L8CX_DISTANCE_BH			((uint32_t)0x66900402U)
-#define VL53L8CX_REFLECTANCE_BH			((uint32_t)0x6A900401U)
-#define VL53L8CX_TARGET_STATUS_BH		((uint32_t)0x6B900401U)
-#define VL53L8CX_MOTION_DETECT_BH		((uint32_t)0xCC5008C0U)
+#define VL53L8CX_MT_NB_TARGET_DETECTED_BH	((uint32_t)0x57D00401U)
+#define VL53L8CX_MT_SIGNAL_RATE_BH		((uint32_t)0x58900404U)
+#define VL53L8CX_MT_RANGE_SIGMA_MM_BH		((uint32_t)0x64900402U)
+#define VL53L8CX_MT_DISTANCE_BH			((uint32_t)0x66900402U)
+#define VL53L8CX_MT_REFLECTANCE_BH		((uint32_t)0x6A900401U)
+#define VL53L8CX_MT_TARGET_STATUS_BH		((uint32_t)0x6B900401U)
+#define VL53L8CX_MT_MOTION_DETECT_BH		((uint32_t)0xCC5008C0U)
 
-#define VL53L8CX_METADATA_IDX			((uint16_t)0x54B4U)
-#define VL53L8CX_SPAD_COUNT_IDX			((uint16_t)0x55D0U)
-#define VL53L8CX_AMBIENT_RATE_IDX		((uint16_t)0x54D0U)
-#define VL53L8CX_NB_TARGET_DETECTED_IDX	((uint16_t)0x57D0U)
-#define VL53L8CX_SIGNAL_RATE_IDX		((uint16_t)0x5890U)
-#define VL53L8CX_RANGE_SIGMA_MM_IDX		((uint16_t)0x6490U)
-#define VL53L8CX_DISTANCE_IDX			((uint16_t)0x6690U)
-#define VL53L8CX_REFLECTANCE_EST_PC_IDX	((uint16_t)0x6A90U)
-#define VL53L8CX_TARGET_STATUS_IDX		((uint16_t)0x6B90U)
-#define VL53L8CX_MOTION_DETEC_IDX		((uint16_t)0xCC50U)
-#endif
+#define VL53L8CX_MT_NB_TARGET_DETECTED_IDX	((uint16_t)0x57D0U)
+#define VL53L8CX_MT_SIGNAL_RATE_IDX		((uint16_t)0x5890U)
+#define VL53L8CX_MT_RANGE_SIGMA_MM_IDX		((uint16_t)0x6490U)
+#define VL53L8CX_MT_DISTANCE_IDX		((uint16_t)0x6690U)
+#define VL53L8CX_MT_REFLECTANCE_EST_PC_IDX	((uint16_t)0x6A90U)
+#define VL53L8CX_MT_TARGET_STATUS_IDX		((uint16_t)0x6B90U)
+#define VL53L8CX_MT_MOTION_DETEC_IDX		((uint16_t)0xCC50U)
+
+/**
+ * @brief Macros for the outputs selected at runtime with function
+ * vl53l8cx_set_output_enable(). Meta data and common data are always read.
+ * Outputs disabled in the 'platform.h' file cannot be enabled.
+ */
+
+#define VL53L8CX_OUTPUT_AMBIENT_PER_SPAD	((uint32_t)8U)
+#define VL53L8CX_OUTPUT_NB_SPADS_ENABLED	((uint32_t)16U)
+#define VL53L8CX_OUTPUT_NB_TARGET_DETECTED	((uint32_t)32U)
+#define VL53L8CX_OUTPUT_SIGNAL_PER_SPAD		((uint32_t)64U)
+#define VL53L8CX_OUTPUT_RANGE_SIGMA_MM		((uint32_t)128U)
+#define VL53L8CX_OUTPUT_DISTANCE_MM			((uint32_t)256U)
+#define VL53L8CX_OUTPUT_REFLECTANCE_PERCENT	((uint32_t)512U)
+#define VL53L8CX_OUTPUT_TARGET_STATUS		((uint32_t)1024U)
+#define VL53L8CX_OUTPUT_MOTION_INDICATOR	((uint32_t)2048U)
 
 
 /**
@@ -158,7 +167,11 @@
 #define VL53L8CX_NVM_DATA_SIZE			((uint16_t)492U)
 #define VL53L8CX_CONFIGURATION_SIZE		((uint16_t)972U)
 #define VL53L8CX_OFFSET_BUFFER_SIZE		((uint16_t)488U)
+/* 8x8 range offsets in the NVM data, calibrated per module */
+#define VL53L8CX_NVM_UNIT_START			((uint16_t)0x140U)
+#define VL53L8CX_NVM_UNIT_SIZE			((uint16_t)128U)
 #define VL53L8CX_XTALK_BUFFER_SIZE		((uint16_t)776U)
+#define VL53L8CX_NB_OUTPUT_BH			((uint8_t)12U)
 
 #define VL53L8CX_DCI_ZONE_CONFIG		((uint16_t)0x5450U)
 #define VL53L8CX_DCI_FREQ_HZ			((uint16_t)0x5458U)
@@ -178,6 +191,14 @@
 #define VL53L8CX_DCI_OUTPUT_LIST		((uint16_t)0xD980U)
 #define VL53L8CX_DCI_PIPE_CONTROL		((uint16_t)0xDB80U)
 
+/* Bits of VL53L8CX_DciShadow.valid */
+#define VL53L8CX_SHADOW_RESOLUTION		((uint8_t)1U)
+#define VL53L8CX_SHADOW_FREQ_HZ			((uint8_t)2U)
+#define VL53L8CX_SHADOW_INT_TIME		((uint8_t)4U)
+#define VL53L8CX_SHADOW_SHARPENER		((uint8_t)8U)
+#define VL53L8CX_SHADOW_TARGET_ORDER	((uint8_t)16U)
+#define VL53L8CX_SHADOW_RANGING_MODE	((uint8_t)32U)
+
 #define VL53L8CX_UI_CMD_STATUS			((uint16_t)0x2C00U)
 #define VL53L8CX_UI_CMD_START			((uint16_t)0x2C04U)
 #define VL53L8CX_UI_CMD_END				((uint16_t)0x2FFFU)
@@ -264,6 +285,26 @@
 #endif
 
 
+/**
+ * @brief Structure VL53L8CX_DciShadow keeps a copy of the DCI settings, so the
+ * getters do not need a DCI read (at least 3 I2C transactions and 10 ms). A
+ * field is only used when its VL53L8CX_SHADOW_* bit is set in 'valid'. The
+ * setters update it, a write to the DCI entry clears the bit, and the init
+ * clears all of them.
+ */
+
+typedef struct
+{
+	uint8_t				valid;
+	uint8_t				resolution;
+	uint8_t				frequency_hz;
+	/* Raw DCI value, the percent is rounded at each conversion */
+	uint8_t				sharpener;
+	uint8_t				target_order;
+	uint8_t				ranging_mode;
+	uint32_t			integration_time_ms;
+} VL53L8CX_DciShadow;
+
 /**
  * @brief Structure VL53L8CX_Configuration contains the sensor configuration.
  * User MUST not manually change these field, except for the sensor address.
@@ -289,6 +330,20 @@ typedef struct
 	uint8_t		        temp_buffer[VL53L8CX_TEMPORARY_BUFFER_SIZE];
 	/* Auto-stop flag for stopping the sensor */
 	uint8_t				is_auto_stop_enabled;
+	/* Set by the user when offset_data already holds the NVM offsets, the
+	 * init then only reads the range offsets of the NVM to check they are
+	 * the ones of this module. Cleared with xtalk_preloaded otherwise */
+	uint8_t				offset_preloaded;
+	/* Set by the user when xtalk_data already holds a calibration, the init
+	 * then sends it instead of the default Xtalk */
+	uint8_t				xtalk_preloaded;
+	/* Outputs read at each frame (VL53L8CX_OUTPUT_*), applied at start */
+	uint32_t			output_enable;
+	/* Copy of the DCI settings served by the getters */
+	VL53L8CX_DciShadow		dci_shadow;
+	/* Targets sent per zone, 1 to VL53L8CX_NB_TARGET_PER_ZONE, applied at
+	 * start */
+	uint8_t				nb_target_per_zone;
 } VL53L8CX_Configuration;
 
 
@@ -394,6 +449,19 @@ uint8_t vl53l8cx_is_alive(
 uint8_t vl53l8cx_init(
 		VL53L8CX_Configuration		*p_dev);
 
+/**
+ * @brief This function initializes a sensor that is still powered with the
+ * firmware loaded and idle (e.g. after a host reset or a BSP DeInit/Init).
+ * It checks the firmware checksum and only sends the configuration, skipping
+ * the firmware download and the MCU boot. If it fails, use vl53l8cx_init().
+ * @param (VL53L8CX_Configuration) *p_dev : VL53L8CX configuration structure.
+ * @return (uint8_t) status : 0 if initialization is OK,
+ * VL53L8CX_STATUS_FW_CHECKSUM_FAIL if no valid firmware is running.
+ */
+
+uint8_t vl53l8cx_init_warm(
+		VL53L8CX_Configuration		*p_dev);
+
 /**
  * @brief This function is used to change the I2C address of the sensor. If
  * multiple VL53L5 sensors are connected to the same I2C line, all other LPn
@@ -438,6 +506,71 @@ uint8_t vl53l8cx_set_power_mode(
 		VL53L8CX_Configuration		*p_dev,
 		uint8_t				power_mode);
 
+/**
+ * @brief This function selects the outputs read at each frame. Fewer outputs
+ * means fewer bytes read through I2C. The selection is applied at the next
+ * vl53l8cx_start_ranging(). By default, all the outputs not disabled in the
+ * 'platform.h' file are read.
+ * @param (VL53L8CX_Configuration) *p_dev : VL53L8CX configuration structure.
+ * @param (uint32_t) output_enable : Combination of VL53L8CX_OUTPUT_* macros.
+ * @return (uint8_t) status : 0 if OK, or 127 if an output is disabled in the
+ * 'platform.h' file.
+ */
+
+uint8_t vl53l8cx_set_output_enable(
+		VL53L8CX_Configuration		*p_dev,
+		uint32_t			output_enable);
+
+/**
+ * @brief This function gets the outputs read at each frame.
+ * @param (VL53L8CX_Configuration) *p_dev : VL53L8CX configuration structure.
+ * @param (uint32_t) *p_output_enable : Combination of VL53L8CX_OUTPUT_* macros.
+ * @return (uint8_t) status : 0 if OK.
+ */
+
+uint8_t vl53l8cx_get_output_enable(
+		VL53L8CX_Configuration		*p_dev,
+		uint32_t			*p_output_enable);
+
+/**
+ * @brief This function sets the number of targets sent per zone, from 1 to
+ * VL53L8CX_NB_TARGET_PER_ZONE (the capacity of the results arrays). The
+ * sensor must be stopped, the value is applied at the next
+ * vl53l8cx_start_ranging(). The per target results are then packed with
+ * nb_target_per_zone entries per zone, target t of zone z is at index
+ * (nb_target_per_zone * z) + t. By default, the capacity is sent.
+ * @param (VL53L8CX_Configuration) *p_dev : VL53L8CX configuration structure.
+ * @param (uint8_t) nb_target_per_zone : Targets sent per zone.
+ * @return (uint8_t) status : 0 if OK, or 127 if the value is out of range.
+ */
+
+uint8_t vl53l8cx_set_nb_target_per_zone(
+		VL53L8CX_Configuration		*p_dev,
+		uint8_t				nb_target_per_zone);
+
+/**
+ * @brief This function gets the number of targets sent per zone.
+ * @param (VL53L8CX_Configuration) *p_dev : VL53L8CX configuration structure.
+ * @param (uint8_t) *p_nb_target_per_zone : Targets sent per zone.
+ * @return (uint8_t) status : 0 if OK.
+ */
+
+uint8_t vl53l8cx_get_nb_target_per_zone(
+		VL53L8CX_Configuration		*p_dev,
+		uint8_t				*p_nb_target_per_zone);
+
+/**
+ * @brief This function gets the number of bytes read through I2C at each
+ * frame, for the current resolution and the selected outputs.
+ * @param (VL53L8CX_Configuration) *p_dev : VL53L8CX configuration structure.
+ * @param (uint32_t) *p_data_read_size : Bytes read per frame.
+ * @return (uint8_t) status : 0 if OK.
+ */
+
+uint8_t vl53l8cx_get_output_size(
+		VL53L8CX_Configuration		*p_dev,
+		uint32_t			*p_data_read_size);
+
 /**
  * @brief This function starts a ranging session. When the sensor streams, host
  * cannot change settings 'on-the-fly'.
@@ -483,6 +616,30 @@ uint8_t vl53l8cx_get_ranging_data(
 		VL53L8CX_Configuration		*p_dev,
 		VL53L8CX_ResultsData		*p_results);
 
+/**
+ * @brief This function starts reading the ranging data into p_dev->temp_buffer
+ * through the platform ReadAsync function (e.g. I2C with DMA), and returns
+ * without waiting. Once the platform reports the end of the transfer, call
+ * vl53l8cx_parse_ranging_data(). The bus must not be used meanwhile.
+ * @param (VL53L8CX_Configuration) *p_dev : VL53L8CX configuration structure.
+ * @return (uint8_t) status : 0 if the transfer started.
+ */
+
+uint8_t vl53l8cx_start_ranging_data(
+		VL53L8CX_Configuration		*p_dev);
+
+/**
+ * @brief This function decodes the ranging data read into p_dev->temp_buffer
+ * (second half of vl53l8cx_get_ranging_data()).
+ * @param (VL53L8CX_Configuration) *p_dev : VL53L8CX configuration structure.
+ * @param (VL53L8CX_ResultsData) *p_results : VL53L5 results structure.
+ * @return (uint8_t) status : 0 data are successfully decoded.
+ */
+
+uint8_t vl53l8cx_parse_ranging_data(
+		VL53L8CX_Configuration		*p_dev,
+		VL53L8CX_ResultsData		*p_results);
+
 /**
  * @brief This function gets the current resolution (4x4 or 8x8).
  * @param (VL53L8CX_Configuration) *p_dev : VL53L8CX configuration structure.
@@ -722,6 +879,7 @@ uint8_t vl53l8cx_dci_read_data(
  * @param (uint16_t)*data_size : This field must be the structure or array size
  * (using sizeof() function).
  * @return (uint8_t) status : 0 if OK
+ * @note The shadow of the written setting is cleared (see VL53L8CX_DciShadow).
  */
 
 uint8_t vl53l8cx_dci_write_data(
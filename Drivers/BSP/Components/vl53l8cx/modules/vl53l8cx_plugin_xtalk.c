@@ -111,7 +111,7 @@ static uint8_t _vl53l8cx_program_output_config(
 			else 
 			{
 				bh_ptr->size = (uint8_t)(resolution 
-                                  * (uint8_t)VL53L8CX_NB_TARGET_PER_ZONE);
+                                  * p_dev->nb_target_per_zone);
 			}
 
                         
@@ -189,6 +189,9 @@ uint8_t vl53l8cx_calibrate_xtalk(
 		status |= VL53L8CX_WrMulti(&(p_dev->platform), 0x2c28,
 				p_dev->temp_buffer, 
                        (uint16_t)sizeof(VL53L8CX_CALIBRATE_XTALK));
+		/* The calibration configuration replaces the DCI settings, the
+		 * setters below fill the shadow again */
+		p_dev->dci_shadow.valid = 0;
 		status |= _vl53l8cx_poll_for_answer(p_dev,
 				VL53L8CX_UI_CMD_STATUS, 0x3);
 
@@ -273,6 +276,11 @@ uint8_t vl53l8cx_calibrate_xtalk(
 			p_dev->default_configuration,
 			VL53L8CX_CONFIGURATION_SIZE);
 	status |= _vl53l8cx_poll_for_answer(p_dev,VL53L8CX_UI_CMD_STATUS, 0x03);
+#if VL53L8CX_NB_TARGET_PER_ZONE != 1
+	/* The default buffer holds the capacity, not the targets sent */
+	status |= vl53l8cx_set_nb_target_per_zone(p_dev,
+			p_dev->nb_target_per_zone);
+#endif
 
 	/* Reset initial configuration */
 	status |= vl53l8cx_set_resolution(p_dev, resolution);
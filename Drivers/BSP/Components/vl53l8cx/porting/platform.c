@@ -12,12 +12,26 @@
 
 #include "platform.h"
 
+/* Counts a failed transaction, returns its status */
+static uint8_t VL53L8CX_Count(
+		VL53L8CX_Platform *p_platform,
+		int32_t status)
+{
+  if (status != 0)
+  {
+    p_platform->errors++;
+  }
+  return (uint8_t)status;
+}
+
 uint8_t VL53L8CX_RdByte(
 		VL53L8CX_Platform *p_platform,
 		uint16_t RegisterAdress,
 		uint8_t *p_value)
 {
-  return p_platform->Read(p_platform->address, RegisterAdress, p_value, 1U);
+  p_platform->transfers++;
+  return VL53L8CX_Count(p_platform,
+		  p_platform->Read(p_platform->address, RegisterAdress, p_value, 1U));
 }
 
 uint8_t VL53L8CX_WrByte(
@@ -25,7 +39,9 @@ uint8_t VL53L8CX_WrByte(
 		uint16_t RegisterAdress,
 		uint8_t value)
 {
-  return p_platform->Write(p_platform->address, RegisterAdress, &value, 1U);
+  p_platform->transfers++;
+  return VL53L8CX_Count(p_platform,
+		  p_platform->Write(p_platform->address, RegisterAdress, &value, 1U));
 }
 
 uint8_t VL53L8CX_WrMulti(
@@ -34,7 +50,9 @@ uint8_t VL53L8CX_WrMulti(
 		uint8_t *p_values,
 		uint32_t size)
 {
-  return p_platform->Write(p_platform->address, RegisterAdress, p_values, size);
+  p_platform->transfers++;
+  return VL53L8CX_Count(p_platform,
+		  p_platform->Write(p_platform->address, RegisterAdress, p_values, size));
 }
 
 uint8_t VL53L8CX_RdMulti(
@@ -43,7 +61,26 @@ uint8_t VL53L8CX_RdMulti(
 		uint8_t *p_values,
 		uint32_t size)
 {
-  return p_platform->Read(p_platform->address, RegisterAdress, p_values, size);
+  p_platform->transfers++;
+  return VL53L8CX_Count(p_platform,
+		  p_platform->Read(p_platform->address, RegisterAdress, p_values, size));
+}
+
+uint8_t VL53L8CX_RdMultiAsync(
+		VL53L8CX_Platform *p_platform,
+		uint16_t RegisterAdress,
+		uint8_t *p_values,
+		uint32_t size)
+{
+  if (p_platform->ReadAsync == NULL)
+  {
+    return 255U;
+  }
+
+  p_platform->transfers++;
+  return VL53L8CX_Count(p_platform,
+		  p_platform->ReadAsync(p_platform->address, RegisterAdress, p_values,
+		  size));
 }
 
 void VL53L8CX_SwapBuffer(
@@ -51,19 +88,64 @@ void VL53L8CX_SwapBuffer(
 		uint16_t 	 	 size)
 {
 	uint32_t i, tmp;
-	
-	/* Example of possible implementation using <string.h> */
-	for(i = 0; i < size; i = i + 4) 
+
+	/* LDR, REV, STR per word instead of four byte loads and shifts */
+	for(i = 0; i < size; i = i + 4)
+	{
+		tmp = VL53L8CX_LoadWord(buffer, i);
+		(void)memcpy(&(buffer[i]), &tmp, 4);
+	}
+}
+
+void VL53L8CX_Decimate4x4_u32(
+		uint8_t			*grid)
+{
+	uint32_t i, j, pos, sum;
+
+	/* each result lands before the words still to be read */
+	for(j = 0; j < 4U; j++)
+	{
+		for(i = 0; i < 4U; i++)
+		{
+			pos = 4U * ((2U * i) + (16U * j));
+			sum = VL53L8CX_LoadWord(grid, pos)
+				+ VL53L8CX_LoadWord(grid, pos + 4U)
+				+ VL53L8CX_LoadWord(grid, pos + 32U)
+				+ VL53L8CX_LoadWord(grid, pos + 36U);
+			VL53L8CX_StoreWord(grid, 4U * (i + (4U * j)), sum / 4U);
+		}
+	}
+
+	(void)memset(&(grid[4U * 16U]), 0, 4U * 48U);
+}
+
+void VL53L8CX_Decimate4x4_i16(
+		uint8_t			*grid)
+{
+	uint32_t i, j, pos, word;
+	int32_t avg[2];
+
+	/* a 2x2 block is the two halves of word (i + 8j) and of the word below
+	 * it, two results fill one word */
+	for(j = 0; j < 4U; j++)
 	{
-		tmp = (
-		  buffer[i]<<24)
-		|(buffer[i+1]<<16)
-		|(buffer[i+2]<<8)
-		|(buffer[i+3]);
-		
-		memcpy(&(buffer[i]), &tmp, 4);
+		for(i = 0; i < 4U; i++)
+		{
+			pos = 4U * (i + (8U * j));
+			avg[i & 1U] = (VL53L8CX_SUM_HALVES(VL53L8CX_LoadWord(grid, pos))
+				+ VL53L8CX_SUM_HALVES(VL53L8CX_LoadWord(grid, pos + 16U)))
+				/ 4;
+			if((i & 1U) != 0U)
+			{
+				word = ((uint32_t)avg[0] & 0xFFFFU)
+					| ((uint32_t)avg[1] << 16);
+				VL53L8CX_StoreWord(grid, 4U * ((2U * j) + (i >> 1)), word);
+			}
+		}
 	}
-}	
+
+	(void)memset(&(grid[2U * 16U]), 0, 2U * 48U);
+}
 
 uint8_t VL53L8CX_WaitMs(
 		VL53L8CX_Platform *p_platform,
@@ -20,6 +20,9 @@
 typedef int32_t (*VL53L8CX_get_tick_Func)(void);
 typedef int32_t (*VL53L8CX_write_Func)(uint16_t, uint16_t, uint8_t *, uint16_t);
 typedef int32_t (*VL53L8CX_read_Func)(uint16_t, uint16_t, uint8_t *, uint16_t);
+/* Starts a read, the platform signals its end outside of the driver */
+typedef int32_t (*VL53L8CX_read_async_Func)(uint16_t, uint16_t, uint8_t *,
+		uint16_t);
 
 /**
  * @brief Structure VL53L8CX_Platform needs to be filled by the customer,
@@ -37,18 +40,25 @@ typedef struct
     uint16_t address;
     VL53L8CX_write_Func Write;
     VL53L8CX_read_Func Read;
+    VL53L8CX_read_async_Func ReadAsync; /* NULL if not supported */
     VL53L8CX_get_tick_Func GetTick;
+    uint32_t transfers; /* I2C transactions issued, wraps around */
+    uint32_t errors; /* of them, failed ones (async reads: the start only) */
 } VL53L8CX_Platform;
 
 /*
  * @brief The macro below is used to define the number of target per zone sent
  * through I2C. This value can be changed by user, in order to tune I2C
  * transaction, and also the total memory size (a lower number of target per
- * zone means a lower RAM usage).
+ * zone means a lower RAM usage). It is the capacity of the results, function
+ * vl53l8cx_set_nb_target_per_zone() selects 1 up to this value at runtime.
  */
 #ifndef VL53L8CX_NB_TARGET_PER_ZONE
 #define 	VL53L8CX_NB_TARGET_PER_ZONE		(1U)
 #endif
+#if (VL53L8CX_NB_TARGET_PER_ZONE < 1U) || (VL53L8CX_NB_TARGET_PER_ZONE > 4U)
+#error "VL53L8CX_NB_TARGET_PER_ZONE must be between 1 and 4"
+#endif
 /*
  * @brief The macro below can be used to avoid data conversion into the driver.
  * By default there is a conversion between firmware and user data. Using this macro
@@ -74,6 +84,42 @@ typedef struct
 // #define VL53L8CX_DISABLE_TARGET_STATUS
 // #define VL53L8CX_DISABLE_MOTION_INDICATOR
 
+/*
+ * @brief Period of the driver polls for a command answer (DCI access, start)
+ * and for the MCU stop. The original driver waits 10 ms before every check,
+ * which makes each DCI access and each stop last at least that long.
+ */
+
+#define 	VL53L8CX_POLL_PERIOD_MS		(1U)
+
+/*
+ * The kernels below use the Cortex-M4 REV and SMUAD instructions. Uncomment
+ * to build the portable C version instead (other cores, host tests).
+ */
+
+// #define VL53L8CX_PORTABLE_KERNELS
+
+#if defined(__ARM_FEATURE_DSP) && !defined(VL53L8CX_PORTABLE_KERNELS)
+#include "cmsis_compiler.h"
+
+/* Byte reversal of a 32-bit word */
+#define VL53L8CX_REV32(x)		__REV(x)
+/* Sum of the two signed 16-bit halves of a word */
+#define VL53L8CX_SUM_HALVES(x)	((int32_t)__SMUAD((x), 0x00010001U))
+#else
+#define VL53L8CX_REV32(x)		((((x) >> 24) & 0xFFU) \
+		| (((x) >> 8) & 0xFF00U) | (((x) & 0xFF00U) << 8) | ((x) << 24))
+#define VL53L8CX_SUM_HALVES(x)	((int32_t)(int16_t)((x) & 0xFFFFU) \
+		+ (int32_t)(int16_t)((x) >> 16))
+#endif
+
+/* -Os would keep the word accessors out of line */
+#if defined(__GNUC__)
+#define VL53L8CX_FORCE_INLINE	static inline __attribute__((always_inline))
+#else
+#define VL53L8CX_FORCE_INLINE	static inline
+#endif
+
 /**
  * @param (VL53L8CX_Platform*) p_platform : Pointer of VL53L8CX platform
  * structure.
@@ -117,6 +163,25 @@ uint8_t VL53L8CX_RdMulti(
 		uint8_t *p_values,
 		uint32_t size);
 
+/**
+ * @brief Optional function used to start reading multiples bytes without
+ * waiting for them (e.g. with DMA). The buffer must not be used until the
+ * platform reports the end of the transfer.
+ * @param (VL53L8CX_Platform*) p_platform : Pointer of VL53L8CX platform
+ * structure.
+ * @param (uint16_t) Address : I2C location of values to read.
+ * @param (uint8_t) *p_values : Buffer of bytes to read.
+ * @param (uint32_t) size : Size of *p_values buffer.
+ * @return (uint8_t) status : 0 if the transfer started, 255 if the platform
+ * has no ReadAsync
+ */
+
+uint8_t VL53L8CX_RdMultiAsync(
+		VL53L8CX_Platform *p_platform,
+		uint16_t RegisterAdress,
+		uint8_t *p_values,
+		uint32_t size);
+
 /**
  * @brief Mandatory function used to write multiples bytes.
  * @param (VL53L8CX_Platform*) p_platform : Pointer of VL53L8CX platform
@@ -143,6 +208,64 @@ uint8_t VL53L8CX_WrMulti(
 void VL53L8CX_SwapBuffer(
 		uint8_t 		*buffer,
 		uint16_t 	 	 size);
+
+/**
+ * @brief Reads the 32-bit word at a sensor buffer position, as
+ * VL53L8CX_SwapBuffer() would leave it.
+ * @param (const uint8_t*) buffer : Sensor (big endian) buffer, any alignment
+ * @param (uint32_t) pos : Byte position, multiple of 4
+ * @return (uint32_t) word : Native word
+ */
+
+VL53L8CX_FORCE_INLINE uint32_t VL53L8CX_LoadWord(
+		const uint8_t	*buffer,
+		uint32_t		pos)
+{
+	uint32_t tmp;
+
+	/* a single LDR on Cortex-M4, unaligned access is allowed */
+	(void)memcpy(&tmp, &(buffer[pos]), 4);
+	return VL53L8CX_REV32(tmp);
+}
+
+/**
+ * @brief Writes a native 32-bit word into a sensor buffer, reverse of
+ * VL53L8CX_LoadWord().
+ * @param (uint8_t*) buffer : Sensor (big endian) buffer, any alignment
+ * @param (uint32_t) pos : Byte position, multiple of 4
+ * @param (uint32_t) word : Native word
+ */
+
+VL53L8CX_FORCE_INLINE void VL53L8CX_StoreWord(
+		uint8_t			*buffer,
+		uint32_t		pos,
+		uint32_t		word)
+{
+	uint32_t tmp = VL53L8CX_REV32(word);
+
+	(void)memcpy(&(buffer[pos]), &tmp, 4);
+}
+
+/**
+ * @brief Reduces an 8x8 grid of uint32_t in sensor byte order to 4x4 in place:
+ * each 2x2 block is averaged into the first 16 words and the 48 others are
+ * cleared. Same result as swapping the buffer, averaging and swapping back,
+ * without touching the bytes around the grid.
+ * @param (uint8_t*) grid : 64 words, at a multiple of 4 from the buffer start
+ */
+
+void VL53L8CX_Decimate4x4_u32(
+		uint8_t			*grid);
+
+/**
+ * @brief Same as VL53L8CX_Decimate4x4_u32() for an 8x8 grid of int16_t (32
+ * words), the average is rounded toward zero.
+ * @param (uint8_t*) grid : 64 values, at a multiple of 4 from the buffer start
+ */
+
+void VL53L8CX_Decimate4x4_i16(
+		uint8_t			*grid);
+
 /**
  * @brief Mandatory function, used to wait during an amount of time. It must be
  * filled as it's used into the API.
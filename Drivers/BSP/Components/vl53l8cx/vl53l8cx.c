@@ -79,6 +79,7 @@ VL53L8CX_RANGING_SENSOR_Drv_t VL53L8CX_RANGING_SENSOR_Driver =
   */
 static int32_t vl53l8cx_poll_for_measurement(VL53L8CX_Object_t *pObj, uint32_t Timeout);
 static int32_t vl53l8cx_get_result(VL53L8CX_Object_t *pObj, VL53L8CX_Result_t *pResult);
+static int32_t vl53l8cx_decode_result(VL53L8CX_Object_t *pObj, VL53L8CX_Result_t *pResult);
 static uint8_t vl53l8cx_map_target_status(uint8_t status);
 /**
   * @}
@@ -105,12 +106,14 @@ int32_t VL53L8CX_RegisterBusIO(VL53L8CX_Object_t *pObj, VL53L8CX_IO_t *pIO)
     pObj->IO.Address   = pIO->Address;
     pObj->IO.WriteReg  = pIO->WriteReg;
     pObj->IO.ReadReg   = pIO->ReadReg;
+    pObj->IO.ReadRegAsync = pIO->ReadRegAsync;
     pObj->IO.GetTick   = pIO->GetTick;
 
     /* fill vl53l8cx platform structure */
     pObj->Dev.platform.address = pIO->Address;
     pObj->Dev.platform.Read = pIO->ReadReg;
     pObj->Dev.platform.Write = pIO->WriteReg;
+    pObj->Dev.platform.ReadAsync = pIO->ReadRegAsync;
     pObj->Dev.platform.GetTick = pIO->GetTick;
 
     if (pObj->IO.Init != NULL)
@@ -128,6 +131,8 @@ int32_t VL53L8CX_RegisterBusIO(VL53L8CX_Object_t *pObj, VL53L8CX_IO_t *pIO)
 
 /**
   * @brief Initializes the vl53l8cx.
+  * @note A sensor still running its firmware (host reset, DeInit/Init) is
+  *       only reconfigured (warm start), otherwise the firmware is downloaded.
   * @param pObj    vl53l8cx context object.
   * @retval VL53L8CX status
   */
@@ -143,11 +148,23 @@ int32_t VL53L8CX_Init(VL53L8CX_Object_t *pObj)
   {
     ret =  VL53L8CX_ERROR;
   }
+  else if (vl53l8cx_init_warm(&pObj->Dev) == VL53L8CX_STATUS_OK)
+  {
+    /* firmware still loaded, only the configuration was sent */
+    pObj->IsWarmStart = 1U;
+    ret = VL53L8CX_OK;
+  }
   else if (vl53l8cx_init(&pObj->Dev) != VL53L8CX_STATUS_OK)
   {
     ret = VL53L8CX_ERROR;
   }
   else
+  {
+    pObj->IsWarmStart = 0U;
+    ret = VL53L8CX_OK;
+  }
+
+  if (ret == VL53L8CX_OK)
   {
     pObj->IsRanging = 0U;
     pObj->IsBlocking = 0U;
@@ -155,7 +172,6 @@ int32_t VL53L8CX_Init(VL53L8CX_Object_t *pObj)
     pObj->IsAmbientEnabled = 0U;
     pObj->IsSignalEnabled = 0U;
     pObj->IsInitialized = 1U;
-    ret = VL53L8CX_OK;
   }
 
   return ret;
@@ -454,6 +470,71 @@ int32_t VL53L8CX_GetDistance(VL53L8CX_Object_t *pObj, VL53L8CX_Result_t *pResult
   return ret;
 }
 
+/**
+  * @brief Start reading the measurement the data ready interrupt announced,
+  *        without waiting for the bulk transfer (IO.ReadRegAsync).
+  * @note Call VL53L8CX_GetDistanceComplete() once the bus reports the end of
+  *       the transfer. The bus must not be used until then.
+  * @note In interrupt mode the data ready poll is skipped, the interrupt
+  *       already announced the frame and the call may come from its handler.
+  * @param pObj    vl53l8cx context object.
+  * @retval VL53L8CX status
+  */
+int32_t VL53L8CX_GetDistanceStart(VL53L8CX_Object_t *pObj)
+{
+  int32_t ret;
+
+  if (pObj == NULL)
+  {
+    ret = VL53L8CX_INVALID_PARAM;
+  }
+  else if (pObj->IsRanging == 0U)
+  {
+    ret = VL53L8CX_ERROR;
+  }
+  else if (pObj->IO.ReadRegAsync == NULL)
+  {
+    ret = VL53L8CX_NOT_IMPLEMENTED;
+  }
+  else if (pObj->IsBlocking == 0U)
+  {
+    ret = VL53L8CX_OK;
+  }
+  else
+  {
+    ret = vl53l8cx_poll_for_measurement(pObj, 0U);
+  }
+
+  if ((ret == VL53L8CX_OK) && (vl53l8cx_start_ranging_data(&pObj->Dev) != VL53L8CX_STATUS_OK))
+  {
+    ret = VL53L8CX_ERROR;
+  }
+
+  return ret;
+}
+
+/**
+  * @brief Decode the measurement read by VL53L8CX_GetDistanceStart().
+  * @param pObj    vl53l8cx context object.
+  * @param pResult    Pointer to the result struct.
+  * @retval VL53L8CX status
+  */
+int32_t VL53L8CX_GetDistanceComplete(VL53L8CX_Object_t *pObj, VL53L8CX_Result_t *pResult)
+{
+  int32_t ret;
+
+  if ((pObj == NULL) || (pResult == NULL))
+  {
+    ret = VL53L8CX_INVALID_PARAM;
+  }
+  else
+  {
+    ret = vl53l8cx_decode_result(pObj, pResult);
+  }
+
+  return ret;
+}
+
 /**
   * @brief Start ranging.
   * @param pObj    vl53l8cx context object.
@@ -716,66 +797,279 @@ static int32_t vl53l8cx_poll_for_measurement(VL53L8CX_Object_t *pObj, uint32_t T
 static int32_t vl53l8cx_get_result(VL53L8CX_Object_t *pObj, VL53L8CX_Result_t *pResult)
 {
   int32_t ret;
-  uint8_t i, j;
-  uint8_t resolution;
-  uint8_t target_status;
-  static VL53L8CX_ResultsData data;
 
   if ((pObj == NULL) || (pResult == NULL))
   {
     ret = VL53L8CX_INVALID_PARAM;
   }
-  else if (vl53l8cx_get_resolution(&pObj->Dev, &resolution) != VL53L8CX_STATUS_OK)
-  {
-    ret = VL53L8CX_ERROR;
-  }
-  else if (vl53l8cx_get_ranging_data(&pObj->Dev, &data) != VL53L8CX_STATUS_OK)
+  else if (VL53L8CX_RdMulti(&pObj->Dev.platform, 0x0, pObj->Dev.temp_buffer,
+                            pObj->Dev.data_read_size) != VL53L8CX_STATUS_OK)
   {
     ret = VL53L8CX_ERROR;
   }
   else
   {
-    pResult->NumberOfZones = resolution;
+    ret = vl53l8cx_decode_result(pObj, pResult);
+  }
+
+  return ret;
+}
+
+/* The sensor streams 32-bit big endian words. Instead of swapping the whole
+ * buffer like vl53l8cx_parse_ranging_data(), the decoder loads each word once
+ * and takes the 8 or 16-bit values from it, lowest bits first. */
+static inline uint32_t vl53l8cx_stream_word(const uint8_t *pBuf, uint32_t Pos)
+{
+  return VL53L8CX_LoadWord(pBuf, Pos);
+}
+
+/* Scaling applied by vl53l8cx_parse_ranging_data() */
+#ifndef VL53L8CX_USE_RAW_FORMAT
+#define VL53L8CX_RATE_DIV         (2048U)
+#define VL53L8CX_DISTANCE_DIV     (4)
+#define VL53L8CX_REFLECTANCE_DIV  (2U)
+#define VL53L8CX_SIGMA_DIV        (128U)
+#define VL53L8CX_MOTION_DIV       (65535U)
+#else
+#define VL53L8CX_RATE_DIV         (1U)
+#define VL53L8CX_DISTANCE_DIV     (1)
+#define VL53L8CX_REFLECTANCE_DIV  (1U)
+#define VL53L8CX_SIGMA_DIV        (1U)
+#define VL53L8CX_MOTION_DIV       (1U)
+#endif
+
+/* Per target blocks hold nt (Dev.nb_target_per_zone) entries per zone. The
+ * loops walk them with a zone and a target index, the runtime nt would cost a
+ * division per entry */
+#define VL53L8CX_ZONE(k, nt)    ((k) / (nt))
+#define VL53L8CX_NEXT_TARGET(z, t, nt) \
+  do { if (++(t) == (nt)) { (t) = 0U; (z)++; } } while (0)
 
-    for (i = 0; i < resolution; i++)
+/**
+  * @brief Decode the frame read into temp_buffer in a single pass.
+  * @note Each block of the stream is read once and written scaled (same
+  *       values as vl53l8cx_parse_ranging_data()) to pResult, or to
+  *       pObj->Results for the outputs pResult has no room for. Only the zones
+  *       of the active resolution are visited, which is taken from the block
+  *       sizes, so no extra I2C transaction is needed. The sensor sends the
+  *       number of targets before the per target blocks, the ambient and
+  *       signal of disabled outputs are cleared with it. NumberOfTargets is
+  *       capped to the targets sent per zone.
+  * @param pObj    vl53l8cx context object.
+  * @param pResult    Pointer to the result struct.
+  * @retval VL53L8CX status
+  */
+static int32_t vl53l8cx_decode_result(VL53L8CX_Object_t *pObj, VL53L8CX_Result_t *pResult)
+{
+  const uint8_t *buf = pObj->Dev.temp_buffer;
+  const uint32_t size = pObj->Dev.data_read_size;
+  VL53L8CX_ResultsData *data = &pObj->Results;
+  VL53L8CX_ZoneResult_t *zone;
+  union Block_header bh;
+  uint32_t i, k, j, t, z, pos, count, msize, word;
+  float_t rate;
+  uint32_t zones = 0;
+  uint16_t header_id, footer_id;
+  const uint8_t ambient_enabled = pObj->IsAmbientEnabled;
+  const uint8_t signal_enabled = pObj->IsSignalEnabled;
+  const uint32_t nt = pObj->Dev.nb_target_per_zone;
+
+  pObj->Dev.streamcount = buf[0];
+
+  /* Start at position 16 to avoid headers */
+  for (i = 16U; i < size; i += 4U)
+  {
+    bh.bytes = vl53l8cx_stream_word(buf, i);
+    if ((bh.type > 0x1U) && (bh.type < 0xdU))
+    {
+      msize = bh.type * bh.size;
+    }
+    else
     {
-      pResult->ZoneResult[i].NumberOfTargets = data.nb_target_detected[i];
+      msize = bh.size;
+    }
+    pos = i + 4U;
+    count = bh.size;
 
-      for (j = 0; j < data.nb_target_detected[i]; j++)
-      {
-        pResult->ZoneResult[i].Distance[j] = (uint32_t)data.distance_mm[(VL53L8CX_NB_TARGET_PER_ZONE * i) + j];
+    switch (bh.idx)
+    {
+      case VL53L8CX_METADATA_IDX:
+        data->silicon_temp_degc = (int8_t)(vl53l8cx_stream_word(buf, i + 12U) & 0xFFU);
+        break;
 
-        /* return Ambient value if ambient rate output is enabled */
-        if (pObj->IsAmbientEnabled == 1U)
+#ifndef VL53L8CX_DISABLE_AMBIENT_PER_SPAD
+      case VL53L8CX_AMBIENT_RATE_IDX:
+        zones = count;
+        for (k = 0; (k < count) && (ambient_enabled == 1U); k++)
         {
           /* apply ambient value to all targets in a given zone */
-          pResult->ZoneResult[i].Ambient[j] = (float_t)data.ambient_per_spad[i];
+          rate = (float_t)(vl53l8cx_stream_word(buf, pos + (4U * k)) / VL53L8CX_RATE_DIV);
+          for (t = 0; t < nt; t++)
+          {
+            pResult->ZoneResult[k].Ambient[t] = rate;
+          }
         }
-        else
+        break;
+#endif
+#ifndef VL53L8CX_DISABLE_NB_SPADS_ENABLED
+      case VL53L8CX_SPAD_COUNT_IDX:
+        zones = count;
+        for (k = 0; k < count; k++)
         {
-          pResult->ZoneResult[i].Ambient[j] = 0.0f;
+          data->nb_spads_enabled[k] = vl53l8cx_stream_word(buf, pos + (4U * k));
         }
-
-        /* return Signal value if signal rate output is enabled */
-        if (pObj->IsSignalEnabled == 1U)
+        break;
+#endif
+#ifndef VL53L8CX_DISABLE_NB_TARGET_DETECTED
+      case VL53L8CX_NB_TARGET_DETECTED_IDX:
+#if VL53L8CX_NB_TARGET_PER_ZONE != 1
+      case VL53L8CX_MT_NB_TARGET_DETECTED_IDX:
+#endif
+        zones = count;
+        for (k = 0; k < count; k += 4U)
         {
-          pResult->ZoneResult[i].Signal[j] =
-            (float_t)data.signal_per_spad[(VL53L8CX_NB_TARGET_PER_ZONE * i) + j];
+          word = vl53l8cx_stream_word(buf, pos + k);
+          for (j = k; j < (k + 4U); j++, word >>= 8)
+          {
+            zone = &pResult->ZoneResult[j];
+            /* the firmware may find more targets than it sends */
+            zone->NumberOfTargets = (uint8_t)((((uint8_t)word) > nt) ? nt : (uint8_t)word);
+            for (t = 0; (t < nt) && ((ambient_enabled & signal_enabled) == 0U); t++)
+            {
+              if (ambient_enabled == 0U)
+              {
+                zone->Ambient[t] = 0.0f;
+              }
+              if (signal_enabled == 0U)
+              {
+                zone->Signal[t] = 0.0f;
+              }
+            }
+          }
         }
-        else
+        break;
+#endif
+#ifndef VL53L8CX_DISABLE_SIGNAL_PER_SPAD
+      case VL53L8CX_SIGNAL_RATE_IDX:
+#if VL53L8CX_NB_TARGET_PER_ZONE != 1
+      case VL53L8CX_MT_SIGNAL_RATE_IDX:
+#endif
+        zones = VL53L8CX_ZONE(count, nt);
+        for (k = 0, z = 0, t = 0; (k < count) && (signal_enabled == 1U); k++)
         {
-          pResult->ZoneResult[i].Signal[j] = 0.0f;
+          pResult->ZoneResult[z].Signal[t] =
+            (float_t)(vl53l8cx_stream_word(buf, pos + (4U * k)) / VL53L8CX_RATE_DIV);
+          VL53L8CX_NEXT_TARGET(z, t, nt);
         }
-
-        target_status = data.target_status[(VL53L8CX_NB_TARGET_PER_ZONE * i) + j];
-        pResult->ZoneResult[i].Status[j] = vl53l8cx_map_target_status(target_status);
-      }
+        break;
+#endif
+#ifndef VL53L8CX_DISABLE_RANGE_SIGMA_MM
+      case VL53L8CX_RANGE_SIGMA_MM_IDX:
+#if VL53L8CX_NB_TARGET_PER_ZONE != 1
+      case VL53L8CX_MT_RANGE_SIGMA_MM_IDX:
+#endif
+        zones = VL53L8CX_ZONE(count, nt);
+        for (k = 0; k < count; k += 2U)
+        {
+          word = vl53l8cx_stream_word(buf, pos + (2U * k));
+          data->range_sigma_mm[k] = (uint16_t)((word & 0xFFFFU) / VL53L8CX_SIGMA_DIV);
+          data->range_sigma_mm[k + 1U] = (uint16_t)((word >> 16) / VL53L8CX_SIGMA_DIV);
+        }
+        break;
+#endif
+#ifndef VL53L8CX_DISABLE_DISTANCE_MM
+      case VL53L8CX_DISTANCE_IDX:
+#if VL53L8CX_NB_TARGET_PER_ZONE != 1
+      case VL53L8CX_MT_DISTANCE_IDX:
+#endif
+        zones = VL53L8CX_ZONE(count, nt);
+        for (k = 0, z = 0, t = 0; k < count; k += 2U)
+        {
+          word = vl53l8cx_stream_word(buf, pos + (2U * k));
+          for (j = k; j < (k + 2U); j++, word >>= 16)
+          {
+            pResult->ZoneResult[z].Distance[t] =
+              (uint32_t)(int32_t)((int16_t)(uint16_t)word / VL53L8CX_DISTANCE_DIV);
+            VL53L8CX_NEXT_TARGET(z, t, nt);
+          }
+        }
+        break;
+#endif
+#ifndef VL53L8CX_DISABLE_REFLECTANCE_PERCENT
+      case VL53L8CX_REFLECTANCE_EST_PC_IDX:
+#if VL53L8CX_NB_TARGET_PER_ZONE != 1
+      case VL53L8CX_MT_REFLECTANCE_EST_PC_IDX:
+#endif
+        zones = VL53L8CX_ZONE(count, nt);
+        for (k = 0; k < count; k += 4U)
+        {
+          word = vl53l8cx_stream_word(buf, pos + k);
+          for (j = k; j < (k + 4U); j++, word >>= 8)
+          {
+            data->reflectance[j] = (uint8_t)((uint8_t)word / VL53L8CX_REFLECTANCE_DIV);
+          }
+        }
+        break;
+#endif
+#ifndef VL53L8CX_DISABLE_TARGET_STATUS
+      case VL53L8CX_TARGET_STATUS_IDX:
+#if VL53L8CX_NB_TARGET_PER_ZONE != 1
+      case VL53L8CX_MT_TARGET_STATUS_IDX:
+#endif
+        zones = VL53L8CX_ZONE(count, nt);
+        for (k = 0, z = 0, t = 0; k < count; k += 4U)
+        {
+          word = vl53l8cx_stream_word(buf, pos + k);
+          for (j = k; j < (k + 4U); j++, word >>= 8)
+          {
+            zone = &pResult->ZoneResult[z];
+#if !defined(VL53L8CX_DISABLE_NB_TARGET_DETECTED) && !defined(VL53L8CX_USE_RAW_FORMAT)
+            /* no target detected for this zone */
+            zone->Status[t] = (zone->NumberOfTargets == 0U) ? 255U :
+                              vl53l8cx_map_target_status((uint8_t)word);
+#else
+            zone->Status[t] = vl53l8cx_map_target_status((uint8_t)word);
+#endif
+            VL53L8CX_NEXT_TARGET(z, t, nt);
+          }
+        }
+        break;
+#endif
+#ifndef VL53L8CX_DISABLE_MOTION_INDICATOR
+      case VL53L8CX_MOTION_DETEC_IDX:
+#if VL53L8CX_NB_TARGET_PER_ZONE != 1
+      case VL53L8CX_MT_MOTION_DETEC_IDX:
+#endif
+        for (k = 0; (k < msize) && (k < sizeof(data->motion_indicator)); k += 4U)
+        {
+          word = vl53l8cx_stream_word(buf, pos + k);
+          (void)memcpy(&((uint8_t *)&data->motion_indicator)[k], &word, 4U);
+        }
+        for (k = 0; k < 32U; k++)
+        {
+          data->motion_indicator.motion[k] /= VL53L8CX_MOTION_DIV;
+        }
+        break;
+#endif
+      default:
+        break;
     }
+    i += msize;
+  }
 
-    ret = VL53L8CX_OK;
+  pResult->NumberOfZones = zones;
+
+  /* Check if footer id and header id are matching. This allows to detect
+   * corrupted frames */
+  header_id = (uint16_t)(vl53l8cx_stream_word(buf, 0x8U) & 0xFFFFU);
+  footer_id = (uint16_t)(vl53l8cx_stream_word(buf, size - 4U) & 0xFFFFU);
+
+  if (header_id != footer_id)
+  {
+    pObj->CorruptedFrames++;
   }
 
-  return ret;
+  return (header_id == footer_id) ? VL53L8CX_OK : VL53L8CX_ERROR;
 }
 
 static uint8_t vl53l8cx_map_target_status(uint8_t status)
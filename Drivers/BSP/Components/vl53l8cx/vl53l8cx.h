@@ -95,6 +95,7 @@ typedef int32_t (*VL53L8CX_DeInit_Func)(void);
 typedef int32_t (*VL53L8CX_GetTick_Func)(void);
 typedef int32_t (*VL53L8CX_WriteReg_Func)(uint16_t, uint16_t, uint8_t *, uint16_t);
 typedef int32_t (*VL53L8CX_ReadReg_Func)(uint16_t, uint16_t, uint8_t *, uint16_t);
+typedef int32_t (*VL53L8CX_ReadRegAsync_Func)(uint16_t, uint16_t, uint8_t *, uint16_t);
 
 typedef struct
 {
@@ -103,6 +104,7 @@ typedef struct
   uint16_t Address;
   VL53L8CX_WriteReg_Func WriteReg;
   VL53L8CX_ReadReg_Func ReadReg;
+  VL53L8CX_ReadRegAsync_Func ReadRegAsync; /*!< NULL if not supported */
   VL53L8CX_GetTick_Func GetTick;
 } VL53L8CX_IO_t;
 
@@ -117,6 +119,11 @@ typedef struct
   uint8_t IsAmbientEnabled;   /*!< Enabled: 0, Disabled: 1 */
   uint8_t IsSignalEnabled;    /*!< Enabled: 0, Disabled: 1 */
   uint8_t RangingProfile;
+  uint8_t IsWarmStart;        /*!< Firmware download skipped by the last Init */
+  uint32_t CorruptedFrames;   /*!< Frames whose header and footer ids differ
+                                   (VL53L8CX_STATUS_CORRUPTED_FRAME), wraps */
+  VL53L8CX_ResultsData Results; /*!< Last frame outputs missing from VL53L8CX_Result_t
+                                     (temperature, spads, sigma, reflectance, motion) */
 } VL53L8CX_Object_t;
 
 typedef struct
@@ -200,6 +207,8 @@ int32_t VL53L8CX_ConfigProfile(VL53L8CX_Object_t *pObj, VL53L8CX_ProfileConfig_t
 int32_t VL53L8CX_ConfigROI(VL53L8CX_Object_t *pObj, VL53L8CX_ROIConfig_t *pROIConfig);
 int32_t VL53L8CX_ConfigIT(VL53L8CX_Object_t *pObj, VL53L8CX_ITConfig_t *pITConfig);
 int32_t VL53L8CX_GetDistance(VL53L8CX_Object_t *pObj, VL53L8CX_Result_t *pResult);
+int32_t VL53L8CX_GetDistanceStart(VL53L8CX_Object_t *pObj);
+int32_t VL53L8CX_GetDistanceComplete(VL53L8CX_Object_t *pObj, VL53L8CX_Result_t *pResult);
 int32_t VL53L8CX_Start(VL53L8CX_Object_t *pObj, uint32_t Mode);
 int32_t VL53L8CX_Stop(VL53L8CX_Object_t *pObj);
 int32_t VL53L8CX_SetAddress(VL53L8CX_Object_t *pObj, uint32_t Address);
@@ -44,7 +44,11 @@ static RANGING_SENSOR_ProfileConfig_t Profile;
 static RANGING_SENSOR_Result_t Result;
 static int32_t status = 0;
 static volatile uint8_t PushButtonDetected = 0;
-volatile uint8_t ToF_EventDetected = 0;
+/* per ranging sensor instance, set by its data ready interrupt */
+volatile uint8_t ToF_EventDetected[RANGING_SENSOR_INSTANCES_NBR] = {0};
+volatile uint32_t ToF_EventTimeUs[RANGING_SENSOR_INSTANCES_NBR] = {0}; /* Tofis_Time_Us */
+/* data ready interrupts while the flag was still set, a frame was lost */
+volatile uint32_t ToF_EventOverruns[RANGING_SENSOR_INSTANCES_NBR] = {0};
 
 /* Private function prototypes -----------------------------------------------*/
 static void MX_53L8A1_SimpleRanging_Init(void);
@@ -151,9 +155,9 @@ static void MX_53L8A1_SimpleRanging_Process(void)
   while (1)
   {
     /* interrupt mode */
-    if (ToF_EventDetected != 0)
+    if (ToF_EventDetected[VL53L8A1_DEV_CENTER] != 0)
     {
-      ToF_EventDetected = 0;
+      ToF_EventDetected[VL53L8A1_DEV_CENTER] = 0;
 
       status = VL53L8A1_RANGING_SENSOR_GetDistance(VL53L8A1_DEV_CENTER, &Result);
 
@@ -26,23 +26,74 @@ extern "C" {
 #include "app_tofis.h"
 #include "main.h"
 #include <stdio.h>
+#include <string.h>
 
 #include "53l8a1_ranging_sensor.h"
 #include "app_tof_pin_conf.h"
 #include "stm32f4xx_nucleo.h"
+#include "tofis_calib.h"
+#include "tofis_cmd.h"
+#include "tofis_event.h"
+#include "tofis_link.h"
+#include "tofis_rate.h"
+#include "tofis_telemetry.h"
 
 #ifdef TOFIS_TRANSMIT_RAW_DATA
+#include "tofis_time.h"
 #include "tofis_uart.h"
 #endif
 
 /* Private typedef -----------------------------------------------------------*/
 typedef uint8_t RANGING_SENSOR_Target_Order_t;
 
+/* State of a ranging sensor instance (VL53L8A1_DEV_*) */
+typedef struct {
+  uint8_t present;          /* answered at boot */
+  uint8_t enabled;          /* ranging, see the 'm' command */
+  uint8_t decoding;         /* frame read, device buffer not decoded yet */
+  uint32_t event_time_us;   /* data ready time of the frame being read */
+  uint32_t read_time_us;    /* end of the read of that frame */
+  uint32_t frame_transfers; /* I2C transactions of the last frame */
+  uint32_t transfers_mark;  /* platform.transfers at the last frame */
+  uint32_t frames;          /* frames read since the last rate report */
+  uint32_t frames_read;     /* frames read since boot, telemetry */
+  uint8_t stream_valid;     /* stream_count holds a frame of this start */
+  uint8_t stream_count;     /* streamcount of the last frame sent */
+  uint32_t stream_gaps;     /* frames missing from the streamcount */
+  uint32_t read_errors;     /* asynchronous reads that failed to end */
+} tofis_sensor_t;
+
+/* Settings asked for by the commands, applied together between two frames */
+typedef struct {
+  uint8_t profile;        /* RS_PROFILE_* */
+  uint8_t fields;         /* TOFIS_FIELD_* streamed */
+  uint8_t targets;        /* targets per zone */
+  uint8_t target_order;   /* VL53L8CX_TARGET_ORDER_* */
+  uint8_t sensors;        /* bit n: instance n ranges */
+  uint8_t frequency_hz;   /* ranging frequency */
+  uint8_t integration_ms; /* integration time, autonomous mode */
+} tofis_config_t;
+
 /* Private define ------------------------------------------------------------*/
 #define TIMING_BUDGET (30U) /* 5 ms < TimingBudget < 100 ms */
 #define RANGING_FREQUENCY                                                      \
   (10U) /* Ranging frequency Hz (shall be consistent with TimingBudget value)  \
          */
+/* encoding of the ranging frames the build asks for, the link budget falls
+ * back to smaller ones */
+#if defined(TOFIS_TRANSMIT_DELTA)
+#define TOFIS_BASE_ENCODING TOFIS_ENCODING_DELTA
+#elif defined(TOFIS_TRANSMIT_COMPACT)
+#define TOFIS_BASE_ENCODING TOFIS_ENCODING_COMPACT
+#else
+#define TOFIS_BASE_ENCODING TOFIS_ENCODING_RAW
+#endif
+/* I2C address a satellite is moved to at boot, the center sensor keeps the
+ * default one */
+#define SATELLITE_ADDRESS(instance)                                            \
+  (RANGING_SENSOR_VL53L8CX_ADDRESS + 2U * ((instance) + 1U))
+/* longest ranging data read, 1444 bytes take 33 ms at 400 kHz */
+#define TOFIS_READ_TIMEOUT_MS (100U)
 
 /* Private variables ---------------------------------------------------------*/
 static RANGING_SENSOR_Capabilities_t Cap;
@@ -50,6 +101,42 @@ static RANGING_SENSOR_ProfileConfig_t Profile;
 static RANGING_SENSOR_Result_t Result;
 static RANGING_SENSOR_Target_Order_t TargetOrder =
     VL53L8CX_TARGET_ORDER_CLOSEST;
+static uint8_t Fields = TOFIS_FIELDS_DEFAULT; /* TOFIS_FIELD_* streamed */
+static uint8_t Encoding = TOFIS_BASE_ENCODING; /* of the ranging frames */
+static tofis_link_t Link; /* UART budget, picks Encoding and Fields */
+static int8_t LinkHeadroom; /* planned for the current settings [%] */
+static uint32_t Outputs; /* sensor outputs read, narrowed at restarts only */
+static tofis_config_t Requested;
+static uint8_t ConfigPending; /* Requested differs, apply_config */
+static uint8_t ConfigId;      /* config_id of the frames sent */
+static uint32_t StoppedUs;    /* ranging stopped by the last restart */
+static uint32_t LastFrameUs;  /* data ready time of the last frame sent */
+static uint8_t GapPending;    /* no frame since the last restart */
+static uint32_t GapUs;        /* frames before and after the last restart */
+static tofis_sensor_t Sensors[RANGING_SENSOR_INSTANCES_NBR];
+static const char *const SensorNames[RANGING_SENSOR_INSTANCES_NBR] = {
+    "left", "center", "right"};
+static volatile uint8_t ReadPending; /* ranging data read in flight */
+static volatile uint32_t ReadSensor; /* instance of that read, last served */
+/* the interrupts may not start reads, the main loop uses the I2C bus */
+static volatile uint8_t BusHeld = 1;
+static tofis_cmd_rx_t CommandRx; /* terminal keys and framed commands */
+static uint8_t CommandRunning;   /* commands received meanwhile wait */
+/* last framed command run, a retransmission is only acknowledged again */
+static uint8_t AckValid;
+static uint8_t AckId;
+static uint8_t AckSequence;
+static uint8_t AckStatus;
+static uint32_t RateMarkUs; /* start of the frame rate measurement */
+static uint32_t IdleMarkUs; /* Tofis_Event_IdleUs at RateMarkUs */
+static uint32_t BytesMark;  /* bytes_sent at RateMarkUs */
+/* Tofis_Event_IdleUs at the last telemetry frame */
+static uint32_t TelemetryIdleUs;
+static uint8_t TelemetryRequested; /* 'i' or 'p', sent without waiting */
+static uint32_t ConfigErrors;      /* changes a sensor refused a setting of */
+#ifdef TOFIS_ADAPTIVE_RATE
+static tofis_rate_t Rate; /* frequency and integration time controller */
+#endif
 static int32_t status = 0;
 static volatile uint8_t PushButtonDetected = 0;
 
@@ -57,19 +144,63 @@ static tofis_slave_device_t _tofis_slave_device;
 
 // // already defined in app_tof.c
 // volatile uint8_t ToF_EventDetected;
-extern volatile uint8_t ToF_EventDetected;
+extern volatile uint8_t ToF_EventDetected[RANGING_SENSOR_INSTANCES_NBR];
+extern volatile uint32_t ToF_EventTimeUs[RANGING_SENSOR_INSTANCES_NBR];
+extern volatile uint32_t ToF_EventOverruns[RANGING_SENSOR_INSTANCES_NBR];
 
 /* Private function prototypes -----------------------------------------------*/
 static void MX_53L8A1_SimpleRanging_Init(void);
 static void MX_53L8A1_SimpleRanging_Process(void);
+static void sensor_reset(void);
+static VL53L8CX_Object_t *get_sensor(uint32_t instance);
+static void init_satellite(uint32_t instance);
+static void print_sensor_init(uint32_t instance, uint32_t init_start_us);
+static void start_sensor(uint32_t instance);
+static void start_sensors(void);
+static void stop_sensors(void);
+static uint8_t enabled_sensors(void);
+static void config_profile(void);
+static void apply_config(void);
+static uint8_t write_settings(const tofis_config_t *config, uint8_t changes,
+                              uint32_t outputs);
+static void announce_config(uint8_t changes);
+static void plan_link(const tofis_config_t *config, uint8_t sensors,
+                      tofis_link_plan_t *plan);
+static uint8_t max_frequency(uint8_t profile);
+static void adapt_rate(void);
+static void set_adaptive_rate(uint8_t enable);
+static void send_telemetry(void);
+static void start_next_read(void);
+static void hold_bus(void);
+static void release_bus(void);
+static void dispatch_events(void);
+#ifndef VL53L8A1_I2C_READREG_ASYNC
+static void read_frame(uint32_t instance);
+#endif
+static void decode_frame(uint32_t instance, int32_t read_status);
+static void run_commands(void);
+static void run_command(const tofis_cmd_t *cmd);
+static void process_result(uint32_t instance);
+static void count_frame_transfers(uint32_t instance);
 static void print_result(RANGING_SENSOR_Result_t *Result);
 static void toggle_resolution(void);
+static void toggle_target_order(void);
 static void toggle_signal_and_ambient(void);
+static void set_fields(uint8_t fields);
+static void set_targets(uint8_t targets);
+static void set_sensors(uint8_t mask);
+#ifndef TOFIS_TRANSMIT_RAW_DATA
+static void print_frame_rates(void);
+#endif
+static uint32_t fields_to_outputs(uint8_t fields);
+static void apply_outputs(void);
 static void clear_screen(void);
+#ifndef TOFIS_TRANSMIT_RAW_DATA
+static void print_i2c_usage(void);
+#endif
+static uint8_t erase_calib(void);
 static void display_commands_banner(void);
-static void handle_cmd(uint8_t cmd);
-static uint8_t get_key(void);
-static uint32_t com_has_data(void);
+static uint8_t handle_cmd(const tofis_cmd_t *cmd);
 
 void MX_TOFIS_Init(void) {
   /* USER CODE BEGIN SV */
@@ -109,9 +240,15 @@ void MX_TOFIS_Process(void) {
 // VL53L8CX_TARGET_ORDER_CLOSEST or VL53L8CX_TARGET_ORDER_STRONGEST
 
 static uint8_t Tofis_Set_Target_Order(uint8_t target_order) {
-  VL53L8CX_Object_t *vl53l8cx_obj_p =
-      (VL53L8CX_Object_t *)VL53L8A1_RANGING_SENSOR_CompObj[VL53L8A1_DEV_CENTER];
-  return vl53l8cx_set_target_order(&(vl53l8cx_obj_p->Dev), target_order);
+  uint8_t ret = 0;
+
+  for (uint32_t i = 0; i < RANGING_SENSOR_INSTANCES_NBR; i++) {
+    if (Sensors[i].present != 0) {
+      ret |= vl53l8cx_set_target_order(&get_sensor(i)->Dev, target_order);
+    }
+  }
+
+  return ret;
 }
 
 static uint8_t Tofis_Get_Target_Order(uint8_t target_order) {
@@ -122,16 +259,81 @@ static uint8_t Tofis_Get_Target_Order(uint8_t target_order) {
   return target_order;
 }
 
-static uint8_t toggle_target_order() {
-  VL53L8A1_RANGING_SENSOR_Stop(VL53L8A1_DEV_CENTER);
+static void toggle_target_order(void) {
+  Requested.target_order =
+      (Requested.target_order == VL53L8CX_TARGET_ORDER_CLOSEST)
+          ? VL53L8CX_TARGET_ORDER_STRONGEST
+          : VL53L8CX_TARGET_ORDER_CLOSEST;
+  ConfigPending = 1;
+}
 
-  TargetOrder = (TargetOrder == VL53L8CX_TARGET_ORDER_CLOSEST)
-                    ? VL53L8CX_TARGET_ORDER_STRONGEST
-                    : VL53L8CX_TARGET_ORDER_CLOSEST;
-  
-  Tofis_Set_Target_Order(TargetOrder);
+/**
+ * @brief Power cycles the sensor, its firmware has to be downloaded again.
+ */
+static void sensor_reset(void) {
+  HAL_GPIO_WritePin(VL53L8A1_PWR_EN_C_PORT, VL53L8A1_PWR_EN_C_PIN,
+                    GPIO_PIN_RESET);
+  HAL_Delay(2);
+  HAL_GPIO_WritePin(VL53L8A1_PWR_EN_C_PORT, VL53L8A1_PWR_EN_C_PIN,
+                    GPIO_PIN_SET);
+  HAL_Delay(2);
+  HAL_GPIO_WritePin(VL53L8A1_LPn_C_PORT, VL53L8A1_LPn_C_PIN, GPIO_PIN_RESET);
+  HAL_Delay(2);
+  HAL_GPIO_WritePin(VL53L8A1_LPn_C_PORT, VL53L8A1_LPn_C_PIN, GPIO_PIN_SET);
+  HAL_Delay(2);
+}
+
+/**
+ * @brief Returns the driver object of a ranging sensor instance.
+ */
+static VL53L8CX_Object_t *get_sensor(uint32_t instance) {
+  return (VL53L8CX_Object_t *)VL53L8A1_RANGING_SENSOR_CompObj[instance];
+}
+
+static void print_sensor_init(uint32_t instance, uint32_t init_start_us) {
+  VL53L8CX_Object_t *sensor = get_sensor(instance);
+
+  printf("Sensor %s init: 0x%02X, %s start, %lu ms%s\n",
+         SensorNames[instance], (unsigned)sensor->Dev.platform.address,
+         (sensor->IsWarmStart != 0U) ? "warm" : "cold",
+         (unsigned long)((Tofis_Time_Us() - init_start_us) / 1000U),
+         (sensor->Dev.offset_preloaded != 0U) ? ", calibration from flash"
+                                              : "");
+}
+
+/**
+ * @brief Brings a satellite up alone at the default address and moves it to
+ * SATELLITE_ADDRESS. One still powered from a previous run already answers
+ * there. An absent satellite is kept off the bus.
+ */
+static void init_satellite(uint32_t instance) {
+  uint32_t address = SATELLITE_ADDRESS(instance);
+  uint32_t init_start_us;
+
+  if (instance >= RANGING_SENSOR_INSTANCES_NBR) {
+    return;
+  }
+
+  ToF_Set_LPn(instance, GPIO_PIN_SET);
+  HAL_Delay(2);
+  init_start_us = Tofis_Time_Us();
 
-  VL53L8A1_RANGING_SENSOR_Start(VL53L8A1_DEV_CENTER, RS_MODE_ASYNC_CONTINUOUS);
+  status = VL53L8A1_RANGING_SENSOR_Init(instance);
+  if (status == BSP_ERROR_NONE) {
+    status = VL53L8A1_RANGING_SENSOR_SetAddress(instance, address);
+  } else {
+    status = VL53L8A1_RANGING_SENSOR_InitAtAddress(instance, address);
+  }
+
+  if (status != BSP_ERROR_NONE) {
+    ToF_Set_LPn(instance, GPIO_PIN_RESET);
+    printf("Sensor %s: not found\n", SensorNames[instance]);
+    return;
+  }
+
+  Sensors[instance].present = 1;
+  Sensors[instance].enabled = 1;
+  print_sensor_init(instance, init_start_us);
 }
 
 static void MX_53L8A1_SimpleRanging_Init(void) {
@@ -143,16 +345,16 @@ static void MX_53L8A1_SimpleRanging_Init(void) {
   BSP_PB_DeInit(BUTTON_KEY);
   BSP_PB_Init(BUTTON_KEY, BUTTON_MODE_EXTI);
 
-  /* Sensor reset */
-  HAL_GPIO_WritePin(VL53L8A1_PWR_EN_C_PORT, VL53L8A1_PWR_EN_C_PIN,
-                    GPIO_PIN_RESET);
-  HAL_Delay(2);
+  /* before any data ready interrupt can post to it */
+  Tofis_Event_Init();
+
+  /* Keep a sensor that is already powered, its firmware may still be loaded
+   * (warm start). Only one sensor may answer at the default address, the
+   * center one is held off the bus (LPn low) until the satellites moved. */
+  ToF_Satellite_Pins_Init();
   HAL_GPIO_WritePin(VL53L8A1_PWR_EN_C_PORT, VL53L8A1_PWR_EN_C_PIN,
                     GPIO_PIN_SET);
-  HAL_Delay(2);
-  HAL_GPIO_WritePin(VL53L8A1_LPn_C_PORT, VL53L8A1_LPn_C_PIN, GPIO_PIN_RESET);
-  HAL_Delay(2);
-  HAL_GPIO_WritePin(VL53L8A1_LPn_C_PORT, VL53L8A1_LPn_C_PIN, GPIO_PIN_SET);
+  ToF_Set_LPn(VL53L8A1_DEV_CENTER, GPIO_PIN_RESET);
   HAL_Delay(2);
 
   clear_screen();
@@ -163,19 +365,44 @@ static void MX_53L8A1_SimpleRanging_Init(void) {
   printf("Sensor initialization...\n");
 #endif
 
+  Tofis_Time_Init();
+
+  init_satellite(VL53L8A1_DEV_LEFT);
+  init_satellite(VL53L8A1_DEV_RIGHT);
+
+  ToF_Set_LPn(VL53L8A1_DEV_CENTER, GPIO_PIN_SET);
+  HAL_Delay(2);
+  uint32_t init_start_us = Tofis_Time_Us();
+
   VL53L8A1_RANGING_SENSOR_DeInit(VL53L8A1_DEV_CENTER);
   status = VL53L8A1_RANGING_SENSOR_Init(VL53L8A1_DEV_CENTER);
 
+  if (status != BSP_ERROR_NONE) {
+    /* unknown sensor state, power cycle it and download the firmware */
+    sensor_reset();
+    VL53L8A1_RANGING_SENSOR_DeInit(VL53L8A1_DEV_CENTER);
+    status = VL53L8A1_RANGING_SENSOR_Init(VL53L8A1_DEV_CENTER);
+  }
+
   if (status != BSP_ERROR_NONE) {
     printf("VL53L8A1_RANGING_SENSOR_Init failed\n");
     while (1)
       ;
   }
 
+  Sensors[VL53L8A1_DEV_CENTER].present = 1;
+  Sensors[VL53L8A1_DEV_CENTER].enabled = 1;
+  print_sensor_init(VL53L8A1_DEV_CENTER, init_start_us);
+
   Tofis_Slave_USART_Init(&_tofis_slave_device, &huart2);
+  Tofis_Link_Init(&Link, huart2.Init.BaudRate, TOFIS_BASE_ENCODING);
+
+  /* COM1 is USART2, the commands come in on the frames link */
+  Tofis_Cmd_Init(&CommandRx, &huart2);
 }
 
 static void MX_53L8A1_SimpleRanging_Process(void) {
+  VL53L8CX_Object_t *sensor = get_sensor(VL53L8A1_DEV_CENTER);
   uint32_t Id;
 
   VL53L8A1_RANGING_SENSOR_ReadID(VL53L8A1_DEV_CENTER, &Id);
@@ -190,7 +417,7 @@ static void MX_53L8A1_SimpleRanging_Process(void) {
   Profile.EnableSignal = 0;  /* Enable: 1, Disable: 0 */
 
   /* set the profile if different from default one */
-  VL53L8A1_RANGING_SENSOR_ConfigProfile(VL53L8A1_DEV_CENTER, &Profile);
+  config_profile();
 
   status = Tofis_Set_Target_Order(VL53L8CX_TARGET_ORDER_CLOSEST);
 
@@ -202,51 +429,883 @@ static void MX_53L8A1_SimpleRanging_Process(void) {
     printf("VL53L8A1_RANGING_SENSOR_Set to target order: CLOEST!\n");
   }
 
-  status = VL53L8A1_RANGING_SENSOR_Start(VL53L8A1_DEV_CENTER,
-                                         RS_MODE_ASYNC_CONTINUOUS);
+  apply_outputs();
+  start_sensors();
 
-  if (status != BSP_ERROR_NONE) {
+  /* the satellites are optional, start_sensors only disables them */
+  if (Sensors[VL53L8A1_DEV_CENTER].enabled == 0) {
     printf("VL53L8A1_RANGING_SENSOR_Start failed\n");
     while (1)
       ;
   }
+  printf("I2C read: %lu bytes/frame\n",
+         (unsigned long)sensor->Dev.data_read_size);
+
+  Requested.profile = Profile.RangingProfile;
+  Requested.fields = Fields;
+  Requested.targets = sensor->Dev.nb_target_per_zone;
+  Requested.target_order = TargetOrder;
+  Requested.sensors = enabled_sensors();
+  Requested.frequency_hz = (uint8_t)Profile.Frequency;
+  Requested.integration_ms = (uint8_t)Profile.TimingBudget;
+
+  RateMarkUs = Tofis_Time_Us();
+  IdleMarkUs = Tofis_Event_IdleUs();
+  BytesMark = _tofis_slave_device.bytes_sent;
+  /* the boot is not part of the first period */
+  Tofis_Telemetry_Init(RateMarkUs);
+  TelemetryIdleUs = IdleMarkUs;
+  set_adaptive_rate(1);
+  release_bus();
+
+  /* the encoding and fields of the build may not fit the link */
+  ConfigPending = 1;
+  run_commands();
+
+  /* everything is driven by the interrupts: data ready queues the read, its
+   * end queues the decode, the encoded frame is queued on the UART. The core
+   * sleeps in between */
+  while (1) {
+    dispatch_events();
+    adapt_rate();
+    send_telemetry();
+    Tofis_Cmd_Arm(&CommandRx);
+    Tofis_Event_Wait();
+  }
+}
+
+/**
+ * @brief Runs the queued events. The I2C and UART interrupts keep running, the
+ * next read is on the bus while a frame is decoded.
+ */
+static void dispatch_events(void) {
+  tofis_event_t event;
+
+  while (Tofis_Event_Get(&event) != 0U) {
+    switch (event.type) {
+    case TOFIS_EVENT_DATA_READY:
+#ifdef VL53L8A1_I2C_READREG_ASYNC
+      start_next_read();
+#else
+      read_frame(event.sensor);
+#endif
+      break;
+
+    case TOFIS_EVENT_FRAME_READ:
+      /* the next frame is read while this one is decoded */
+      start_next_read();
+      decode_frame(event.sensor, event.status);
+      break;
+
+    case TOFIS_EVENT_COMMAND:
+      /* a command running sends the frames read meanwhile, the bytes
+       * received meanwhile are parsed once it is done */
+      if (CommandRunning == 0) {
+        run_commands();
+      }
+      break;
+
+    default:
+      break;
+    }
+  }
+}
+
+#ifndef VL53L8A1_I2C_READREG_ASYNC
+/**
+ * @brief Reads a frame on the bus and sends it, builds without
+ * VL53L8A1_I2C_READREG_ASYNC.
+ */
+static void read_frame(uint32_t instance) {
+  if ((Sensors[instance].enabled == 0) ||
+      (ToF_EventDetected[instance] == 0)) {
+    return;
+  }
+  ToF_EventDetected[instance] = 0;
+  Sensors[instance].event_time_us = ToF_EventTimeUs[instance];
+
+  status = VL53L8A1_RANGING_SENSOR_GetDistance(instance, &Result);
+
+  if (status == BSP_ERROR_NONE) {
+    /* the blocking read also decoded the frame */
+    Sensors[instance].read_time_us = Tofis_Time_Us();
+    Tofis_Telemetry_Latency(TOFIS_STAGE_READ,
+                            Sensors[instance].read_time_us -
+                                Sensors[instance].event_time_us);
+    process_result(instance);
+    count_frame_transfers(instance);
+  }
+}
+#endif
+
+/**
+ * @brief Decodes and sends a frame read by the interrupts, then lets the main
+ * loop read that sensor again.
+ */
+static void decode_frame(uint32_t instance, int32_t read_status) {
+  status = read_status;
+  if (status == BSP_ERROR_NONE) {
+    /* fails on a corrupted frame, counted by the driver */
+    status = VL53L8A1_RANGING_SENSOR_GetDistanceComplete(instance, &Result);
+  } else {
+    Sensors[instance].read_errors++;
+  }
 
+  if (status == BSP_ERROR_NONE) {
+    process_result(instance);
+    count_frame_transfers(instance);
+  }
+
+  /* a frame announced while this one was waiting would overwrite it */
+  Sensors[instance].decoding = 0;
+  start_next_read();
+}
+
+/**
+ * @brief Runs the commands complete in the reception ring, the start of a
+ * command waits there for its next bytes. The settings they change are applied
+ * once the whole batch ran.
+ */
+static void run_commands(void) {
+  tofis_cmd_t cmd;
+
+  CommandRunning = 1;
   while (1) {
-    /* interrupt mode */
-    if (ToF_EventDetected != 0) {
-      ToF_EventDetected = 0;
+    if (Tofis_Cmd_Next(&CommandRx, &cmd) != 0U) {
+      run_command(&cmd);
+    } else if (ConfigPending != 0U) {
+      /* the commands received meanwhile are run after it */
+      apply_config();
+    } else {
+      break;
+    }
+  }
+  CommandRunning = 0;
+}
 
-      status =
-          VL53L8A1_RANGING_SENSOR_GetDistance(VL53L8A1_DEV_CENTER, &Result);
+/**
+ * @brief Runs a command and acknowledges it if it came framed. Settings are
+ * only requested here, apply_config writes them to the sensors.
+ */
+static void run_command(const tofis_cmd_t *cmd) {
+  uint8_t result;
 
-      // transmit data
-      if (status == BSP_ERROR_NONE) {
-#ifdef TOFIS_TRANSMIT_RAW_DATA
+  if ((cmd->binary != 0U) && (AckValid != 0U) && (cmd->id == AckId) &&
+      (cmd->sequence == AckSequence)) {
+    /* the host did not get the ack */
+    result = AckStatus;
+  } else {
+    result = handle_cmd(cmd);
+  }
 
-        uint8_t zones_per_line =
-            ((Profile.RangingProfile == RS_PROFILE_8x8_AUTONOMOUS) ||
-             (Profile.RangingProfile == RS_PROFILE_8x8_CONTINUOUS))
-                ? 8
-                : 4;
+  if (cmd->binary == 0U) {
+    if (result != TOFIS_CMD_STATUS_OK) {
+      printf("Command 0x%02X: status %u\n", (unsigned)cmd->id,
+             (unsigned)result);
+    }
+    return;
+  }
 
-        Tofis_Slave_USART_SendData_Le(&_tofis_slave_device, zones_per_line,
-                                      &Result);
+  AckValid = 1;
+  AckId = cmd->id;
+  AckSequence = cmd->sequence;
+  AckStatus = result;
+#ifdef TOFIS_TRANSMIT_RAW_DATA
+  Tofis_Slave_USART_SendAck(&_tofis_slave_device, cmd->id, cmd->sequence,
+                            result);
 #else
-        print_result(&Result);
+  printf("Ack 0x%02X #%u: status %u\n", (unsigned)cmd->id,
+         (unsigned)cmd->sequence, (unsigned)result);
+#endif
+}
+
+/**
+ * @brief Takes the I2C bus for the main loop: waits for the read in flight and
+ * sends the frames already read, none is decoded with a configuration changed
+ * in between. A read that does not end in time is aborted and counted as a
+ * read error.
+ */
+static void hold_bus(void) {
+  uint32_t start = HAL_GetTick();
+
+  BusHeld = 1;
+  while (ReadPending != 0) {
+    if ((HAL_GetTick() - start) > TOFIS_READ_TIMEOUT_MS) {
+      /* ends it through BSP_I2C1_ReadCpltCallback */
+      (void)BSP_I2C1_AbortRead();
+      start = HAL_GetTick();
+    }
+  }
+  dispatch_events();
+}
+
+/**
+ * @brief Lets the main loop start reads again and reads the frames announced
+ * while the bus was held.
+ */
+static void release_bus(void) {
+  BusHeld = 0;
+  start_next_read();
+}
+
+/**
+ * @brief Idle line or half of the reception ring filled, the main loop parses
+ * what arrived.
+ */
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size) {
+  tofis_event_t event = {.type = TOFIS_EVENT_COMMAND};
+
+  UNUSED(Size);
+  if (huart == CommandRx.huart) {
+    Tofis_Event_Post(&event);
+  }
+}
+
+/**
+ * @brief Data ready interrupt of a sensor, the main loop reads the frame. A
+ * read in flight delays it to the end of that read.
+ */
+void ToF_EventCallback(uint32_t Instance) {
+  tofis_event_t event = {.type = TOFIS_EVENT_DATA_READY,
+                         .sensor = (uint8_t)Instance};
+
+  Tofis_Event_Post(&event);
+}
+
+/**
+ * @brief End of the ranging data read started by start_next_read, queues its
+ * decode. The main loop starts the next read, the HAL polls the address phase
+ * against HAL_GetTick, which does not advance in an interrupt of the same
+ * priority as SysTick.
+ */
+void BSP_I2C1_ReadCpltCallback(int32_t Status) {
+  tofis_event_t event = {.type = TOFIS_EVENT_FRAME_READ,
+                         .sensor = (uint8_t)ReadSensor,
+                         .status = Status};
+
+  ReadPending = 0;
+  if (Status == BSP_ERROR_NONE) {
+    Sensors[ReadSensor].read_time_us = Tofis_Time_Us();
+    Tofis_Telemetry_Latency(TOFIS_STAGE_READ,
+                            Sensors[ReadSensor].read_time_us -
+                                Sensors[ReadSensor].event_time_us);
+  }
+  if (Tofis_Event_Post(&event) == 0U) {
+    Sensors[ReadSensor].decoding = 1;
+  }
+}
+
+/**
+ * @brief Starts the ranging data read of the next sensor with a frame ready,
+ * in turn after the last one served so that none can starve the others. Main
+ * loop only, with the interrupts enabled: only it starts reads, the interrupt
+ * ending one clears ReadPending.
+ */
+static void start_next_read(void) {
+#ifdef VL53L8A1_I2C_READREG_ASYNC
+  if ((ReadPending != 0) || (BusHeld != 0)) {
+    return;
+  }
+
+  for (uint32_t n = 1; n <= RANGING_SENSOR_INSTANCES_NBR; n++) {
+    uint32_t i = (ReadSensor + n) % RANGING_SENSOR_INSTANCES_NBR;
+    uint8_t detected;
+
+    if ((Sensors[i].enabled == 0) || (Sensors[i].decoding != 0)) {
+      continue;
+    }
+    /* a data ready in between would be cleared unread */
+    __disable_irq();
+    detected = ToF_EventDetected[i];
+    ToF_EventDetected[i] = 0;
+    Sensors[i].event_time_us = ToF_EventTimeUs[i];
+    __enable_irq();
+    if (detected == 0) {
+      continue;
+    }
+
+    /* the end of the read may come before GetDistanceStart returns */
+    ReadSensor = i;
+    ReadPending = 1;
+    if (VL53L8A1_RANGING_SENSOR_GetDistanceStart(i) == BSP_ERROR_NONE) {
+      return;
+    }
+    ReadPending = 0;
+  }
+#endif
+}
+
+/**
+ * @brief Starts an enabled sensor, disables it if it fails.
+ */
+static void start_sensor(uint32_t instance) {
+  ToF_EventDetected[instance] = 0;
+  /* the streamcount starts over */
+  Sensors[instance].stream_valid = 0;
+  if (VL53L8A1_RANGING_SENSOR_Start(instance, RS_MODE_ASYNC_CONTINUOUS) !=
+      BSP_ERROR_NONE) {
+    printf("Sensor %s: start failed\n", SensorNames[instance]);
+    Sensors[instance].enabled = 0;
+  }
+}
+
+/**
+ * @brief Starts the enabled sensors, one that fails is disabled.
+ */
+static void start_sensors(void) {
+  for (uint32_t i = 0; i < RANGING_SENSOR_INSTANCES_NBR; i++) {
+    if (Sensors[i].enabled != 0) {
+      start_sensor(i);
+    }
+  }
+}
+
+static void stop_sensors(void) {
+  for (uint32_t i = 0; i < RANGING_SENSOR_INSTANCES_NBR; i++) {
+    if (Sensors[i].enabled != 0) {
+      VL53L8A1_RANGING_SENSOR_Stop(i);
+    }
+  }
+}
+
+/**
+ * @brief Returns the ranging sensors, bit n is instance n.
+ */
+static uint8_t enabled_sensors(void) {
+  uint8_t mask = 0;
+
+  for (uint32_t i = 0; i < RANGING_SENSOR_INSTANCES_NBR; i++) {
+    if (Sensors[i].enabled != 0) {
+      mask |= (uint8_t)(1U << i);
+    }
+  }
+
+  return mask;
+}
+
+/**
+ * @brief Applies Profile to every sensor, call it while they are stopped.
+ */
+static void config_profile(void) {
+  for (uint32_t i = 0; i < RANGING_SENSOR_INSTANCES_NBR; i++) {
+    if (Sensors[i].present != 0) {
+      VL53L8A1_RANGING_SENSOR_ConfigProfile(i, &Profile);
+    }
+  }
+}
+
+/**
+ * @brief Applies the settings requested since the previous call, all at once
+ * between two frames. Only the resolution, the target order, the targets per
+ * zone and output blocks not read yet need the sensors stopped: they are
+ * restarted once for the whole batch and only the changed settings are
+ * written. The other changes take effect from the next frame encoded, a sensor
+ * switched on or off is started or stopped alone. Narrower outputs wait for
+ * the next restart, the extra blocks are read and not sent. The frequency is
+ * capped to the resolution's maximum, the integration time to its period.
+ */
+static void apply_config(void) {
+  tofis_config_t config = Requested;
+  tofis_link_plan_t plan;
+  uint32_t outputs;
+  uint8_t sensors = 0;
+  uint8_t changes = 0;
+  uint8_t restart;
+  uint32_t start_us;
+
+  ConfigPending = 0;
+
+  for (uint32_t i = 0; i < RANGING_SENSOR_INSTANCES_NBR; i++) {
+    if ((Sensors[i].present != 0) && ((config.sensors & (1U << i)) != 0U)) {
+      sensors |= (uint8_t)(1U << i);
+    }
+  }
+
+  /* 8x8 ranges up to 15 Hz, the integration ends within the period */
+  if (config.frequency_hz > max_frequency(config.profile)) {
+    config.frequency_hz = max_frequency(config.profile);
+  }
+  if (((config.profile == RS_PROFILE_4x4_AUTONOMOUS) ||
+       (config.profile == RS_PROFILE_8x8_AUTONOMOUS)) &&
+      (config.integration_ms + TOFIS_RATE_INTEGRATION_MARGIN_MS >
+       1000U / config.frequency_hz)) {
+    config.integration_ms = (uint8_t)(1000U / config.frequency_hz -
+                                      TOFIS_RATE_INTEGRATION_MARGIN_MS);
+  }
+  Requested.frequency_hz = config.frequency_hz;
+  Requested.integration_ms = config.integration_ms;
+
+  /* the requested fields the link carries, only their blocks are read */
+  plan_link(&config, sensors, &plan);
+  outputs = fields_to_outputs(plan.fields);
+  LinkHeadroom = plan.headroom_percent;
+
+  if (config.profile != Profile.RangingProfile) {
+    changes |= TOFIS_CONFIG_RESOLUTION;
+  }
+  if (plan.fields != Fields) {
+    changes |= TOFIS_CONFIG_FIELDS;
+  }
+  if (plan.encoding != Encoding) {
+    changes |= TOFIS_CONFIG_ENCODING;
+  }
+  if ((outputs & ~Outputs) != 0U) {
+    changes |= TOFIS_CONFIG_OUTPUTS;
+  }
+  if (config.targets !=
+      get_sensor(VL53L8A1_DEV_CENTER)->Dev.nb_target_per_zone) {
+    changes |= TOFIS_CONFIG_TARGETS;
+  }
+  if (config.target_order != TargetOrder) {
+    changes |= TOFIS_CONFIG_TARGET_ORDER;
+  }
+  if (sensors != enabled_sensors()) {
+    changes |= TOFIS_CONFIG_SENSORS;
+  }
+  if ((config.frequency_hz != Profile.Frequency) ||
+      (config.integration_ms != Profile.TimingBudget)) {
+    changes |= TOFIS_CONFIG_RATE;
+  }
+  if (changes == 0U) {
+    return;
+  }
+
+  /* the frames read so far are decoded and sent with the fields they were
+   * read for. Without a restart the read in flight has the new fields' blocks
+   * and takes them, only the frames already read are sent first. */
+  restart = ((changes & (TOFIS_CONFIG_RESTART | TOFIS_CONFIG_SENSORS)) != 0U)
+                ? 1U
+                : 0U;
+  if (restart != 0U) {
+    hold_bus();
+  } else {
+    dispatch_events();
+  }
+
+  /* the BSP fills ambient and signal of the next results only if enabled */
+  Fields = plan.fields;
+#ifdef TOFIS_TRANSMIT_RAW_DATA
+  if ((plan.encoding == TOFIS_ENCODING_DELTA) &&
+      (Encoding != TOFIS_ENCODING_DELTA)) {
+    /* the delta references were last updated in a previous delta mode */
+    Tofis_Slave_USART_ResetDelta(&_tofis_slave_device);
+  }
 #endif
+  Encoding = plan.encoding;
+  Profile.EnableAmbient = (Fields & TOFIS_FIELD_AMBIENT) ? 1U : 0U;
+  Profile.EnableSignal = (Fields & TOFIS_FIELD_SIGNAL) ? 1U : 0U;
+  for (uint32_t i = 0; i < RANGING_SENSOR_INSTANCES_NBR; i++) {
+    if (Sensors[i].present != 0) {
+      get_sensor(i)->IsAmbientEnabled = Profile.EnableAmbient;
+      get_sensor(i)->IsSignalEnabled = Profile.EnableSignal;
+    }
+  }
+
+  if (restart != 0U) {
+    start_us = Tofis_Time_Us();
+
+    if ((changes & TOFIS_CONFIG_RESTART) != 0U) {
+      stop_sensors();
+      if (write_settings(&config, changes, outputs) != 0U) {
+        ConfigErrors++;
+#ifndef TOFIS_TRANSMIT_RAW_DATA
+        printf("Reconfiguration failed\n");
+#endif
+      }
+      for (uint32_t i = 0; i < RANGING_SENSOR_INSTANCES_NBR; i++) {
+        Sensors[i].enabled = ((sensors & (1U << i)) != 0U) ? 1U : 0U;
       }
+      start_sensors();
+      StoppedUs = Tofis_Time_Us() - start_us;
+      GapPending = 1;
+    } else {
+      for (uint32_t i = 0; i < RANGING_SENSOR_INSTANCES_NBR; i++) {
+        uint8_t enable = ((sensors & (1U << i)) != 0U) ? 1U : 0U;
+
+        if ((Sensors[i].enabled != 0) && (enable == 0U)) {
+          VL53L8A1_RANGING_SENSOR_Stop(i);
+          Sensors[i].enabled = 0;
+        } else if ((Sensors[i].enabled == 0) && (enable != 0U)) {
+          Sensors[i].enabled = 1;
+          start_sensor(i);
+        }
+      }
+    }
+
+    /* the configuration transactions are not part of a frame */
+    for (uint32_t i = 0; i < RANGING_SENSOR_INSTANCES_NBR; i++) {
+      if (Sensors[i].present != 0) {
+        Sensors[i].transfers_mark = get_sensor(i)->Dev.platform.transfers;
+      }
+    }
+    release_bus();
+  }
+
+  if ((changes & TOFIS_CONFIG_SENSORS) != 0U) {
+    /* new baseline for 'p' */
+    for (uint32_t i = 0; i < RANGING_SENSOR_INSTANCES_NBR; i++) {
+      Sensors[i].frames = 0;
+    }
+    RateMarkUs = Tofis_Time_Us();
+    IdleMarkUs = Tofis_Event_IdleUs();
+    BytesMark = _tofis_slave_device.bytes_sent;
+#ifdef TOFIS_TRANSMIT_RAW_DATA
+    Tofis_Slave_USART_ResetLatency(&_tofis_slave_device);
+#endif
+  }
+
+#ifdef TOFIS_ADAPTIVE_RATE
+  Tofis_Rate_Applied(&Rate, (uint8_t)Profile.Frequency,
+                     (uint8_t)Profile.TimingBudget);
+#endif
+  announce_config(changes);
+}
+
+/**
+ * @brief Writes the changed settings that need a restart to every sensor
+ * present, call it while they are stopped. The resolution also sends the
+ * offset and xtalk data again, the others are a single DCI access each.
+ *
+ * @return uint8_t 0 if every sensor took them.
+ */
+static uint8_t write_settings(const tofis_config_t *config, uint8_t changes,
+                              uint32_t outputs) {
+  uint8_t resolution =
+      ((config->profile == RS_PROFILE_8x8_AUTONOMOUS) ||
+       (config->profile == RS_PROFILE_8x8_CONTINUOUS))
+          ? VL53L8CX_RESOLUTION_8X8
+          : VL53L8CX_RESOLUTION_4X4;
+  uint8_t ret = 0;
+
+  for (uint32_t i = 0; i < RANGING_SENSOR_INSTANCES_NBR; i++) {
+    VL53L8CX_Configuration *dev = &get_sensor(i)->Dev;
+
+    if (Sensors[i].present == 0) {
+      continue;
+    }
+    if ((changes & TOFIS_CONFIG_RESOLUTION) != 0U) {
+      ret |= vl53l8cx_set_resolution(dev, resolution);
+    }
+    if ((changes & TOFIS_CONFIG_TARGET_ORDER) != 0U) {
+      ret |= vl53l8cx_set_target_order(dev, config->target_order);
+    }
+    if ((changes & TOFIS_CONFIG_TARGETS) != 0U) {
+      ret |= vl53l8cx_set_nb_target_per_zone(dev, config->targets);
+    }
+    if ((changes & TOFIS_CONFIG_RATE) != 0U) {
+      ret |= vl53l8cx_set_ranging_frequency_hz(dev, config->frequency_hz);
+      ret |= vl53l8cx_set_integration_time_ms(dev, config->integration_ms);
+    }
+    /* sent by the start, narrower outputs are also taken here */
+    ret |= vl53l8cx_set_output_enable(dev, outputs);
+  }
+
+  /* a setting a sensor refused is requested again at the next change */
+  Profile.RangingProfile = config->profile;
+  TargetOrder = config->target_order;
+  Profile.Frequency = config->frequency_hz;
+  Profile.TimingBudget = config->integration_ms;
+  Outputs = outputs;
+
+  return ret;
+}
+
+/**
+ * @brief Tags the next frames with a new config_id and tells the host what
+ * changed.
+ */
+static void announce_config(uint8_t changes) {
+  VL53L8CX_Object_t *sensor = get_sensor(VL53L8A1_DEV_CENTER);
+
+  ConfigId++;
+
+#ifdef TOFIS_TRANSMIT_RAW_DATA
+  tofis_config_desc_t desc = {
+      .config_id = ConfigId,
+      .changes = changes,
+      .resolution = ((Profile.RangingProfile == RS_PROFILE_8x8_AUTONOMOUS) ||
+                     (Profile.RangingProfile == RS_PROFILE_8x8_CONTINUOUS))
+                        ? 8
+                        : 4,
+      .fields = Fields,
+      .targets = sensor->Dev.nb_target_per_zone,
+      .target_order = TargetOrder,
+      .sensors = enabled_sensors(),
+      .frequency_hz = (uint8_t)Profile.Frequency,
+      .stopped_us =
+          ((changes & TOFIS_CONFIG_RESTART) != 0U) ? StoppedUs : 0U,
+      .integration_ms = (uint8_t)Profile.TimingBudget,
+#ifdef TOFIS_ADAPTIVE_RATE
+      .adaptive = Rate.enabled,
+#endif
+      .encoding = Encoding,
+      .headroom_percent = LinkHeadroom,
+  };
+
+  Tofis_Slave_USART_SendConfig(&_tofis_slave_device, &desc);
+#else
+  printf("Config #%u: changes 0x%02X, %s, I2C read %lu bytes/frame\n",
+         (unsigned)ConfigId, (unsigned)changes,
+         ((changes & TOFIS_CONFIG_RESTART) != 0U) ? "restarted" : "no restart",
+         (unsigned long)sensor->Dev.data_read_size);
+#endif
+}
+
+/**
+ * @brief Encoding and fields of the ranging frames for a configuration, with
+ * the given sensors ranging. Printed results are not budgeted.
+ */
+static void plan_link(const tofis_config_t *config, uint8_t sensors,
+                      tofis_link_plan_t *plan) {
+#ifdef TOFIS_TRANSMIT_RAW_DATA
+  tofis_link_demand_t demand = {
+      .resolution = ((config->profile == RS_PROFILE_8x8_AUTONOMOUS) ||
+                     (config->profile == RS_PROFILE_8x8_CONTINUOUS))
+                        ? 8
+                        : 4,
+      .targets = config->targets,
+      .fields = config->fields,
+      .frequency_hz = config->frequency_hz,
+      .sensors = 0,
+  };
+
+  for (uint32_t i = 0; i < RANGING_SENSOR_INSTANCES_NBR; i++) {
+    demand.sensors += ((sensors & (1U << i)) != 0U) ? 1U : 0U;
+  }
+  Tofis_Link_Plan(&Link, &demand, plan);
+#else
+  UNUSED(sensors);
+  plan->encoding = TOFIS_BASE_ENCODING;
+  plan->fields = config->fields;
+  plan->headroom_percent = 0;
+  plan->frame_size = 0;
+#endif
+}
+
+/**
+ * @brief Highest ranging frequency of a profile's resolution.
+ */
+static uint8_t max_frequency(uint8_t profile) {
+  return ((profile == RS_PROFILE_8x8_AUTONOMOUS) ||
+          (profile == RS_PROFILE_8x8_CONTINUOUS))
+             ? TOFIS_RATE_MAX_HZ_8X8
+             : TOFIS_RATE_MAX_HZ_4X4;
+}
+
+/**
+ * @brief Once per controller window, requests the frequency and integration
+ * time the scene and the link call for. They are applied like the settings of
+ * a command, between two frames.
+ */
+static void adapt_rate(void) {
+#ifdef TOFIS_ADAPTIVE_RATE
+  tofis_slave_device_t *device = &_tofis_slave_device;
+  tofis_rate_link_t link = {
+      .bytes_sent = device->bytes_sent,
+      .frames_sent = device->frames_sent,
+      .frames_dropped = device->frames_dropped,
+  };
+  uint8_t sensors = 0;
+  uint8_t frequency_hz;
+  uint8_t integration_ms;
+
+  for (uint32_t i = 0; i < RANGING_SENSOR_INSTANCES_NBR; i++) {
+    sensors += (Sensors[i].enabled != 0) ? 1U : 0U;
+  }
+
+  if (Tofis_Rate_Update(
+          &Rate, Tofis_Time_Us(), &link, sensors,
+          max_frequency(Profile.RangingProfile),
+          (Profile.RangingProfile == RS_PROFILE_4x4_AUTONOMOUS) ||
+              (Profile.RangingProfile == RS_PROFILE_8x8_AUTONOMOUS),
+          &frequency_hz, &integration_ms) == 0U) {
+    return;
+  }
+
+  Requested.frequency_hz = frequency_hz;
+  Requested.integration_ms = integration_ms;
+  ConfigPending = 1;
+  if (CommandRunning == 0) {
+    run_commands();
+  }
+#endif
+}
+
+/**
+ * @brief Starts the frequency controller from the current settings, or stops
+ * it and returns to RANGING_FREQUENCY and TIMING_BUDGET.
+ */
+static void set_adaptive_rate(uint8_t enable) {
+#ifdef TOFIS_ADAPTIVE_RATE
+  tofis_slave_device_t *device = &_tofis_slave_device;
+  tofis_rate_link_t link = {
+      .bytes_sent = device->bytes_sent,
+      .frames_sent = device->frames_sent,
+      .frames_dropped = device->frames_dropped,
+  };
+
+  if (enable != 0U) {
+    if (Rate.enabled == 0U) {
+      /* 8N1: 10 bits per byte */
+      Tofis_Rate_Init(&Rate, device->huart->Init.BaudRate / 10U,
+                      (uint8_t)Profile.Frequency,
+                      (uint8_t)Profile.TimingBudget, &link, Tofis_Time_Us());
     }
-    if (com_has_data()) {
-      handle_cmd(get_key());
+    return;
+  }
+
+  Rate.enabled = 0;
+  Requested.frequency_hz = RANGING_FREQUENCY;
+  Requested.integration_ms = TIMING_BUDGET;
+  ConfigPending = 1;
+#else
+  UNUSED(enable);
+#endif
+}
+
+/**
+ * @brief Once per TOFIS_TELEMETRY_PERIOD_US, or once asked by 'i' or 'p',
+ * sends the counters since boot and the latencies of the period. Printed
+ * results only restart the period, 'p' prints the counters instead.
+ */
+static void send_telemetry(void) {
+  tofis_slave_device_t *device = &_tofis_slave_device;
+  tofis_telemetry_t telemetry;
+  uint32_t now_us = Tofis_Time_Us();
+  uint32_t idle_us = Tofis_Event_IdleUs();
+
+  if ((TelemetryRequested == 0U) && (Tofis_Telemetry_Due(now_us) == 0U)) {
+    return;
+  }
+  TelemetryRequested = 0;
+
+  memset(&telemetry, 0, sizeof(telemetry));
+  Tofis_Telemetry_Take(&telemetry, now_us);
+  telemetry.frames_sent = device->frames_sent;
+  telemetry.frames_dropped = device->frames_dropped;
+  telemetry.tx_errors = device->tx_errors;
+  telemetry.events_lost = Tofis_Event_Lost();
+  telemetry.config_errors = ConfigErrors;
+  telemetry.queue_high_water = (uint8_t)Tofis_Event_HighWater();
+  if (telemetry.period_us != 0U) {
+    telemetry.idle_percent = (uint8_t)((uint64_t)(idle_us - TelemetryIdleUs) *
+                                       100U / telemetry.period_us);
+  }
+  TelemetryIdleUs = idle_us;
+
+  for (uint32_t i = 0; i < RANGING_SENSOR_INSTANCES_NBR; i++) {
+    tofis_sensor_counters_t *counters = &telemetry.sensor[i];
+
+    if (Sensors[i].present == 0) {
+      continue;
     }
+    counters->stream_gaps = Sensors[i].stream_gaps;
+    counters->overruns = ToF_EventOverruns[i];
+    counters->corrupted = get_sensor(i)->CorruptedFrames;
+    counters->i2c_errors =
+        get_sensor(i)->Dev.platform.errors + Sensors[i].read_errors;
+    counters->frames = Sensors[i].frames_read;
+    counters->frame_transfers = (uint16_t)Sensors[i].frame_transfers;
+    counters->frame_bytes = (uint16_t)get_sensor(i)->Dev.data_read_size;
+  }
+
+#ifdef TOFIS_TRANSMIT_RAW_DATA
+  Tofis_Slave_USART_SendTelemetry(device, &telemetry);
+#endif
+}
+
+/**
+ * @brief Transmits (or prints) the frame of a sensor just read into Result.
+ */
+static void process_result(uint32_t instance) {
+  tofis_sensor_t *state = &Sensors[instance];
+  uint8_t stream_count = get_sensor(instance)->Dev.streamcount;
+
+  state->frames++;
+  state->frames_read++;
+  if (state->stream_valid != 0U) {
+    state->stream_gaps += (uint8_t)(stream_count - state->stream_count - 1U);
+  }
+  state->stream_valid = 1;
+  state->stream_count = stream_count;
+
+  /* first frame of the new settings */
+  if (GapPending != 0U) {
+    GapPending = 0;
+    GapUs = state->event_time_us - LastFrameUs;
+  }
+  LastFrameUs = state->event_time_us;
+
+#ifdef TOFIS_ADAPTIVE_RATE
+  Tofis_Rate_AddFrame(&Rate, (uint8_t)instance, &Result);
+#endif
+
+#ifdef TOFIS_TRANSMIT_RAW_DATA
+
+  uint8_t zones_per_line =
+      ((Profile.RangingProfile == RS_PROFILE_8x8_AUTONOMOUS) ||
+       (Profile.RangingProfile == RS_PROFILE_8x8_CONTINUOUS))
+          ? 8
+          : 4;
+  VL53L8CX_Object_t *sensor = get_sensor(instance);
+
+  Tofis_Slave_USART_SetFrameInfo(&_tofis_slave_device, (uint8_t)instance,
+                                 stream_count, state->event_time_us);
+
+  tofis_frame_source_t source = {
+      .resolution = zones_per_line,
+      .fields = Fields,
+      .targets = sensor->Dev.nb_target_per_zone,
+      .result = &Result,
+      .raw = &sensor->Results,
+  };
+
+  switch (Encoding) {
+  case TOFIS_ENCODING_DELTA:
+    Tofis_Slave_USART_SendData_Delta(&_tofis_slave_device, &source);
+    break;
+
+  case TOFIS_ENCODING_COMPACT:
+    Tofis_Slave_USART_SendData_Compact(&_tofis_slave_device, &source);
+    break;
+
+  default:
+    Tofis_Slave_USART_SendData_Le(&_tofis_slave_device, zones_per_line,
+                                  &Result);
+    break;
+  }
+#else
+  /* one matrix fits the terminal, 'p' reports the other sensors */
+  if (instance == VL53L8A1_DEV_CENTER) {
+    print_result(&Result);
   }
+#endif
+
+  Tofis_Telemetry_Latency(TOFIS_STAGE_PROCESS,
+                          Tofis_Time_Us() - state->read_time_us);
+}
+
+/**
+ * @brief Counts the I2C transactions of a sensor since its previous frame:
+ * data ready poll, ranging data read and any configuration access of the
+ * driver.
+ */
+static void count_frame_transfers(uint32_t instance) {
+  tofis_sensor_t *state = &Sensors[instance];
+  uint32_t transfers = get_sensor(instance)->Dev.platform.transfers;
+
+  state->frame_transfers = transfers - state->transfers_mark;
+  state->transfers_mark = transfers;
 }
 
 static void print_result(RANGING_SENSOR_Result_t *Result) {
+  VL53L8CX_Object_t *sensor =
+      (VL53L8CX_Object_t *)VL53L8A1_RANGING_SENSOR_CompObj[VL53L8A1_DEV_CENTER];
   int8_t i;
   int8_t j;
   int8_t k;
   int8_t l;
+  int8_t targets = (int8_t)sensor->Dev.nb_target_per_zone;
   uint8_t zones_per_line;
 
   zones_per_line = ((Profile.RangingProfile == RS_PROFILE_8x8_AUTONOMOUS) ||
@@ -257,7 +1316,7 @@ static void print_result(RANGING_SENSOR_Result_t *Result) {
   display_commands_banner();
 
   printf("Cell Format :\n\n");
-  for (l = 0; l < RANGING_SENSOR_NB_TARGET_PER_ZONE; l++) {
+  for (l = 0; l < targets; l++) {
     printf(" \033[38;5;10m%20s\033[0m : %20s\n", "Distance [mm]", "Status");
     if ((Profile.EnableAmbient != 0) || (Profile.EnableSignal != 0)) {
       printf(" %20s : %20s\n", "Signal [kcps/spad]", "Ambient [kcps/spad]");
@@ -278,12 +1337,12 @@ static void print_result(RANGING_SENSOR_Result_t *Result) {
     }
     printf("|\n");
 
-    for (l = 0; l < RANGING_SENSOR_NB_TARGET_PER_ZONE; l++) {
+    for (l = 0; l < targets; l++) {
       /* Print distance and status */
       // inverse k logic
       for (k = (zones_per_line - 1); k >= 0; k--) {
         //   for (k = 0; k < zones_per_line; k++) {
-        if (Result->ZoneResult[j + k].NumberOfTargets > 0)
+        if (Result->ZoneResult[j + k].NumberOfTargets > l)
           printf("| \033[38;5;10m%5ld\033[0m  :  %5ld ",
                  (long)Result->ZoneResult[j + k].Distance[l],
                  (long)Result->ZoneResult[j + k].Status[l]);
@@ -295,7 +1354,7 @@ static void print_result(RANGING_SENSOR_Result_t *Result) {
       if ((Profile.EnableAmbient != 0) || (Profile.EnableSignal != 0)) {
         /* Print Signal and Ambient */
         for (k = (zones_per_line - 1); k >= 0; k--) {
-          if (Result->ZoneResult[j + k].NumberOfTargets > 0) {
+          if (Result->ZoneResult[j + k].NumberOfTargets > l) {
             if (Profile.EnableSignal != 0) {
               printf("| %5ld  :  ", (long)Result->ZoneResult[j + k].Signal[l]);
             } else
@@ -320,41 +1379,110 @@ static void print_result(RANGING_SENSOR_Result_t *Result) {
 }
 
 static void toggle_resolution(void) {
-  VL53L8A1_RANGING_SENSOR_Stop(VL53L8A1_DEV_CENTER);
-
-  switch (Profile.RangingProfile) {
+  switch (Requested.profile) {
   case RS_PROFILE_4x4_AUTONOMOUS:
-    Profile.RangingProfile = RS_PROFILE_8x8_AUTONOMOUS;
+    Requested.profile = RS_PROFILE_8x8_AUTONOMOUS;
     break;
 
   case RS_PROFILE_4x4_CONTINUOUS:
-    Profile.RangingProfile = RS_PROFILE_8x8_CONTINUOUS;
+    Requested.profile = RS_PROFILE_8x8_CONTINUOUS;
     break;
 
   case RS_PROFILE_8x8_AUTONOMOUS:
-    Profile.RangingProfile = RS_PROFILE_4x4_AUTONOMOUS;
+    Requested.profile = RS_PROFILE_4x4_AUTONOMOUS;
     break;
 
   case RS_PROFILE_8x8_CONTINUOUS:
-    Profile.RangingProfile = RS_PROFILE_4x4_CONTINUOUS;
+    Requested.profile = RS_PROFILE_4x4_CONTINUOUS;
     break;
 
   default:
     break;
   }
-
-  VL53L8A1_RANGING_SENSOR_ConfigProfile(VL53L8A1_DEV_CENTER, &Profile);
-  VL53L8A1_RANGING_SENSOR_Start(VL53L8A1_DEV_CENTER, RS_MODE_ASYNC_CONTINUOUS);
+  ConfigPending = 1;
 }
 
 static void toggle_signal_and_ambient(void) {
-  VL53L8A1_RANGING_SENSOR_Stop(VL53L8A1_DEV_CENTER);
+  if ((Requested.fields & TOFIS_FIELD_AMBIENT) == 0U) {
+    Requested.fields |= TOFIS_FIELD_SIGNAL | TOFIS_FIELD_AMBIENT;
+  } else {
+    Requested.fields &= (uint8_t)~(TOFIS_FIELD_SIGNAL | TOFIS_FIELD_AMBIENT);
+  }
+  ConfigPending = 1;
+}
+
+/**
+ * @brief Selects the TOFIS_FIELD_* streamed. The ambient and signal outputs of
+ * the BSP and the blocks read from the sensor follow the mask.
+ */
+static void set_fields(uint8_t fields) {
+  Requested.fields = fields;
+  ConfigPending = 1;
+}
+
+/**
+ * @brief Selects the targets sent per zone, 1 to
+ * RANGING_SENSOR_NB_TARGET_PER_ZONE (build time capacity). A second target
+ * sees through glass or past a partial occlusion, each one adds to the I2C read
+ * and to the compact frames.
+ */
+static void set_targets(uint8_t targets) {
+  Requested.targets = targets;
+  ConfigPending = 1;
+}
+
+/**
+ * @brief Sensor outputs needed to stream the TOFIS_FIELD_* mask. The number
+ * of targets, the distance and the status fill every BSP result, the other
+ * blocks are only read over I2C when streamed. Temperature is in the always
+ * read metadata.
+ */
+static uint32_t fields_to_outputs(uint8_t fields) {
+  uint32_t outputs = VL53L8CX_OUTPUT_NB_TARGET_DETECTED |
+                     VL53L8CX_OUTPUT_DISTANCE_MM |
+                     VL53L8CX_OUTPUT_TARGET_STATUS;
+
+#ifndef VL53L8CX_DISABLE_AMBIENT_PER_SPAD
+  if (fields & TOFIS_FIELD_AMBIENT) {
+    outputs |= VL53L8CX_OUTPUT_AMBIENT_PER_SPAD;
+  }
+#endif
+#ifndef VL53L8CX_DISABLE_SIGNAL_PER_SPAD
+  if (fields & TOFIS_FIELD_SIGNAL) {
+    outputs |= VL53L8CX_OUTPUT_SIGNAL_PER_SPAD;
+  }
+#endif
+#ifndef VL53L8CX_DISABLE_RANGE_SIGMA_MM
+  if (fields & TOFIS_FIELD_SIGMA) {
+    outputs |= VL53L8CX_OUTPUT_RANGE_SIGMA_MM;
+  }
+#endif
+#ifndef VL53L8CX_DISABLE_REFLECTANCE_PERCENT
+  if (fields & TOFIS_FIELD_REFLECTANCE) {
+    outputs |= VL53L8CX_OUTPUT_REFLECTANCE_PERCENT;
+  }
+#endif
+#ifndef VL53L8CX_DISABLE_NB_SPADS_ENABLED
+  if (fields & TOFIS_FIELD_SPADS) {
+    outputs |= VL53L8CX_OUTPUT_NB_SPADS_ENABLED;
+  }
+#endif
 
-  Profile.EnableAmbient = (Profile.EnableAmbient) ? 0U : 1U;
-  Profile.EnableSignal = (Profile.EnableSignal) ? 0U : 1U;
+  return outputs;
+}
 
-  VL53L8A1_RANGING_SENSOR_ConfigProfile(VL53L8A1_DEV_CENTER, &Profile);
-  VL53L8A1_RANGING_SENSOR_Start(VL53L8A1_DEV_CENTER, RS_MODE_ASYNC_CONTINUOUS);
+/**
+ * @brief Selects the sensor outputs of Fields, call it while the sensors are
+ * stopped, it takes effect at the next start.
+ */
+static void apply_outputs(void) {
+  Outputs = fields_to_outputs(Fields);
+  for (uint32_t i = 0; i < RANGING_SENSOR_INSTANCES_NBR; i++) {
+    if (Sensors[i].present != 0) {
+      vl53l8cx_set_output_enable(&get_sensor(i)->Dev,
+                                 Outputs);
+    }
+  }
 }
 
 static void clear_screen(void) {
@@ -362,6 +1490,146 @@ static void clear_screen(void) {
   printf("\033[2J\033[H");
 }
 
+#ifndef TOFIS_TRANSMIT_RAW_DATA
+static void print_i2c_usage(void) {
+  for (uint32_t i = 0; i < RANGING_SENSOR_INSTANCES_NBR; i++) {
+    if (Sensors[i].present == 0) {
+      continue;
+    }
+    printf("I2C %s: %lu transactions, %lu bytes read per frame\n",
+           SensorNames[i], (unsigned long)Sensors[i].frame_transfers,
+           (unsigned long)get_sensor(i)->Dev.data_read_size);
+  }
+}
+#endif
+
+/**
+ * @brief Erases the calibration store, the offsets are read from the NVM again
+ * at the next init. The sector erase stalls every flash fetch, interrupts
+ * included, for up to ~2 s: the sensors are stopped meanwhile and the ack
+ * status is the only report.
+ */
+static uint8_t erase_calib(void) {
+  uint8_t result = TOFIS_CMD_STATUS_OK;
+
+  hold_bus();
+  stop_sensors();
+  if (Tofis_Calib_Erase() != 0) {
+    result = TOFIS_CMD_STATUS_FAILED;
+  }
+  start_sensors();
+
+  /* the restart transactions are not part of a frame */
+  for (uint32_t i = 0; i < RANGING_SENSOR_INSTANCES_NBR; i++) {
+    if (Sensors[i].present != 0) {
+      Sensors[i].transfers_mark = get_sensor(i)->Dev.platform.transfers;
+    }
+  }
+  release_bus();
+
+  return result;
+}
+
+/**
+ * @brief Selects the sensors that range, bit n of the mask is instance n
+ * (VL53L8A1_DEV_*). 'm2' leaves the center one alone, the single sensor
+ * baseline of the rates printed by 'p'.
+ */
+static void set_sensors(uint8_t mask) {
+  Requested.sensors = mask;
+  ConfigPending = 1;
+}
+
+#ifndef TOFIS_TRANSMIT_RAW_DATA
+/**
+ * @brief Prints the frames read per second by each sensor since the previous
+ * report and their sum, against the configured rate of a single sensor, the
+ * data ready to transmission start latency and the time the core slept. The
+ * error counters run since boot, like the telemetry frames.
+ */
+static void print_frame_rates(void) {
+  uint32_t now_us = Tofis_Time_Us();
+  uint32_t elapsed_us = now_us - RateMarkUs;
+  uint32_t idle_us = Tofis_Event_IdleUs();
+  uint32_t idle; /* [1/10 %] */
+  tofis_slave_device_t *device = &_tofis_slave_device;
+  uint32_t frames = 0;
+  uint32_t sensors = 0;
+  uint32_t rate; /* [1/100 fps] */
+
+  if (elapsed_us == 0U) {
+    return;
+  }
+
+  for (uint32_t i = 0; i < RANGING_SENSOR_INSTANCES_NBR; i++) {
+    if (Sensors[i].present == 0) {
+      continue;
+    }
+    rate = (uint32_t)((uint64_t)Sensors[i].frames * 100000000U / elapsed_us);
+    printf("Sensor %s: %lu.%02lu fps%s, %lu gaps, %lu overruns, %lu "
+           "corrupted, %lu I2C errors\n",
+           SensorNames[i], (unsigned long)(rate / 100U),
+           (unsigned long)(rate % 100U),
+           (Sensors[i].enabled != 0) ? "" : " (stopped)",
+           (unsigned long)Sensors[i].stream_gaps,
+           (unsigned long)ToF_EventOverruns[i],
+           (unsigned long)get_sensor(i)->CorruptedFrames,
+           (unsigned long)(get_sensor(i)->Dev.platform.errors +
+                           Sensors[i].read_errors));
+    frames += Sensors[i].frames;
+    sensors += (Sensors[i].enabled != 0) ? 1U : 0U;
+    Sensors[i].frames = 0;
+  }
+
+  rate = (uint32_t)((uint64_t)frames * 100000000U / elapsed_us);
+  printf("Aggregate: %lu.%02lu fps from %lu sensors, %lu.%02lu x one sensor "
+         "at %lu Hz\n",
+         (unsigned long)(rate / 100U), (unsigned long)(rate % 100U),
+         (unsigned long)sensors,
+         (unsigned long)(rate / Profile.Frequency / 100U),
+         (unsigned long)(rate / Profile.Frequency % 100U),
+         (unsigned long)Profile.Frequency);
+  printf("UART: %lu frames sent, %lu dropped, %lu tx errors\n",
+         (unsigned long)device->frames_sent,
+         (unsigned long)device->frames_dropped,
+         (unsigned long)device->tx_errors);
+  printf("Link: %lu baud, encoding %u, fields 0x%02X, headroom %d %% planned, "
+         "%d %% measured\n",
+         (unsigned long)device->huart->Init.BaudRate, (unsigned)Encoding,
+         (unsigned)Fields, (int)LinkHeadroom,
+         (int)Tofis_Link_Headroom(&Link, device->bytes_sent - BytesMark,
+                                  elapsed_us));
+  if (device->latency_frames != 0U) {
+    printf("Data ready to tx: avg %lu us, max %lu us\n",
+           (unsigned long)(device->latency_sum_us / device->latency_frames),
+           (unsigned long)device->latency_max_us);
+  }
+  idle = (uint32_t)((uint64_t)(idle_us - IdleMarkUs) * 1000U / elapsed_us);
+  printf("CPU idle: %lu.%lu %%, %lu events lost, up to %lu queued\n",
+         (unsigned long)(idle / 10U), (unsigned long)(idle % 10U),
+         (unsigned long)Tofis_Event_Lost(),
+         (unsigned long)Tofis_Event_HighWater());
+  if (ConfigId != 0U) {
+    printf("Config #%u: last restart %lu us stopped, %lu us between frames\n",
+           (unsigned)ConfigId, (unsigned long)StoppedUs,
+           (unsigned long)GapUs);
+  }
+#ifdef TOFIS_ADAPTIVE_RATE
+  printf("Rate: %s, %lu Hz, %lu ms, moving %u %%, valid %u %%, link up to "
+         "%u Hz\n",
+         (Rate.enabled != 0U) ? "adaptive" : "fixed",
+         (unsigned long)Profile.Frequency, (unsigned long)Profile.TimingBudget,
+         (unsigned)Rate.motion_percent, (unsigned)Rate.quality_percent,
+         (unsigned)Rate.link_max_hz);
+#endif
+
+  RateMarkUs = now_us;
+  IdleMarkUs = idle_us;
+  BytesMark = device->bytes_sent;
+  Tofis_Slave_USART_ResetLatency(device);
+}
+#endif
+
 static void display_commands_banner(void) {
   // move to second row
   printf("%c[2H", 27);
@@ -369,50 +1637,106 @@ static void display_commands_banner(void) {
   printf("TOFIS Simple Ranging demo application\n");
   printf("--------------------------------------\n\n");
 
+#ifdef TOFIS_CMD_TERMINAL_KEYS
   printf("Use the following keys to control application\n");
   printf(" 'r' : change resolution\n");
   printf(" 's' : enable signal and ambient\n");
+  printf(" 'fXX' : stream fields XX (hex TOFIS_FIELD_* mask)\n");
+  printf(" 'nX' : X targets per zone (1 to %u)\n",
+         (unsigned)RANGING_SENSOR_NB_TARGET_PER_ZONE);
   printf(" 'c' : clear screen\n");
   printf(" 't' : toggle target order\n");
+  printf(" 'i' : I2C usage of the last frame\n");
+  printf(" 'mX' : sensors ranging, X bit mask (1 left, 2 center, 4 right)\n");
+  printf(" 'p' : frame rates since the last report\n");
+#ifdef TOFIS_ADAPTIVE_RATE
+  printf(" 'aX' : X = 1 adaptive frequency, 0 fixed %u Hz\n",
+         (unsigned)RANGING_FREQUENCY);
+#endif
+#endif
   printf("\n");
 }
 
-static void handle_cmd(uint8_t cmd) {
-  switch (cmd) {
-  case 'r':
+/**
+ * @brief Runs a command, returns its TOFIS_CMD_STATUS_*.
+ */
+static uint8_t handle_cmd(const tofis_cmd_t *cmd) {
+  switch (cmd->id) {
+  case TOFIS_CMD_RESOLUTION:
     toggle_resolution();
     clear_screen();
     break;
 
-  case 's':
+  case TOFIS_CMD_SIGNAL_AMBIENT:
     toggle_signal_and_ambient();
     clear_screen();
     break;
 
-  case 'c':
+  case TOFIS_CMD_FIELDS:
+    if (cmd->length != 1U) {
+      return TOFIS_CMD_STATUS_BAD_ARGS;
+    }
+    set_fields(cmd->args[0]);
+    break;
+
+  case TOFIS_CMD_TARGETS:
+    if ((cmd->length != 1U) || (cmd->args[0] == 0U) ||
+        (cmd->args[0] > RANGING_SENSOR_NB_TARGET_PER_ZONE)) {
+      return TOFIS_CMD_STATUS_BAD_ARGS;
+    }
+    set_targets(cmd->args[0]);
+    break;
+
+  case TOFIS_CMD_CLEAR_SCREEN:
     clear_screen();
     break;
 
-  case 't':
+  case TOFIS_CMD_TARGET_ORDER:
     toggle_target_order();
     break;
 
-  default:
+  case TOFIS_CMD_ERASE_CALIB:
+    return erase_calib();
+
+  case TOFIS_CMD_I2C_USAGE:
+#ifdef TOFIS_TRANSMIT_RAW_DATA
+    /* printing would corrupt the binary link, the telemetry carries it */
+    TelemetryRequested = 1;
+#else
+    print_i2c_usage();
+#endif
     break;
-  }
-}
 
-static uint8_t get_key(void) {
-  uint8_t cmd = 0;
+  case TOFIS_CMD_SENSORS:
+    if ((cmd->length != 1U) ||
+        (cmd->args[0] >= (1U << RANGING_SENSOR_INSTANCES_NBR))) {
+      return TOFIS_CMD_STATUS_BAD_ARGS;
+    }
+    set_sensors(cmd->args[0]);
+    break;
 
-  HAL_UART_Receive(&hcom_uart[COM1], &cmd, 1, HAL_MAX_DELAY);
+  case TOFIS_CMD_FRAME_RATES:
+#ifdef TOFIS_TRANSMIT_RAW_DATA
+    TelemetryRequested = 1;
+#else
+    print_frame_rates();
+#endif
+    break;
 
-  return cmd;
-}
+#ifdef TOFIS_ADAPTIVE_RATE
+  case TOFIS_CMD_ADAPTIVE_RATE:
+    if ((cmd->length != 1U) || (cmd->args[0] > 1U)) {
+      return TOFIS_CMD_STATUS_BAD_ARGS;
+    }
+    set_adaptive_rate(cmd->args[0]);
+    break;
+#endif
+
+  default:
+    return TOFIS_CMD_STATUS_UNKNOWN;
+  }
 
-static uint32_t com_has_data(void) {
-  return __HAL_UART_GET_FLAG(&hcom_uart[COM1], UART_FLAG_RXNE);
-  ;
+  return TOFIS_CMD_STATUS_OK;
 }
 
 // // declared in app_tof.c
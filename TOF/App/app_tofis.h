@@ -30,6 +30,16 @@ extern "C" {
 // in terminal
 
 #define TOFIS_TRANSMIT_RAW_DATA
+
+// send the compact protocol v2 frames instead of the full result struct
+#define TOFIS_TRANSMIT_COMPACT
+
+// send compact keyframes and inter-frame deltas (requires TOFIS_TRANSMIT_COMPACT)
+// #define TOFIS_TRANSMIT_DELTA
+
+// adapt the ranging frequency (and integration time in autonomous mode) to the
+// scene and the link at runtime, 'a0' returns to the fixed ones
+#define TOFIS_ADAPTIVE_RATE
 /* Exported functions --------------------------------------------------------*/
 void MX_TOFIS_Init(void);
 void MX_TOFIS_Process(void);
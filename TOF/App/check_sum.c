@@ -1,10 +1,21 @@
 #include "check_sum.h"
+#include "stm32f4xx_hal.h"
 
-// should pass pointer point to tofis_data_packet_t.data 
-uint8_t calculate_checksum(uint8_t *buffer, int length) {
-    uint8_t checksum = 0;
-    for(int i = 0; i < length; i++) {
-        checksum ^= buffer[i];
-    }
-    return checksum;
-}
\ No newline at end of file
+void crc32_init(void) { __HAL_RCC_CRC_CLK_ENABLE(); }
+
+uint32_t calculate_crc32(const uint8_t *buffer, int length) {
+  CRC->CR = CRC_CR_RESET;
+  return accumulate_crc32(buffer, length);
+}
+
+uint32_t accumulate_crc32(const uint8_t *buffer, int length) {
+  const uint32_t *words = (const uint32_t *)buffer;
+
+  // the peripheral shifts in bit 31 first, swap so the first byte in memory
+  // goes first and the result matches a byte-wise CRC on the host
+  for (int i = 0; i < length / 4; i++) {
+    CRC->DR = __REV(words[i]);
+  }
+
+  return CRC->DR;
+}
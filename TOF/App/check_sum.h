@@ -2,4 +2,26 @@
 
 #include <stdint.h>
 
-uint8_t calculate_checksum(uint8_t *buffer, int length);
\ No newline at end of file
+/**
+ * @brief Enables the CRC peripheral clock.
+ */
+void crc32_init(void);
+
+/**
+ * @brief CRC-32/MPEG-2 (poly 0x04C11DB7, init 0xFFFFFFFF, no reflection, no
+ * final xor) of a word aligned buffer, computed by the CRC peripheral.
+ *
+ * @param buffer Word aligned buffer, bytes are processed in memory order.
+ * @param length Length in bytes, multiple of 4.
+ * @return uint32_t CRC of the buffer.
+ */
+uint32_t calculate_crc32(const uint8_t *buffer, int length);
+
+/**
+ * @brief Continues the CRC of the previous calculate_crc32 call.
+ *
+ * @param buffer Word aligned buffer, bytes are processed in memory order.
+ * @param length Length in bytes, multiple of 4.
+ * @return uint32_t CRC of all data fed since calculate_crc32.
+ */
+uint32_t accumulate_crc32(const uint8_t *buffer, int length);
@@ -0,0 +1,154 @@
+#include "tofis_calib.h"
+#include "check_sum.h"
+#include "stm32f4xx_hal.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#define TOFIS_CALIB_MAGIC (0x32414354U) /* "TCA2" */
+#define TOFIS_CALIB_SECTOR FLASH_SECTOR_7 /* must match CALIB in the .ld */
+#define TOFIS_CALIB_USER_XTALK (0x01U)
+
+typedef struct {
+  uint32_t magic;
+  uint16_t address;
+  uint8_t instance;
+  uint8_t flags; /* TOFIS_CALIB_USER_XTALK */
+  uint8_t offset_data[VL53L8CX_OFFSET_BUFFER_SIZE];
+  uint8_t xtalk_data[VL53L8CX_XTALK_BUFFER_SIZE];
+  uint32_t crc; /* of everything above */
+} tofis_calib_record_t;
+
+extern uint32_t _calib_start;
+extern uint32_t _calib_end;
+
+/* staging copy, too large for the stack */
+static tofis_calib_record_t _record;
+
+static uint32_t record_crc(const tofis_calib_record_t *record) {
+  crc32_init();
+  return calculate_crc32((const uint8_t *)record,
+                         offsetof(tofis_calib_record_t, crc));
+}
+
+/* Walks the record log, returns the last valid record of the sensor and the
+ * first never written slot (NULL when the sector is full). A record cut by a
+ * reset fails its CRC and is skipped. A slot of another record layout makes
+ * the sector count as full, the next save erases it. */
+static const tofis_calib_record_t *
+find_record(uint32_t instance, uint16_t address,
+            const tofis_calib_record_t **free_slot) {
+  const tofis_calib_record_t *record =
+      (const tofis_calib_record_t *)&_calib_start;
+  const tofis_calib_record_t *end = (const tofis_calib_record_t *)&_calib_end;
+  const tofis_calib_record_t *found = NULL;
+
+  *free_slot = NULL;
+  for (; record + 1 <= end; record++) {
+    if (record->magic == 0xFFFFFFFFU) {
+      *free_slot = record;
+      break;
+    }
+    if (record->magic != TOFIS_CALIB_MAGIC) {
+      break;
+    }
+    if ((record->instance == instance) && (record->address == address) &&
+        (record->crc == record_crc(record))) {
+      found = record;
+    }
+  }
+
+  return found;
+}
+
+int32_t Tofis_Calib_Load(uint32_t instance, VL53L8CX_Configuration *p_dev) {
+  const tofis_calib_record_t *free_slot;
+  const tofis_calib_record_t *record =
+      find_record(instance, p_dev->platform.address, &free_slot);
+
+  if (record == NULL) {
+    p_dev->offset_preloaded = 0;
+    p_dev->xtalk_preloaded = 0;
+    return -1;
+  }
+
+  memcpy(p_dev->offset_data, record->offset_data, sizeof(record->offset_data));
+  p_dev->offset_preloaded = 1;
+
+  /* a default Xtalk is not worth restoring, the ULD has it in flash too */
+  if ((record->flags & TOFIS_CALIB_USER_XTALK) != 0U) {
+    memcpy(p_dev->xtalk_data, record->xtalk_data, sizeof(record->xtalk_data));
+    p_dev->xtalk_preloaded = 1;
+  } else {
+    p_dev->xtalk_preloaded = 0;
+  }
+
+  return 0;
+}
+
+int32_t Tofis_Calib_Save(uint32_t instance, VL53L8CX_Configuration *p_dev) {
+  const tofis_calib_record_t *free_slot;
+  const tofis_calib_record_t *last =
+      find_record(instance, p_dev->platform.address, &free_slot);
+  const uint32_t *words = (const uint32_t *)&_record;
+  uint32_t address;
+  int32_t ret = 0;
+
+  memset(&_record, 0, sizeof(_record));
+  _record.magic = TOFIS_CALIB_MAGIC;
+  _record.address = p_dev->platform.address;
+  _record.instance = (uint8_t)instance;
+  memcpy(_record.offset_data, p_dev->offset_data, sizeof(_record.offset_data));
+  memcpy(_record.xtalk_data, p_dev->xtalk_data, sizeof(_record.xtalk_data));
+  if (memcmp(p_dev->xtalk_data, p_dev->default_xtalk,
+             sizeof(_record.xtalk_data)) != 0) {
+    _record.flags = TOFIS_CALIB_USER_XTALK;
+  }
+  _record.crc = record_crc(&_record);
+
+  /* every save costs flash wear, skip the ones that change nothing */
+  if ((last != NULL) && (memcmp(last, &_record, sizeof(_record)) == 0)) {
+    return 0;
+  }
+
+  /* full: start over, the other sensors are saved again on their next init */
+  if (free_slot == NULL) {
+    if (Tofis_Calib_Erase() != 0) {
+      return -1;
+    }
+    free_slot = (const tofis_calib_record_t *)&_calib_start;
+  }
+
+  HAL_FLASH_Unlock();
+  address = (uint32_t)free_slot;
+  for (uint32_t i = 0; i < sizeof(_record) / 4U; i++) {
+    if (HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, address + 4U * i,
+                          words[i]) != HAL_OK) {
+      ret = -1;
+      break;
+    }
+  }
+  HAL_FLASH_Lock();
+
+  return ret;
+}
+
+int32_t Tofis_Calib_Erase(void) {
+  FLASH_EraseInitTypeDef erase = {0};
+  uint32_t sector_error = 0;
+  HAL_StatusTypeDef hal_status;
+
+  erase.TypeErase = FLASH_TYPEERASE_SECTORS;
+  erase.Sector = TOFIS_CALIB_SECTOR;
+  erase.NbSectors = 1;
+  erase.VoltageRange = FLASH_VOLTAGE_RANGE_3;
+
+  HAL_FLASH_Unlock();
+  __HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_EOP | FLASH_FLAG_OPERR | FLASH_FLAG_WRPERR |
+                         FLASH_FLAG_PGAERR | FLASH_FLAG_PGPERR |
+                         FLASH_FLAG_PGSERR);
+  hal_status = HAL_FLASHEx_Erase(&erase, &sector_error);
+  HAL_FLASH_Lock();
+
+  return (hal_status == HAL_OK) ? 0 : -1;
+}
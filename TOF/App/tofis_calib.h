@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "vl53l8cx_api.h"
+
+/**
+ * @brief Calibration store in flash sector 7 (see _calib_start in the linker
+ * script). It keeps the NVM offsets and the Xtalk of each sensor so the init
+ * does not have to read the NVM again, and a user Xtalk calibration survives a
+ * reset.
+ *
+ * @note Records are looked up by instance and I2C address. The ULD exposes no
+ * serial number, the init reads the 8x8 range offsets of the NVM instead of
+ * the whole NVM data and only keeps a record whose offsets match them: a
+ * module swapped in the same slot is calibrated from its own NVM, with the
+ * default Xtalk, and saved as a new record.
+ */
+
+/**
+ * @brief Fills offset_data and xtalk_data of the device from the last record
+ * stored for the sensor and sets offset_preloaded / xtalk_preloaded, call it
+ * before vl53l8cx_init.
+ *
+ * @param instance Ranging sensor instance.
+ * @param p_dev Device, only the platform address is read.
+ * @return int32_t 0 if a record was restored, -1 if none.
+ */
+int32_t Tofis_Calib_Load(uint32_t instance, VL53L8CX_Configuration *p_dev);
+
+/**
+ * @brief Appends the current offset_data and xtalk_data of the device to the
+ * store, nothing is written when the last record already holds them. The
+ * sector is erased when full, which stalls the CPU for ~1 s.
+ *
+ * @param instance Ranging sensor instance.
+ * @param p_dev Initialized device.
+ * @return int32_t 0 on success, -1 on flash error.
+ */
+int32_t Tofis_Calib_Save(uint32_t instance, VL53L8CX_Configuration *p_dev);
+
+/**
+ * @brief Erases the whole store, the next init reads the NVM again.
+ *
+ * @return int32_t 0 on success, -1 on flash error.
+ */
+int32_t Tofis_Calib_Erase(void);
@@ -0,0 +1,252 @@
+#include "tofis_cmd.h"
+#include "check_sum.h"
+#include <string.h>
+
+#define TOFIS_CMD_RX_RING_MASK (TOFIS_CMD_RX_RING_SIZE - 1U)
+
+#if (TOFIS_CMD_RX_RING_SIZE & TOFIS_CMD_RX_RING_MASK) != 0
+#error "TOFIS_CMD_RX_RING_SIZE must be a power of two"
+#endif
+
+DMA_HandleTypeDef hdma_usart2_rx;
+
+#ifdef TOFIS_CMD_TERMINAL_KEYS
+// legacy terminal keys, digits: hex digits of the single argument byte. The
+// calibration erase has no key, a stray byte must not run it
+static const struct {
+  uint8_t key;
+  uint8_t id;
+  uint8_t digits;
+} Tofis_Cmd_Keys[] = {
+    {'r', TOFIS_CMD_RESOLUTION, 0},   {'s', TOFIS_CMD_SIGNAL_AMBIENT, 0},
+    {'f', TOFIS_CMD_FIELDS, 2},       {'n', TOFIS_CMD_TARGETS, 1},
+    {'t', TOFIS_CMD_TARGET_ORDER, 0}, {'i', TOFIS_CMD_I2C_USAGE, 0},
+    {'m', TOFIS_CMD_SENSORS, 1},      {'p', TOFIS_CMD_FRAME_RATES, 0},
+    {'c', TOFIS_CMD_CLEAR_SCREEN, 0}, {'a', TOFIS_CMD_ADAPTIVE_RATE, 1},
+};
+#endif
+
+/**
+ * @brief Links the USART2 RX DMA stream (DMA1 Stream5, channel 4) to the UART
+ * handle in circular mode.
+ *
+ * @param huart Pointer to the UART handle.
+ */
+static void Tofis_Cmd_DMA_Init(UART_HandleTypeDef *huart) {
+  __HAL_RCC_DMA1_CLK_ENABLE();
+
+  hdma_usart2_rx.Instance = DMA1_Stream5;
+  hdma_usart2_rx.Init.Channel = DMA_CHANNEL_4;
+  hdma_usart2_rx.Init.Direction = DMA_PERIPH_TO_MEMORY;
+  hdma_usart2_rx.Init.PeriphInc = DMA_PINC_DISABLE;
+  hdma_usart2_rx.Init.MemInc = DMA_MINC_ENABLE;
+  hdma_usart2_rx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+  hdma_usart2_rx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+  hdma_usart2_rx.Init.Mode = DMA_CIRCULAR;
+  hdma_usart2_rx.Init.Priority = DMA_PRIORITY_LOW;
+  hdma_usart2_rx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+  HAL_DMA_DeInit(&hdma_usart2_rx);
+  HAL_DMA_Init(&hdma_usart2_rx);
+
+  __HAL_LINKDMA(huart, hdmarx, hdma_usart2_rx);
+
+  HAL_NVIC_SetPriority(DMA1_Stream5_IRQn, 0, 1);
+  HAL_NVIC_EnableIRQ(DMA1_Stream5_IRQn);
+  HAL_NVIC_SetPriority(USART2_IRQn, 0, 1);
+  HAL_NVIC_EnableIRQ(USART2_IRQn);
+}
+
+void Tofis_Cmd_Init(tofis_cmd_rx_t *rx, UART_HandleTypeDef *huart) {
+  rx->huart = huart;
+  rx->read_index = 0;
+  rx->frame_length = 0;
+  rx->rescan = 0;
+#ifdef TOFIS_CMD_TERMINAL_KEYS
+  rx->key_digits = 0;
+#endif
+  rx->commands = 0;
+  rx->crc_errors = 0;
+
+  crc32_init();
+  Tofis_Cmd_DMA_Init(huart);
+  Tofis_Cmd_Arm(rx);
+}
+
+void Tofis_Cmd_Arm(tofis_cmd_rx_t *rx) {
+  // receive errors end a DMA reception, HAL_UARTEx_RxEventCallback reports
+  // the idle line and every half of the ring
+  if (rx->huart->RxState == HAL_UART_STATE_READY) {
+    // the ring starts over, a partial command lost bytes to the error
+    rx->read_index = 0;
+    rx->frame_length = 0;
+    rx->rescan = 0;
+    HAL_UARTEx_ReceiveToIdle_DMA(rx->huart, rx->ring, TOFIS_CMD_RX_RING_SIZE);
+  }
+}
+
+#ifdef TOFIS_CMD_TERMINAL_KEYS
+static uint8_t hex_digit(uint8_t c, uint8_t *value) {
+  if (c >= '0' && c <= '9') {
+    *value = (uint8_t)(c - '0');
+  } else if (c >= 'a' && c <= 'f') {
+    *value = (uint8_t)(c - 'a' + 10);
+  } else if (c >= 'A' && c <= 'F') {
+    *value = (uint8_t)(c - 'A' + 10);
+  } else {
+    return 0;
+  }
+  return 1;
+}
+#endif
+
+/**
+ * @brief Drops a rejected command and parses its bytes again from the second
+ * one, like the host parser: a lost byte can make the start of the next
+ * command look like the end of this one. The bytes are still in the ring.
+ */
+static void Tofis_Cmd_Resync(tofis_cmd_rx_t *rx) {
+  rx->read_index = (uint16_t)((rx->read_index - rx->frame_length + 1U) &
+                              TOFIS_CMD_RX_RING_MASK);
+  rx->rescan = (uint16_t)(rx->rescan + rx->frame_length - 1U);
+  rx->frame_length = 0;
+}
+
+/**
+ * @brief Adds a byte to the framed command being received, checks the header
+ * as soon as it is complete and the CRC at the end.
+ */
+static uint8_t Tofis_Cmd_Parse_Frame(tofis_cmd_rx_t *rx, uint8_t byte,
+                                     tofis_cmd_t *cmd) {
+  const tofis_cmd_header_t *header = (const tofis_cmd_header_t *)rx->frame;
+  uint16_t args_size;
+  uint32_t crc;
+
+  rx->frame[rx->frame_length++] = byte;
+
+  if ((rx->frame_length == 2U) && (byte != TOFIS_CMD_SYNC_BYTE_1)) {
+    rx->frame_length = 0;
+    if (byte == TOFIS_CMD_SYNC_BYTE_0) {
+      rx->frame[rx->frame_length++] = byte;
+    }
+    return 0;
+  }
+  if (rx->frame_length < sizeof(tofis_cmd_header_t)) {
+    return 0;
+  }
+  if ((rx->frame_length == sizeof(tofis_cmd_header_t)) &&
+      ((header->length > TOFIS_CMD_MAX_ARGS) || (header->reserved[0] != 0) ||
+       (header->reserved[1] != 0) || (header->reserved[2] != 0))) {
+    Tofis_Cmd_Resync(rx);
+    return 0;
+  }
+
+  args_size = TOFIS_PADDED_LENGTH(header->length);
+  if (rx->frame_length < sizeof(tofis_cmd_header_t) + args_size + 4U) {
+    return 0;
+  }
+
+  memcpy(&crc, &rx->frame[sizeof(tofis_cmd_header_t) + args_size],
+         sizeof(crc));
+  if (calculate_crc32(rx->frame, sizeof(tofis_cmd_header_t) + args_size) !=
+      crc) {
+    rx->crc_errors++;
+    Tofis_Cmd_Resync(rx);
+    return 0;
+  }
+  rx->frame_length = 0;
+
+  rx->commands++;
+  cmd->id = header->id;
+  cmd->sequence = header->sequence;
+  cmd->binary = 1;
+  cmd->length = header->length;
+  memcpy(cmd->args, &rx->frame[sizeof(tofis_cmd_header_t)], header->length);
+
+  return 1;
+}
+
+#ifdef TOFIS_CMD_TERMINAL_KEYS
+/**
+ * @brief Legacy terminal input: a key and the hex digits of its argument.
+ * Unknown keys are skipped, a non hex digit drops the command.
+ */
+static uint8_t Tofis_Cmd_Parse_Key(tofis_cmd_rx_t *rx, uint8_t byte,
+                                   tofis_cmd_t *cmd) {
+  uint8_t digit;
+
+  if (rx->key_digits != 0U) {
+    if (hex_digit(byte, &digit) == 0U) {
+      rx->key_digits = 0;
+      return 0;
+    }
+    rx->key_value = (uint8_t)((rx->key_value << 4) | digit);
+    if (--rx->key_digits != 0U) {
+      return 0;
+    }
+    cmd->id = rx->key_id;
+    cmd->binary = 0;
+    cmd->length = 1;
+    cmd->args[0] = rx->key_value;
+    return 1;
+  }
+
+  for (uint32_t i = 0; i < sizeof(Tofis_Cmd_Keys) / sizeof(Tofis_Cmd_Keys[0]);
+       i++) {
+    if (Tofis_Cmd_Keys[i].key != byte) {
+      continue;
+    }
+    if (Tofis_Cmd_Keys[i].digits != 0U) {
+      rx->key_id = Tofis_Cmd_Keys[i].id;
+      rx->key_digits = Tofis_Cmd_Keys[i].digits;
+      rx->key_value = 0;
+      return 0;
+    }
+    cmd->id = Tofis_Cmd_Keys[i].id;
+    cmd->binary = 0;
+    cmd->length = 0;
+    return 1;
+  }
+
+  return 0;
+}
+#endif
+
+uint8_t Tofis_Cmd_Next(tofis_cmd_rx_t *rx, tofis_cmd_t *cmd) {
+  // the DMA counts down the bytes left before it wraps to the ring start
+  uint16_t write_index =
+      (uint16_t)((TOFIS_CMD_RX_RING_SIZE -
+                  __HAL_DMA_GET_COUNTER(rx->huart->hdmarx)) &
+                 TOFIS_CMD_RX_RING_MASK);
+
+  while (rx->read_index != write_index) {
+    uint8_t byte = rx->ring[rx->read_index];
+    uint8_t rescanned = (rx->rescan != 0U) ? 1U : 0U;
+    uint8_t done;
+
+    rx->read_index = (rx->read_index + 1U) & TOFIS_CMD_RX_RING_MASK;
+    if (rescanned != 0U) {
+      rx->rescan--;
+    }
+
+    if ((rx->frame_length != 0U) || (byte == TOFIS_CMD_SYNC_BYTE_0)) {
+#ifdef TOFIS_CMD_TERMINAL_KEYS
+      rx->key_digits = 0;
+#endif
+      done = Tofis_Cmd_Parse_Frame(rx, byte, cmd);
+    } else if (rescanned != 0U) {
+      // the rest of a rejected command, never a key
+      done = 0;
+    } else {
+#ifdef TOFIS_CMD_TERMINAL_KEYS
+      done = Tofis_Cmd_Parse_Key(rx, byte, cmd);
+#else
+      done = 0;
+#endif
+    }
+    if (done != 0U) {
+      return 1;
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "stm32f4xx_hal.h"
+#include "tofis_data.h"
+
+// bytes the circular DMA receives into, a power of two
+#define TOFIS_CMD_RX_RING_SIZE (256U)
+
+// also accept the single key commands of a terminal. Off on the binary link:
+// the bytes of a damaged framed command would run as keys
+// #define TOFIS_CMD_TERMINAL_KEYS
+
+/**
+ * @brief A complete command, binary or typed on the terminal.
+ */
+typedef struct {
+  uint8_t id;                       /**< TOFIS_CMD_* */
+  uint8_t sequence;                 /**< Host sequence, binary commands */
+  uint8_t binary;                   /**< 1: framed command, expects an ack */
+  uint8_t length;                   /**< Argument bytes */
+  uint8_t args[TOFIS_CMD_MAX_ARGS]; /**< Arguments */
+} tofis_cmd_t;
+
+/**
+ * @brief Command reception: circular DMA ring and incremental parser.
+ *
+ * @note The DMA writes the ring in the background, the main loop parses what
+ * arrived since its last call and never waits for the rest of a command.
+ * Bytes that are neither a framed command nor a known terminal key are
+ * skipped. A framed command with a bad header or CRC is parsed again from its
+ * second byte.
+ */
+typedef struct {
+  UART_HandleTypeDef *huart; /**< UART handle, shared with the frames */
+  uint8_t ring[TOFIS_CMD_RX_RING_SIZE]; /**< Written by the DMA */
+  uint16_t read_index;                  /**< Next ring byte to parse */
+  uint8_t frame[TOFIS_CMD_MAX_FRAME_SIZE]
+      __attribute__((aligned(4))); /**< Framed command, CRC needs words */
+  uint8_t frame_length;            /**< Bytes in frame, 0: not in a frame */
+  uint16_t rescan; /**< Ring bytes left of rejected commands, not keys */
+#ifdef TOFIS_CMD_TERMINAL_KEYS
+  uint8_t key_id;     /**< Terminal command waiting for digits */
+  uint8_t key_digits; /**< Hex digits still expected */
+  uint8_t key_value;  /**< Argument of the terminal command */
+#endif
+  uint32_t commands;               /**< Framed commands received */
+  uint32_t crc_errors;             /**< Framed commands with a bad CRC */
+} tofis_cmd_rx_t;
+
+extern DMA_HandleTypeDef hdma_usart2_rx;
+
+/**
+ * @brief Sets up the USART2 RX DMA stream and starts the reception.
+ *
+ * @param rx Pointer to the reception state.
+ * @param huart Pointer to the UART handle.
+ */
+void Tofis_Cmd_Init(tofis_cmd_rx_t *rx, UART_HandleTypeDef *huart);
+
+/**
+ * @brief Restarts the reception if a UART error stopped it, cheap enough to
+ * call on every main loop iteration.
+ *
+ * @param rx Pointer to the reception state.
+ */
+void Tofis_Cmd_Arm(tofis_cmd_rx_t *rx);
+
+/**
+ * @brief Parses the bytes received so far up to the next complete command.
+ *
+ * @param rx Pointer to the reception state.
+ * @param cmd Filled with the command.
+ * @return uint8_t 1 if a command is complete, 0 once the received bytes are
+ * used up (a partial command is kept for the next call).
+ */
+uint8_t Tofis_Cmd_Next(tofis_cmd_rx_t *rx, tofis_cmd_t *cmd);
@@ -6,13 +6,261 @@
 #define VL53L8A1_MAX_RESOLUTION (8)
 #define VL53L8A1_MAX_DATA_SIZE                                                 \
   (VL53L8A1_MAX_RESOLUTION * VL53L8A1_MAX_RESOLUTION)
-#define VL53L8A1_PING_PONG_BUFFER_SIZE (5000)
-#define VL53L8A1_TOFIS_CHECK_SUM_START_BYTE (4)
+// each half holds a whole frame, at least the raw one which grows with the
+// targets per zone
+#define VL53L8A1_PING_PONG_BUFFER_SIZE                                         \
+  (2U * ((TOFIS_RAW_MAX_FRAME_SIZE > 2500U)                                    \
+             ? TOFIS_PADDED_LENGTH(TOFIS_RAW_MAX_FRAME_SIZE)                   \
+             : 2500U))
+/* Protocol -------------------------------------------------------------------*/
+// every frame is tofis_frame_header_t + payload + zero padding up to a multiple
+// of 4 bytes, all fields little endian
+#define TOFIS_SYNC_BYTE_0 (0xA5)
+#define TOFIS_SYNC_BYTE_1 (0x5A)
+#define TOFIS_PROTOCOL_VERSION (12)
 
+// payload encodings
+#define TOFIS_ENCODING_COMPACT (0x01)
+#define TOFIS_ENCODING_KEYFRAME (0x02)
+#define TOFIS_ENCODING_DELTA (0x03)
+#define TOFIS_ENCODING_RAW (0x04)       // tofis_raw_desc_t + BSP result struct
+#define TOFIS_ENCODING_RAW_BE (0x05)    // same, every field big endian
+#define TOFIS_ENCODING_ACK (0x06)       // tofis_cmd_ack_t, answer to a command
+#define TOFIS_ENCODING_CONFIG (0x07)    // tofis_config_desc_t, settings changed
+#define TOFIS_ENCODING_TELEMETRY (0x08) // tofis_telemetry_t, health counters
+
+#define TOFIS_PADDED_LENGTH(length) (((length) + 3U) & ~3U)
+
+// fields carried by a compact payload, selected at runtime
+#define TOFIS_FIELD_DISTANCE (1U << 0)    // per target, int16_t [mm]
+#define TOFIS_FIELD_STATUS (1U << 1)      // per target, uint8_t
+#define TOFIS_FIELD_SIGNAL (1U << 2)      // per target, uint16_t [kcps/spad]
+#define TOFIS_FIELD_AMBIENT (1U << 3)     // per zone, uint16_t [kcps/spad]
+#define TOFIS_FIELD_SIGMA (1U << 4)       // per target, uint16_t [mm]
+#define TOFIS_FIELD_REFLECTANCE (1U << 5) // per target, uint8_t [%]
+#define TOFIS_FIELD_SPADS (1U << 6)       // per zone, uint16_t
+#define TOFIS_FIELD_TEMPERATURE (1U << 7) // per frame, int8_t [degC]
+
+#define TOFIS_FIELDS_DEFAULT (TOFIS_FIELD_DISTANCE | TOFIS_FIELD_STATUS)
+
+// times are Tofis_Time_Us microseconds. tx_time_us is written when the DMA
+// starts, after the CRC was computed, so it is the only field not covered
+typedef struct __attribute__((packed)) {
+  uint8_t sync[2];      // Fixed to 0xA5 0x5A
+  uint8_t version;      // TOFIS_PROTOCOL_VERSION
+  uint8_t encoding;     // TOFIS_ENCODING_*
+  uint16_t length;      // Payload length in bytes, without padding
+  uint16_t sequence;    // Incremented on every frame, gaps are dropped frames
+  uint8_t stream_count; // Sensor streamcount, gaps are skipped ranging frames
+  uint8_t sensor;       // Ranging sensor instance (VL53L8A1_DEV_*)
+  uint8_t config_id;    // Settings the frame was produced with, see below
+  uint8_t reserved;     // 0
+  uint32_t irq_time_us; // Data ready interrupt of the sensor frame
+  uint32_t crc32;       // CRC-32/MPEG-2 of header bytes 0-15 and padded payload
+  uint32_t tx_time_us;  // Start of the transmission
+} tofis_frame_header_t;
+
+#define TOFIS_FRAME_HEADER_CRC_SIZE (16)
+
+// upper bound of the sensor instances on the wire, the host keeps a delta
+// reference and timing statistics for each
+#define TOFIS_MAX_SENSORS (3)
+
+#if RANGING_SENSOR_INSTANCES_NBR > TOFIS_MAX_SENSORS
+#error "more ranging sensors than the protocol carries"
+#endif
+
+/* Configuration --------------------------------------------------------------*/
+// runtime settings are changed between two frames. Each change increments the
+// config_id of the frames that follow and is announced by a
+// TOFIS_ENCODING_CONFIG frame (sensor 0, stream_count 0) carrying the new
+// settings. A lost announcement still shows as a config_id step.
+#define TOFIS_CONFIG_RESOLUTION (1U << 0)   // 4x4 / 8x8, sensors restarted
+#define TOFIS_CONFIG_FIELDS (1U << 1)       // TOFIS_FIELD_* streamed
+#define TOFIS_CONFIG_OUTPUTS (1U << 2)      // blocks read, sensors restarted
+#define TOFIS_CONFIG_TARGETS (1U << 3)      // targets per zone, restarted
+#define TOFIS_CONFIG_TARGET_ORDER (1U << 4) // closest / strongest, restarted
+#define TOFIS_CONFIG_SENSORS (1U << 5)      // sensors started or stopped
+#define TOFIS_CONFIG_RATE (1U << 6)         // frequency, integration, restarted
+#define TOFIS_CONFIG_ENCODING (1U << 7)     // TOFIS_ENCODING_* of the frames
+
+// changes the sensors only take when ranging starts
+#define TOFIS_CONFIG_RESTART                                                   \
+  (TOFIS_CONFIG_RESOLUTION | TOFIS_CONFIG_OUTPUTS | TOFIS_CONFIG_TARGETS |     \
+   TOFIS_CONFIG_TARGET_ORDER | TOFIS_CONFIG_RATE)
+
+typedef struct __attribute__((packed)) {
+  uint8_t config_id;       // config_id of the frames from now on
+  uint8_t changes;         // TOFIS_CONFIG_* applied
+  uint8_t resolution;      // 4 or 8
+  uint8_t fields;          // TOFIS_FIELD_* streamed, requested ones that fit
+  uint8_t targets;         // Targets per zone
+  uint8_t target_order;    // 1 closest, 2 strongest
+  uint8_t sensors;         // Bit n: sensor instance n ranging
+  uint8_t frequency_hz;    // Ranging frequency of each sensor
+  uint32_t stopped_us;     // Ranging stopped for the change, 0: no restart
+  uint8_t integration_ms;  // Integration time, autonomous mode only
+  uint8_t adaptive;        // 1: frequency and integration time adaptive
+  uint8_t encoding;        // TOFIS_ENCODING_RAW, COMPACT or DELTA (delta mode)
+  int8_t headroom_percent; // Link left unused as planned, negative: overrun
+} tofis_config_desc_t;
+
+/* Telemetry ------------------------------------------------------------------*/
+// every TOFIS_TELEMETRY_PERIOD_US the firmware sends a TOFIS_ENCODING_TELEMETRY
+// frame (sensor 0, stream_count 0). Counters run since boot and wrap, the host
+// takes the difference between two frames, so a lost frame loses nothing. The
+// latencies only cover the period since the previous frame. The I2C usage and
+// frame rate commands send one at once, the terminal build prints them instead.
+#define TOFIS_STAGE_READ (0)    // data ready interrupt to end of the I2C read
+#define TOFIS_STAGE_PROCESS (1) // end of the read to frame queued on the UART
+#define TOFIS_STAGE_QUEUE (2)   // frame queued to start of its transmission
+#define TOFIS_STAGE_TOTAL (3)   // data ready interrupt to start of transmission
+#define TOFIS_STAGE_COUNT (4)
+
+typedef struct __attribute__((packed)) {
+  uint32_t min_us; // 0 if count is 0
+  uint32_t avg_us;
+  uint32_t max_us;
+  uint32_t count; // Frames measured during the period
+} tofis_latency_desc_t;
+
+typedef struct __attribute__((packed)) {
+  uint32_t stream_gaps;     // Ranging frames missing from the streamcount
+  uint32_t overruns;        // Data ready while the previous frame was not read
+  uint32_t corrupted;       // Header and footer ids differ, frame not sent
+  uint32_t i2c_errors;      // Failed I2C transactions
+  uint32_t frames;          // Ranging frames read
+  uint16_t frame_transfers; // I2C transactions of the last frame
+  uint16_t frame_bytes;     // Bytes read per frame
+} tofis_sensor_counters_t;
+
+typedef struct __attribute__((packed)) {
+  uint32_t period_us;       // Time covered by the latencies
+  uint32_t frames_sent;     // Frames fully transmitted
+  uint32_t frames_dropped;  // Frames overwritten before transmission
+  uint32_t tx_errors;       // Transmissions that failed or timed out
+  uint32_t events_lost;     // Interrupt events lost, event queue full
+  uint32_t config_errors;   // Changes a sensor refused a setting of
+  uint8_t queue_high_water; // Most events queued at once since boot
+  uint8_t idle_percent;     // Core asleep (WFI) during the period
+  uint8_t reserved[2];      // 0
+  tofis_sensor_counters_t sensor[TOFIS_MAX_SENSORS]; // Per sensor instance
+  tofis_latency_desc_t latency[TOFIS_STAGE_COUNT];   // TOFIS_STAGE_*
+} tofis_telemetry_t;
+
+/* Commands -------------------------------------------------------------------*/
+// host to MCU: tofis_cmd_header_t + arguments zero padded to a multiple of 4
+// bytes + CRC-32/MPEG-2 of both (uint32_t). Every command is answered with a
+// TOFIS_ENCODING_ACK frame (sensor 0, stream_count 0), one with a bad CRC is
+// ignored and sent again by the host. A retransmission (same sequence) is
+// acknowledged again without running the command twice.
+#define TOFIS_CMD_SYNC_BYTE_0 (0xC3)
+#define TOFIS_CMD_SYNC_BYTE_1 (0x3C)
+#define TOFIS_CMD_MAX_ARGS (8)
+
+typedef struct __attribute__((packed)) {
+  uint8_t sync[2];     // Fixed to 0xC3 0x3C
+  uint8_t id;          // TOFIS_CMD_*
+  uint8_t sequence;    // Chosen by the host, echoed by the ack
+  uint8_t length;      // Argument bytes, up to TOFIS_CMD_MAX_ARGS
+  uint8_t reserved[3]; // 0
+} tofis_cmd_header_t;
+
+#define TOFIS_CMD_MAX_FRAME_SIZE                                               \
+  (sizeof(tofis_cmd_header_t) + TOFIS_PADDED_LENGTH(TOFIS_CMD_MAX_ARGS) + 4U)
+
+// command ids, the terminal key in brackets (TOFIS_CMD_TERMINAL_KEYS)
+#define TOFIS_CMD_RESOLUTION (0x01)     // ('r') toggle 4x4 / 8x8
+#define TOFIS_CMD_SIGNAL_AMBIENT (0x02) // ('s') toggle signal and ambient
+#define TOFIS_CMD_FIELDS (0x03)         // ('f') uint8_t TOFIS_FIELD_* mask
+#define TOFIS_CMD_TARGETS (0x04)        // ('n') uint8_t targets per zone
+#define TOFIS_CMD_TARGET_ORDER (0x05)   // ('t') toggle closest / strongest
+#define TOFIS_CMD_ERASE_CALIB (0x06)    // (none) erase the stored calibration
+#define TOFIS_CMD_I2C_USAGE (0x07)      // ('i') send the telemetry now
+#define TOFIS_CMD_SENSORS (0x08)        // ('m') uint8_t mask of instances
+#define TOFIS_CMD_FRAME_RATES (0x09)    // ('p') send the telemetry now
+#define TOFIS_CMD_CLEAR_SCREEN (0x0A)   // ('c') clear the terminal
+#define TOFIS_CMD_ADAPTIVE_RATE (0x0B)  // ('a') uint8_t 1 adaptive, 0 fixed
+
+// ack status
+#define TOFIS_CMD_STATUS_OK (0x00)
+#define TOFIS_CMD_STATUS_UNKNOWN (0x01)  // id not supported
+#define TOFIS_CMD_STATUS_BAD_ARGS (0x02) // wrong argument length or value
+#define TOFIS_CMD_STATUS_FAILED (0x03)   // sensor or flash access failed
+
+typedef struct __attribute__((packed)) {
+  uint8_t id;       // Command id
+  uint8_t sequence; // Command sequence
+  uint8_t status;   // TOFIS_CMD_STATUS_*
+  uint8_t reserved; // 0
+} tofis_cmd_ack_t;
+
+// upper bound of the targets per zone on the wire, the host decodes up to it
+#define TOFIS_MAX_TARGETS_PER_ZONE (4)
+
+#if RANGING_SENSOR_NB_TARGET_PER_ZONE > TOFIS_MAX_TARGETS_PER_ZONE
+#error "more targets per zone than the protocol carries"
+#endif
+
+// raw payloads carry the arrays of RANGING_SENSOR_Result_t at full capacity
+typedef struct __attribute__((packed)) {
+  uint8_t resolution;  // 4 or 8
+  uint8_t targets;     // Array length per zone (build time capacity)
+  uint8_t reserved[2]; // 0
+} tofis_raw_desc_t;
+
+#define TOFIS_RAW_MAX_FRAME_SIZE                                               \
+  (sizeof(tofis_frame_header_t) + sizeof(tofis_raw_desc_t) +                   \
+   sizeof(RANGING_SENSOR_Result_t))
+
+// first bytes of a compact payload. The fields mask describes the layout of
+// what follows, each value only if its bit is set (16-bit values saturated):
+//   int8_t temperature
+//   `zones` x {
+//     uint8_t nb_targets
+//     uint16_t ambient, uint16_t spads
+//     min(nb_targets, targets) x {
+//       int16_t distance, uint8_t status, uint16_t signal, uint16_t sigma,
+//       uint8_t reflectance
+//     }
+//   }
+typedef struct __attribute__((packed)) {
+  uint8_t resolution; // 4 or 8
+  uint8_t fields;     // TOFIS_FIELD_* present in the payload
+  uint8_t zones;      // Number of zone records
+  uint8_t targets;    // Targets sent per zone by the sensor, max records
+} tofis_frame_desc_t;
+
+// keyframe and delta payloads start with tofis_delta_desc_t.
+// keyframe: compact payload (tofis_frame_desc_t + zone records).
+// delta: tofis_frame_desc_t, the temperature if selected, a changed-zone bitmap
+// (bit z % 8 of byte z / 8) and, for every changed zone, either one int8_t
+// distance delta per target record of the previous frame (only distance
+// changed) or TOFIS_DELTA_ESCAPE and a full zone record.
+typedef struct __attribute__((packed)) {
+  uint8_t key_id; // Incremented on every keyframe
+  uint8_t index;  // 0 for a keyframe, n for the n-th delta after it
+} tofis_delta_desc_t;
+
+#define TOFIS_DELTA_ESCAPE (0x80)
+
+// values of a zone as they are carried on the wire
 typedef struct {
-  uint8_t start_byte;           // Fixed to 0xAA
-  uint8_t resolution;           // 4 or 8
-  uint8_t checksum;             // XOR checksum
-  uint8_t end_byte;             // Fixed to 0x55
-  RANGING_SENSOR_Result_t data; // Data
-} tofis_data_packet_t;
\ No newline at end of file
+  uint8_t nb_targets; // NumberOfTargets
+  uint8_t records;    // Target records sent
+  uint16_t ambient;
+  uint16_t spads;
+  int16_t distance[RANGING_SENSOR_NB_TARGET_PER_ZONE];
+  uint8_t status[RANGING_SENSOR_NB_TARGET_PER_ZONE];
+  uint8_t reflectance[RANGING_SENSOR_NB_TARGET_PER_ZONE];
+  uint16_t signal[RANGING_SENSOR_NB_TARGET_PER_ZONE];
+  uint16_t sigma[RANGING_SENSOR_NB_TARGET_PER_ZONE];
+} tofis_zone_record_t;
+
+#define TOFIS_COMPACT_ZONE_MAX_SIZE (1 + 2 + 2)
+#define TOFIS_COMPACT_TARGET_MAX_SIZE (2 + 1 + 2 + 2 + 1)
+#define TOFIS_COMPACT_MAX_FRAME_SIZE                                           \
+  (sizeof(tofis_frame_header_t) + sizeof(tofis_frame_desc_t) + 1 +             \
+   VL53L8A1_MAX_DATA_SIZE *                                                    \
+       (TOFIS_COMPACT_ZONE_MAX_SIZE +                                          \
+        RANGING_SENSOR_NB_TARGET_PER_ZONE * TOFIS_COMPACT_TARGET_MAX_SIZE))
@@ -0,0 +1,100 @@
+#include "tofis_event.h"
+#include "stm32f4xx_hal.h"
+#include "tofis_time.h"
+
+#define TOFIS_EVENT_QUEUE_MASK (TOFIS_EVENT_QUEUE_SIZE - 1U)
+
+#if (TOFIS_EVENT_QUEUE_SIZE & TOFIS_EVENT_QUEUE_MASK) != 0
+#error "TOFIS_EVENT_QUEUE_SIZE must be a power of two"
+#endif
+
+// a slot is free for position pos when sequence == pos, holds the event of
+// pos when sequence == pos + 1
+typedef struct {
+  volatile uint32_t sequence;
+  tofis_event_t event;
+} tofis_event_slot_t;
+
+static tofis_event_slot_t _slots[TOFIS_EVENT_QUEUE_SIZE];
+static volatile uint32_t _head = 0; // next position to reserve (producers)
+static uint32_t _tail = 0;          // next position to read (main loop)
+static volatile uint32_t _lost = 0;
+static volatile uint32_t _high_water = 0; // most events queued at once
+static uint32_t _idle_us = 0;
+
+void Tofis_Event_Init(void) {
+  for (uint32_t i = 0; i < TOFIS_EVENT_QUEUE_SIZE; i++) {
+    _slots[i].sequence = i;
+  }
+  _head = 0;
+  _tail = 0;
+  _lost = 0;
+  _high_water = 0;
+  _idle_us = 0;
+}
+
+uint8_t Tofis_Event_Post(const tofis_event_t *event) {
+  tofis_event_slot_t *slot;
+  uint32_t pos;
+
+  // reserve a position, an interrupt preempting us between the exclusive load
+  // and store makes the store fail and we retry past the position it took
+  do {
+    pos = __LDREXW(&_head);
+    slot = &_slots[pos & TOFIS_EVENT_QUEUE_MASK];
+    if (slot->sequence != pos) {
+      __CLREX();
+      _lost++;
+      return 1;
+    }
+  } while (__STREXW(pos + 1U, &_head) != 0U);
+
+  // an event the main loop is taking out may still count, at most one more
+  if (pos + 1U - _tail > _high_water) {
+    _high_water = pos + 1U - _tail;
+  }
+
+  slot->event = *event;
+  __DMB();
+  slot->sequence = pos + 1U;
+
+  return 0;
+}
+
+uint8_t Tofis_Event_Get(tofis_event_t *event) {
+  tofis_event_slot_t *slot = &_slots[_tail & TOFIS_EVENT_QUEUE_MASK];
+
+  // the main loop only runs once every interrupt returned, a reserved slot is
+  // always written by then
+  if (slot->sequence != _tail + 1U) {
+    return 0;
+  }
+
+  *event = slot->event;
+  __DMB();
+  slot->sequence = _tail + TOFIS_EVENT_QUEUE_SIZE;
+  _tail++;
+
+  return 1;
+}
+
+void Tofis_Event_Wait(void) {
+  uint32_t start_us;
+
+  // an interrupt between the check and WFI still wakes the core: it stays
+  // pending while masked and runs right after __enable_irq
+  __disable_irq();
+  if (_slots[_tail & TOFIS_EVENT_QUEUE_MASK].sequence != _tail + 1U) {
+    start_us = Tofis_Time_Us();
+    __DSB();
+    __WFI();
+    _idle_us += Tofis_Time_Us() - start_us;
+  }
+  __enable_irq();
+}
+
+uint32_t Tofis_Event_IdleUs(void) { return _idle_us; }
+
+uint32_t Tofis_Event_Lost(void) { return _lost; }
+
+uint32_t Tofis_Event_HighWater(void) { return _high_water; }
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdint.h>
+
+// events the queue holds, a power of two
+#define TOFIS_EVENT_QUEUE_SIZE (16U)
+
+/**
+ * @brief Work handed from the interrupts to the main loop.
+ */
+typedef enum {
+  TOFIS_EVENT_DATA_READY = 0, /**< Frame announced, read it (blocking reads) */
+  TOFIS_EVENT_FRAME_READ,     /**< Ranging data read over, decode and send */
+  TOFIS_EVENT_COMMAND,        /**< Command bytes received, parse them */
+} tofis_event_type_t;
+
+typedef struct {
+  uint8_t type;   /**< tofis_event_type_t */
+  uint8_t sensor; /**< Ranging sensor instance (VL53L8A1_DEV_*) */
+  int32_t status; /**< BSP status of the read */
+} tofis_event_t;
+
+/**
+ * @brief Empties the queue and clears the idle time, call it before the
+ * interrupts that post events are enabled.
+ */
+void Tofis_Event_Init(void);
+
+/**
+ * @brief Queues an event, lock-free: interrupts of any priority may post while
+ * the main loop takes events out.
+ *
+ * @param event Event copied into the queue.
+ * @return uint8_t 0 if queued, 1 if the queue is full and the event is lost.
+ */
+uint8_t Tofis_Event_Post(const tofis_event_t *event);
+
+/**
+ * @brief Takes the oldest event out of the queue, main loop only.
+ *
+ * @param event Filled with the event.
+ * @return uint8_t 1 if an event was taken, 0 if the queue is empty.
+ */
+uint8_t Tofis_Event_Get(tofis_event_t *event);
+
+/**
+ * @brief Sleeps the core (WFI) until the next interrupt if the queue is empty,
+ * the time spent asleep counts as idle.
+ */
+void Tofis_Event_Wait(void);
+
+/**
+ * @brief Microseconds spent in Tofis_Event_Wait, wraps like Tofis_Time_Us.
+ */
+uint32_t Tofis_Event_IdleUs(void);
+
+/**
+ * @brief Events lost because the queue was full.
+ */
+uint32_t Tofis_Event_Lost(void);
+
+/**
+ * @brief Most events queued at once since Tofis_Event_Init, up to
+ * TOFIS_EVENT_QUEUE_SIZE.
+ */
+uint32_t Tofis_Event_HighWater(void);
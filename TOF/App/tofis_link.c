@@ -0,0 +1,112 @@
+#include "tofis_link.h"
+#include "tofis_uart.h"
+
+// optional fields, in the order they are dropped
+static const uint8_t Tofis_Link_Optional[] = {
+    TOFIS_FIELD_SPADS,   TOFIS_FIELD_REFLECTANCE, TOFIS_FIELD_SIGMA,
+    TOFIS_FIELD_AMBIENT, TOFIS_FIELD_SIGNAL,      TOFIS_FIELD_TEMPERATURE,
+};
+
+void Tofis_Link_Init(tofis_link_t *link, uint32_t baud_rate,
+                     uint8_t base_encoding) {
+  // 8N1: a start and a stop bit per byte
+  link->bytes_per_s = baud_rate / 10U;
+  link->base_encoding = base_encoding;
+}
+
+/**
+ * @brief Average frame size of an encoding, delta mode spreads a keyframe over
+ * VL53L8A1_DELTA_KEYFRAME_INTERVAL frames.
+ */
+static uint32_t Tofis_Link_FrameSize(uint8_t encoding,
+                                     const tofis_link_demand_t *demand,
+                                     uint8_t fields) {
+  uint32_t size = Tofis_Slave_USART_FrameSize(encoding, demand->resolution,
+                                              demand->targets, fields);
+
+  if (encoding == TOFIS_ENCODING_DELTA) {
+    size = (size + (VL53L8A1_DELTA_KEYFRAME_INTERVAL - 1U) * size *
+                       TOFIS_LINK_DELTA_PERCENT / 100U) /
+           VL53L8A1_DELTA_KEYFRAME_INTERVAL;
+  }
+
+  return size;
+}
+
+static int8_t Tofis_Link_Percent(const tofis_link_t *link,
+                                 uint32_t bytes_per_s) {
+  int32_t headroom;
+
+  if (link->bytes_per_s == 0U) {
+    return INT8_MIN;
+  }
+  headroom = 100 - (int32_t)((uint64_t)bytes_per_s * 100U / link->bytes_per_s);
+
+  return (headroom < INT8_MIN) ? INT8_MIN : (int8_t)headroom;
+}
+
+/**
+ * @brief Fills the plan of an encoding and fields, returns 1 if it fits.
+ */
+static uint8_t Tofis_Link_Try(const tofis_link_t *link,
+                              const tofis_link_demand_t *demand,
+                              uint8_t encoding, uint8_t fields,
+                              tofis_link_plan_t *plan) {
+  uint32_t size = Tofis_Link_FrameSize(encoding, demand, fields);
+  uint32_t needed = size * demand->frequency_hz * demand->sensors;
+
+  plan->encoding = encoding;
+  plan->fields = fields;
+  plan->frame_size = (uint16_t)size;
+  plan->headroom_percent = Tofis_Link_Percent(link, needed);
+
+  return (needed <= link->bytes_per_s / 100U * TOFIS_LINK_LOAD_PERCENT) ? 1U
+                                                                         : 0U;
+}
+
+void Tofis_Link_Plan(const tofis_link_t *link,
+                     const tofis_link_demand_t *demand,
+                     tofis_link_plan_t *plan) {
+  uint8_t fields = demand->fields;
+
+  switch (link->base_encoding) {
+  case TOFIS_ENCODING_RAW:
+    if (Tofis_Link_Try(link, demand, TOFIS_ENCODING_RAW, fields, plan) != 0U) {
+      return;
+    }
+    // fall through
+  case TOFIS_ENCODING_COMPACT:
+    if (Tofis_Link_Try(link, demand, TOFIS_ENCODING_COMPACT, fields, plan) !=
+        0U) {
+      return;
+    }
+    // fall through
+  default:
+    if (Tofis_Link_Try(link, demand, TOFIS_ENCODING_DELTA, fields, plan) !=
+        0U) {
+      return;
+    }
+    break;
+  }
+
+  for (uint32_t i = 0; i < sizeof(Tofis_Link_Optional); i++) {
+    if ((fields & Tofis_Link_Optional[i]) == 0U) {
+      continue;
+    }
+    fields &= (uint8_t)~Tofis_Link_Optional[i];
+    if (Tofis_Link_Try(link, demand, TOFIS_ENCODING_DELTA, fields, plan) !=
+        0U) {
+      return;
+    }
+  }
+}
+
+int8_t Tofis_Link_Headroom(const tofis_link_t *link, uint32_t bytes,
+                           uint32_t elapsed_us) {
+  if (elapsed_us == 0U) {
+    return 100;
+  }
+
+  return Tofis_Link_Percent(
+      link, (uint32_t)((uint64_t)bytes * 1000000U / elapsed_us));
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "tofis_data.h"
+
+// share of the link the ranging frames are planned at, the rest absorbs acks,
+// announcements and frame size variations
+#define TOFIS_LINK_LOAD_PERCENT (80U)
+
+// delta frames are budgeted at this share of their keyframe size (about 40 %
+// measured for a static 8x8 scene with distance noise)
+#define TOFIS_LINK_DELTA_PERCENT (50U)
+
+/**
+ * @brief Frame size and rate budget of the UART link.
+ *
+ * @note The plan keeps the encoding of the build when it fits. Otherwise it
+ * moves on to the compact frames, then to delta mode, and finally drops the
+ * optional fields one at a time (spad count, reflectance, sigma, ambient,
+ * signal, temperature), the distance and status are always sent. Compact
+ * frames are preferred over delta mode while they fit: each one is decoded on
+ * its own, a lost frame costs nothing more.
+ */
+typedef struct {
+  uint32_t bytes_per_s;  /**< Link capacity */
+  uint8_t base_encoding; /**< TOFIS_ENCODING_* of the build, tried first */
+} tofis_link_t;
+
+/**
+ * @brief What the sensors produce.
+ */
+typedef struct {
+  uint8_t resolution;   /**< Matrix resolution (4 or 8) */
+  uint8_t targets;      /**< Targets sent per zone */
+  uint8_t fields;       /**< TOFIS_FIELD_* requested */
+  uint8_t frequency_hz; /**< Ranging frequency of each sensor */
+  uint8_t sensors;      /**< Sensors ranging */
+} tofis_link_demand_t;
+
+/**
+ * @brief How the frames go on the wire.
+ */
+typedef struct {
+  uint8_t encoding;        /**< RAW, COMPACT or DELTA (delta mode) */
+  uint8_t fields;          /**< Fields sent, the requested ones that fit */
+  int8_t headroom_percent; /**< Link left unused, negative: overrun */
+  uint16_t frame_size;     /**< Average bytes per frame budgeted */
+} tofis_link_plan_t;
+
+/**
+ * @brief Sets up the budget of a link.
+ *
+ * @param link Pointer to the budget.
+ * @param baud_rate UART baud rate, 8N1 frames.
+ * @param base_encoding TOFIS_ENCODING_RAW, COMPACT or DELTA, preferred.
+ */
+void Tofis_Link_Init(tofis_link_t *link, uint32_t baud_rate,
+                     uint8_t base_encoding);
+
+/**
+ * @brief Picks the encoding and fields that carry a demand within
+ * TOFIS_LINK_LOAD_PERCENT of the link. If even the distance and status in
+ * delta mode do not fit, the plan is that one with a negative headroom.
+ *
+ * @param link Pointer to the budget.
+ * @param demand Frames to carry.
+ * @param plan Filled with the encoding and fields.
+ */
+void Tofis_Link_Plan(const tofis_link_t *link,
+                     const tofis_link_demand_t *demand,
+                     tofis_link_plan_t *plan);
+
+/**
+ * @brief Headroom of the link from the bytes actually sent.
+ *
+ * @param link Pointer to the budget.
+ * @param bytes Bytes sent during the period.
+ * @param elapsed_us Length of the period.
+ * @return int8_t Link left unused [%], negative: more than the link carries.
+ */
+int8_t Tofis_Link_Headroom(const tofis_link_t *link, uint32_t bytes,
+                           uint32_t elapsed_us);
@@ -0,0 +1,183 @@
+#include "tofis_rate.h"
+#include <string.h>
+
+static void Tofis_Rate_Mark(tofis_rate_t *rate, const tofis_rate_link_t *link,
+                            uint32_t now_us) {
+  rate->window_start_us = now_us;
+  rate->zones = 0;
+  rate->moving = 0;
+  rate->scanned = 0;
+  rate->valid = 0;
+  rate->bytes_mark = link->bytes_sent;
+  rate->frames_mark = link->frames_sent;
+  rate->dropped_mark = link->frames_dropped;
+}
+
+void Tofis_Rate_Init(tofis_rate_t *rate, uint32_t link_bytes_per_s,
+                     uint8_t frequency_hz, uint8_t integration_ms,
+                     const tofis_rate_link_t *link, uint32_t now_us) {
+  memset(rate, 0, sizeof(*rate));
+  rate->enabled = 1;
+  rate->frequency_hz = frequency_hz;
+  rate->integration_ms = integration_ms;
+  rate->link_bytes_per_s = link_bytes_per_s;
+  rate->quality_percent = 100;
+  Tofis_Rate_Mark(rate, link, now_us);
+}
+
+void Tofis_Rate_AddFrame(tofis_rate_t *rate, uint8_t sensor,
+                         const RANGING_SENSOR_Result_t *result) {
+  uint32_t zones = result->NumberOfZones;
+  uint8_t compare;
+
+  if ((sensor >= RANGING_SENSOR_INSTANCES_NBR) ||
+      (zones > VL53L8A1_MAX_DATA_SIZE)) {
+    return;
+  }
+  compare = (rate->previous_zones[sensor] == zones) ? 1U : 0U;
+
+  for (uint32_t z = 0; z < zones; z++) {
+    const RANGING_SENSOR_ZoneResult_t *zone = &result->ZoneResult[z];
+    int16_t *previous = &rate->previous[sensor][z];
+    int16_t distance = -1;
+
+    // the BSP maps the valid range statuses (5 and 9) to 0, the sensor
+    // flags a range whose sigma or signal is off
+    if ((zone->NumberOfTargets != 0U) && (zone->Status[0] == 0U)) {
+      distance = (zone->Distance[0] > INT16_MAX) ? INT16_MAX
+                                                 : (int16_t)zone->Distance[0];
+      rate->valid++;
+    }
+    rate->scanned++;
+
+    if (compare != 0U) {
+      int32_t change = (int32_t)distance - *previous;
+
+      rate->zones++;
+      if (((distance < 0) != (*previous < 0)) ||
+          ((distance >= 0) &&
+           ((change > TOFIS_RATE_MOTION_MM) ||
+            (change < -TOFIS_RATE_MOTION_MM)))) {
+        rate->moving++;
+      }
+    }
+    *previous = distance;
+  }
+
+  rate->previous_zones[sensor] = (uint8_t)zones;
+}
+
+/**
+ * @brief Highest frequency the link carries for every sensor at the average
+ * frame size of the window, max_hz if nothing was sent.
+ */
+static uint8_t Tofis_Rate_LinkMax(const tofis_rate_t *rate, uint32_t bytes,
+                                  uint32_t frames, uint8_t sensors,
+                                  uint8_t max_hz) {
+  uint32_t budget = rate->link_bytes_per_s / 100U * TOFIS_LINK_LOAD_PERCENT;
+  uint32_t hz;
+
+  if ((frames == 0U) || (bytes == 0U) || (sensors == 0U)) {
+    return max_hz;
+  }
+  // bytes / frames per frame, for every sensor
+  hz = (uint32_t)((uint64_t)budget * frames / ((uint64_t)bytes * sensors));
+
+  return (hz > max_hz) ? max_hz : (uint8_t)hz;
+}
+
+uint8_t Tofis_Rate_Update(tofis_rate_t *rate, uint32_t now_us,
+                          const tofis_rate_link_t *link, uint8_t sensors,
+                          uint8_t max_hz, uint8_t autonomous,
+                          uint8_t *frequency_hz, uint8_t *integration_ms) {
+  uint32_t frames = link->frames_sent - rate->frames_mark;
+  uint32_t bytes = link->bytes_sent - rate->bytes_mark;
+  uint32_t dropped = link->frames_dropped - rate->dropped_mark;
+  uint32_t target = rate->frequency_hz;
+  uint32_t integration = rate->integration_ms;
+  uint32_t limit;
+  uint8_t measured;
+
+  if ((rate->enabled == 0U) ||
+      ((now_us - rate->window_start_us) < TOFIS_RATE_WINDOW_US)) {
+    return 0;
+  }
+  measured = (rate->zones != 0U) ? 1U : 0U;
+
+  if (measured != 0U) {
+    rate->motion_percent = (uint8_t)(rate->moving * 100U / rate->zones);
+  }
+  if (rate->scanned != 0U) {
+    rate->quality_percent = (uint8_t)(rate->valid * 100U / rate->scanned);
+  }
+  rate->link_max_hz = Tofis_Rate_LinkMax(rate, bytes, frames, sensors, max_hz);
+  Tofis_Rate_Mark(rate, link, now_us);
+
+  if (dropped != 0U) {
+    // the link fell behind, whatever the scene
+    target = target * 3U / 4U;
+    rate->hold = TOFIS_RATE_HOLD_WINDOWS;
+  } else if (measured == 0U) {
+    // no frame to compare, e.g. right after a restart
+    return 0;
+  } else if (rate->motion_percent >= TOFIS_RATE_MOTION_HIGH_PERCENT) {
+    target = max_hz;
+  } else if (rate->motion_percent < TOFIS_RATE_MOTION_LOW_PERCENT) {
+    target = target / 2U;
+  }
+
+  // continuous mode integrates over the whole period, the time is not used
+  if (autonomous != 0U) {
+    if (rate->quality_percent < TOFIS_RATE_QUALITY_LOW_PERCENT) {
+      integration = integration * 3U / 2U + 1U;
+      // unless the scene moves, trade frequency for the longer integration
+      if (rate->motion_percent < TOFIS_RATE_MOTION_HIGH_PERCENT) {
+        integration = (integration > TOFIS_RATE_INTEGRATION_MAX_MS)
+                          ? TOFIS_RATE_INTEGRATION_MAX_MS
+                          : integration;
+        limit = 1000U / (integration + TOFIS_RATE_INTEGRATION_MARGIN_MS);
+        target = (target > limit) ? limit : target;
+      }
+    } else if ((rate->quality_percent > TOFIS_RATE_QUALITY_HIGH_PERCENT) &&
+               (rate->motion_percent >= TOFIS_RATE_MOTION_HIGH_PERCENT)) {
+      // shorter exposures blur moving targets less
+      integration = integration * 3U / 4U;
+    }
+  }
+
+  if (rate->hold != 0U) {
+    rate->hold--;
+    target = (target > rate->frequency_hz) ? rate->frequency_hz : target;
+  }
+  target = (target < TOFIS_RATE_MIN_HZ) ? TOFIS_RATE_MIN_HZ : target;
+  target = (target > max_hz) ? max_hz : target;
+  target = (target > rate->link_max_hz) ? rate->link_max_hz : target;
+  target = (target == 0U) ? 1U : target;
+
+  if (autonomous != 0U) {
+    // the integration has to end within the ranging period
+    limit = 1000U / target - TOFIS_RATE_INTEGRATION_MARGIN_MS;
+    limit = (limit > TOFIS_RATE_INTEGRATION_MAX_MS)
+                ? TOFIS_RATE_INTEGRATION_MAX_MS
+                : limit;
+    integration = (integration > limit) ? limit : integration;
+    integration = (integration < TOFIS_RATE_INTEGRATION_MIN_MS)
+                      ? TOFIS_RATE_INTEGRATION_MIN_MS
+                      : integration;
+  }
+
+  if ((target == rate->frequency_hz) &&
+      (integration == rate->integration_ms)) {
+    return 0;
+  }
+
+  *frequency_hz = (uint8_t)target;
+  *integration_ms = (uint8_t)integration;
+  return 1;
+}
+
+void Tofis_Rate_Applied(tofis_rate_t *rate, uint8_t frequency_hz,
+                        uint8_t integration_ms) {
+  rate->frequency_hz = frequency_hz;
+  rate->integration_ms = integration_ms;
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "53l8a1_ranging_sensor.h"
+#include "tofis_data.h"
+#include "tofis_link.h"
+
+// frames are evaluated over windows of this length
+#define TOFIS_RATE_WINDOW_US (1000000U)
+
+// lowest rate of a static scene and sensor limits per resolution
+#define TOFIS_RATE_MIN_HZ (5U)
+#define TOFIS_RATE_MAX_HZ_4X4 (60U)
+#define TOFIS_RATE_MAX_HZ_8X8 (15U)
+
+// a zone moves if its distance changes by more than this between two frames
+#define TOFIS_RATE_MOTION_MM (30)
+// moving zones [%] above which the scene asks for the highest rate, and below
+// which the rate is halved
+#define TOFIS_RATE_MOTION_HIGH_PERCENT (10U)
+#define TOFIS_RATE_MOTION_LOW_PERCENT (2U)
+
+// zones with a valid target [%] below which the integration time is raised
+// (autonomous mode), and above which a moving scene lowers it again
+#define TOFIS_RATE_QUALITY_LOW_PERCENT (50U)
+#define TOFIS_RATE_QUALITY_HIGH_PERCENT (80U)
+// integration time bounds [ms], the ranging period keeps a margin beyond it
+#define TOFIS_RATE_INTEGRATION_MIN_MS (5U)
+#define TOFIS_RATE_INTEGRATION_MAX_MS (100U)
+#define TOFIS_RATE_INTEGRATION_MARGIN_MS (3U)
+
+// windows without increase after a frame was dropped on the link
+#define TOFIS_RATE_HOLD_WINDOWS (3U)
+
+/**
+ * @brief Adaptive ranging frequency and integration time.
+ *
+ * @note The frames of every sensor feed the statistics of a window. At the end
+ * of each window the controller picks the highest frequency the link and the
+ * sensor sustain when the scene moves, halves it when the scene is static,
+ * and trades frequency for integration time when few zones have a valid
+ * target, the sensor rejecting ranges whose sigma or signal is off (autonomous
+ * mode only, continuous mode integrates over the whole period). The link
+ * ceiling follows the average size of the frames sent in the window. A frame
+ * dropped on the link lowers the frequency at once and holds it for a few
+ * windows.
+ */
+typedef struct {
+  uint8_t enabled;           /**< Controller running */
+  uint8_t frequency_hz;      /**< Frequency in effect */
+  uint8_t integration_ms;    /**< Integration time in effect */
+  uint8_t hold;              /**< Windows left without increase */
+  uint32_t link_bytes_per_s; /**< Link capacity */
+  uint32_t window_start_us;  /**< Start of the current window */
+  uint32_t zones;            /**< Zones compared with the previous frame */
+  uint32_t moving;           /**< Of them, zones that moved */
+  uint32_t scanned;          /**< Zones of the frames, for the quality */
+  uint32_t valid;            /**< Of them, zones with a valid target */
+  uint32_t bytes_mark;       /**< Link bytes sent at the window start */
+  uint32_t frames_mark;      /**< Link frames sent at the window start */
+  uint32_t dropped_mark;     /**< Link frames dropped at the window start */
+  uint8_t motion_percent;    /**< Moving zones of the last window */
+  uint8_t quality_percent;   /**< Valid zones of the last window */
+  uint8_t link_max_hz;       /**< Highest frequency the link sustains */
+  uint8_t previous_zones[RANGING_SENSOR_INSTANCES_NBR]; /**< 0: none yet */
+  int16_t previous[RANGING_SENSOR_INSTANCES_NBR]
+                  [VL53L8A1_MAX_DATA_SIZE]; /**< Distances, -1: no target */
+} tofis_rate_t;
+
+/**
+ * @brief Link usage at the end of a window, cumulative counters.
+ */
+typedef struct {
+  uint32_t bytes_sent;     /**< Bytes fully transmitted */
+  uint32_t frames_sent;    /**< Frames fully transmitted */
+  uint32_t frames_dropped; /**< Frames overwritten before transmission */
+} tofis_rate_link_t;
+
+/**
+ * @brief Starts the controller from the current settings, also clears the
+ * window.
+ *
+ * @param rate Pointer to the controller.
+ * @param link_bytes_per_s Link capacity (baud rate / 10 for 8N1).
+ * @param frequency_hz Ranging frequency in effect.
+ * @param integration_ms Integration time in effect.
+ * @param link Link counters now.
+ * @param now_us Tofis_Time_Us.
+ */
+void Tofis_Rate_Init(tofis_rate_t *rate, uint32_t link_bytes_per_s,
+                     uint8_t frequency_hz, uint8_t integration_ms,
+                     const tofis_rate_link_t *link, uint32_t now_us);
+
+/**
+ * @brief Accounts a frame for the motion and quality of the window. The first
+ * frame of a sensor, or the first one after a resolution change, is only kept
+ * as the reference of the next one.
+ *
+ * @param rate Pointer to the controller.
+ * @param sensor Ranging sensor instance (VL53L8A1_DEV_*).
+ * @param result Frame just read.
+ */
+void Tofis_Rate_AddFrame(tofis_rate_t *rate, uint8_t sensor,
+                         const RANGING_SENSOR_Result_t *result);
+
+/**
+ * @brief Ends the window once it is over and picks the settings for the next
+ * one.
+ *
+ * @param rate Pointer to the controller.
+ * @param now_us Tofis_Time_Us.
+ * @param link Link counters now.
+ * @param sensors Sensors ranging.
+ * @param max_hz Highest frequency of the resolution.
+ * @param autonomous 1 in autonomous mode, the integration time is used.
+ * @param frequency_hz Receives the frequency to apply.
+ * @param integration_ms Receives the integration time to apply.
+ * @return uint8_t 1 if the settings should change, 0 otherwise.
+ */
+uint8_t Tofis_Rate_Update(tofis_rate_t *rate, uint32_t now_us,
+                          const tofis_rate_link_t *link, uint8_t sensors,
+                          uint8_t max_hz, uint8_t autonomous,
+                          uint8_t *frequency_hz, uint8_t *integration_ms);
+
+/**
+ * @brief Records the settings actually applied.
+ *
+ * @param rate Pointer to the controller.
+ * @param frequency_hz Ranging frequency in effect.
+ * @param integration_ms Integration time in effect.
+ */
+void Tofis_Rate_Applied(tofis_rate_t *rate, uint8_t frequency_hz,
+                        uint8_t integration_ms);
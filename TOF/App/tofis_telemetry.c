@@ -0,0 +1,68 @@
+#include "tofis_telemetry.h"
+#include "stm32f4xx_hal.h"
+#include <string.h>
+
+typedef struct {
+  uint32_t min_us;
+  uint32_t max_us;
+  uint32_t sum_us;
+  uint32_t count;
+} tofis_stage_t;
+
+static tofis_stage_t _stages[TOFIS_STAGE_COUNT];
+static uint32_t _period_start_us = 0;
+
+void Tofis_Telemetry_Init(uint32_t now_us) {
+  memset(_stages, 0, sizeof(_stages));
+  _period_start_us = now_us;
+}
+
+void Tofis_Telemetry_Latency(uint8_t stage, uint32_t latency_us) {
+  uint32_t primask = __get_PRIMASK();
+  tofis_stage_t *s;
+
+  if (stage >= TOFIS_STAGE_COUNT) {
+    return;
+  }
+  s = &_stages[stage];
+
+  // the read stage is reported by the I2C interrupt, the queue stage by the
+  // UART one
+  __disable_irq();
+  if ((s->count == 0U) || (latency_us < s->min_us)) {
+    s->min_us = latency_us;
+  }
+  if (latency_us > s->max_us) {
+    s->max_us = latency_us;
+  }
+  s->sum_us += latency_us;
+  s->count++;
+  __set_PRIMASK(primask);
+}
+
+uint8_t Tofis_Telemetry_Due(uint32_t now_us) {
+  return ((now_us - _period_start_us) >= TOFIS_TELEMETRY_PERIOD_US) ? 1U : 0U;
+}
+
+void Tofis_Telemetry_Take(tofis_telemetry_t *telemetry, uint32_t now_us) {
+  tofis_stage_t stages[TOFIS_STAGE_COUNT];
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  memcpy(stages, _stages, sizeof(stages));
+  memset(_stages, 0, sizeof(_stages));
+  __set_PRIMASK(primask);
+
+  telemetry->period_us = now_us - _period_start_us;
+  _period_start_us = now_us;
+
+  for (uint32_t i = 0; i < TOFIS_STAGE_COUNT; i++) {
+    tofis_latency_desc_t *latency = &telemetry->latency[i];
+
+    latency->min_us = stages[i].min_us;
+    latency->max_us = stages[i].max_us;
+    latency->avg_us =
+        (stages[i].count != 0U) ? stages[i].sum_us / stages[i].count : 0U;
+    latency->count = stages[i].count;
+  }
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "tofis_data.h"
+
+// a TOFIS_ENCODING_TELEMETRY frame is sent once per period
+#define TOFIS_TELEMETRY_PERIOD_US (1000000U)
+
+/**
+ * @brief Starts the latency statistics of the first period, call it before
+ * the interrupts that report latencies are enabled.
+ *
+ * @param now_us Tofis_Time_Us.
+ */
+void Tofis_Telemetry_Init(uint32_t now_us);
+
+/**
+ * @brief Accounts the latency of a frame through a stage, safe from interrupt
+ * handlers.
+ *
+ * @param stage TOFIS_STAGE_*.
+ * @param latency_us Time the frame spent in the stage.
+ */
+void Tofis_Telemetry_Latency(uint8_t stage, uint32_t latency_us);
+
+/**
+ * @brief Returns non-zero once the current period is over.
+ *
+ * @param now_us Tofis_Time_Us.
+ */
+uint8_t Tofis_Telemetry_Due(uint32_t now_us);
+
+/**
+ * @brief Fills the latencies and the period of a telemetry frame and starts
+ * the next period. The counters are left to the caller.
+ *
+ * @param telemetry Frame to fill.
+ * @param now_us Tofis_Time_Us.
+ */
+void Tofis_Telemetry_Take(tofis_telemetry_t *telemetry, uint32_t now_us);
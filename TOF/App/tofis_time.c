@@ -0,0 +1,41 @@
+#include "tofis_time.h"
+#include "stm32f4xx_hal.h"
+
+static uint32_t _cycles_per_us = 1;
+static uint32_t _last_cycles = 0;
+static uint32_t _rest_cycles = 0;
+static uint32_t _time_us = 0;
+
+void Tofis_Time_Init(void) {
+  _cycles_per_us = SystemCoreClock / 1000000U;
+  _last_cycles = 0;
+  _rest_cycles = 0;
+  _time_us = 0;
+
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  // WFI gates the core clock and the cycle counter with it, keep it counting
+  // in sleep mode
+  DBGMCU->CR |= DBGMCU_CR_DBG_SLEEP;
+}
+
+uint32_t Tofis_Time_Us(void) {
+  uint32_t primask = __get_PRIMASK();
+  uint32_t now;
+  uint32_t elapsed;
+  uint32_t time_us;
+
+  __disable_irq();
+  now = DWT->CYCCNT;
+  // the counter itself is not a whole number of microseconds per wrap, so
+  // accumulate the elapsed cycles and carry the remainder
+  elapsed = (now - _last_cycles) + _rest_cycles;
+  _last_cycles = now;
+  _time_us += elapsed / _cycles_per_us;
+  _rest_cycles = elapsed % _cycles_per_us;
+  time_us = _time_us;
+  __set_PRIMASK(primask);
+
+  return time_us;
+}
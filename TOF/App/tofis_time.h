@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * @brief Starts the DWT cycle counter used as microsecond time base, it keeps
+ * counting while the core sleeps in WFI.
+ */
+void Tofis_Time_Init(void);
+
+/**
+ * @brief Microseconds since Tofis_Time_Init, wraps after 2^32 us (~71 min).
+ *
+ * @note The cycle counter wraps every 2^32 cycles (~51 s at 84 MHz), call this
+ * at least once per wrap (the main loop does) to keep the count exact. Safe to
+ * call from interrupt handlers.
+ *
+ * @return uint32_t Current time in microseconds.
+ */
+uint32_t Tofis_Time_Us(void);
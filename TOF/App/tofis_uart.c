@@ -1,7 +1,196 @@
 #include "tofis_uart.h"
 #include "check_sum.h"
+#include "tofis_telemetry.h"
+#include "tofis_time.h"
 
-static tofis_data_packet_t _packet;
+DMA_HandleTypeDef hdma_usart2_tx;
+
+// device whose DMA transfer completes in HAL_UART_TxCpltCallback
+static tofis_slave_device_t *_tx_device = NULL;
+
+/**
+ * @brief Links the USART2 TX DMA stream (DMA1 Stream6, channel 4) to the UART
+ * handle and enables the interrupts needed by HAL_UART_Transmit_DMA.
+ *
+ * @param huart Pointer to the UART handle.
+ */
+static void Tofis_Slave_USART_DMA_Init(UART_HandleTypeDef *huart) {
+  __HAL_RCC_DMA1_CLK_ENABLE();
+
+  hdma_usart2_tx.Instance = DMA1_Stream6;
+  hdma_usart2_tx.Init.Channel = DMA_CHANNEL_4;
+  hdma_usart2_tx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+  hdma_usart2_tx.Init.PeriphInc = DMA_PINC_DISABLE;
+  hdma_usart2_tx.Init.MemInc = DMA_MINC_ENABLE;
+  hdma_usart2_tx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+  hdma_usart2_tx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+  hdma_usart2_tx.Init.Mode = DMA_NORMAL;
+  hdma_usart2_tx.Init.Priority = DMA_PRIORITY_LOW;
+  hdma_usart2_tx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+  HAL_DMA_DeInit(&hdma_usart2_tx);
+  HAL_DMA_Init(&hdma_usart2_tx);
+
+  __HAL_LINKDMA(huart, hdmatx, hdma_usart2_tx);
+
+  HAL_NVIC_SetPriority(DMA1_Stream6_IRQn, 0, 1);
+  HAL_NVIC_EnableIRQ(DMA1_Stream6_IRQn);
+  HAL_NVIC_SetPriority(USART2_IRQn, 0, 1);
+  HAL_NVIC_EnableIRQ(USART2_IRQn);
+}
+
+/**
+ * @brief Accounts a frame the host never gets, whole or at all. The next delta
+ * mode frame of its sensor is then a keyframe, the host lost the reference.
+ * Interrupts must be masked or the caller must be a UART callback.
+ *
+ * @note Only flags the sensor, the delta state belongs to the encoder, which
+ * an interrupt may have preempted (Tofis_Slave_USART_SendData_Delta).
+ *
+ * @param device Pointer to the Slave device structure.
+ * @param frame Start of the lost frame.
+ */
+static void Tofis_Slave_USART_LoseFrame(tofis_slave_device_t *device,
+                                        const uint8_t *frame) {
+  const tofis_frame_header_t *header = (const tofis_frame_header_t *)frame;
+
+  // acks and announcements are no delta reference
+  if ((header->encoding < TOFIS_ENCODING_ACK) &&
+      (header->sensor < RANGING_SENSOR_INSTANCES_NBR)) {
+    device->delta_lost |= (uint8_t)(1U << header->sensor);
+  }
+}
+
+/**
+ * @brief Returns the half the next frame can be serialized into.
+ *
+ * @note A frame still queued in that half is dropped, the newer frame wins.
+ *
+ * @param device Pointer to the Slave device structure.
+ * @param dropped Set to 1 if a queued frame was dropped.
+ * @return uint8_t* Start of the free half.
+ */
+static uint8_t *Tofis_Slave_USART_AcquireBuffer(tofis_slave_device_t *device,
+                                                uint8_t *dropped) {
+  uint8_t *frame;
+
+  __disable_irq();
+  frame = &device->buffer[(device->wire_half ^ 1U) *
+                          VL53L8A1_PING_PONG_HALF_SIZE];
+  if (device->pending_length != 0) {
+    device->pending_length = 0;
+    device->frames_dropped++;
+    Tofis_Slave_USART_LoseFrame(device, frame);
+    *dropped = 1;
+  } else {
+    *dropped = 0;
+  }
+  __enable_irq();
+
+  return frame;
+}
+
+/**
+ * @brief Stamps a frame with the transmission start time and accounts the
+ * time since its data ready interrupt and since it was queued.
+ *
+ * @param device Pointer to the Slave device structure.
+ * @param frame Start of the frame about to be transmitted.
+ */
+static void Tofis_Slave_USART_StampTx(tofis_slave_device_t *device,
+                                      uint8_t *frame) {
+  tofis_frame_header_t *header = (tofis_frame_header_t *)frame;
+  uint32_t latency_us;
+
+  header->tx_time_us = Tofis_Time_Us();
+  if (header->encoding >= TOFIS_ENCODING_ACK) {
+    return;
+  }
+  latency_us = header->tx_time_us - header->irq_time_us;
+  Tofis_Telemetry_Latency(TOFIS_STAGE_QUEUE,
+                          header->tx_time_us - device->queued_us);
+  Tofis_Telemetry_Latency(TOFIS_STAGE_TOTAL, latency_us);
+
+  device->latency_sum_us += latency_us;
+  device->latency_frames++;
+  if (latency_us > device->latency_max_us) {
+    device->latency_max_us = latency_us;
+  }
+}
+
+#ifdef VL53L8A1_UART_USE_DMA
+/**
+ * @brief Moves the wire to the other half and starts its DMA transfer,
+ * stamping the frame with the transmission start time. Interrupts must be
+ * masked or the caller must be the Tx complete callback.
+ *
+ * @param device Pointer to the Slave device structure.
+ * @param length Frame length in bytes.
+ * @return HAL_StatusTypeDef Status of HAL_UART_Transmit_DMA.
+ */
+static HAL_StatusTypeDef
+Tofis_Slave_USART_StartWire(tofis_slave_device_t *device, uint16_t length) {
+  uint8_t *frame;
+
+  device->wire_half ^= 1U;
+  frame = &device->buffer[device->wire_half * VL53L8A1_PING_PONG_HALF_SIZE];
+  Tofis_Slave_USART_StampTx(device, frame);
+
+  return HAL_UART_Transmit_DMA(device->huart, frame, length);
+}
+#endif
+
+/**
+ * @brief Hands a serialized frame over to the wire.
+ *
+ * @param device Pointer to the Slave device structure.
+ * @param length Frame length in the half returned by
+ * Tofis_Slave_USART_AcquireBuffer.
+ * @return HAL_StatusTypeDef Status of the UART transmission.
+ */
+static HAL_StatusTypeDef
+Tofis_Slave_USART_SubmitBuffer(tofis_slave_device_t *device, uint16_t length) {
+#ifdef VL53L8A1_UART_USE_DMA
+  HAL_StatusTypeDef status = HAL_OK;
+
+  __disable_irq();
+  // a queued frame replaces the previous one, only one waits at a time
+  device->queued_us = Tofis_Time_Us();
+  if (device->tx_active) {
+    // picked up by HAL_UART_TxCpltCallback
+    device->pending_length = length;
+  } else {
+    device->tx_active = 1;
+    status = Tofis_Slave_USART_StartWire(device, length);
+    if (status != HAL_OK) {
+      device->tx_active = 0;
+      device->tx_errors++;
+      Tofis_Slave_USART_LoseFrame(
+          device,
+          &device->buffer[device->wire_half * VL53L8A1_PING_PONG_HALF_SIZE]);
+    }
+  }
+  __enable_irq();
+
+  return status;
+#else
+  uint8_t *frame =
+      &device->buffer[(device->wire_half ^ 1U) * VL53L8A1_PING_PONG_HALF_SIZE];
+
+  device->queued_us = Tofis_Time_Us();
+  Tofis_Slave_USART_StampTx(device, frame);
+  HAL_StatusTypeDef status = HAL_UART_Transmit(device->huart, frame, length,
+                                               VL53L8A1_UART_MAX_DELAY);
+  if (status == HAL_OK) {
+    device->frames_sent++;
+    device->bytes_sent += length;
+  } else {
+    // HAL_TIMEOUT after VL53L8A1_UART_MAX_DELAY, the frame went out cut
+    device->tx_errors++;
+    Tofis_Slave_USART_LoseFrame(device, frame);
+  }
+  return status;
+#endif
+}
 
 /**
  * @brief Initializes the Slave UART device.
@@ -13,6 +202,126 @@ void Tofis_Slave_USART_Init(tofis_slave_device_t *device,
                             UART_HandleTypeDef *huart) {
   device->huart = huart;
   memset(device->buffer, 0, VL53L8A1_PING_PONG_BUFFER_SIZE);
+  device->wire_half = 1;
+  device->tx_active = 0;
+  device->pending_length = 0;
+  device->frames_sent = 0;
+  device->bytes_sent = 0;
+  device->frames_dropped = 0;
+  device->tx_errors = 0;
+  device->queued_us = 0;
+  device->sequence = 0;
+  device->stream_count = 0;
+  device->sensor = 0;
+  device->irq_time_us = 0;
+  device->config_id = 0;
+  Tofis_Slave_USART_ResetLatency(device);
+  for (uint8_t i = 0; i < RANGING_SENSOR_INSTANCES_NBR; i++) {
+    device->delta[i].key_id = 0;
+    device->delta[i].index = 0;
+  }
+  device->delta_lost = 0;
+
+  crc32_init();
+
+#ifdef VL53L8A1_UART_USE_DMA
+  Tofis_Slave_USART_DMA_Init(huart);
+#endif
+
+  _tx_device = device;
+}
+
+void Tofis_Slave_USART_SetFrameInfo(tofis_slave_device_t *device,
+                                    uint8_t sensor, uint8_t stream_count,
+                                    uint32_t irq_time_us) {
+  device->sensor = sensor;
+  device->stream_count = stream_count;
+  device->irq_time_us = irq_time_us;
+}
+
+void Tofis_Slave_USART_ResetDelta(tofis_slave_device_t *device) {
+  for (uint32_t i = 0; i < RANGING_SENSOR_INSTANCES_NBR; i++) {
+    device->delta[i].index = 0;
+  }
+}
+
+void Tofis_Slave_USART_ResetLatency(tofis_slave_device_t *device) {
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  device->latency_sum_us = 0;
+  device->latency_max_us = 0;
+  device->latency_frames = 0;
+  __set_PRIMASK(primask);
+}
+
+uint8_t Tofis_Slave_USART_IsBusy(tofis_slave_device_t *device) {
+  return device->tx_active || (device->pending_length != 0);
+}
+
+static inline uint8_t *put_u16(uint8_t *p, uint16_t value) {
+  p[0] = (uint8_t)(value & 0xFF);
+  p[1] = (uint8_t)(value >> 8);
+  return p + 2;
+}
+
+static inline uint16_t saturate_u16(float value) {
+  if (value <= 0.0f) {
+    return 0;
+  }
+  return (value >= 65535.0f) ? 0xFFFF : (uint16_t)value;
+}
+
+static inline uint16_t clamp_u16(uint32_t value) {
+  return (value > 0xFFFFU) ? 0xFFFF : (uint16_t)value;
+}
+
+/**
+ * @brief Fills the header in front of an encoded payload, pads the payload to
+ * a multiple of 4 bytes and hands the frame over to the wire.
+ *
+ * @param device Pointer to the Slave device structure.
+ * @param frame Start of the frame (header) in the acquired half.
+ * @param encoding Payload encoding (TOFIS_ENCODING_*).
+ * @param length Payload length in bytes.
+ * @return HAL_StatusTypeDef Status of the UART transmission.
+ */
+static HAL_StatusTypeDef Tofis_Slave_USART_SubmitFrame(
+    tofis_slave_device_t *device, uint8_t *frame, uint8_t encoding,
+    uint16_t length) {
+  tofis_frame_header_t *header = (tofis_frame_header_t *)frame;
+  uint8_t *payload = frame + sizeof(tofis_frame_header_t);
+  uint16_t padded = TOFIS_PADDED_LENGTH(length);
+
+  memset(payload + length, 0, padded - length);
+
+  header->sync[0] = TOFIS_SYNC_BYTE_0;
+  header->sync[1] = TOFIS_SYNC_BYTE_1;
+  header->version = TOFIS_PROTOCOL_VERSION;
+  header->encoding = encoding;
+  header->length = length;
+  // dropped frames consume a sequence number too, so the host sees the gap
+  header->sequence = device->sequence++;
+  header->stream_count = device->stream_count;
+  header->sensor = device->sensor;
+  header->config_id = device->config_id;
+  header->reserved = 0;
+  header->irq_time_us = device->irq_time_us;
+  header->tx_time_us = 0;
+
+  calculate_crc32(frame, TOFIS_FRAME_HEADER_CRC_SIZE);
+  header->crc32 = accumulate_crc32(payload, padded);
+
+  return Tofis_Slave_USART_SubmitBuffer(device,
+                                        sizeof(tofis_frame_header_t) + padded);
+}
+
+static inline uint8_t *put_u32_be(uint8_t *p, uint32_t value) {
+  p[0] = (uint8_t)(value >> 24);
+  p[1] = (uint8_t)(value >> 16);
+  p[2] = (uint8_t)(value >> 8);
+  p[3] = (uint8_t)(value & 0xFF);
+  return p + 4;
 }
 
 /**
@@ -21,101 +330,591 @@ void Tofis_Slave_USART_Init(tofis_slave_device_t *device,
  * @param device Pointer to the Slave device structure.
  * @param resolution Matrix resolution (4 or 8).
  * @param result Pointer to the Ranging Sensor Result structure.
- * @return HAL_StatusTypeDef Status of the UART transmission.
+ * @return HAL_StatusTypeDef HAL_OK if the frame is on the wire or queued,
+ * HAL_BUSY if a queued frame had to be dropped for this one.
  */
 HAL_StatusTypeDef Tofis_Slave_USART_SendData(tofis_slave_device_t *device,
                                              uint8_t resolution,
                                              RANGING_SENSOR_Result_t *result) {
-  uint8_t *buffer = device->buffer;
-  int index = 0;
-
-  // Start byte
-  buffer[index++] = 0xAA;
+  uint8_t dropped;
+  uint8_t *frame = Tofis_Slave_USART_AcquireBuffer(device, &dropped);
+  uint8_t *payload = frame + sizeof(tofis_frame_header_t);
+  tofis_raw_desc_t *desc = (tofis_raw_desc_t *)payload;
+  uint8_t *p = payload + sizeof(tofis_raw_desc_t);
 
-  // Resolution byte
-  buffer[index++] = resolution;
-
-  // Placeholder for checksum
-  int checksum_position = index++;
-
-  // End byte (reserved byte)
-  buffer[index++] = 0x55;
+  desc->resolution = resolution;
+  desc->targets = RANGING_SENSOR_NB_TARGET_PER_ZONE;
+  memset(desc->reserved, 0, sizeof(desc->reserved));
 
   // Serialize NumberOfZones
-  buffer[index++] = (result->NumberOfZones >> 24) & 0xFF;
-  buffer[index++] = (result->NumberOfZones >> 16) & 0xFF;
-  buffer[index++] = (result->NumberOfZones >> 8) & 0xFF;
-  buffer[index++] = result->NumberOfZones & 0xFF;
+  p = put_u32_be(p, result->NumberOfZones);
 
   // Serialize each ZoneResult
   for (uint32_t zone = 0; zone < result->NumberOfZones; zone++) {
     RANGING_SENSOR_ZoneResult_t *zone_result = &result->ZoneResult[zone];
 
     // NumberOfTargets
-    buffer[index++] = zone_result->NumberOfTargets;
+    *p++ = zone_result->NumberOfTargets;
 
     // Distance array
     for (int i = 0; i < RANGING_SENSOR_NB_TARGET_PER_ZONE; i++) {
-      buffer[index++] = (zone_result->Distance[i] >> 24) & 0xFF;
-      buffer[index++] = (zone_result->Distance[i] >> 16) & 0xFF;
-      buffer[index++] = (zone_result->Distance[i] >> 8) & 0xFF;
-      buffer[index++] = zone_result->Distance[i] & 0xFF;
+      p = put_u32_be(p, zone_result->Distance[i]);
     }
 
     // Status array
     for (int i = 0; i < RANGING_SENSOR_NB_TARGET_PER_ZONE; i++) {
-      buffer[index++] = (zone_result->Status[i] >> 24) & 0xFF;
-      buffer[index++] = (zone_result->Status[i] >> 16) & 0xFF;
-      buffer[index++] = (zone_result->Status[i] >> 8) & 0xFF;
-      buffer[index++] = zone_result->Status[i] & 0xFF;
+      p = put_u32_be(p, zone_result->Status[i]);
     }
 
     // Ambient array
     for (int i = 0; i < RANGING_SENSOR_NB_TARGET_PER_ZONE; i++) {
-      float ambient = zone_result->Ambient[i];
-      uint8_t *ambient_bytes = (uint8_t *)&ambient;
-      buffer[index++] = ambient_bytes[3];
-      buffer[index++] = ambient_bytes[2];
-      buffer[index++] = ambient_bytes[1];
-      buffer[index++] = ambient_bytes[0];
+      uint32_t ambient;
+      memcpy(&ambient, &zone_result->Ambient[i], sizeof(ambient));
+      p = put_u32_be(p, ambient);
     }
 
     // Signal array
     for (int i = 0; i < RANGING_SENSOR_NB_TARGET_PER_ZONE; i++) {
-      float signal = zone_result->Signal[i];
-      uint8_t *signal_bytes = (uint8_t *)&signal;
-      buffer[index++] = signal_bytes[3];
-      buffer[index++] = signal_bytes[2];
-      buffer[index++] = signal_bytes[1];
-      buffer[index++] = signal_bytes[0];
+      uint32_t signal;
+      memcpy(&signal, &zone_result->Signal[i], sizeof(signal));
+      p = put_u32_be(p, signal);
     }
   }
 
-  // Calculate checksum over resolution and data
-  buffer[checksum_position] =
-      calculate_checksum((uint8_t *)result, sizeof(RANGING_SENSOR_Result_t));
-
   // Transmit the buffer up to the current index
-  HAL_StatusTypeDef status =
-      HAL_UART_Transmit(device->huart, buffer, index, VL53L8A1_UART_MAX_DELAY);
-  return status;
+  HAL_StatusTypeDef status = Tofis_Slave_USART_SubmitFrame(
+      device, frame, TOFIS_ENCODING_RAW_BE, (uint16_t)(p - payload));
+  return (status == HAL_OK && dropped) ? HAL_BUSY : status;
 }
 
 HAL_StatusTypeDef
 Tofis_Slave_USART_SendData_Le(tofis_slave_device_t *device, uint8_t resolution,
                               RANGING_SENSOR_Result_t *result) {
-  _packet.start_byte = 0xAA;
-  _packet.resolution = resolution;
-  _packet.end_byte = 0x55;
+  uint8_t dropped;
+  uint8_t *frame = Tofis_Slave_USART_AcquireBuffer(device, &dropped);
+  tofis_raw_desc_t *desc =
+      (tofis_raw_desc_t *)(frame + sizeof(tofis_frame_header_t));
 
-  memcpy(&_packet.data, result, sizeof(RANGING_SENSOR_Result_t));
+  desc->resolution = resolution;
+  desc->targets = RANGING_SENSOR_NB_TARGET_PER_ZONE;
+  memset(desc->reserved, 0, sizeof(desc->reserved));
 
-  // calculate checksum of result field
-  _packet.checksum =
-      calculate_checksum((uint8_t *)result, sizeof(RANGING_SENSOR_Result_t));
+  memcpy((uint8_t *)desc + sizeof(tofis_raw_desc_t), result,
+         sizeof(RANGING_SENSOR_Result_t));
 
   // transmit data packet
-  return HAL_UART_Transmit(device->huart, (uint8_t *)&_packet,
-                           sizeof(tofis_data_packet_t),
-                           VL53L8A1_UART_MAX_DELAY);
-}
\ No newline at end of file
+  HAL_StatusTypeDef status = Tofis_Slave_USART_SubmitFrame(
+      device, frame, TOFIS_ENCODING_RAW,
+      sizeof(tofis_raw_desc_t) + sizeof(RANGING_SENSOR_Result_t));
+  return (status == HAL_OK && dropped) ? HAL_BUSY : status;
+}
+
+HAL_StatusTypeDef Tofis_Slave_USART_SendAck(tofis_slave_device_t *device,
+                                            uint8_t id, uint8_t sequence,
+                                            uint8_t status) {
+  uint8_t dropped;
+  uint8_t *frame = Tofis_Slave_USART_AcquireBuffer(device, &dropped);
+  tofis_cmd_ack_t *ack =
+      (tofis_cmd_ack_t *)(frame + sizeof(tofis_frame_header_t));
+
+  ack->id = id;
+  ack->sequence = sequence;
+  ack->status = status;
+  ack->reserved = 0;
+
+  // not a ranging frame, the next one sets its own info again
+  Tofis_Slave_USART_SetFrameInfo(device, 0, 0, Tofis_Time_Us());
+  HAL_StatusTypeDef ret = Tofis_Slave_USART_SubmitFrame(
+      device, frame, TOFIS_ENCODING_ACK, sizeof(tofis_cmd_ack_t));
+  return (ret == HAL_OK && dropped) ? HAL_BUSY : ret;
+}
+
+HAL_StatusTypeDef
+Tofis_Slave_USART_SendConfig(tofis_slave_device_t *device,
+                             const tofis_config_desc_t *config) {
+  uint8_t dropped;
+  uint8_t *frame = Tofis_Slave_USART_AcquireBuffer(device, &dropped);
+
+  memcpy(frame + sizeof(tofis_frame_header_t), config, sizeof(*config));
+
+  // the announcement already carries the new id
+  device->config_id = config->config_id;
+  Tofis_Slave_USART_SetFrameInfo(device, 0, 0, Tofis_Time_Us());
+  HAL_StatusTypeDef ret = Tofis_Slave_USART_SubmitFrame(
+      device, frame, TOFIS_ENCODING_CONFIG, sizeof(tofis_config_desc_t));
+  return (ret == HAL_OK && dropped) ? HAL_BUSY : ret;
+}
+
+HAL_StatusTypeDef
+Tofis_Slave_USART_SendTelemetry(tofis_slave_device_t *device,
+                                const tofis_telemetry_t *telemetry) {
+  uint8_t dropped;
+  uint8_t *frame = Tofis_Slave_USART_AcquireBuffer(device, &dropped);
+
+  memcpy(frame + sizeof(tofis_frame_header_t), telemetry, sizeof(*telemetry));
+
+  Tofis_Slave_USART_SetFrameInfo(device, 0, 0, Tofis_Time_Us());
+  HAL_StatusTypeDef ret = Tofis_Slave_USART_SubmitFrame(
+      device, frame, TOFIS_ENCODING_TELEMETRY, sizeof(tofis_telemetry_t));
+  return (ret == HAL_OK && dropped) ? HAL_BUSY : ret;
+}
+
+uint8_t Tofis_Slave_USART_AvailableFields(const tofis_frame_source_t *source) {
+  uint8_t fields = TOFIS_FIELD_DISTANCE | TOFIS_FIELD_STATUS |
+                   TOFIS_FIELD_SIGNAL | TOFIS_FIELD_AMBIENT;
+
+  // the other fields only exist in the ULD results, if not compiled out
+  if (source->raw != NULL) {
+#ifndef VL53L8CX_DISABLE_RANGE_SIGMA_MM
+    fields |= TOFIS_FIELD_SIGMA;
+#endif
+#ifndef VL53L8CX_DISABLE_REFLECTANCE_PERCENT
+    fields |= TOFIS_FIELD_REFLECTANCE;
+#endif
+#ifndef VL53L8CX_DISABLE_NB_SPADS_ENABLED
+    fields |= TOFIS_FIELD_SPADS;
+#endif
+    fields |= TOFIS_FIELD_TEMPERATURE;
+  }
+
+  return fields;
+}
+
+/**
+ * @brief Converts a zone of the source into the values carried on the wire.
+ *
+ * @param record Destination zone record.
+ * @param source Frame to encode.
+ * @param zone Zone index.
+ */
+static void Tofis_Zone_Record(tofis_zone_record_t *record,
+                              const tofis_frame_source_t *source,
+                              uint8_t zone) {
+  const RANGING_SENSOR_ZoneResult_t *zone_result =
+      &source->result->ZoneResult[zone];
+  const VL53L8CX_ResultsData *raw = source->raw;
+  uint8_t targets = zone_result->NumberOfTargets;
+
+  if (targets > source->targets) {
+    targets = source->targets;
+  }
+
+  memset(record, 0, sizeof(tofis_zone_record_t));
+  record->nb_targets = zone_result->NumberOfTargets;
+  record->records = targets;
+  // the BSP copies the zone ambient into every target
+  record->ambient = (targets > 0) ? saturate_u16(zone_result->Ambient[0]) : 0;
+
+  for (uint8_t t = 0; t < targets; t++) {
+    record->distance[t] = (int16_t)zone_result->Distance[t];
+    record->status[t] = (uint8_t)zone_result->Status[t];
+    record->signal[t] = saturate_u16(zone_result->Signal[t]);
+  }
+
+  if (raw == NULL) {
+    return;
+  }
+
+#ifndef VL53L8CX_DISABLE_NB_SPADS_ENABLED
+  record->spads = clamp_u16(raw->nb_spads_enabled[zone]);
+#endif
+
+  for (uint8_t t = 0; t < targets; t++) {
+    // the ULD packs the targets sent, not the array capacity
+    uint16_t index = (uint16_t)(source->targets * zone + t);
+
+    (void)index;
+#ifndef VL53L8CX_DISABLE_RANGE_SIGMA_MM
+    record->sigma[t] = raw->range_sigma_mm[index];
+#endif
+#ifndef VL53L8CX_DISABLE_REFLECTANCE_PERCENT
+    record->reflectance[t] = raw->reflectance[index];
+#endif
+  }
+}
+
+/**
+ * @brief Writes a full compact zone record.
+ *
+ * @param p Destination.
+ * @param record Zone record.
+ * @param fields Fields to include (TOFIS_FIELD_*).
+ * @return uint8_t* End of the written record.
+ */
+static uint8_t *Tofis_Encode_Zone(uint8_t *p, const tofis_zone_record_t *record,
+                                  uint8_t fields) {
+  *p++ = record->nb_targets;
+
+  if (fields & TOFIS_FIELD_AMBIENT) {
+    p = put_u16(p, record->ambient);
+  }
+  if (fields & TOFIS_FIELD_SPADS) {
+    p = put_u16(p, record->spads);
+  }
+
+  // empty targets are not sent, the host knows them from nb_targets
+  for (uint8_t t = 0; t < record->records; t++) {
+    if (fields & TOFIS_FIELD_DISTANCE) {
+      p = put_u16(p, (uint16_t)record->distance[t]);
+    }
+    if (fields & TOFIS_FIELD_STATUS) {
+      *p++ = record->status[t];
+    }
+    if (fields & TOFIS_FIELD_SIGNAL) {
+      p = put_u16(p, record->signal[t]);
+    }
+    if (fields & TOFIS_FIELD_SIGMA) {
+      p = put_u16(p, record->sigma[t]);
+    }
+    if (fields & TOFIS_FIELD_REFLECTANCE) {
+      *p++ = record->reflectance[t];
+    }
+  }
+
+  return p;
+}
+
+/**
+ * @brief Size of a zone record with the given fields and target records.
+ */
+static uint16_t Tofis_Zone_Size(uint8_t fields, uint8_t records) {
+  uint16_t zone = 1;
+  uint16_t target = 0;
+
+  zone += (fields & TOFIS_FIELD_AMBIENT) ? 2 : 0;
+  zone += (fields & TOFIS_FIELD_SPADS) ? 2 : 0;
+  target += (fields & TOFIS_FIELD_DISTANCE) ? 2 : 0;
+  target += (fields & TOFIS_FIELD_STATUS) ? 1 : 0;
+  target += (fields & TOFIS_FIELD_SIGNAL) ? 2 : 0;
+  target += (fields & TOFIS_FIELD_SIGMA) ? 2 : 0;
+  target += (fields & TOFIS_FIELD_REFLECTANCE) ? 1 : 0;
+
+  return zone + records * target;
+}
+
+uint16_t Tofis_Slave_USART_FrameSize(uint8_t encoding, uint8_t resolution,
+                                     uint8_t targets, uint8_t fields) {
+  uint32_t payload;
+
+  switch (encoding) {
+  case TOFIS_ENCODING_RAW:
+  case TOFIS_ENCODING_RAW_BE:
+    payload = sizeof(tofis_raw_desc_t) + sizeof(RANGING_SENSOR_Result_t);
+    break;
+
+  case TOFIS_ENCODING_COMPACT:
+  case TOFIS_ENCODING_KEYFRAME:
+  case TOFIS_ENCODING_DELTA:
+    payload = sizeof(tofis_frame_desc_t) +
+              ((fields & TOFIS_FIELD_TEMPERATURE) ? 1U : 0U) +
+              (uint32_t)resolution * resolution *
+                  Tofis_Zone_Size(fields, targets);
+    if (encoding != TOFIS_ENCODING_COMPACT) {
+      payload += sizeof(tofis_delta_desc_t);
+    }
+    break;
+
+  default:
+    return 0;
+  }
+
+  return (uint16_t)(sizeof(tofis_frame_header_t) +
+                    TOFIS_PADDED_LENGTH(payload));
+}
+
+/**
+ * @brief Fills the compact descriptor for a frame. Fields the source cannot
+ * provide are removed from the mask.
+ *
+ * @return uint8_t Number of zone records.
+ */
+static uint8_t Tofis_Encode_Desc(tofis_frame_desc_t *desc,
+                                 const tofis_frame_source_t *source) {
+  uint32_t zones = source->result->NumberOfZones;
+
+  if (zones > VL53L8A1_MAX_DATA_SIZE) {
+    zones = VL53L8A1_MAX_DATA_SIZE;
+  }
+
+  desc->resolution = source->resolution;
+  desc->fields = source->fields & Tofis_Slave_USART_AvailableFields(source);
+  desc->zones = (uint8_t)zones;
+  desc->targets = source->targets;
+
+  return (uint8_t)zones;
+}
+
+/**
+ * @brief Writes the per-frame values following the descriptor.
+ *
+ * @return uint8_t* End of the written values.
+ */
+static uint8_t *Tofis_Encode_Frame_Fields(uint8_t *p,
+                                          const tofis_frame_desc_t *desc,
+                                          const tofis_frame_source_t *source) {
+  if (desc->fields & TOFIS_FIELD_TEMPERATURE) {
+    *p++ = (uint8_t)source->raw->silicon_temp_degc;
+  }
+
+  return p;
+}
+
+/**
+ * @brief Encodes a frame as a compact payload (descriptor + zone records).
+ *
+ * @param payload Destination buffer.
+ * @param source Frame to encode.
+ * @param ref If not NULL, receives the zone records as the delta reference.
+ * @return uint16_t Payload length in bytes.
+ */
+static uint16_t Tofis_Encode_Compact(uint8_t *payload,
+                                     const tofis_frame_source_t *source,
+                                     tofis_zone_record_t *ref) {
+  tofis_frame_desc_t *desc = (tofis_frame_desc_t *)payload;
+  uint8_t zones = Tofis_Encode_Desc(desc, source);
+  uint8_t *p = Tofis_Encode_Frame_Fields(payload + sizeof(tofis_frame_desc_t),
+                                         desc, source);
+  tofis_zone_record_t record;
+
+  for (uint8_t zone = 0; zone < zones; zone++) {
+    tofis_zone_record_t *dst = (ref != NULL) ? &ref[zone] : &record;
+
+    Tofis_Zone_Record(dst, source, zone);
+    p = Tofis_Encode_Zone(p, dst, desc->fields);
+  }
+
+  return (uint16_t)(p - payload);
+}
+
+/**
+ * @brief Returns non-zero if a selected field other than the distance differs
+ * between two zone records.
+ */
+static uint8_t Tofis_Zone_Fields_Changed(const tofis_zone_record_t *a,
+                                         const tofis_zone_record_t *b,
+                                         uint8_t fields) {
+  if (a->nb_targets != b->nb_targets || a->records != b->records ||
+      ((fields & TOFIS_FIELD_AMBIENT) && a->ambient != b->ambient) ||
+      ((fields & TOFIS_FIELD_SPADS) && a->spads != b->spads)) {
+    return 1;
+  }
+
+  for (uint8_t t = 0; t < a->records; t++) {
+    if (((fields & TOFIS_FIELD_STATUS) && a->status[t] != b->status[t]) ||
+        ((fields & TOFIS_FIELD_SIGNAL) && a->signal[t] != b->signal[t]) ||
+        ((fields & TOFIS_FIELD_SIGMA) && a->sigma[t] != b->sigma[t]) ||
+        ((fields & TOFIS_FIELD_REFLECTANCE) &&
+         a->reflectance[t] != b->reflectance[t])) {
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+/**
+ * @brief Encodes the zones that differ from the reference frame.
+ *
+ * A changed zone is sent as one int8 distance delta per target record when
+ * only the distances changed and every delta fits in [-127, 127]. Otherwise
+ * TOFIS_DELTA_ESCAPE is followed by the full zone record. The reference is
+ * updated to the current frame.
+ *
+ * @param payload Destination buffer (after the tofis_delta_desc_t).
+ * @param desc Descriptor of the current frame.
+ * @param source Frame to encode.
+ * @param ref Zone records of the previous frame.
+ * @param key_length Receives the size this frame would have as keyframe.
+ * @return uint16_t Payload length in bytes.
+ */
+static uint16_t Tofis_Encode_Delta(uint8_t *payload,
+                                   const tofis_frame_desc_t *desc,
+                                   const tofis_frame_source_t *source,
+                                   tofis_zone_record_t *ref,
+                                   uint16_t *key_length) {
+  uint8_t *bitmap = Tofis_Encode_Frame_Fields(
+      payload + sizeof(tofis_frame_desc_t), desc, source);
+  uint8_t bitmap_size = (desc->zones + 7) / 8;
+  uint8_t *p = bitmap + bitmap_size;
+  uint16_t key = (uint16_t)(bitmap - payload);
+
+  memcpy(payload, desc, sizeof(tofis_frame_desc_t));
+  memset(bitmap, 0, bitmap_size);
+
+  for (uint8_t zone = 0; zone < desc->zones; zone++) {
+    tofis_zone_record_t record;
+    tofis_zone_record_t *prev = &ref[zone];
+    uint8_t changed = 0;
+    uint8_t small = (desc->fields & TOFIS_FIELD_DISTANCE) ? 1 : 0;
+
+    Tofis_Zone_Record(&record, source, zone);
+    key += Tofis_Zone_Size(desc->fields, record.records);
+
+    if (Tofis_Zone_Fields_Changed(&record, prev, desc->fields)) {
+      changed = 1;
+      small = 0;
+    }
+
+    for (uint8_t t = 0; t < record.records && !changed; t++) {
+      if ((desc->fields & TOFIS_FIELD_DISTANCE) &&
+          record.distance[t] != prev->distance[t]) {
+        changed = 1;
+      }
+    }
+
+    for (uint8_t t = 0; t < record.records && small; t++) {
+      int32_t delta = (int32_t)record.distance[t] - prev->distance[t];
+
+      if (delta < -127 || delta > 127) {
+        small = 0;
+      }
+    }
+
+    if (!changed) {
+      continue;
+    }
+
+    bitmap[zone / 8] |= (uint8_t)(1U << (zone % 8));
+
+    if (small) {
+      for (uint8_t t = 0; t < record.records; t++) {
+        *p++ = (uint8_t)(int8_t)(record.distance[t] - prev->distance[t]);
+      }
+    } else {
+      *p++ = TOFIS_DELTA_ESCAPE;
+      p = Tofis_Encode_Zone(p, &record, desc->fields);
+    }
+
+    *prev = record;
+  }
+
+  *key_length = key;
+  return (uint16_t)(p - payload);
+}
+
+HAL_StatusTypeDef
+Tofis_Slave_USART_SendData_Compact(tofis_slave_device_t *device,
+                                   const tofis_frame_source_t *source) {
+  uint8_t dropped;
+  uint8_t *frame = Tofis_Slave_USART_AcquireBuffer(device, &dropped);
+  uint16_t length = Tofis_Encode_Compact(frame + sizeof(tofis_frame_header_t),
+                                         source, NULL);
+
+  HAL_StatusTypeDef status = Tofis_Slave_USART_SubmitFrame(
+      device, frame, TOFIS_ENCODING_COMPACT, length);
+  return (status == HAL_OK && dropped) ? HAL_BUSY : status;
+}
+
+HAL_StatusTypeDef
+Tofis_Slave_USART_SendData_Delta(tofis_slave_device_t *device,
+                                 const tofis_frame_source_t *source) {
+  uint8_t dropped;
+  uint8_t *frame = Tofis_Slave_USART_AcquireBuffer(device, &dropped);
+  tofis_delta_desc_t *delta = (tofis_delta_desc_t *)(frame +
+                                                     sizeof(tofis_frame_header_t));
+  uint8_t *payload = (uint8_t *)delta + sizeof(tofis_delta_desc_t);
+  tofis_delta_state_t *state = &device->delta[device->sensor];
+  tofis_frame_desc_t desc;
+  uint16_t length = 0;
+  uint8_t encoding = TOFIS_ENCODING_DELTA;
+  uint8_t lost;
+
+  Tofis_Encode_Desc(&desc, source);
+
+  // the reference is the last encoded frame of the sensor, a frame that never
+  // reached the host restarts it from a key (LoseFrame)
+  __disable_irq();
+  lost = device->delta_lost & (uint8_t)(1U << device->sensor);
+  device->delta_lost &= (uint8_t)~lost;
+  __enable_irq();
+
+  if (lost != 0 || state->index == 0 ||
+      memcmp(&desc, &state->desc, sizeof(desc)) != 0) {
+    state->index = 0;
+  } else {
+    uint16_t key_length;
+
+    length =
+        Tofis_Encode_Delta(payload, &desc, source, state->ref, &key_length);
+
+    // a delta larger than the keyframe is sent as keyframe instead
+    if (length >= key_length) {
+      state->index = 0;
+    }
+  }
+
+  if (state->index == 0) {
+    state->key_id++;
+    state->desc = desc;
+    encoding = TOFIS_ENCODING_KEYFRAME;
+    length = Tofis_Encode_Compact(payload, source, state->ref);
+  }
+
+  delta->key_id = state->key_id;
+  delta->index = state->index;
+
+  if (++state->index >= VL53L8A1_DELTA_KEYFRAME_INTERVAL) {
+    state->index = 0;
+  }
+
+  HAL_StatusTypeDef status = Tofis_Slave_USART_SubmitFrame(
+      device, frame, encoding, sizeof(tofis_delta_desc_t) + length);
+  return (status == HAL_OK && dropped) ? HAL_BUSY : status;
+}
+
+#ifdef VL53L8A1_UART_USE_DMA
+/**
+ * @brief Tx transfer completed, starts the frame queued in the other half.
+ *
+ * @param huart Pointer to the UART handle.
+ */
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart) {
+  tofis_slave_device_t *device = _tx_device;
+
+  if (device == NULL || huart != device->huart) {
+    return;
+  }
+
+  device->frames_sent++;
+  device->bytes_sent += huart->TxXferSize;
+
+  if (device->pending_length != 0) {
+    uint16_t length = device->pending_length;
+
+    device->pending_length = 0;
+    if (Tofis_Slave_USART_StartWire(device, length) == HAL_OK) {
+      return;
+    }
+    device->frames_dropped++;
+    device->tx_errors++;
+    Tofis_Slave_USART_LoseFrame(
+        device,
+        &device->buffer[device->wire_half * VL53L8A1_PING_PONG_HALF_SIZE]);
+  }
+
+  device->tx_active = 0;
+}
+
+/**
+ * @brief UART error, releases the wire if the transmission was aborted.
+ *
+ * @param huart Pointer to the UART handle.
+ */
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart) {
+  tofis_slave_device_t *device = _tx_device;
+
+  if (device == NULL || huart != device->huart) {
+    return;
+  }
+
+  // only DMA errors end the transmission, receive errors leave it running
+  if (device->tx_active && huart->gState == HAL_UART_STATE_READY) {
+    device->frames_dropped++;
+    device->tx_errors++;
+    device->tx_active = 0;
+    Tofis_Slave_USART_LoseFrame(
+        device,
+        &device->buffer[device->wire_half * VL53L8A1_PING_PONG_HALF_SIZE]);
+  }
+}
+#endif
\ No newline at end of file
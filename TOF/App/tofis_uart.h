@@ -2,18 +2,79 @@
 
 #include "stm32f4xx_hal.h"
 #include "tofis_data.h"
+#include "vl53l8cx.h"
 
 // TODO: change to driver folder?
 #define VL53L8A1_UART_MAX_DELAY (500)
 
+// transmit frames with DMA from the ping-pong buffer, comment out to fall back
+// to blocking HAL_UART_Transmit
+#define VL53L8A1_UART_USE_DMA
+
+#define VL53L8A1_PING_PONG_HALF_SIZE (VL53L8A1_PING_PONG_BUFFER_SIZE / 2)
+
+// frames per keyframe in delta mode (keyframe + N - 1 deltas)
+#define VL53L8A1_DELTA_KEYFRAME_INTERVAL (10)
+
+/**
+ * @brief Delta mode state of one sensor, its frames only reference its own
+ * previous frame.
+ */
+typedef struct {
+  uint8_t key_id;                /**< Id of the last keyframe */
+  uint8_t index;                 /**< Frames since keyframe, 0: send key */
+  tofis_frame_desc_t desc;       /**< Descriptor of the reference */
+  tofis_zone_record_t
+      ref[VL53L8A1_MAX_DATA_SIZE]; /**< Last encoded zones */
+} tofis_delta_state_t;
+
 /**
  * @brief Structure representing the Slave UART device.
+ *
+ * @note The buffer is split into two halves. One half is on the wire while the
+ * next frame is serialized into the other one. If a frame is still waiting for
+ * the wire when a newer one is produced, the older frame is dropped, whatever
+ * sensor it came from.
  */
 typedef struct {
   UART_HandleTypeDef *huart;                      /**< UART handle */
-  uint8_t buffer[VL53L8A1_PING_PONG_BUFFER_SIZE]; /**< UART buffer */
+  uint8_t buffer[VL53L8A1_PING_PONG_BUFFER_SIZE]
+      __attribute__((aligned(4))); /**< UART buffer, CRC needs words */
+  uint8_t wire_half;                /**< Half owned by the DMA (0 or 1) */
+  volatile uint8_t tx_active;       /**< DMA transfer in progress */
+  volatile uint16_t pending_length; /**< Frame queued behind tx, 0 if none */
+  volatile uint32_t frames_sent;    /**< Frames fully transmitted */
+  volatile uint32_t bytes_sent;     /**< Bytes of the frames transmitted */
+  volatile uint32_t frames_dropped; /**< Frames overwritten before tx */
+  volatile uint32_t tx_errors;      /**< Transmissions failed or timed out */
+  volatile uint32_t queued_us;      /**< Time the last frame was queued */
+  uint16_t sequence;                /**< Sequence number of the next frame */
+  uint8_t stream_count;             /**< Sensor streamcount of the next frame */
+  uint8_t sensor;                   /**< Sensor instance of the next frame */
+  uint32_t irq_time_us;             /**< Data ready time of the next frame */
+  uint8_t config_id;                /**< Settings id carried by the frames */
+  volatile uint32_t latency_sum_us; /**< Sum of data ready to tx start */
+  volatile uint32_t latency_max_us; /**< Longest data ready to tx start */
+  volatile uint32_t latency_frames; /**< Frames in latency_sum_us */
+  tofis_delta_state_t
+      delta[RANGING_SENSOR_INSTANCES_NBR]; /**< Delta state per sensor */
+  volatile uint8_t delta_lost; /**< Bit n: a frame of sensor n was lost */
 } tofis_slave_device_t;
 
+/**
+ * @brief Frame handed to the compact encoders.
+ */
+typedef struct {
+  uint8_t resolution;                     /**< Matrix resolution (4 or 8) */
+  uint8_t fields;                         /**< Requested TOFIS_FIELD_* mask */
+  uint8_t targets;                        /**< Targets sent per zone (1 to
+                                               RANGING_SENSOR_NB_TARGET_PER_ZONE) */
+  const RANGING_SENSOR_Result_t *result;  /**< BSP result */
+  const VL53L8CX_ResultsData *raw;        /**< ULD results, NULL if unknown */
+} tofis_frame_source_t;
+
+extern DMA_HandleTypeDef hdma_usart2_tx;
+
 /**
  * @brief Initializes the Slave UART device.
  *
@@ -24,26 +85,158 @@ void Tofis_Slave_USART_Init(tofis_slave_device_t *device,
                             UART_HandleTypeDef *huart);
 
 /**
- * @brief Sends data from the Slave to the Host.
+ * @brief Sets the sensor frame information carried in the header of the
+ * frames sent from now on.
+ *
+ * @param device Pointer to the Slave device structure.
+ * @param sensor Ranging sensor instance (VL53L8A1_DEV_*).
+ * @param stream_count Sensor streamcount (VL53L8CX_Configuration).
+ * @param irq_time_us Data ready interrupt time (Tofis_Time_Us).
+ */
+void Tofis_Slave_USART_SetFrameInfo(tofis_slave_device_t *device,
+                                    uint8_t sensor, uint8_t stream_count,
+                                    uint32_t irq_time_us);
+
+/**
+ * @brief Sends data from the Slave to the Host (TOFIS_ENCODING_RAW_BE, every
+ * field big endian).
  *
  * @param device Pointer to the Slave device structure.
  * @param resolution Matrix resolution (4 or 8).
  * @param result Pointer to the Ranging Sensor Result structure.
- * @return HAL_StatusTypeDef Status of the UART transmission.
+ * @return HAL_StatusTypeDef HAL_OK if the frame is on the wire or queued,
+ * HAL_BUSY if a queued frame had to be dropped for this one.
  */
 HAL_StatusTypeDef Tofis_Slave_USART_SendData(tofis_slave_device_t *device,
                                              uint8_t resolution,
                                              RANGING_SENSOR_Result_t *result);
 
 /**
- * @brief Sends data from the Slave to the Host (Assume little endian in both
- * side).
+ * @brief Sends data from the Slave to the Host (TOFIS_ENCODING_RAW, the result
+ * struct as is, assume little endian in both side).
  *
  * @param device Pointer to the Slave device structure.
  * @param resolution Matrix resolution (4 or 8).
  * @param result Pointer to the Ranging Sensor Result structure.
- * @return HAL_StatusTypeDef Status of the UART transmission.
+ * @return HAL_StatusTypeDef HAL_OK if the frame is on the wire or queued,
+ * HAL_BUSY if a queued frame had to be dropped for this one.
  */
 HAL_StatusTypeDef
 Tofis_Slave_USART_SendData_Le(tofis_slave_device_t *device, uint8_t resolution,
                               RANGING_SENSOR_Result_t *result);
+
+/**
+ * @brief Answers a framed command (TOFIS_ENCODING_ACK). The ack shares the
+ * ping-pong buffer with the ranging frames, the host retransmits a command
+ * whose ack got dropped.
+ *
+ * @param device Pointer to the Slave device structure.
+ * @param id Command id (TOFIS_CMD_*).
+ * @param sequence Command sequence.
+ * @param status Result (TOFIS_CMD_STATUS_*).
+ * @return HAL_StatusTypeDef HAL_OK if the frame is on the wire or queued,
+ * HAL_BUSY if a queued frame had to be dropped for this one.
+ */
+HAL_StatusTypeDef Tofis_Slave_USART_SendAck(tofis_slave_device_t *device,
+                                            uint8_t id, uint8_t sequence,
+                                            uint8_t status);
+
+/**
+ * @brief Announces changed settings (TOFIS_ENCODING_CONFIG), the frames sent
+ * from now on carry config->config_id.
+ *
+ * @param device Pointer to the Slave device structure.
+ * @param config Settings in effect from the next frame on.
+ * @return HAL_StatusTypeDef HAL_OK if the frame is on the wire or queued,
+ * HAL_BUSY if a queued frame had to be dropped for this one.
+ */
+HAL_StatusTypeDef
+Tofis_Slave_USART_SendConfig(tofis_slave_device_t *device,
+                             const tofis_config_desc_t *config);
+
+/**
+ * @brief Sends the health counters and latencies (TOFIS_ENCODING_TELEMETRY).
+ *
+ * @param device Pointer to the Slave device structure.
+ * @param telemetry Counters and latencies of the period.
+ * @return HAL_StatusTypeDef HAL_OK if the frame is on the wire or queued,
+ * HAL_BUSY if a queued frame had to be dropped for this one.
+ */
+HAL_StatusTypeDef
+Tofis_Slave_USART_SendTelemetry(tofis_slave_device_t *device,
+                                const tofis_telemetry_t *telemetry);
+
+/**
+ * @brief Returns the TOFIS_FIELD_* a source can provide. Sigma, reflectance,
+ * spad count and temperature need the ULD results and are dropped when the
+ * driver output is compiled out (VL53L8CX_DISABLE_*).
+ *
+ * @param source Frame to encode.
+ * @return uint8_t Available fields.
+ */
+uint8_t Tofis_Slave_USART_AvailableFields(const tofis_frame_source_t *source);
+
+/**
+ * @brief Sends data from the Slave to the Host using the compact encoding
+ * (only NumberOfZones zones and the selected fields, the frame descriptor
+ * tells the host the layout).
+ *
+ * @param device Pointer to the Slave device structure.
+ * @param source Frame to encode, unavailable fields are masked off.
+ * @return HAL_StatusTypeDef HAL_OK if the frame is on the wire or queued,
+ * HAL_BUSY if a queued frame had to be dropped for this one.
+ */
+HAL_StatusTypeDef
+Tofis_Slave_USART_SendData_Compact(tofis_slave_device_t *device,
+                                   const tofis_frame_source_t *source);
+
+/**
+ * @brief Sends data from the Slave to the Host in delta mode: a compact
+ * keyframe every VL53L8A1_DELTA_KEYFRAME_INTERVAL frames and, in between, only
+ * the zones that changed since the previous frame.
+ *
+ * @param device Pointer to the Slave device structure.
+ * @param source Frame to encode, unavailable fields are masked off.
+ * @return HAL_StatusTypeDef HAL_OK if the frame is on the wire or queued,
+ * HAL_BUSY if a queued frame had to be dropped for this one.
+ */
+HAL_StatusTypeDef
+Tofis_Slave_USART_SendData_Delta(tofis_slave_device_t *device,
+                                 const tofis_frame_source_t *source);
+
+/**
+ * @brief Largest frame of an encoding on the wire, header and padding
+ * included. A delta frame is never larger than its keyframe, the size
+ * returned for TOFIS_ENCODING_DELTA.
+ *
+ * @param encoding TOFIS_ENCODING_RAW, RAW_BE, COMPACT, KEYFRAME or DELTA.
+ * @param resolution Matrix resolution (4 or 8).
+ * @param targets Targets sent per zone.
+ * @param fields TOFIS_FIELD_* of the compact encodings.
+ * @return uint16_t Frame size in bytes, 0 for other encodings.
+ */
+uint16_t Tofis_Slave_USART_FrameSize(uint8_t encoding, uint8_t resolution,
+                                     uint8_t targets, uint8_t fields);
+
+/**
+ * @brief Makes the next delta mode frame of every sensor a keyframe, call it
+ * before switching to delta mode.
+ *
+ * @param device Pointer to the Slave device structure.
+ */
+void Tofis_Slave_USART_ResetDelta(tofis_slave_device_t *device);
+
+/**
+ * @brief Restarts the data ready to transmission start statistics
+ * (latency_*), safe while frames are on the wire.
+ *
+ * @param device Pointer to the Slave device structure.
+ */
+void Tofis_Slave_USART_ResetLatency(tofis_slave_device_t *device);
+
+/**
+ * @brief Returns non-zero while a frame is on the wire or queued.
+ *
+ * @param device Pointer to the Slave device structure.
+ */
+uint8_t Tofis_Slave_USART_IsBusy(tofis_slave_device_t *device);
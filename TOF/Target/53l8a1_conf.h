@@ -20,6 +20,7 @@
 #include "stm32f4xx_hal.h"
 #include "stm32f4xx_nucleo_bus.h"
 #include "stm32f4xx_nucleo_errno.h"
+#include "tofis_calib.h"
 
 /* Define to prevent recursive inclusion -------------------------------------*/
 #ifndef VL53L8A1_CONF_H
@@ -44,8 +45,15 @@ extern "C" {
 #define VL53L8A1_I2C_DEINIT             BSP_I2C1_DeInit
 #define VL53L8A1_I2C_WRITEREG           BSP_I2C1_WriteReg16
 #define VL53L8A1_I2C_READREG            BSP_I2C1_ReadReg16
+/* bulk ranging data read with DMA, comment out to read it in polling mode */
+#define VL53L8A1_I2C_READREG_ASYNC      BSP_I2C1_ReadReg16_DMA
 #define VL53L8A1_GETTICK                BSP_GetTick
 
+/* Optional calibration store, restores the NVM offsets and the Xtalk before
+ * the sensor init and saves them after it */
+#define VL53L8A1_CALIB_LOAD             Tofis_Calib_Load
+#define VL53L8A1_CALIB_SAVE             Tofis_Calib_Save
+
 #ifdef __cplusplus
 }
 #endif
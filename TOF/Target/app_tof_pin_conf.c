@@ -20,23 +20,125 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include "app_tof_pin_conf.h"
+#include "53l8a1_ranging_sensor.h"
+#include "stm32f4xx_nucleo_bus.h"
+#include "tofis_time.h"
 
-extern volatile uint8_t ToF_EventDetected;
+extern volatile uint8_t ToF_EventDetected[RANGING_SENSOR_INSTANCES_NBR];
+extern volatile uint32_t ToF_EventTimeUs[RANGING_SENSOR_INSTANCES_NBR];
+extern volatile uint32_t ToF_EventOverruns[RANGING_SENSOR_INSTANCES_NBR];
+
+/* Satellite LPn outputs (held low, I2C disabled) and data ready inputs, the
+ * center sensor pins are set up by MX_GPIO_Init */
+void ToF_Satellite_Pins_Init(void)
+{
+  GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+  __HAL_RCC_GPIOA_CLK_ENABLE();
+  __HAL_RCC_GPIOB_CLK_ENABLE();
+
+  HAL_GPIO_WritePin(VL53L8A1_LPn_L_PORT, VL53L8A1_LPn_L_PIN, GPIO_PIN_RESET);
+  HAL_GPIO_WritePin(VL53L8A1_LPn_R_PORT, VL53L8A1_LPn_R_PIN, GPIO_PIN_RESET);
+
+  GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_PP;
+  GPIO_InitStruct.Pull = GPIO_NOPULL;
+  GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
+  GPIO_InitStruct.Pin = VL53L8A1_LPn_L_PIN;
+  HAL_GPIO_Init(VL53L8A1_LPn_L_PORT, &GPIO_InitStruct);
+  GPIO_InitStruct.Pin = VL53L8A1_LPn_R_PIN;
+  HAL_GPIO_Init(VL53L8A1_LPn_R_PORT, &GPIO_InitStruct);
+
+  /* an absent satellite leaves its line floating, keep it high */
+  GPIO_InitStruct.Mode = GPIO_MODE_IT_FALLING;
+  GPIO_InitStruct.Pull = GPIO_PULLUP;
+  GPIO_InitStruct.Pin = TOF_INT_L_EXTI_PIN;
+  HAL_GPIO_Init(TOF_INT_L_EXTI_PORT, &GPIO_InitStruct);
+  GPIO_InitStruct.Pin = TOF_INT_R_EXTI_PIN;
+  HAL_GPIO_Init(TOF_INT_R_EXTI_PORT, &GPIO_InitStruct);
+
+  HAL_NVIC_SetPriority(TOF_INT_L_EXTI_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(TOF_INT_L_EXTI_IRQn);
+  HAL_NVIC_SetPriority(TOF_INT_R_EXTI_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(TOF_INT_R_EXTI_IRQn);
+}
+
+/* LPn low disables the I2C interface of a sensor, ranging and its address are
+ * kept */
+void ToF_Set_LPn(uint32_t Instance, GPIO_PinState State)
+{
+  switch (Instance)
+  {
+    case VL53L8A1_DEV_LEFT:
+      HAL_GPIO_WritePin(VL53L8A1_LPn_L_PORT, VL53L8A1_LPn_L_PIN, State);
+      break;
+    case VL53L8A1_DEV_CENTER:
+      HAL_GPIO_WritePin(VL53L8A1_LPn_C_PORT, VL53L8A1_LPn_C_PIN, State);
+      break;
+    case VL53L8A1_DEV_RIGHT:
+      HAL_GPIO_WritePin(VL53L8A1_LPn_R_PORT, VL53L8A1_LPn_R_PIN, State);
+      break;
+    default:
+      break;
+  }
+}
+
+static void ToF_Event(uint32_t Instance)
+{
+  if (Instance < RANGING_SENSOR_INSTANCES_NBR)
+  {
+    /* the frame announced before was not read, the sensor replaced it */
+    if (ToF_EventDetected[Instance] != 0U)
+    {
+      ToF_EventOverruns[Instance]++;
+    }
+    ToF_EventTimeUs[Instance] = Tofis_Time_Us();
+    ToF_EventDetected[Instance] = 1;
+    ToF_EventCallback(Instance);
+  }
+}
+
+/* Called from the data ready interrupt once the flag of the instance is set,
+ * the application may start the read from there */
+__weak void ToF_EventCallback(uint32_t Instance)
+{
+  /* Prevent unused argument(s) compilation warning */
+  UNUSED(Instance);
+}
 
 #ifdef STM32G0xx
 void HAL_GPIO_EXTI_Falling_Callback(uint16_t GPIO_Pin)
 {
-  if (GPIO_Pin == TOF_INT_EXTI_PIN)
+  switch (GPIO_Pin)
   {
-    ToF_EventDetected = 1;
+    case TOF_INT_EXTI_PIN:
+      ToF_Event(VL53L8A1_DEV_CENTER);
+      break;
+    case TOF_INT_L_EXTI_PIN:
+      ToF_Event(VL53L8A1_DEV_LEFT);
+      break;
+    case TOF_INT_R_EXTI_PIN:
+      ToF_Event(VL53L8A1_DEV_RIGHT);
+      break;
+    default:
+      break;
   }
 }
 #else
 void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
 {
-  if (GPIO_Pin == TOF_INT_EXTI_PIN)
+  switch (GPIO_Pin)
   {
-    ToF_EventDetected = 1;
+    case TOF_INT_EXTI_PIN:
+      ToF_Event(VL53L8A1_DEV_CENTER);
+      break;
+    case TOF_INT_L_EXTI_PIN:
+      ToF_Event(VL53L8A1_DEV_LEFT);
+      break;
+    case TOF_INT_R_EXTI_PIN:
+      ToF_Event(VL53L8A1_DEV_RIGHT);
+      break;
+    default:
+      break;
   }
 }
 #endif
@@ -37,6 +37,28 @@ extern "C" {
 #define VL53L8A1_LPn_C_PIN   (GPIO_PIN_0)
 #define VL53L8A1_LPn_C_PORT  (GPIOB)
 
+/* Satellite lines on the Arduino connector, follow the solder bridges fitted
+ * on the expansion board. The INT pin numbers must differ from TOF_INT_EXTI_PIN
+ * (one EXTI line per pin number). */
+#define TOF_INT_L_EXTI_PIN   (GPIO_PIN_1)
+#define TOF_INT_L_EXTI_PORT  (GPIOA)
+#define TOF_INT_L_EXTI_IRQn  (EXTI1_IRQn)
+
+#define TOF_INT_R_EXTI_PIN   (GPIO_PIN_0)
+#define TOF_INT_R_EXTI_PORT  (GPIOA)
+#define TOF_INT_R_EXTI_IRQn  (EXTI0_IRQn)
+
+#define VL53L8A1_LPn_L_PIN   (GPIO_PIN_8)
+#define VL53L8A1_LPn_L_PORT  (GPIOA)
+
+#define VL53L8A1_LPn_R_PIN   (GPIO_PIN_10)
+#define VL53L8A1_LPn_R_PORT  (GPIOB)
+
+/* Exported functions --------------------------------------------------------*/
+void ToF_Satellite_Pins_Init(void);
+void ToF_Set_LPn(uint32_t Instance, GPIO_PinState State);
+void ToF_EventCallback(uint32_t Instance);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,308 @@
+// bench_decode_result.c
+// 比對 vl53l8cx.c 的單次解碼 (VL53L8CX_GetDistanceComplete) 與原本的路徑：
+// ULD 的 vl53l8cx_parse_ranging_data (整個 buffer swap、逐 block memcpy、
+// 縮放) 後再由 BSP 原本的 fill 複製到結果。以合成的 sensor 串流確認兩者的
+// 結果相同，並量測兩者的時間。
+// 沒有錄製的 I2C 資料，frame 依 block header 的格式以亂數產生
+#include "vl53l8cx.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define FRAMES 200     // 每種輸出組合比對的亂數 frame 數
+#define FRAME_SIZE 8192 // 8x8、4 個 target、全部輸出時約 5.3 KB
+
+// 輸出的 block，依 sensor 送出的順序
+typedef struct {
+  uint32_t header;    // 單一 target 的 block header
+  uint32_t mt_header; // 多個 target 時的 block header
+  uint8_t per_zone;   // 每個 zone 一個值 (否則每個 target 一個)
+  uint32_t output;    // VL53L8CX_OUTPUT_*
+} block_t;
+
+static const block_t blocks[] = {
+    {VL53L8CX_AMBIENT_RATE_BH, VL53L8CX_AMBIENT_RATE_BH, 1,
+     VL53L8CX_OUTPUT_AMBIENT_PER_SPAD},
+    {VL53L8CX_SPAD_COUNT_BH, VL53L8CX_SPAD_COUNT_BH, 1,
+     VL53L8CX_OUTPUT_NB_SPADS_ENABLED},
+    {VL53L8CX_NB_TARGET_DETECTED_BH, VL53L8CX_MT_NB_TARGET_DETECTED_BH, 1,
+     VL53L8CX_OUTPUT_NB_TARGET_DETECTED},
+    {VL53L8CX_SIGNAL_RATE_BH, VL53L8CX_MT_SIGNAL_RATE_BH, 0,
+     VL53L8CX_OUTPUT_SIGNAL_PER_SPAD},
+    {VL53L8CX_RANGE_SIGMA_MM_BH, VL53L8CX_MT_RANGE_SIGMA_MM_BH, 0,
+     VL53L8CX_OUTPUT_RANGE_SIGMA_MM},
+    {VL53L8CX_DISTANCE_BH, VL53L8CX_MT_DISTANCE_BH, 0,
+     VL53L8CX_OUTPUT_DISTANCE_MM},
+    {VL53L8CX_REFLECTANCE_BH, VL53L8CX_MT_REFLECTANCE_BH, 0,
+     VL53L8CX_OUTPUT_REFLECTANCE_PERCENT},
+    {VL53L8CX_TARGET_STATUS_BH, VL53L8CX_MT_TARGET_STATUS_BH, 0,
+     VL53L8CX_OUTPUT_TARGET_STATUS},
+    {VL53L8CX_MOTION_DETECT_BH, VL53L8CX_MT_MOTION_DETECT_BH, 0,
+     VL53L8CX_OUTPUT_MOTION_INDICATOR},
+};
+
+// target 數一定會讀，其他輸出依組合
+#define ALL_OUTPUTS 0xFFFU
+#define DISTANCE_STATUS                                                        \
+  (VL53L8CX_OUTPUT_DISTANCE_MM | VL53L8CX_OUTPUT_TARGET_STATUS)
+
+static const struct {
+  const char *name;
+  uint32_t outputs;
+} cases[] = {
+    {"all outputs", ALL_OUTPUTS},
+    {"distance+status", DISTANCE_STATUS},
+    {"ambient", VL53L8CX_OUTPUT_AMBIENT_PER_SPAD},
+    {"spads", VL53L8CX_OUTPUT_NB_SPADS_ENABLED},
+    {"signal", VL53L8CX_OUTPUT_SIGNAL_PER_SPAD},
+    {"sigma", VL53L8CX_OUTPUT_RANGE_SIGMA_MM},
+    {"reflectance", VL53L8CX_OUTPUT_REFLECTANCE_PERCENT},
+    {"motion", VL53L8CX_OUTPUT_MOTION_INDICATOR},
+};
+
+static VL53L8CX_Object_t obj;
+static VL53L8CX_Result_t ref, out;
+static VL53L8CX_ResultsData ref_data;
+static uint8_t frame[FRAME_SIZE];
+static uint32_t frame_size;
+static uint32_t rng_state = 2463534242U;
+
+// xorshift32，各平台結果相同
+static uint32_t rng_next(void) {
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return rng_state;
+}
+
+// sensor 以 32-bit big endian word 送出
+static void put_word(uint32_t pos, uint32_t word) {
+  frame[pos] = (uint8_t)(word >> 24);
+  frame[pos + 1] = (uint8_t)(word >> 16);
+  frame[pos + 2] = (uint8_t)(word >> 8);
+  frame[pos + 3] = (uint8_t)word;
+}
+
+// 產生 zones 個 zone、nt 個 target 的 frame：16 bytes 的 header、metadata、
+// common data、選定的輸出 block 及 footer。header 與 footer 的 id 相同
+static void make_frame(uint32_t zones, uint32_t nt, uint32_t outputs) {
+  union Block_header bh;
+  uint32_t pos = 16;
+
+  for (uint32_t i = 0; i < 16; i++) {
+    frame[i] = (uint8_t)rng_next();
+  }
+  put_word(8, 0x1234U);
+
+  const uint32_t fixed[] = {VL53L8CX_METADATA_BH, VL53L8CX_COMMONDATA_BH};
+  for (uint32_t b = 0; b < 2; b++) {
+    bh.bytes = fixed[b];
+    put_word(pos, bh.bytes);
+    for (uint32_t k = 0; k < bh.size; k++) {
+      frame[pos + 4 + k] = (uint8_t)rng_next();
+    }
+    pos += 4 + bh.size;
+  }
+
+  outputs |= VL53L8CX_OUTPUT_NB_TARGET_DETECTED;
+  for (size_t b = 0; b < sizeof(blocks) / sizeof(blocks[0]); b++) {
+    if ((outputs & blocks[b].output) == 0U) {
+      continue;
+    }
+    bh.bytes = (nt > 1U) ? blocks[b].mt_header : blocks[b].header;
+    if (blocks[b].output != VL53L8CX_OUTPUT_MOTION_INDICATOR) {
+      bh.size = blocks[b].per_zone ? zones : zones * nt;
+    }
+    put_word(pos, bh.bytes);
+    pos += 4;
+
+    uint32_t msize = ((bh.type > 1U) && (bh.type < 0xDU)) ? bh.type * bh.size
+                                                          : bh.size;
+    for (uint32_t k = 0; k < msize; k++) {
+      frame[pos + k] = (uint8_t)rng_next();
+    }
+    // target 數為 0 至 nt，其他為亂數
+    if (blocks[b].output == VL53L8CX_OUTPUT_NB_TARGET_DETECTED) {
+      for (uint32_t k = 0; k < msize; k++) {
+        frame[pos + k] = (uint8_t)(rng_next() % (nt + 1U));
+      }
+    }
+    pos += msize;
+  }
+
+  memset(&frame[pos], 0, 12);
+  put_word(pos + 8, 0x1234U);
+  frame_size = pos + 12;
+}
+
+// BSP 原本的 vl53l8cx_fill_result，per target 的陣列以執行時的 target 數排列
+static void old_fill(VL53L8CX_Object_t *pObj, uint32_t zones,
+                     VL53L8CX_Result_t *pResult) {
+  VL53L8CX_ResultsData *data = &pObj->Results;
+  uint32_t nt = pObj->Dev.nb_target_per_zone;
+  uint8_t status;
+
+  pResult->NumberOfZones = zones;
+  for (uint32_t i = 0; i < zones; i++) {
+    pResult->ZoneResult[i].NumberOfTargets = data->nb_target_detected[i];
+    for (uint32_t j = 0; j < data->nb_target_detected[i]; j++) {
+      pResult->ZoneResult[i].Distance[j] =
+          (uint32_t)data->distance_mm[(nt * i) + j];
+      pResult->ZoneResult[i].Ambient[j] =
+          (pObj->IsAmbientEnabled == 1U) ? (float)data->ambient_per_spad[i]
+                                         : 0.0f;
+      pResult->ZoneResult[i].Signal[j] =
+          (pObj->IsSignalEnabled == 1U)
+              ? (float)data->signal_per_spad[(nt * i) + j]
+              : 0.0f;
+      status = data->target_status[(nt * i) + j];
+      pResult->ZoneResult[i].Status[j] =
+          ((status == 5U) || (status == 9U)) ? 0U
+          : (status == 0U)                   ? 255U
+                                             : status;
+    }
+  }
+}
+
+static void run_old(uint32_t zones) {
+  memcpy(obj.Dev.temp_buffer, frame, frame_size);
+  vl53l8cx_parse_ranging_data(&obj.Dev, &obj.Results);
+  old_fill(&obj, zones, &ref);
+}
+
+static int32_t run_new(void) {
+  memcpy(obj.Dev.temp_buffer, frame, frame_size);
+  return VL53L8CX_GetDistanceComplete(&obj, &out);
+}
+
+// 回傳不一致的項目數。比對 frame 中有的輸出：target 數、有 target 的
+// distance、status、ambient 與 signal，以及 ULD 結果中 BSP 沒有欄位的輸出
+static int compare(uint32_t zones, uint32_t nt, uint32_t outputs) {
+  int bad = 0;
+
+  for (uint32_t z = 0; z < zones; z++) {
+    const VL53L8CX_ZoneResult_t *a = &ref.ZoneResult[z];
+    const VL53L8CX_ZoneResult_t *b = &out.ZoneResult[z];
+
+    bad += (a->NumberOfTargets != b->NumberOfTargets);
+    for (uint32_t t = 0; t < a->NumberOfTargets; t++) {
+      if (outputs & VL53L8CX_OUTPUT_DISTANCE_MM) {
+        bad += (a->Distance[t] != b->Distance[t]);
+      }
+      if (outputs & VL53L8CX_OUTPUT_TARGET_STATUS) {
+        bad += (a->Status[t] != b->Status[t]);
+      }
+      if (outputs & VL53L8CX_OUTPUT_AMBIENT_PER_SPAD) {
+        bad += (a->Ambient[t] != b->Ambient[t]);
+      }
+      if (outputs & VL53L8CX_OUTPUT_SIGNAL_PER_SPAD) {
+        bad += (a->Signal[t] != b->Signal[t]);
+      }
+    }
+  }
+  bad += (out.NumberOfZones != zones);
+  bad += (ref_data.silicon_temp_degc != obj.Results.silicon_temp_degc);
+  if (outputs & VL53L8CX_OUTPUT_NB_SPADS_ENABLED) {
+    bad += memcmp(ref_data.nb_spads_enabled, obj.Results.nb_spads_enabled,
+                  zones * 4U) != 0;
+  }
+  if (outputs & VL53L8CX_OUTPUT_RANGE_SIGMA_MM) {
+    bad += memcmp(ref_data.range_sigma_mm, obj.Results.range_sigma_mm,
+                  zones * nt * 2U) != 0;
+  }
+  if (outputs & VL53L8CX_OUTPUT_REFLECTANCE_PERCENT) {
+    bad += memcmp(ref_data.reflectance, obj.Results.reflectance,
+                  zones * nt) != 0;
+  }
+  if (outputs & VL53L8CX_OUTPUT_MOTION_INDICATOR) {
+    bad += memcmp(&ref_data.motion_indicator, &obj.Results.motion_indicator,
+                  sizeof(ref_data.motion_indicator)) != 0;
+  }
+  return bad;
+}
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// 1000 次解碼取平均，重複 200 次取最小值，扣除複製 frame 的時間
+static double time_ns(int old_path, uint32_t zones) {
+  double best = 1e18;
+  double copy = 1e18;
+
+  for (int r = 0; r < 200; r++) {
+    double start = now_ns();
+    for (int n = 0; n < 1000; n++) {
+      if (old_path) {
+        run_old(zones);
+      } else {
+        (void)run_new();
+      }
+      __asm__ volatile("" ::: "memory");
+    }
+    double elapsed = (now_ns() - start) / 1000;
+    best = (elapsed < best) ? elapsed : best;
+
+    start = now_ns();
+    for (int n = 0; n < 1000; n++) {
+      memcpy(obj.Dev.temp_buffer, frame, frame_size);
+      __asm__ volatile("" ::: "memory");
+    }
+    elapsed = (now_ns() - start) / 1000;
+    copy = (elapsed < copy) ? elapsed : copy;
+  }
+  return best - copy;
+}
+
+int main(void) {
+  int mismatches = 0;
+
+  obj.IsAmbientEnabled = 1;
+  obj.IsSignalEnabled = 1;
+
+  printf("%-16s %5s %7s %10s\n", "outputs", "zones", "targets", "mismatches");
+  for (uint32_t nt = 1; nt <= VL53L8CX_NB_TARGET_PER_ZONE; nt++) {
+    obj.Dev.nb_target_per_zone = (uint8_t)nt;
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+      for (uint32_t zones = 16; zones <= 64; zones *= 4) {
+        int bad = 0;
+
+        for (int f = 0; f < FRAMES; f++) {
+          make_frame(zones, nt, cases[c].outputs);
+          obj.Dev.data_read_size = frame_size;
+          memset(&ref, 0xAA, sizeof(ref));
+          memset(&out, 0xAA, sizeof(out));
+          run_old(zones);
+          ref_data = obj.Results;
+          bad += (run_new() != VL53L8CX_OK);
+          bad += compare(zones, nt, cases[c].outputs);
+        }
+        printf("%-16s %5u %7u %10d\n", cases[c].name, (unsigned)zones,
+               (unsigned)nt, bad);
+        mismatches += bad;
+      }
+    }
+  }
+
+  // 速度只量測 1 個 target，與韌體預設的建置相同
+  obj.Dev.nb_target_per_zone = 1;
+  printf("\n%-16s %5s %6s %9s %9s %7s\n", "outputs", "zones", "bytes",
+         "ULD+fill", "decode", "speedup");
+  for (size_t c = 0; c < 2; c++) {
+    for (uint32_t zones = 16; zones <= 64; zones *= 4) {
+      make_frame(zones, 1, cases[c].outputs);
+      obj.Dev.data_read_size = frame_size;
+      double before = time_ns(1, zones);
+      double after = time_ns(0, zones);
+      printf("%-16s %5u %6u %6.0f ns %6.0f ns %6.2fx\n", cases[c].name,
+             (unsigned)zones, (unsigned)frame_size, before, after,
+             before / after);
+    }
+  }
+
+  printf("%s\n", mismatches ? "FAILED" : "PASSED");
+  return mismatches ? 1 : 0;
+}
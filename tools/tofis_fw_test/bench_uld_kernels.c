@@ -0,0 +1,231 @@
+// bench_uld_kernels.c
+// 比對 platform.c 的 VL53L8CX_SwapBuffer、VL53L8CX_Decimate4x4_* 與 ST ULD
+// 原本的迴圈 (逐 byte swap、整個 buffer swap 後平均再 swap 回去)，
+// 以亂數 buffer 確認結果相同，並量測兩者的時間。
+// x86 使用可攜的 C kernel；以 ARM 編譯器 (定義 __ARM_FEATURE_DSP) 編譯時
+// 驗證的是 REV / SMUAD 版本
+#include "platform.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define BUFFERS 2000 // 比對的亂數 buffer 數
+#define SWAP_SIZE 1444 // 8x8 全部輸出時的 ranging data
+#define OFFSET_SIZE 488 // VL53L8CX_OFFSET_BUFFER_SIZE
+#define XTALK_SIZE 776  // VL53L8CX_XTALK_BUFFER_SIZE
+
+static const uint8_t dss_4x4[] = {0x0F, 0x04, 0x04, 0x00,
+                                  0x08, 0x10, 0x10, 0x07};
+static uint32_t rng_state = 2463534242U;
+
+// xorshift32，各平台結果相同
+static uint32_t rng_next(void) {
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return rng_state;
+}
+
+/* ST ULD 原本的實作 */
+static void ref_swap(uint8_t *buffer, uint16_t size) {
+  uint32_t i, tmp;
+
+  for (i = 0; i < size; i = i + 4) {
+    tmp = (buffer[i] << 24) | (buffer[i + 1] << 16) | (buffer[i + 2] << 8) |
+          (buffer[i + 3]);
+    memcpy(&(buffer[i]), &tmp, 4);
+  }
+}
+
+static void ref_decimate_u32(uint32_t *signal_grid) {
+  for (int8_t j = 0; j < 4; j++) {
+    for (int8_t i = 0; i < 4; i++) {
+      signal_grid[i + (4 * j)] =
+          (signal_grid[(2 * i) + (16 * j) + 0] +
+           signal_grid[(2 * i) + (16 * j) + 1] +
+           signal_grid[(2 * i) + (16 * j) + 8] +
+           signal_grid[(2 * i) + (16 * j) + 9]) /
+          (uint32_t)4;
+    }
+  }
+  memset(&signal_grid[0x10], 0, 192);
+}
+
+static void ref_decimate_i16(int16_t *range_grid) {
+  for (int8_t j = 0; j < 4; j++) {
+    for (int8_t i = 0; i < 4; i++) {
+      range_grid[i + (4 * j)] =
+          (range_grid[(2 * i) + (16 * j)] + range_grid[(2 * i) + (16 * j) + 1] +
+           range_grid[(2 * i) + (16 * j) + 8] +
+           range_grid[(2 * i) + (16 * j) + 9]) /
+          (int16_t)4;
+    }
+  }
+  memset(&range_grid[0x10], 0, 96);
+}
+
+// _vl53l8cx_send_offset_data 的 4x4 轉換，footer 之前的部分
+static void ref_offset(uint8_t *buffer, const uint8_t *data) {
+  uint32_t signal_grid[64];
+  int16_t range_grid[64];
+
+  memcpy(buffer, data, OFFSET_SIZE);
+  memcpy(&buffer[0x10], dss_4x4, sizeof(dss_4x4));
+  ref_swap(buffer, OFFSET_SIZE);
+  memcpy(signal_grid, &buffer[0x3C], sizeof(signal_grid));
+  memcpy(range_grid, &buffer[0x140], sizeof(range_grid));
+  ref_decimate_u32(signal_grid);
+  ref_decimate_i16(range_grid);
+  memcpy(&buffer[0x3C], signal_grid, sizeof(signal_grid));
+  memcpy(&buffer[0x140], range_grid, sizeof(range_grid));
+  ref_swap(buffer, OFFSET_SIZE);
+  for (uint16_t k = 0; k < (OFFSET_SIZE - 4); k++) {
+    buffer[k] = buffer[k + 8];
+  }
+}
+
+static void new_offset(uint8_t *buffer, const uint8_t *data) {
+  memcpy(buffer, data, OFFSET_SIZE);
+  memcpy(&buffer[0x10], dss_4x4, sizeof(dss_4x4));
+  VL53L8CX_Decimate4x4_u32(&buffer[0x3C]);
+  VL53L8CX_Decimate4x4_i16(&buffer[0x140]);
+  memmove(buffer, &buffer[8], OFFSET_SIZE - 8);
+}
+
+// _vl53l8cx_send_xtalk_data 的 4x4 signal grid
+static void ref_xtalk(uint8_t *buffer, const uint8_t *data) {
+  uint32_t signal_grid[64];
+
+  memcpy(buffer, data, XTALK_SIZE);
+  ref_swap(buffer, XTALK_SIZE);
+  memcpy(signal_grid, &buffer[0x34], sizeof(signal_grid));
+  ref_decimate_u32(signal_grid);
+  memcpy(&buffer[0x34], signal_grid, sizeof(signal_grid));
+  ref_swap(buffer, XTALK_SIZE);
+}
+
+static void new_xtalk(uint8_t *buffer, const uint8_t *data) {
+  memcpy(buffer, data, XTALK_SIZE);
+  VL53L8CX_Decimate4x4_u32(&buffer[0x34]);
+}
+
+static uint8_t data[2048] __attribute__((aligned(4)));
+static uint8_t ref[2048] __attribute__((aligned(4)));
+static uint8_t out[2048] __attribute__((aligned(4)));
+
+static void fill_random(void) {
+  for (size_t i = 0; i < sizeof(data); i++) {
+    data[i] = (uint8_t)rng_next();
+  }
+  // 兩份都在 buffer 尾端之後讀到同樣的資料 (原本的位移迴圈多讀 4 bytes)
+  memset(ref, 0x5A, sizeof(ref));
+  memset(out, 0x5A, sizeof(out));
+}
+
+// 回傳不一致的 buffer 數
+static int check(const char *name, void (*reference)(void), void (*kernel)(void),
+                 size_t compare) {
+  int mismatches = 0;
+
+  for (int n = 0; n < BUFFERS; n++) {
+    fill_random();
+    reference();
+    kernel();
+    mismatches += (memcmp(ref, out, compare) != 0);
+  }
+  printf("  %-16s %4d / %d mismatches\n", name, mismatches, BUFFERS);
+  return mismatches;
+}
+
+static void ref_swap_case(void) {
+  memcpy(ref, data, SWAP_SIZE);
+  ref_swap(ref, SWAP_SIZE);
+}
+static void new_swap_case(void) {
+  memcpy(out, data, SWAP_SIZE);
+  VL53L8CX_SwapBuffer(out, SWAP_SIZE);
+}
+// kernel 直接處理 sensor 的 byte order，原本的迴圈處理 swap 後的 grid
+static void ref_u32_case(void) {
+  memcpy(ref, data, 256);
+  ref_swap(ref, 256);
+  ref_decimate_u32((uint32_t *)ref);
+  ref_swap(ref, 256);
+}
+static void new_u32_case(void) {
+  memcpy(out, data, 256);
+  VL53L8CX_Decimate4x4_u32(out);
+}
+static void ref_i16_case(void) {
+  memcpy(ref, data, 128);
+  ref_swap(ref, 128);
+  ref_decimate_i16((int16_t *)ref);
+  ref_swap(ref, 128);
+}
+static void new_i16_case(void) {
+  memcpy(out, data, 128);
+  VL53L8CX_Decimate4x4_i16(out);
+}
+static void ref_offset_case(void) { ref_offset(ref, data); }
+static void new_offset_case(void) { new_offset(out, data); }
+static void ref_xtalk_case(void) { ref_xtalk(ref, data); }
+static void new_xtalk_case(void) { new_xtalk(out, data); }
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// 1000 次呼叫取平均，重複 200 次取最小值
+static double time_ns(void (*run)(void)) {
+  double best = 1e18;
+
+  for (int r = 0; r < 200; r++) {
+    double start = now_ns();
+    for (int n = 0; n < 1000; n++) {
+      run();
+      __asm__ volatile("" ::: "memory");
+    }
+    double elapsed = (now_ns() - start) / 1000;
+    best = (elapsed < best) ? elapsed : best;
+  }
+  return best;
+}
+
+static void bench(const char *name, void (*reference)(void),
+                  void (*kernel)(void)) {
+  double before = time_ns(reference);
+  double after = time_ns(kernel);
+
+  printf("  %-16s %8.0f ns %8.0f ns %6.2fx\n", name, before, after,
+         before / after);
+}
+
+int main(void) {
+  int mismatches = 0;
+
+#if defined(__ARM_FEATURE_DSP) && !defined(VL53L8CX_PORTABLE_KERNELS)
+  printf("REV / SMUAD kernels\n");
+#else
+  printf("Portable C kernels\n");
+#endif
+
+  mismatches += check("swap 1444 B", ref_swap_case, new_swap_case, SWAP_SIZE);
+  mismatches += check("decimate u32", ref_u32_case, new_u32_case, 256);
+  mismatches += check("decimate i16", ref_i16_case, new_i16_case, 128);
+  // 之後 footer 覆蓋 0x1E0 起的 8 bytes
+  mismatches += check("offset 4x4", ref_offset_case, new_offset_case, 0x1E0);
+  mismatches += check("xtalk 4x4", ref_xtalk_case, new_xtalk_case, XTALK_SIZE);
+
+  fill_random();
+  printf("  %-16s %11s %11s %7s\n", "", "ST loop", "kernel", "speedup");
+  bench("swap 1444 B", ref_swap_case, new_swap_case);
+  bench("decimate u32", ref_u32_case, new_u32_case);
+  bench("decimate i16", ref_i16_case, new_i16_case);
+  bench("offset 4x4", ref_offset_case, new_offset_case);
+  bench("xtalk 4x4", ref_xtalk_case, new_xtalk_case);
+
+  printf("%s\n", mismatches ? "FAILED" : "PASSED");
+  return mismatches ? 1 : 0;
+}
@@ -0,0 +1,86 @@
+// cmsis_host.h
+// 以 -include 放在最前面，取代 cmsis_gcc.h：Cortex-M 的指令 (cpsid、wfi、
+// ldrex ...) 無法在 host 上組譯，改為單執行緒下等效的 C
+#pragma once
+
+#include <stdint.h>
+
+#define __CMSIS_GCC_H
+
+#define __ASM __asm
+#define __INLINE inline
+#define __STATIC_INLINE static inline
+#define __STATIC_FORCEINLINE static inline
+#define __NO_RETURN __attribute__((__noreturn__))
+#define __USED __attribute__((used))
+#define __WEAK __attribute__((weak))
+#define __PACKED __attribute__((packed, aligned(1)))
+#define __PACKED_STRUCT struct __attribute__((packed, aligned(1)))
+#define __PACKED_UNION union __attribute__((packed, aligned(1)))
+#define __ALIGNED(x) __attribute__((aligned(x)))
+#define __RESTRICT __restrict
+#define __COMPILER_BARRIER() __asm volatile("" ::: "memory")
+
+// 中斷遮罩只記錄狀態，mock 的中斷由測試程式在主執行緒呼叫
+extern uint32_t host_primask;
+
+__STATIC_FORCEINLINE void __enable_irq(void) { host_primask = 0; }
+__STATIC_FORCEINLINE void __disable_irq(void) { host_primask = 1; }
+__STATIC_FORCEINLINE uint32_t __get_PRIMASK(void) { return host_primask; }
+__STATIC_FORCEINLINE void __set_PRIMASK(uint32_t primask) {
+    host_primask = primask;
+}
+__STATIC_FORCEINLINE uint32_t __get_IPSR(void) { return 0; }
+__STATIC_FORCEINLINE uint32_t __get_CONTROL(void) { return 0; }
+__STATIC_FORCEINLINE void __set_CONTROL(uint32_t control) { (void)control; }
+__STATIC_FORCEINLINE uint32_t __get_BASEPRI(void) { return 0; }
+__STATIC_FORCEINLINE void __set_BASEPRI(uint32_t basepri) { (void)basepri; }
+__STATIC_FORCEINLINE uint32_t __get_FPSCR(void) { return 0; }
+__STATIC_FORCEINLINE void __set_FPSCR(uint32_t fpscr) { (void)fpscr; }
+
+#define __NOP() __COMPILER_BARRIER()
+#define __WFI() __COMPILER_BARRIER()
+#define __WFE() __COMPILER_BARRIER()
+#define __SEV() __COMPILER_BARRIER()
+#define __ISB() __sync_synchronize()
+#define __DSB() __sync_synchronize()
+#define __DMB() __sync_synchronize()
+
+__STATIC_FORCEINLINE uint32_t __REV(uint32_t value) {
+    return __builtin_bswap32(value);
+}
+__STATIC_FORCEINLINE uint32_t __REV16(uint32_t value) {
+    return ((value & 0xFF00FF00U) >> 8) | ((value & 0x00FF00FFU) << 8);
+}
+__STATIC_FORCEINLINE int16_t __REVSH(int16_t value) {
+    return (int16_t)__builtin_bswap16((uint16_t)value);
+}
+__STATIC_FORCEINLINE uint32_t __ROR(uint32_t op1, uint32_t op2) {
+    op2 %= 32U;
+    return (op2 == 0U) ? op1 : (op1 >> op2) | (op1 << (32U - op2));
+}
+__STATIC_FORCEINLINE uint32_t __RBIT(uint32_t value) {
+    uint32_t result = 0;
+    for (int i = 0; i < 32; i++) {
+        result = (result << 1) | ((value >> i) & 1U);
+    }
+    return result;
+}
+#define __CLZ(value) (((value) == 0U) ? 32U : (uint8_t)__builtin_clz(value))
+
+// 單執行緒下 exclusive 存取必定成功
+__STATIC_FORCEINLINE uint32_t __LDREXW(volatile uint32_t *addr) {
+    return *addr;
+}
+__STATIC_FORCEINLINE uint32_t __STREXW(uint32_t value, volatile uint32_t *addr) {
+    *addr = value;
+    return 0;
+}
+__STATIC_FORCEINLINE uint16_t __LDREXH(volatile uint16_t *addr) {
+    return *addr;
+}
+__STATIC_FORCEINLINE uint32_t __STREXH(uint16_t value, volatile uint16_t *addr) {
+    *addr = value;
+    return 0;
+}
+__STATIC_FORCEINLINE void __CLREX(void) {}
@@ -0,0 +1,154 @@
+// mock_hal.c
+// tofis_uart.c 與 tofis_cmd.c 在 host 上所需的 HAL、CRC 與時間函數
+#include "mock_hal.h"
+#include "check_sum.h"
+#include "tofis_time.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+// 韌體直接寫入的周邊 (例如 __HAL_RCC_DMA1_CLK_ENABLE) 從 PERIPH_BASE 起算
+#define MOCK_PERIPH_SIZE 0x00080000UL
+
+uint32_t host_primask;
+mock_uart_t mock_uart;
+
+static uint32_t time_us;
+static uint32_t crc;
+
+void mock_hal_init(void) {
+  static int mapped;
+
+  if (!mapped) {
+    void *base = mmap((void *)PERIPH_BASE, MOCK_PERIPH_SIZE,
+                      PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+    if (base != (void *)PERIPH_BASE) {
+      perror("mmap peripherals");
+      exit(2);
+    }
+    mapped = 1;
+  }
+  memset(&mock_uart, 0, sizeof(mock_uart));
+  host_primask = 0;
+  time_us = 0;
+}
+
+int mock_uart_complete(UART_HandleTypeDef *huart) {
+  if (mock_uart.tx_data == NULL) {
+    return 0;
+  }
+  mock_uart.tx_data = NULL;
+  huart->gState = HAL_UART_STATE_READY;
+  // 與中斷相同，在主程式的兩個敘述之間執行
+  HAL_UART_TxCpltCallback(huart);
+  return 1;
+}
+
+void mock_uart_abort(UART_HandleTypeDef *huart) {
+  mock_uart.tx_data = NULL;
+  huart->gState = HAL_UART_STATE_READY;
+  huart->ErrorCode = HAL_UART_ERROR_DMA;
+  HAL_UART_ErrorCallback(huart);
+}
+
+void mock_uart_receive(UART_HandleTypeDef *huart, const uint8_t *data,
+                       uint16_t length) {
+  DMA_Stream_TypeDef *stream = huart->hdmarx->Instance;
+
+  for (uint16_t i = 0; i < length; i++) {
+    huart->pRxBuffPtr[huart->RxXferSize - stream->NDTR] = data[i];
+    if (--stream->NDTR == 0U) {
+      stream->NDTR = huart->RxXferSize;
+    }
+  }
+}
+
+void mock_time_advance(uint32_t us) { time_us += us; }
+
+/* HAL */
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart,
+                                        const uint8_t *data, uint16_t size) {
+  if (huart->gState != HAL_UART_STATE_READY) {
+    return HAL_BUSY;
+  }
+  if (mock_uart.fail_next != HAL_OK) {
+    HAL_StatusTypeDef status = mock_uart.fail_next;
+
+    mock_uart.fail_next = HAL_OK;
+    return status;
+  }
+  huart->gState = HAL_UART_STATE_BUSY_TX;
+  huart->TxXferSize = size;
+  mock_uart.tx_data = data;
+  mock_uart.tx_length = size;
+  mock_uart.dma_starts++;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef *huart,
+                                    const uint8_t *data, uint16_t size,
+                                    uint32_t timeout) {
+  (void)huart;
+  (void)data;
+  (void)size;
+  (void)timeout;
+  mock_uart.blocking_calls++;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_DMA(UART_HandleTypeDef *huart,
+                                               uint8_t *data, uint16_t size) {
+  huart->RxState = HAL_UART_STATE_BUSY_RX;
+  huart->pRxBuffPtr = data;
+  huart->RxXferSize = size;
+  huart->hdmarx->Instance->NDTR = size;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DMA_Init(DMA_HandleTypeDef *hdma) {
+  (void)hdma;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DMA_DeInit(DMA_HandleTypeDef *hdma) {
+  (void)hdma;
+  return HAL_OK;
+}
+
+void HAL_NVIC_SetPriority(IRQn_Type irq, uint32_t preempt, uint32_t sub) {
+  (void)irq;
+  (void)preempt;
+  (void)sub;
+}
+
+void HAL_NVIC_EnableIRQ(IRQn_Type irq) { (void)irq; }
+
+uint32_t HAL_GetTick(void) {
+  mock_uart.tick_reads++;
+  return time_us / 1000U;
+}
+
+/* CRC-32/MPEG-2，與 CRC 周邊相同 */
+void crc32_init(void) {}
+
+uint32_t accumulate_crc32(const uint8_t *buffer, int length) {
+  for (int i = 0; i < length; i++) {
+    crc ^= (uint32_t)buffer[i] << 24;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x80000000U) ? (crc << 1) ^ 0x04C11DB7U : crc << 1;
+    }
+  }
+  return crc;
+}
+
+uint32_t calculate_crc32(const uint8_t *buffer, int length) {
+  crc = 0xFFFFFFFFU;
+  return accumulate_crc32(buffer, length);
+}
+
+/* Time */
+void Tofis_Time_Init(void) { time_us = 0; }
+
+uint32_t Tofis_Time_Us(void) { return time_us; }
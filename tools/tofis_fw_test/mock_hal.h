@@ -0,0 +1,34 @@
+// mock_hal.h
+#pragma once
+
+#include "stm32f4xx_hal.h"
+
+// mock 的 UART DMA：傳送不會自行完成，由測試程式呼叫 mock_uart_complete
+// 模擬 DMA 完成中斷，因此等待傳送的程式會卡住或讀取 HAL_GetTick
+typedef struct {
+  uint32_t dma_starts;     // 成功開始的 HAL_UART_Transmit_DMA
+  uint32_t blocking_calls; // HAL_UART_Transmit (阻塞傳送)
+  uint32_t tick_reads;     // HAL_GetTick，HAL 的逾時等待迴圈會讀取
+  const uint8_t *tx_data;  // 傳送中的 frame，沒有時為 NULL
+  uint16_t tx_length;
+  HAL_StatusTypeDef fail_next; // 非 HAL_OK 時下一次 DMA 開始回傳此值
+} mock_uart_t;
+
+extern mock_uart_t mock_uart;
+
+// 映射周邊暫存器位址 (RCC、DMA ...) 並清除計數，需最先呼叫
+void mock_hal_init(void);
+
+// DMA 傳送完成，呼叫 HAL_UART_TxCpltCallback，沒有傳送中的 frame 時回傳 0
+int mock_uart_complete(UART_HandleTypeDef *huart);
+
+// DMA 錯誤中止傳送，呼叫 HAL_UART_ErrorCallback
+void mock_uart_abort(UART_HandleTypeDef *huart);
+
+// UART 收到 data：由 HAL_UARTEx_ReceiveToIdle_DMA 開始的循環 DMA 寫入接收
+// buffer 並遞減 NDTR，不呼叫任何 callback
+void mock_uart_receive(UART_HandleTypeDef *huart, const uint8_t *data,
+                       uint16_t length);
+
+// Tofis_Time_Us 前進 us
+void mock_time_advance(uint32_t us);
@@ -0,0 +1,169 @@
+// test_cmd_rx.c
+// 以 mock HAL 在 host 上執行 tofis_cmd.c：binary link 上的雜訊不會被當成
+// 終端機按鍵執行，header 或 CRC 錯誤的指令從第二個 byte 重新同步，
+// 不會吃掉緊接在後的指令
+#include "check_sum.h"
+#include "mock_hal.h"
+#include "tofis_cmd.h"
+#include <stdio.h>
+#include <string.h>
+
+static int failures;
+
+#define CHECK(condition)                                                       \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition);              \
+      failures++;                                                              \
+    }                                                                          \
+  } while (0)
+
+static UART_HandleTypeDef huart;
+static tofis_cmd_rx_t rx;
+
+// 韌體中在 tofis_uart.c，此測試沒有傳送
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart) { (void)huart; }
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart) { (void)huart; }
+
+static void setup(void) {
+  mock_hal_init();
+  memset(&huart, 0, sizeof(huart));
+  huart.RxState = HAL_UART_STATE_READY;
+  Tofis_Cmd_Init(&rx, &huart);
+}
+
+// 與 host 送出的相同：header、補零到 4 的倍數的參數、CRC
+static uint16_t build(uint8_t *frame, uint8_t id, uint8_t sequence,
+                      const uint8_t *args, uint8_t length) {
+  tofis_cmd_header_t header = {
+      .sync = {TOFIS_CMD_SYNC_BYTE_0, TOFIS_CMD_SYNC_BYTE_1},
+      .id = id,
+      .sequence = sequence,
+      .length = length,
+  };
+  uint16_t size = sizeof(header);
+  uint32_t crc;
+
+  memcpy(frame, &header, sizeof(header));
+  memset(&frame[size], 0, TOFIS_PADDED_LENGTH(length));
+  memcpy(&frame[size], args, length);
+  size += TOFIS_PADDED_LENGTH(length);
+  crc = calculate_crc32(frame, size);
+  memcpy(&frame[size], &crc, sizeof(crc));
+  return size + sizeof(crc);
+}
+
+static void receive(const uint8_t *data, uint16_t length) {
+  mock_uart_receive(&huart, data, length);
+}
+
+// 收到的所有指令的 sequence，依序寫入 sequences
+static int next_all(uint8_t *sequences, int max) {
+  tofis_cmd_t cmd;
+  int count = 0;
+
+  while (Tofis_Cmd_Next(&rx, &cmd)) {
+    CHECK(cmd.binary == 1);
+    if (count < max) {
+      sequences[count] = cmd.sequence;
+    }
+    count++;
+  }
+  return count;
+}
+
+// 任何單一 byte 都不會執行指令，之後的指令照常收到
+static void test_stray_bytes(void) {
+  uint8_t frame[TOFIS_CMD_MAX_FRAME_SIZE];
+  uint8_t noise[256];
+  uint8_t sequences[4];
+  uint16_t size;
+
+  setup();
+  for (int i = 0; i < 256; i++) {
+    noise[i] = (uint8_t)i;
+  }
+  // 0xC3 在結尾的話會等待下一個 byte
+  noise[TOFIS_CMD_SYNC_BYTE_0] = 0;
+  // 一次收滿 ring 會被當成沒有收到
+  receive(noise, sizeof(noise) / 2);
+  CHECK(next_all(sequences, 4) == 0);
+  receive(&noise[sizeof(noise) / 2], sizeof(noise) / 2);
+  CHECK(next_all(sequences, 4) == 0);
+
+  size = build(frame, TOFIS_CMD_ERASE_CALIB, 1, NULL, 0);
+  receive(frame, size);
+  CHECK(next_all(sequences, 4) == 1);
+  CHECK(sequences[0] == 1);
+  CHECK(rx.crc_errors == 0);
+}
+
+// 指令少了一個 byte：CRC 涵蓋下一個指令的開頭，下一個指令仍須收到
+static void test_lost_byte(void) {
+  uint8_t first[TOFIS_CMD_MAX_FRAME_SIZE];
+  uint8_t second[TOFIS_CMD_MAX_FRAME_SIZE];
+  uint8_t sequences[4];
+  const uint8_t fields = 0x3F;
+  uint16_t first_size;
+  uint16_t second_size;
+
+  setup();
+  first_size = build(first, TOFIS_CMD_FIELDS, 1, &fields, 1);
+  second_size = build(second, TOFIS_CMD_TARGETS, 2, (const uint8_t[]){2}, 1);
+
+  receive(first, 9);
+  receive(&first[10], (uint16_t)(first_size - 10));
+  receive(second, second_size);
+  CHECK(next_all(sequences, 4) == 1);
+  CHECK(sequences[0] == 2);
+  CHECK(rx.crc_errors == 1);
+  CHECK(rx.commands == 1);
+}
+
+// header 不合法 (參數過長) 時不等待 CRC，其後的指令仍須收到
+static void test_bad_header(void) {
+  uint8_t frame[TOFIS_CMD_MAX_FRAME_SIZE];
+  uint8_t sequences[4];
+  const uint8_t bad[] = {TOFIS_CMD_SYNC_BYTE_0, TOFIS_CMD_SYNC_BYTE_1,
+                         TOFIS_CMD_FIELDS, 7, 200};
+  uint16_t size;
+
+  setup();
+  size = build(frame, TOFIS_CMD_RESOLUTION, 3, NULL, 0);
+  receive(bad, sizeof(bad));
+  receive(frame, size);
+  CHECK(next_all(sequences, 4) == 1);
+  CHECK(sequences[0] == 3);
+  CHECK(rx.crc_errors == 0);
+}
+
+// 重新同步的 byte 在 DMA ring 的結尾與開頭之間繞回
+static void test_resync_wraps(void) {
+  uint8_t frame[TOFIS_CMD_MAX_FRAME_SIZE];
+  uint8_t filler[TOFIS_CMD_RX_RING_SIZE - 6];
+  uint8_t sequences[4];
+  uint16_t size;
+
+  setup();
+  memset(filler, 0, sizeof(filler));
+  receive(filler, sizeof(filler));
+  CHECK(next_all(sequences, 4) == 0);
+
+  size = build(frame, TOFIS_CMD_SENSORS, 4, (const uint8_t[]){7}, 1);
+  // 只有 header 與第一個參數 byte，CRC 錯誤時 ring 剛好繞回
+  receive(frame, 9);
+  receive(frame, size);
+  CHECK(next_all(sequences, 4) == 1);
+  CHECK(sequences[0] == 4);
+  CHECK(rx.crc_errors == 1);
+}
+
+int main(void) {
+  test_stray_bytes();
+  test_lost_byte();
+  test_bad_header();
+  test_resync_wraps();
+
+  printf("%s\n", failures ? "FAILED" : "PASSED");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,184 @@
+// test_dci_shadow.c
+// 以模擬的 I2C bus 在 host 上執行 ULD：計算 DCI getter 的 I2C transaction，
+// 沒有 shadow 時 get_resolution 需要 3 個，有 shadow 的 getter 一個也不用，
+// 直接以 vl53l8cx_dci_write_data 寫入後 shadow 失效，又回到 3 個
+#include "vl53l8cx_api.h"
+#include <stdio.h>
+#include <string.h>
+
+static int failures;
+
+#define CHECK(condition)                                                       \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition);              \
+      failures++;                                                              \
+    }                                                                          \
+  } while (0)
+
+#define DCI_ENTRIES 8
+#define DCI_MAX_SIZE 64
+
+// sensor 的暫存器，DCI 內容以 sensor 的 byte order 保存
+static struct {
+  uint8_t regs[VL53L8CX_UI_CMD_END + 1];
+  struct {
+    uint16_t index;
+    uint8_t data[DCI_MAX_SIZE];
+  } dci[DCI_ENTRIES];
+  int fail_next_read;
+  int32_t tick;
+} sensor;
+
+static uint8_t *dci_entry(uint16_t index) {
+  for (int i = 0; i < DCI_ENTRIES; i++) {
+    if (sensor.dci[i].index == index || sensor.dci[i].index == 0) {
+      sensor.dci[i].index = index;
+      return sensor.dci[i].data;
+    }
+  }
+  return NULL;
+}
+
+// 寫到 UI_CMD_END 為止的是 firmware 命令：倒數第三個 byte 0x02 為讀取，
+// 0x01 為寫入，開頭是 index 與資料長度
+static void run_command(uint16_t address, uint16_t size) {
+  const uint8_t *cmd = &sensor.regs[address];
+  uint16_t index = (uint16_t)((cmd[0] << 8) | cmd[1]);
+  uint16_t data_size = (uint16_t)((cmd[2] << 4) | (cmd[3] >> 4));
+  uint8_t *entry = dci_entry(index);
+
+  if (entry == NULL || data_size > DCI_MAX_SIZE) {
+    return;
+  }
+  if (cmd[size - 3] == 0x02) {
+    memset(&sensor.regs[VL53L8CX_UI_CMD_START], 0, 4);
+    memcpy(&sensor.regs[VL53L8CX_UI_CMD_START + 4], entry, data_size);
+  } else if (cmd[size - 3] == 0x01) {
+    memcpy(entry, &cmd[4], data_size);
+  }
+  sensor.regs[VL53L8CX_UI_CMD_STATUS + 1] = 0x03;
+}
+
+static int32_t bus_write(uint16_t address, uint16_t reg, uint8_t *data,
+                         uint16_t size) {
+  (void)address;
+  memcpy(&sensor.regs[reg], data, size);
+  if ((uint32_t)reg + size - 1U == VL53L8CX_UI_CMD_END) {
+    run_command(reg, size);
+  }
+  return 0;
+}
+
+static int32_t bus_read(uint16_t address, uint16_t reg, uint8_t *data,
+                        uint16_t size) {
+  (void)address;
+  if (sensor.fail_next_read) {
+    sensor.fail_next_read = 0;
+    return -1;
+  }
+  memcpy(data, &sensor.regs[reg], size);
+  return 0;
+}
+
+static int32_t bus_tick(void) { return sensor.tick++; }
+
+static VL53L8CX_Configuration dev;
+
+// 以 host 的 byte order 設定 sensor 上的 DCI 內容，不經過 ULD
+static void sensor_set_dci(uint16_t index, const uint8_t *data,
+                           uint16_t size) {
+  uint8_t *entry = dci_entry(index);
+
+  memcpy(entry, data, size);
+  VL53L8CX_SwapBuffer(entry, size);
+}
+
+static void setup(void) {
+  static const uint8_t zone_config_4x4[8] = {4, 4};
+
+  memset(&sensor, 0, sizeof(sensor));
+  memset(&dev, 0, sizeof(dev));
+  dev.platform.Write = bus_write;
+  dev.platform.Read = bus_read;
+  dev.platform.GetTick = bus_tick;
+  sensor_set_dci(VL53L8CX_DCI_ZONE_CONFIG, zone_config_4x4,
+                 sizeof(zone_config_4x4));
+}
+
+// 呼叫 getter 前歸零 transaction 計數
+#define TRANSFERS(call)                                                        \
+  (dev.platform.transfers = 0, (call), dev.platform.transfers)
+
+static void test_resolution(void) {
+  uint8_t resolution = 0;
+  uint8_t zone_config_8x8[8] = {8, 8};
+
+  setup();
+
+  // 第一次：命令、等待回應、讀取資料
+  CHECK(TRANSFERS(vl53l8cx_get_resolution(&dev, &resolution)) == 3);
+  CHECK(resolution == VL53L8CX_RESOLUTION_4X4);
+  CHECK(TRANSFERS(vl53l8cx_get_resolution(&dev, &resolution)) == 0);
+  CHECK(resolution == VL53L8CX_RESOLUTION_4X4);
+
+  // 直接寫入 DCI，ULD 不知道寫了甚麼
+  CHECK(vl53l8cx_dci_write_data(&dev, zone_config_8x8,
+                                VL53L8CX_DCI_ZONE_CONFIG,
+                                sizeof(zone_config_8x8)) == 0);
+  CHECK(TRANSFERS(vl53l8cx_get_resolution(&dev, &resolution)) == 3);
+  CHECK(resolution == VL53L8CX_RESOLUTION_8X8);
+  CHECK(TRANSFERS(vl53l8cx_get_resolution(&dev, &resolution)) == 0);
+
+  printf("resolution: 3 transactions cold, 0 shadowed\n");
+}
+
+static void test_setters_fill_shadow(void) {
+  uint8_t frequency_hz = 0;
+  uint32_t time_ms = 0;
+  static const uint8_t freq_config[4] = {0};
+  static const uint8_t int_time_config[20] = {0};
+
+  setup();
+  sensor_set_dci(VL53L8CX_DCI_FREQ_HZ, freq_config, sizeof(freq_config));
+  sensor_set_dci(VL53L8CX_DCI_INT_TIME, int_time_config,
+                 sizeof(int_time_config));
+
+  CHECK(vl53l8cx_set_ranging_frequency_hz(&dev, 15) == 0);
+  CHECK(vl53l8cx_set_integration_time_ms(&dev, 20) == 0);
+  CHECK(TRANSFERS(vl53l8cx_get_ranging_frequency_hz(&dev, &frequency_hz)) ==
+        0);
+  CHECK(frequency_hz == 15);
+  CHECK(TRANSFERS(vl53l8cx_get_integration_time_ms(&dev, &time_ms)) == 0);
+  CHECK(time_ms == 20);
+
+  // shadow 與 sensor 一致：清掉 shadow 後讀回相同的值
+  dev.dci_shadow.valid = 0;
+  CHECK(TRANSFERS(vl53l8cx_get_ranging_frequency_hz(&dev, &frequency_hz)) ==
+        3);
+  CHECK(frequency_hz == 15);
+  CHECK(TRANSFERS(vl53l8cx_get_integration_time_ms(&dev, &time_ms)) == 3);
+  CHECK(time_ms == 20);
+}
+
+// 讀取失敗時 sensor 上的值未知，下一次必須重讀
+static void test_failed_read_drops_shadow(void) {
+  uint8_t resolution = 0;
+
+  setup();
+  sensor.fail_next_read = 1;
+  CHECK(vl53l8cx_get_resolution(&dev, &resolution) != 0);
+  CHECK(dev.platform.errors == 1);
+  CHECK(TRANSFERS(vl53l8cx_get_resolution(&dev, &resolution)) == 3);
+  CHECK(resolution == VL53L8CX_RESOLUTION_4X4);
+  CHECK(TRANSFERS(vl53l8cx_get_resolution(&dev, &resolution)) == 0);
+}
+
+int main(void) {
+  test_resolution();
+  test_setters_fill_shadow();
+  test_failed_read_drops_shadow();
+
+  printf("%s\n", failures ? "FAILED" : "PASSED");
+  return failures ? 1 : 0;
+}
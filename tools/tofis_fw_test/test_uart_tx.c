@@ -0,0 +1,187 @@
+// test_uart_tx.c
+// 以 mock HAL 在 host 上執行 tofis_uart.c：量測迴圈連續送出 frame 時
+// 不會等待 UART，傳送中只保留最新的一個 frame，被覆蓋的計入 frames_dropped
+#include "mock_hal.h"
+#include "tofis_time.h"
+#include "tofis_uart.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define FRAMES 1000
+
+static int failures;
+
+#define CHECK(condition)                                                       \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition);              \
+      failures++;                                                              \
+    }                                                                          \
+  } while (0)
+
+static UART_HandleTypeDef huart;
+static tofis_slave_device_t device;
+static RANGING_SENSOR_Result_t result;
+
+static double now_s(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void setup(void) {
+  mock_hal_init();
+  memset(&huart, 0, sizeof(huart));
+  huart.gState = HAL_UART_STATE_READY;
+  Tofis_Slave_USART_Init(&device, &huart);
+
+  memset(&result, 0, sizeof(result));
+  result.NumberOfZones = 16;
+  for (uint32_t z = 0; z < result.NumberOfZones; z++) {
+    result.ZoneResult[z].NumberOfTargets = 1;
+    result.ZoneResult[z].Distance[0] = 100 + z;
+  }
+}
+
+static uint16_t wire_sequence(void) {
+  const tofis_frame_header_t *header =
+      (const tofis_frame_header_t *)mock_uart.tx_data;
+  return header->sequence;
+}
+
+// UART 一直沒有傳完，所有 Send 仍須立即返回
+static void test_back_to_back(void) {
+  double elapsed = 0.0;
+
+  setup();
+  for (int i = 0; i < FRAMES; i++) {
+    Tofis_Slave_USART_SetFrameInfo(&device, (uint8_t)(i % 3), (uint8_t)i,
+                                   Tofis_Time_Us());
+    double start = now_s();
+    HAL_StatusTypeDef status = Tofis_Slave_USART_SendData_Le(&device, 4,
+                                                             &result);
+    elapsed += now_s() - start;
+
+    // 第一個上線，第二個排隊，其後每一個都覆蓋排隊中的 frame
+    CHECK(status == ((i < 2) ? HAL_OK : HAL_BUSY));
+    mock_time_advance(1000);
+  }
+
+  CHECK(mock_uart.dma_starts == 1);
+  CHECK(mock_uart.blocking_calls == 0);
+  CHECK(mock_uart.tick_reads == 0);
+  CHECK(device.frames_dropped == FRAMES - 2);
+  CHECK(device.frames_sent == 0);
+  CHECK(wire_sequence() == 0);
+
+  // 傳完後接著送出最新的 frame
+  CHECK(mock_uart_complete(&huart));
+  CHECK(mock_uart.dma_starts == 2);
+  CHECK(device.frames_sent == 1);
+  CHECK(wire_sequence() == FRAMES - 1);
+
+  CHECK(mock_uart_complete(&huart));
+  CHECK(device.frames_sent == 2);
+  CHECK(!Tofis_Slave_USART_IsBusy(&device));
+  CHECK(!mock_uart_complete(&huart));
+
+  printf("back to back: %d frames, %lu dropped, %.2f us per send\n", FRAMES,
+         (unsigned long)device.frames_dropped, elapsed / FRAMES * 1e6);
+}
+
+// UART 跟得上時不應丟棄任何 frame
+static void test_link_keeps_up(void) {
+  setup();
+  for (int i = 0; i < FRAMES; i++) {
+    CHECK(Tofis_Slave_USART_SendData_Le(&device, 4, &result) == HAL_OK);
+    if (i % 2 == 1) {
+      // 兩個 frame 之間 DMA 只完成一次：一個在線上、一個排隊
+      mock_uart_complete(&huart);
+      mock_uart_complete(&huart);
+    }
+  }
+  while (mock_uart_complete(&huart)) {
+  }
+
+  CHECK(device.frames_dropped == 0);
+  CHECK(device.frames_sent == FRAMES);
+  CHECK(mock_uart.dma_starts == FRAMES);
+  CHECK(mock_uart.tick_reads == 0);
+  printf("link keeps up: %lu sent, %lu dropped\n",
+         (unsigned long)device.frames_sent,
+         (unsigned long)device.frames_dropped);
+}
+
+static HAL_StatusTypeDef send_delta(void) {
+  tofis_frame_source_t source = {
+      .resolution = 4,
+      .fields = TOFIS_FIELD_DISTANCE | TOFIS_FIELD_STATUS,
+      .targets = 1,
+      .result = &result,
+      .raw = NULL,
+  };
+
+  // 每個 frame 都有變動，delta 不會比 keyframe 大
+  result.ZoneResult[0].Distance[0]++;
+  return Tofis_Slave_USART_SendData_Delta(&device, &source);
+}
+
+static uint8_t wire_encoding(void) {
+  return ((const tofis_frame_header_t *)mock_uart.tx_data)->encoding;
+}
+
+// host 沒收到的 frame 是後續 delta 的參考，下一個 frame 必須是 keyframe
+static void test_lost_frames_restart_delta(void) {
+  // DMA 無法開始
+  setup();
+  send_delta();
+  CHECK(wire_encoding() == TOFIS_ENCODING_KEYFRAME);
+  mock_uart_complete(&huart);
+  send_delta();
+  CHECK(wire_encoding() == TOFIS_ENCODING_DELTA);
+  mock_uart_complete(&huart);
+  mock_uart.fail_next = HAL_ERROR;
+  CHECK(send_delta() == HAL_ERROR);
+  CHECK(device.tx_errors == 1);
+  send_delta();
+  CHECK(wire_encoding() == TOFIS_ENCODING_KEYFRAME);
+
+  // 傳送中因 DMA 錯誤中止
+  mock_uart_complete(&huart);
+  send_delta();
+  CHECK(wire_encoding() == TOFIS_ENCODING_DELTA);
+  mock_uart_abort(&huart);
+  CHECK(device.frames_dropped == 1);
+  send_delta();
+  CHECK(wire_encoding() == TOFIS_ENCODING_KEYFRAME);
+
+  // 排隊中的 frame 在 Tx complete 時無法開始
+  send_delta();
+  mock_uart.fail_next = HAL_ERROR;
+  mock_uart_complete(&huart);
+  CHECK(device.frames_dropped == 2);
+  CHECK(!Tofis_Slave_USART_IsBusy(&device));
+  send_delta();
+  CHECK(wire_encoding() == TOFIS_ENCODING_KEYFRAME);
+
+  // 被覆蓋的 frame
+  send_delta();
+  send_delta();
+  CHECK(device.frames_dropped == 3);
+  mock_uart_complete(&huart);
+  CHECK(wire_encoding() == TOFIS_ENCODING_KEYFRAME);
+
+  printf("lost frames restart delta: %lu tx errors, %lu dropped\n",
+         (unsigned long)device.tx_errors,
+         (unsigned long)device.frames_dropped);
+}
+
+int main(void) {
+  test_back_to_back();
+  test_link_keeps_up();
+  test_lost_frames_restart_delta();
+
+  printf("%s\n", failures ? "FAILED" : "PASSED");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,290 @@
+// tofis_parser_bench.c
+// 將錄製的串流加入雜訊後送進 tofis_stream_parser，統計救回的 frame 比例與
+// 解析速度。沒有指定錄製檔時產生模擬的 8x8 delta 串流
+#include "checksum.h"
+#include "tofis_stream_parser.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_FRAMES 20000 // 模擬串流的 frame 數
+#define BENCH_REPEAT 5     // 量測速度時重複解析的次數
+#define BENCH_CHUNK 4096   // 每次送進解析器的位元組，相當於一次 read()
+
+typedef struct {
+  size_t start; // frame 在乾淨串流中的位置
+  size_t size;  // header + 補齊後的 payload
+  uint16_t sequence;
+  uint32_t crc32;
+} bench_frame_t;
+
+typedef struct {
+  uint8_t *data;
+  size_t length;
+  size_t capacity;
+} bench_buffer_t;
+
+static tofis_parser_t parser;
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+// xorshift64*，各平台結果相同，數字可以重現
+static uint32_t rng_next(void) {
+  rng_state ^= rng_state >> 12;
+  rng_state ^= rng_state << 25;
+  rng_state ^= rng_state >> 27;
+  return (uint32_t)((rng_state * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+static double rng_unit(void) { return rng_next() / 4294967296.0; }
+
+static void buffer_put(bench_buffer_t *buffer, const uint8_t *data,
+                       size_t length) {
+  if (buffer->length + length > buffer->capacity) {
+    buffer->capacity = (buffer->length + length) * 2;
+    buffer->data = realloc(buffer->data, buffer->capacity);
+    if (buffer->data == NULL) {
+      perror("realloc");
+      exit(1);
+    }
+  }
+  memcpy(buffer->data + buffer->length, data, length);
+  buffer->length += length;
+}
+
+// 每個感測器 10 個 frame 一個 keyframe (284 bytes，8x8 compact 距離與狀態)，
+// 其間為 16 至 160 bytes 的 delta，payload 為亂數，會出現假的 sync
+static void generate_stream(bench_buffer_t *stream) {
+  static uint8_t frame[sizeof(tofis_frame_header_t) +
+                       TOFIS_PADDED_LENGTH(TOFIS_MAX_PAYLOAD_SIZE)];
+  tofis_frame_header_t *header = (tofis_frame_header_t *)frame;
+  uint8_t *payload = frame + sizeof(*header);
+
+  for (uint32_t i = 0; i < BENCH_FRAMES; i++) {
+    uint8_t key = ((i / TOFIS_MAX_SENSORS) % 10) == 0;
+    uint16_t length = key ? 284 : (uint16_t)(16 + rng_next() % 145);
+    size_t padded = TOFIS_PADDED_LENGTH(length);
+
+    memset(header, 0, sizeof(*header));
+    header->sync[0] = TOFIS_SYNC_BYTE_0;
+    header->sync[1] = TOFIS_SYNC_BYTE_1;
+    header->version = TOFIS_PROTOCOL_VERSION;
+    header->encoding = key ? TOFIS_ENCODING_KEYFRAME : TOFIS_ENCODING_DELTA;
+    header->length = length;
+    header->sequence = (uint16_t)i;
+    header->stream_count = (uint8_t)(i / TOFIS_MAX_SENSORS);
+    header->sensor = (uint8_t)(i % TOFIS_MAX_SENSORS);
+    header->irq_time_us = i * 5555U;
+    header->tx_time_us = header->irq_time_us + 800U;
+
+    for (size_t b = 0; b < padded; b++) {
+      payload[b] = (b < length) ? (uint8_t)rng_next() : 0;
+    }
+    uint32_t crc = crc32_update(TOFIS_CRC32_INIT, frame,
+                                TOFIS_FRAME_HEADER_CRC_SIZE);
+    header->crc32 = crc32_update(crc, payload, padded);
+
+    buffer_put(stream, frame, sizeof(*header) + padded);
+  }
+}
+
+static int read_stream(const char *path, bench_buffer_t *stream) {
+  uint8_t chunk[BENCH_CHUNK];
+  size_t length;
+  FILE *file = fopen(path, "rb");
+
+  if (file == NULL) {
+    perror(path);
+    return -1;
+  }
+  while ((length = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+    buffer_put(stream, chunk, length);
+  }
+  fclose(file);
+  return 0;
+}
+
+// 解析乾淨的串流，記下每個 frame 的位置。解析器只會跳過位元組或取出 frame，
+// 所以 frame 的起點為之前跳過的位元組加上之前的 frame 大小
+static size_t index_frames(const bench_buffer_t *stream, bench_frame_t *frames,
+                           size_t max_frames) {
+  tofis_frame_header_t header;
+  const uint8_t *payload;
+  size_t consumed = 0;
+  size_t count = 0;
+
+  tofis_parser_reset(&parser);
+  for (size_t i = 0; i < stream->length;) {
+    i += tofis_parser_feed(&parser, stream->data + i, stream->length - i);
+    while (tofis_parser_next(&parser, &header, &payload)) {
+      size_t size = sizeof(header) + TOFIS_PADDED_LENGTH(header.length);
+
+      if (count < max_frames) {
+        frames[count].start = parser.stats.skipped_bytes + consumed;
+        frames[count].size = size;
+        frames[count].sequence = header.sequence;
+        frames[count].crc32 = header.crc32;
+        count++;
+      }
+      consumed += size;
+    }
+  }
+  return count;
+}
+
+// 以 rate 的機率改變每個位元組，並以 rate / 4 的機率在其後插入最多 31 bytes
+// 的雜訊 (四分之一為 sync byte)。touched[i] 表示位元組 i 被改變或其後被插入
+static void add_noise(const bench_buffer_t *clean, double rate,
+                      bench_buffer_t *noisy, uint8_t *touched) {
+  uint8_t burst[32];
+
+  noisy->length = 0;
+  for (size_t i = 0; i < clean->length; i++) {
+    uint8_t value = clean->data[i];
+
+    touched[i] = 0;
+    if (rng_unit() < rate) {
+      value ^= (uint8_t)(1 + rng_next() % 255);
+      touched[i] |= 1;
+    }
+    buffer_put(noisy, &value, 1);
+
+    if (rng_unit() < rate / 4) {
+      size_t length = rng_next() % 32;
+
+      for (size_t b = 0; b < length; b++) {
+        burst[b] = (rng_next() % 4 == 0) ? TOFIS_SYNC_BYTE_0
+                                         : (uint8_t)rng_next();
+      }
+      buffer_put(noisy, burst, length);
+      touched[i] |= (length != 0) ? 2 : 0;
+    }
+  }
+}
+
+// 插入在 frame 最後一個位元組之後的雜訊不影響此 frame
+static int frame_intact(const bench_frame_t *frame, const uint8_t *touched) {
+  for (size_t b = 0; b < frame->size; b++) {
+    uint8_t mask = (b + 1 < frame->size) ? 3 : 1;
+
+    if (touched[frame->start + b] & mask) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+static double now_s(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// 解析加入雜訊的串流，依序比對救回的 frame，回傳遺失的完好 frame 數
+static size_t run(const bench_buffer_t *noisy, const bench_frame_t *frames,
+                  size_t count, const uint8_t *touched, size_t *recovered,
+                  size_t *intact, double *mb_per_s) {
+  tofis_frame_header_t header;
+  const uint8_t *payload;
+  size_t next = 0;
+  size_t missed = 0;
+  double start;
+
+  *recovered = 0;
+  *intact = 0;
+  tofis_parser_reset(&parser);
+  for (size_t i = 0; i < noisy->length;) {
+    size_t chunk = noisy->length - i;
+
+    chunk = (chunk > BENCH_CHUNK) ? BENCH_CHUNK : chunk;
+    i += tofis_parser_feed(&parser, noisy->data + i, chunk);
+    while (tofis_parser_next(&parser, &header, &payload)) {
+      (*recovered)++;
+      // 其間的 frame 沒有救回，完好的 frame 不應如此
+      while (next < count && (frames[next].sequence != header.sequence ||
+                              frames[next].crc32 != header.crc32)) {
+        if (frame_intact(&frames[next], touched)) {
+          missed++;
+        }
+        next++;
+      }
+      next++;
+    }
+  }
+  for (; next < count; next++) {
+    missed += frame_intact(&frames[next], touched);
+  }
+  for (size_t f = 0; f < count; f++) {
+    *intact += frame_intact(&frames[f], touched);
+  }
+
+  // 速度另外量測，不含比對
+  start = now_s();
+  for (int r = 0; r < BENCH_REPEAT; r++) {
+    tofis_parser_reset(&parser);
+    for (size_t i = 0; i < noisy->length;) {
+      size_t chunk = noisy->length - i;
+
+      chunk = (chunk > BENCH_CHUNK) ? BENCH_CHUNK : chunk;
+      i += tofis_parser_feed(&parser, noisy->data + i, chunk);
+      while (tofis_parser_next(&parser, &header, &payload)) {
+      }
+    }
+  }
+  *mb_per_s = (double)noisy->length * BENCH_REPEAT / (now_s() - start) / 1e6;
+  return missed;
+}
+
+int main(int argc, char *argv[]) {
+  static const double rates[] = {0.0, 1e-5, 1e-4, 1e-3, 1e-2};
+  bench_buffer_t clean = {0};
+  bench_buffer_t noisy = {0};
+  int failed = 0;
+
+  // 參數為以 `cat /dev/ttyUSB0 > capture.bin` 錄下的串流
+  if (argc > 1) {
+    if (read_stream(argv[1], &clean) != 0) {
+      return 1;
+    }
+  } else {
+    generate_stream(&clean);
+  }
+
+  size_t max_frames = clean.length / sizeof(tofis_frame_header_t) + 1;
+  bench_frame_t *frames = malloc(max_frames * sizeof(*frames));
+  uint8_t *touched = malloc(clean.length + 1);
+  if (frames == NULL || touched == NULL) {
+    perror("malloc");
+    return 1;
+  }
+  size_t count = index_frames(&clean, frames, max_frames);
+  if (count == 0) {
+    printf("No frame in the stream (protocol v%u expected)\n",
+           TOFIS_PROTOCOL_VERSION);
+    return 1;
+  }
+
+  printf("%s: %zu bytes, %zu frames\n", (argc > 1) ? argv[1] : "simulated",
+         clean.length, count);
+  printf("%-8s %10s %10s %10s %8s %8s\n", "noise", "recovered", "intact",
+         "missed", "rate", "MB/s");
+  for (size_t r = 0; r < sizeof(rates) / sizeof(rates[0]); r++) {
+    size_t recovered, intact;
+    double mb_per_s;
+
+    add_noise(&clean, rates[r], &noisy, touched);
+    size_t missed = run(&noisy, frames, count, touched, &recovered, &intact,
+                        &mb_per_s);
+    printf("%-8g %10zu %10zu %10zu %7.1f%% %8.0f\n", rates[r], recovered,
+           intact, missed, 100.0 * recovered / count, mb_per_s);
+    failed |= (missed != 0);
+  }
+
+  free(frames);
+  free(touched);
+  free(clean.data);
+  free(noisy.data);
+
+  // 完好的 frame 都應救回
+  return failed ? 2 : 0;
+}
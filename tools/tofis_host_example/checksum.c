@@ -0,0 +1,51 @@
+// checksum.c
+#include "checksum.h"
+
+#define CRC32_POLY 0x04C11DB7U
+
+static uint32_t crc_table[8][256];
+static int crc_table_ready = 0;
+
+void crc32_init_tables(void) {
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t crc = i << 24;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x80000000U) ? (crc << 1) ^ CRC32_POLY : (crc << 1);
+    }
+    crc_table[0][i] = crc;
+  }
+
+  // crc_table[k][i]：位元組 i 之後再接 k 個 0 位元組的 CRC
+  for (int k = 1; k < 8; k++) {
+    for (int i = 0; i < 256; i++) {
+      uint32_t prev = crc_table[k - 1][i];
+      crc_table[k][i] = (prev << 8) ^ crc_table[0][prev >> 24];
+    }
+  }
+
+  crc_table_ready = 1;
+}
+
+uint32_t crc32_update(uint32_t crc, const uint8_t *data, size_t length) {
+  if (!crc_table_ready) {
+    crc32_init_tables();
+  }
+
+  // 一次處理 8 bytes
+  while (length >= 8) {
+    uint32_t word = crc ^ ((uint32_t)data[0] << 24 | (uint32_t)data[1] << 16 |
+                           (uint32_t)data[2] << 8 | (uint32_t)data[3]);
+    crc = crc_table[7][word >> 24] ^ crc_table[6][(word >> 16) & 0xFF] ^
+          crc_table[5][(word >> 8) & 0xFF] ^ crc_table[4][word & 0xFF] ^
+          crc_table[3][data[4]] ^ crc_table[2][data[5]] ^
+          crc_table[1][data[6]] ^ crc_table[0][data[7]];
+    data += 8;
+    length -= 8;
+  }
+
+  while (length--) {
+    crc = (crc << 8) ^ crc_table[0][(crc >> 24) ^ *data++];
+  }
+
+  return crc;
+}
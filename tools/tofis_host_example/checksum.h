@@ -1,12 +1,15 @@
 // checksum.h
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 
-static inline uint8_t calculate_checksum(uint8_t *buffer, int length) {
-    uint8_t checksum = 0;
-    for(int i = 0; i < length; i++) {
-        checksum ^= buffer[i];
-    }
-    return checksum;
-}
+// CRC-32/MPEG-2（poly 0x04C11DB7、init 0xFFFFFFFF、不反射、無 final xor），
+// 與 STM32 CRC 周邊的結果一致
+#define TOFIS_CRC32_INIT 0xFFFFFFFFU
+
+// 建立 slice-by-8 查表（第一次呼叫 crc32_update 時自動建立）
+void crc32_init_tables(void);
+
+// 以 slice-by-8 查表更新 CRC
+uint32_t crc32_update(uint32_t crc, const uint8_t *data, size_t length);
@@ -3,7 +3,10 @@
 
 #include <stdint.h>
 
-#define RANGING_SENSOR_NB_TARGET_PER_ZONE 1
+// 協定可攜帶的每個 zone 最大 target 數，韌體實際的數量由 descriptor 告知，
+// 不需與韌體的 VL53L8CX_NB_TARGET_PER_ZONE 一致
+#define TOFIS_MAX_TARGETS_PER_ZONE 4
+#define RANGING_SENSOR_NB_TARGET_PER_ZONE TOFIS_MAX_TARGETS_PER_ZONE
 #define RANGING_SENSOR_MAX_NB_ZONES 64
 
 typedef struct {
@@ -19,10 +22,240 @@ typedef struct {
     RANGING_SENSOR_ZoneResult_t ZoneResult[RANGING_SENSOR_MAX_NB_ZONES];
 } RANGING_SENSOR_Result_t;
 
+/* Protocol */
+// 每個 frame 為 tofis_frame_header_t + payload + 補 0 至 4 bytes 倍數，
+// 皆為 little endian
+#define TOFIS_SYNC_BYTE_0 0xA5
+#define TOFIS_SYNC_BYTE_1 0x5A
+#define TOFIS_PROTOCOL_VERSION 12
+
+// payload 編碼
+#define TOFIS_ENCODING_COMPACT 0x01
+#define TOFIS_ENCODING_KEYFRAME 0x02
+#define TOFIS_ENCODING_DELTA 0x03
+#define TOFIS_ENCODING_RAW 0x04       // tofis_raw_desc_t + 韌體的 RANGING_SENSOR_Result_t
+#define TOFIS_ENCODING_RAW_BE 0x05    // 同上，所有欄位為 big endian
+#define TOFIS_ENCODING_ACK 0x06       // tofis_cmd_ack_t，指令的回覆
+#define TOFIS_ENCODING_CONFIG 0x07    // tofis_config_desc_t，設定已變更
+#define TOFIS_ENCODING_TELEMETRY 0x08 // tofis_telemetry_t，錯誤計數與延遲
+
+#define TOFIS_PADDED_LENGTH(length) (((length) + 3U) & ~3U)
+
+// compact payload 的欄位，由 host 於執行時選擇 (韌體 'f' 指令)
+#define TOFIS_FIELD_DISTANCE (1U << 0)    // 每個 target，int16_t [mm]
+#define TOFIS_FIELD_STATUS (1U << 1)      // 每個 target，uint8_t
+#define TOFIS_FIELD_SIGNAL (1U << 2)      // 每個 target，uint16_t [kcps/spad]
+#define TOFIS_FIELD_AMBIENT (1U << 3)     // 每個 zone，uint16_t [kcps/spad]
+#define TOFIS_FIELD_SIGMA (1U << 4)       // 每個 target，uint16_t [mm]
+#define TOFIS_FIELD_REFLECTANCE (1U << 5) // 每個 target，uint8_t [%]
+#define TOFIS_FIELD_SPADS (1U << 6)       // 每個 zone，uint16_t
+#define TOFIS_FIELD_TEMPERATURE (1U << 7) // 每個 frame，int8_t [degC]
+
+#define TOFIS_FIELD_RAW                                                        \
+    (TOFIS_FIELD_DISTANCE | TOFIS_FIELD_STATUS | TOFIS_FIELD_SIGNAL |          \
+     TOFIS_FIELD_AMBIENT)
+
+#pragma pack(push, 1)
+// 時間皆為 MCU 的 Tofis_Time_Us (us)，tx_time_us 於 DMA 開始時才寫入，
+// 不在 CRC 範圍內
+typedef struct {
+    uint8_t sync[2];      // Fixed to 0xA5 0x5A
+    uint8_t version;      // TOFIS_PROTOCOL_VERSION
+    uint8_t encoding;     // TOFIS_ENCODING_*
+    uint16_t length;      // Payload length in bytes, without padding
+    uint16_t sequence;    // 每個 frame 加一，跳號即為遺失的 frame
+    uint8_t stream_count; // sensor streamcount，跳號即為 sensor 端略過的 frame
+    uint8_t sensor;       // 感測器 (0 left, 1 center, 2 right)
+    uint8_t config_id;    // 產生此 frame 的設定，每次變更加一
+    uint8_t reserved;     // 0
+    uint32_t irq_time_us; // sensor data ready 中斷時間
+    uint32_t crc32;       // CRC-32/MPEG-2 of header bytes 0-15 and padded payload
+    uint32_t tx_time_us;  // 開始傳送的時間
+} tofis_frame_header_t;
+
+#define TOFIS_FRAME_HEADER_CRC_SIZE 16
+
+// 韌體最多的感測器數 (53L8A1 的 left、center、right)，delta 參考 frame 與
+// 時序統計各自獨立
+#define TOFIS_MAX_SENSORS 3
+
+// raw payload 的陣列長度為韌體編譯時的容量 (targets)，與 host 的不同
+typedef struct {
+    uint8_t resolution;  // 4 or 8
+    uint8_t targets;     // 每個 zone 的陣列長度
+    uint8_t reserved[2]; // 0
+} tofis_raw_desc_t;
+
+// compact payload 以 tofis_frame_desc_t 開頭，其後依 fields 排列 (僅含有設定的欄位):
+//   int8_t temperature
+//   zones 個 { uint8_t nb_targets, uint16_t ambient, uint16_t spads,
+//             min(nb_targets, targets) 個 { int16_t distance, uint8_t status,
+//             uint16_t signal, uint16_t sigma, uint8_t reflectance } }
+typedef struct {
+    uint8_t resolution; // 4 or 8
+    uint8_t fields;     // TOFIS_FIELD_*
+    uint8_t zones;      // Number of zone records
+    uint8_t targets;    // sensor 每個 zone 傳送的 target 數，即 record 上限
+} tofis_frame_desc_t;
+
+// keyframe 與 delta payload 以 tofis_delta_desc_t 開頭
+typedef struct {
+    uint8_t key_id; // 每個 keyframe 加一
+    uint8_t index;  // keyframe 為 0，其後第 n 個 delta 為 n
+} tofis_delta_desc_t;
+
+// 指令 (host 至 MCU) 為 tofis_cmd_header_t + 參數補 0 至 4 bytes 倍數 +
+// 兩者的 CRC-32/MPEG-2 (uint32_t)。韌體以 TOFIS_ENCODING_ACK frame 回覆，
+// CRC 錯誤的指令不回覆，host 逾時後以相同 sequence 重送，韌體只重送 ack
+typedef struct {
+    uint8_t sync[2];     // Fixed to 0xC3 0x3C
+    uint8_t id;          // TOFIS_CMD_*
+    uint8_t sequence;    // host 決定，ack 原樣帶回
+    uint8_t length;      // 參數長度，最多 TOFIS_CMD_MAX_ARGS
+    uint8_t reserved[3]; // 0
+} tofis_cmd_header_t;
+
+// 韌體在兩個 frame 之間變更設定後送出 TOFIS_ENCODING_CONFIG frame
+// (sensor 0、stream_count 0)，其後的 frame 帶有新的 config_id，
+// 即使此 frame 遺失也能由 config_id 跳動得知
+typedef struct {
+    uint8_t config_id;       // 其後 frame 的 config_id
+    uint8_t changes;         // TOFIS_CONFIG_*
+    uint8_t resolution;      // 4 or 8
+    uint8_t fields;          // 傳送的 TOFIS_FIELD_*，頻寬不足時少於要求
+    uint8_t targets;         // 每個 zone 的 target 數
+    uint8_t target_order;    // 1 closest, 2 strongest
+    uint8_t sensors;         // bit n 為感測器 n 量測中
+    uint8_t frequency_hz;    // 每個感測器的量測頻率
+    uint32_t stopped_us;     // 為此變更停止量測的時間，未重新啟動為 0
+    uint8_t integration_ms;  // 積分時間，僅 autonomous 模式使用
+    uint8_t adaptive;        // 1: 量測頻率與積分時間由韌體自動調整
+    uint8_t encoding;        // TOFIS_ENCODING_RAW、COMPACT 或 DELTA (delta 模式)
+    int8_t headroom_percent; // 預估未使用的頻寬 %，負值表示超出
+} tofis_config_desc_t;
+
+typedef struct {
+    uint8_t id;       // 指令 id
+    uint8_t sequence; // 指令 sequence
+    uint8_t status;   // TOFIS_CMD_STATUS_*
+    uint8_t reserved; // 0
+} tofis_cmd_ack_t;
+
+// 延遲的階段
+#define TOFIS_STAGE_READ 0    // data ready 中斷至 I2C 讀取完成
+#define TOFIS_STAGE_PROCESS 1 // 讀取完成至 frame 排入 UART
+#define TOFIS_STAGE_QUEUE 2   // 排入 UART 至開始傳送
+#define TOFIS_STAGE_TOTAL 3   // data ready 中斷至開始傳送
+#define TOFIS_STAGE_COUNT 4
+
+// 韌體每秒送出 TOFIS_ENCODING_TELEMETRY frame (sensor 0、stream_count 0)。
+// 計數自開機累計，host 取兩個 frame 的差值，frame 遺失也不會少算；
+// 延遲只涵蓋上一個 frame 之後的期間。指令 'i'、'p' 立即送出一個
+typedef struct {
+    uint32_t min_us; // count 為 0 時為 0
+    uint32_t avg_us;
+    uint32_t max_us;
+    uint32_t count; // 期間內量測的 frame 數
+} tofis_latency_desc_t;
+
+typedef struct {
+    uint32_t stream_gaps; // streamcount 跳號，感測器產生但未送出的 frame
+    uint32_t overruns;    // 前一個 frame 尚未讀取時又收到 data ready
+    uint32_t corrupted;   // header 與 footer id 不符，frame 未送出
+    uint32_t i2c_errors;  // 失敗的 I2C 傳輸
+    uint32_t frames;          // 讀取的 frame
+    uint16_t frame_transfers; // 最近一個 frame 的 I2C 傳輸數
+    uint16_t frame_bytes;     // 每個 frame 讀取的 bytes
+} tofis_sensor_counters_t;
+
+typedef struct {
+    uint32_t period_us;       // 延遲涵蓋的時間
+    uint32_t frames_sent;     // 傳送完成的 frame
+    uint32_t frames_dropped;  // 傳送前被覆蓋的 frame
+    uint32_t tx_errors;       // 傳送失敗或逾時
+    uint32_t events_lost;     // event queue 已滿而遺失的中斷事件
+    uint32_t config_errors;   // 感測器拒絕設定的變更次數
+    uint8_t queue_high_water; // 開機以來 event queue 同時最多的事件數
+    uint8_t idle_percent;     // 期間內核心休眠 (WFI) 的比例
+    uint8_t reserved[2];      // 0
+    tofis_sensor_counters_t sensor[TOFIS_MAX_SENSORS]; // 每個感測器
+    tofis_latency_desc_t latency[TOFIS_STAGE_COUNT];   // TOFIS_STAGE_*
+} tofis_telemetry_t;
+#pragma pack(pop)
+
+#define TOFIS_CMD_SYNC_BYTE_0 0xC3
+#define TOFIS_CMD_SYNC_BYTE_1 0x3C
+#define TOFIS_CMD_MAX_ARGS 8
+
+#define TOFIS_CMD_MAX_FRAME_SIZE                                               \
+    (sizeof(tofis_cmd_header_t) + TOFIS_PADDED_LENGTH(TOFIS_CMD_MAX_ARGS) + 4U)
+
+// 指令 id，括號內為韌體終端機的按鍵
+#define TOFIS_CMD_RESOLUTION 0x01     // ('r') 切換 4x4 / 8x8
+#define TOFIS_CMD_SIGNAL_AMBIENT 0x02 // ('s') 切換 signal 與 ambient
+#define TOFIS_CMD_FIELDS 0x03         // ('f') uint8_t TOFIS_FIELD_* mask
+#define TOFIS_CMD_TARGETS 0x04        // ('n') uint8_t 每個 zone 的 target 數
+#define TOFIS_CMD_TARGET_ORDER 0x05   // ('t') 切換 closest / strongest
+#define TOFIS_CMD_ERASE_CALIB 0x06    // ("erase") 清除校正資料
+#define TOFIS_CMD_I2C_USAGE 0x07      // ('i') 印出 I2C 使用率
+#define TOFIS_CMD_SENSORS 0x08        // ('m') uint8_t 感測器 mask
+#define TOFIS_CMD_FRAME_RATES 0x09    // ('p') 印出 frame rate
+#define TOFIS_CMD_CLEAR_SCREEN 0x0A   // ('c') 清除終端機畫面
+#define TOFIS_CMD_ADAPTIVE_RATE 0x0B  // ('a') uint8_t 1 自動調整，0 固定
+
+// tofis_config_desc_t.changes
+#define TOFIS_CONFIG_RESOLUTION (1U << 0)   // 4x4 / 8x8，重新啟動
+#define TOFIS_CONFIG_FIELDS (1U << 1)       // 傳送的 TOFIS_FIELD_*
+#define TOFIS_CONFIG_OUTPUTS (1U << 2)      // 讀取的區塊，重新啟動
+#define TOFIS_CONFIG_TARGETS (1U << 3)      // 每個 zone 的 target 數，重新啟動
+#define TOFIS_CONFIG_TARGET_ORDER (1U << 4) // closest / strongest，重新啟動
+#define TOFIS_CONFIG_SENSORS (1U << 5)      // 感測器啟動或停止
+#define TOFIS_CONFIG_RATE (1U << 6)         // 量測頻率、積分時間，重新啟動
+#define TOFIS_CONFIG_ENCODING (1U << 7)     // frame 的 TOFIS_ENCODING_*
+
+#define TOFIS_CONFIG_RESTART                                                   \
+    (TOFIS_CONFIG_RESOLUTION | TOFIS_CONFIG_OUTPUTS | TOFIS_CONFIG_TARGETS |   \
+     TOFIS_CONFIG_TARGET_ORDER | TOFIS_CONFIG_RATE)
+
+// ack status
+#define TOFIS_CMD_STATUS_OK 0x00
+#define TOFIS_CMD_STATUS_UNKNOWN 0x01  // 不支援的 id
+#define TOFIS_CMD_STATUS_BAD_ARGS 0x02 // 參數長度或數值錯誤
+#define TOFIS_CMD_STATUS_FAILED 0x03   // 感測器或 flash 存取失敗
+
+#define TOFIS_DELTA_ESCAPE 0x80
+
+// TOFIS_ENCODING_RAW 每個 zone 的大小 (NumberOfTargets 補齊至 4 bytes)
+#define TOFIS_RAW_ZONE_SIZE(targets) (4 + 16 * (targets))
+
+// 最大的 payload 為 TOFIS_MAX_TARGETS_PER_ZONE 個 target 的 raw frame
+#define TOFIS_MAX_PAYLOAD_SIZE                                                 \
+    (sizeof(tofis_raw_desc_t) + 4 +                                            \
+     RANGING_SENSOR_MAX_NB_ZONES *                                             \
+         TOFIS_RAW_ZONE_SIZE(TOFIS_MAX_TARGETS_PER_ZONE))
+
+// RANGING_SENSOR_Result_t 沒有的欄位
+typedef struct {
+    uint16_t spads; // TOFIS_FIELD_SPADS
+    uint16_t sigma[RANGING_SENSOR_NB_TARGET_PER_ZONE];      // [mm]
+    uint8_t reflectance[RANGING_SENSOR_NB_TARGET_PER_ZONE]; // [%]
+} tofis_zone_extra_t;
+
+// 解碼後交給使用者的 frame
 typedef struct {
-    uint8_t start_byte;           // Fixed to 0xAA
+    uint8_t version;              // TOFIS_PROTOCOL_VERSION
+    uint8_t encoding;             // TOFIS_ENCODING_*
+    uint16_t sequence;            // header sequence
+    uint8_t stream_count;         // header stream_count
+    uint8_t sensor;               // header sensor
+    uint8_t config_id;            // header config_id
+    uint32_t irq_time_us;         // header irq_time_us (MCU 時間)
+    uint32_t tx_time_us;          // header tx_time_us (MCU 時間)
+    uint64_t host_time_us;        // 收到 sync byte 的 host 時間
     uint8_t resolution;           // 4 or 8
-    uint8_t checksum;             // XOR checksum
-    uint8_t end_byte;             // Fixed to 0x55
+    uint8_t fields;               // TOFIS_FIELD_* 有效欄位
+    uint8_t targets;              // 每個 zone 有效的 target 數上限
+    int8_t temperature;           // TOFIS_FIELD_TEMPERATURE [degC]
     RANGING_SENSOR_Result_t data; // Data
-} tofis_data_packet_t;
+    tofis_zone_extra_t extra[RANGING_SENSOR_MAX_NB_ZONES];
+} tofis_frame_t;
@@ -0,0 +1,419 @@
+// tofis_decoder.c
+#include "tofis_decoder.h"
+#include <string.h>
+
+static uint16_t get_u16(const uint8_t *p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static size_t zone_header_size(uint8_t fields) {
+  size_t size = 1;
+  if (fields & TOFIS_FIELD_AMBIENT) {
+    size += 2;
+  }
+  if (fields & TOFIS_FIELD_SPADS) {
+    size += 2;
+  }
+  return size;
+}
+
+static size_t target_record_size(uint8_t fields) {
+  size_t size = 0;
+  if (fields & TOFIS_FIELD_DISTANCE) {
+    size += 2;
+  }
+  if (fields & TOFIS_FIELD_STATUS) {
+    size += 1;
+  }
+  if (fields & TOFIS_FIELD_SIGNAL) {
+    size += 2;
+  }
+  if (fields & TOFIS_FIELD_SIGMA) {
+    size += 2;
+  }
+  if (fields & TOFIS_FIELD_REFLECTANCE) {
+    size += 1;
+  }
+  return size;
+}
+
+// 解碼一個完整的 zone record，回傳下一個 record 位置，失敗回傳 NULL
+static const uint8_t *decode_zone(const uint8_t *p, const uint8_t *end,
+                                  const tofis_frame_desc_t *desc,
+                                  RANGING_SENSOR_ZoneResult_t *zone_result,
+                                  tofis_zone_extra_t *extra) {
+  size_t target_size = target_record_size(desc->fields);
+  float ambient = 0.0f;
+
+  if ((size_t)(end - p) < zone_header_size(desc->fields)) {
+    return NULL;
+  }
+
+  memset(zone_result, 0, sizeof(*zone_result));
+  memset(extra, 0, sizeof(*extra));
+
+  uint8_t nb_targets = *p++;
+  uint8_t records = (nb_targets < desc->targets) ? nb_targets : desc->targets;
+
+  if (desc->fields & TOFIS_FIELD_AMBIENT) {
+    ambient = (float)get_u16(p);
+    p += 2;
+  }
+  if (desc->fields & TOFIS_FIELD_SPADS) {
+    extra->spads = get_u16(p);
+    p += 2;
+  }
+
+  if ((size_t)(end - p) < records * target_size) {
+    return NULL;
+  }
+
+  zone_result->NumberOfTargets = nb_targets;
+
+  for (uint8_t t = 0; t < records; t++) {
+    // 超出 host 容量的 target 直接略過
+    if (t >= RANGING_SENSOR_NB_TARGET_PER_ZONE) {
+      p += target_size;
+      continue;
+    }
+
+    // ambient 為整個 zone 的值，與 BSP 相同複製到每個 target
+    zone_result->Ambient[t] = ambient;
+
+    if (desc->fields & TOFIS_FIELD_DISTANCE) {
+      // distance 為 int16，與 v1 的 uint32 轉換結果一致
+      zone_result->Distance[t] = (uint32_t)(int16_t)get_u16(p);
+      p += 2;
+    }
+    if (desc->fields & TOFIS_FIELD_STATUS) {
+      zone_result->Status[t] = *p++;
+    }
+    if (desc->fields & TOFIS_FIELD_SIGNAL) {
+      zone_result->Signal[t] = (float)get_u16(p);
+      p += 2;
+    }
+    if (desc->fields & TOFIS_FIELD_SIGMA) {
+      extra->sigma[t] = get_u16(p);
+      p += 2;
+    }
+    if (desc->fields & TOFIS_FIELD_REFLECTANCE) {
+      extra->reflectance[t] = *p++;
+    }
+  }
+
+  return p;
+}
+
+static const uint8_t *decode_desc(const uint8_t *p, const uint8_t *end,
+                                  tofis_frame_desc_t *desc,
+                                  tofis_frame_t *frame) {
+  if ((size_t)(end - p) < sizeof(tofis_frame_desc_t)) {
+    return NULL;
+  }
+
+  memcpy(desc, p, sizeof(*desc));
+  if (desc->zones > RANGING_SENSOR_MAX_NB_ZONES) {
+    return NULL;
+  }
+
+  frame->resolution = desc->resolution;
+  frame->fields = desc->fields;
+  frame->targets = (desc->targets < RANGING_SENSOR_NB_TARGET_PER_ZONE)
+                       ? desc->targets
+                       : RANGING_SENSOR_NB_TARGET_PER_ZONE;
+  frame->temperature = 0;
+  frame->data.NumberOfZones = desc->zones;
+  p += sizeof(*desc);
+
+  // frame 層級的欄位接在 descriptor 之後
+  if (desc->fields & TOFIS_FIELD_TEMPERATURE) {
+    if (p >= end) {
+      return NULL;
+    }
+    frame->temperature = (int8_t)*p++;
+  }
+
+  return p;
+}
+
+static int decode_compact(const uint8_t *payload, size_t length,
+                          tofis_frame_t *frame) {
+  const uint8_t *end = payload + length;
+  tofis_frame_desc_t desc;
+  const uint8_t *p = decode_desc(payload, end, &desc, frame);
+
+  if (p == NULL) {
+    return TOFIS_DECODE_ERROR;
+  }
+
+  for (uint8_t zone = 0; zone < desc.zones; zone++) {
+    p = decode_zone(p, end, &desc, &frame->data.ZoneResult[zone],
+                    &frame->extra[zone]);
+    if (p == NULL) {
+      return TOFIS_DECODE_ERROR;
+    }
+  }
+
+  return (p == end) ? TOFIS_DECODE_OK : TOFIS_DECODE_ERROR;
+}
+
+// 以參考 frame 為基礎套用變動的 zone
+static int decode_delta(const tofis_frame_t *reference, const uint8_t *payload,
+                        size_t length, tofis_frame_t *frame) {
+  const uint8_t *end = payload + length;
+  tofis_frame_desc_t desc;
+
+  *frame = *reference;
+
+  const uint8_t *p = decode_desc(payload, end, &desc, frame);
+  if (p == NULL || desc.zones != reference->data.NumberOfZones ||
+      desc.fields != reference->fields) {
+    return TOFIS_DECODE_ERROR;
+  }
+
+  size_t bitmap_size = (desc.zones + 7) / 8;
+  const uint8_t *bitmap = p;
+  if ((size_t)(end - p) < bitmap_size) {
+    return TOFIS_DECODE_ERROR;
+  }
+  p += bitmap_size;
+
+  for (uint8_t zone = 0; zone < desc.zones; zone++) {
+    RANGING_SENSOR_ZoneResult_t *zone_result = &frame->data.ZoneResult[zone];
+
+    if (!(bitmap[zone / 8] & (1U << (zone % 8)))) {
+      continue;
+    }
+
+    if (p >= end) {
+      return TOFIS_DECODE_ERROR;
+    }
+
+    if (*p == TOFIS_DELTA_ESCAPE) {
+      p = decode_zone(p + 1, end, &desc, zone_result, &frame->extra[zone]);
+      if (p == NULL) {
+        return TOFIS_DECODE_ERROR;
+      }
+      continue;
+    }
+
+    // 每個 target record 一個 int8 距離差值，其餘欄位不變
+    if (!(desc.fields & TOFIS_FIELD_DISTANCE)) {
+      return TOFIS_DECODE_ERROR;
+    }
+    uint8_t records = (zone_result->NumberOfTargets < desc.targets)
+                          ? zone_result->NumberOfTargets
+                          : desc.targets;
+    if ((size_t)(end - p) < records) {
+      return TOFIS_DECODE_ERROR;
+    }
+    for (uint8_t t = 0; t < records; t++) {
+      int8_t delta = (int8_t)*p++;
+      if (t < RANGING_SENSOR_NB_TARGET_PER_ZONE) {
+        int16_t distance = (int16_t)zone_result->Distance[t];
+        zone_result->Distance[t] = (uint32_t)(int16_t)(distance + delta);
+      }
+    }
+  }
+
+  return (p == end) ? TOFIS_DECODE_OK : TOFIS_DECODE_ERROR;
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+  return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 |
+         (uint32_t)p[3] << 24;
+}
+
+static uint32_t get_u32_be(const uint8_t *p) {
+  return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 |
+         (uint32_t)p[3];
+}
+
+// 讀取 raw desc，targets 為韌體的陣列長度，超出 host 容量者無法解碼
+static int decode_raw_desc(const uint8_t *payload, size_t length,
+                           tofis_raw_desc_t *desc, tofis_frame_t *frame) {
+  if (length < sizeof(*desc) + 4) {
+    return TOFIS_DECODE_ERROR;
+  }
+
+  memcpy(desc, payload, sizeof(*desc));
+  if (desc->targets == 0 ||
+      desc->targets > RANGING_SENSOR_NB_TARGET_PER_ZONE) {
+    return TOFIS_DECODE_ERROR;
+  }
+
+  frame->resolution = desc->resolution;
+  // raw 一律帶有 RANGING_SENSOR_Result_t 的所有欄位
+  frame->fields = TOFIS_FIELD_RAW;
+  frame->targets = desc->targets;
+  frame->temperature = 0;
+  memset(frame->extra, 0, sizeof(frame->extra));
+  memset(&frame->data, 0, sizeof(frame->data));
+  return TOFIS_DECODE_OK;
+}
+
+// 依韌體的陣列長度讀取一個 zone 的 Distance、Status、Ambient、Signal
+static const uint8_t *decode_raw_arrays(const uint8_t *p, uint8_t targets,
+                                        uint32_t (*get)(const uint8_t *),
+                                        RANGING_SENSOR_ZoneResult_t *result) {
+  uint32_t value;
+
+  for (uint8_t i = 0; i < targets; i++, p += 4) {
+    result->Distance[i] = get(p);
+  }
+  for (uint8_t i = 0; i < targets; i++, p += 4) {
+    result->Status[i] = get(p);
+  }
+  for (uint8_t i = 0; i < targets; i++, p += 4) {
+    value = get(p);
+    memcpy(&result->Ambient[i], &value, sizeof(value));
+  }
+  for (uint8_t i = 0; i < targets; i++, p += 4) {
+    value = get(p);
+    memcpy(&result->Signal[i], &value, sizeof(value));
+  }
+
+  return p;
+}
+
+// 韌體的 RANGING_SENSOR_Result_t 原樣傳送，一律帶有全部 64 個 zone
+static int decode_raw(const uint8_t *payload, size_t length,
+                      tofis_frame_t *frame) {
+  const uint8_t *p = payload + sizeof(tofis_raw_desc_t);
+  tofis_raw_desc_t desc;
+
+  if (decode_raw_desc(payload, length, &desc, frame) != TOFIS_DECODE_OK ||
+      length != sizeof(desc) + 4 +
+                    RANGING_SENSOR_MAX_NB_ZONES *
+                        TOFIS_RAW_ZONE_SIZE(desc.targets)) {
+    return TOFIS_DECODE_ERROR;
+  }
+
+  frame->data.NumberOfZones = get_u32(p);
+  p += 4;
+
+  if (frame->data.NumberOfZones > RANGING_SENSOR_MAX_NB_ZONES) {
+    return TOFIS_DECODE_ERROR;
+  }
+
+  for (uint32_t zone = 0; zone < frame->data.NumberOfZones; zone++) {
+    RANGING_SENSOR_ZoneResult_t *zone_result = &frame->data.ZoneResult[zone];
+
+    // NumberOfTargets 之後補齊至 4 bytes
+    zone_result->NumberOfTargets = *p;
+    p = decode_raw_arrays(p + 4, desc.targets, get_u32, zone_result);
+  }
+
+  return TOFIS_DECODE_OK;
+}
+
+static int decode_raw_be(const uint8_t *payload, size_t length,
+                         tofis_frame_t *frame) {
+  const uint8_t *p = payload + sizeof(tofis_raw_desc_t);
+  const uint8_t *end = payload + length;
+  tofis_raw_desc_t desc;
+
+  if (decode_raw_desc(payload, length, &desc, frame) != TOFIS_DECODE_OK) {
+    return TOFIS_DECODE_ERROR;
+  }
+
+  size_t zone_size = 1 + 16 * desc.targets;
+
+  frame->data.NumberOfZones = get_u32_be(p);
+  p += 4;
+
+  if (frame->data.NumberOfZones > RANGING_SENSOR_MAX_NB_ZONES ||
+      (size_t)(end - p) != frame->data.NumberOfZones * zone_size) {
+    return TOFIS_DECODE_ERROR;
+  }
+
+  for (uint32_t zone = 0; zone < frame->data.NumberOfZones; zone++) {
+    RANGING_SENSOR_ZoneResult_t *zone_result = &frame->data.ZoneResult[zone];
+
+    zone_result->NumberOfTargets = *p++;
+    p = decode_raw_arrays(p, desc.targets, get_u32_be, zone_result);
+  }
+
+  return TOFIS_DECODE_OK;
+}
+
+void tofis_decoder_reset(tofis_decoder_t *decoder) {
+  memset(decoder, 0, sizeof(*decoder));
+}
+
+static int decode_keyframe_or_delta(tofis_decoder_t *decoder,
+                                    const tofis_frame_header_t *header,
+                                    const uint8_t *payload,
+                                    tofis_frame_t *frame) {
+  tofis_delta_desc_t delta;
+  int ret;
+
+  if (header->length < sizeof(delta)) {
+    return TOFIS_DECODE_ERROR;
+  }
+  memcpy(&delta, payload, sizeof(delta));
+  payload += sizeof(delta);
+
+  if (header->encoding == TOFIS_ENCODING_KEYFRAME) {
+    ret = decode_compact(payload, header->length - sizeof(delta), frame);
+  } else {
+    // 參考 frame 必須是同一個 keyframe 之後的前一個 frame
+    if (!decoder->valid || delta.key_id != decoder->key_id ||
+        delta.index != (uint8_t)(decoder->index + 1)) {
+      decoder->valid = 0;
+      return TOFIS_DECODE_RESYNC;
+    }
+    ret = decode_delta(&decoder->reference, payload,
+                       header->length - sizeof(delta), frame);
+  }
+
+  if (ret != TOFIS_DECODE_OK) {
+    decoder->valid = 0;
+    return ret;
+  }
+
+  decoder->reference = *frame;
+  decoder->key_id = delta.key_id;
+  decoder->index = delta.index;
+  decoder->valid = 1;
+  return TOFIS_DECODE_OK;
+}
+
+int tofis_decode_payload(tofis_decoder_t *decoder,
+                         const tofis_frame_header_t *header,
+                         const uint8_t *payload, tofis_frame_t *frame) {
+  int ret;
+
+  switch (header->encoding) {
+  case TOFIS_ENCODING_COMPACT:
+    ret = decode_compact(payload, header->length, frame);
+    break;
+
+  case TOFIS_ENCODING_KEYFRAME:
+  case TOFIS_ENCODING_DELTA:
+    ret = decode_keyframe_or_delta(decoder, header, payload, frame);
+    break;
+
+  case TOFIS_ENCODING_RAW:
+    ret = decode_raw(payload, header->length, frame);
+    break;
+
+  case TOFIS_ENCODING_RAW_BE:
+    ret = decode_raw_be(payload, header->length, frame);
+    break;
+
+  default:
+    return TOFIS_DECODE_ERROR;
+  }
+
+  // delta 會從參考 frame 複製，header 資訊最後再填
+  frame->version = header->version;
+  frame->encoding = header->encoding;
+  frame->sequence = header->sequence;
+  frame->stream_count = header->stream_count;
+  frame->sensor = header->sensor;
+  frame->config_id = header->config_id;
+  frame->irq_time_us = header->irq_time_us;
+  frame->tx_time_us = header->tx_time_us;
+  return ret;
+}
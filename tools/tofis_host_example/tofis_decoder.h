@@ -0,0 +1,27 @@
+// tofis_decoder.h
+#pragma once
+
+#include "tofis_data.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// 解碼結果
+#define TOFIS_DECODE_OK 0
+#define TOFIS_DECODE_ERROR -1  // payload 格式錯誤
+#define TOFIS_DECODE_RESYNC -2 // delta 缺少參考 frame，等待下一個 keyframe
+
+// 解碼器狀態（delta 模式的參考 frame），每個感測器各用一個
+typedef struct {
+  tofis_frame_t reference;
+  uint8_t key_id;
+  uint8_t index;
+  uint8_t valid;
+} tofis_decoder_t;
+
+// 重置解碼器，之後的 delta 會被丟棄直到下一個 keyframe
+void tofis_decoder_reset(tofis_decoder_t *decoder);
+
+// 將 frame 的 payload 解碼為 tofis_frame_t，回傳 TOFIS_DECODE_*
+int tofis_decode_payload(tofis_decoder_t *decoder,
+                         const tofis_frame_header_t *header,
+                         const uint8_t *payload, tofis_frame_t *frame);
@@ -0,0 +1,257 @@
+// tofis_frame_hub.c
+#include "tofis_frame_hub.h"
+#include <string.h>
+
+#define QUEUE_MASK (TOFIS_HUB_QUEUE_DEPTH - 1U)
+
+_Static_assert((TOFIS_HUB_QUEUE_DEPTH & QUEUE_MASK) == 0,
+               "TOFIS_HUB_QUEUE_DEPTH must be a power of two");
+
+#ifdef _WIN32
+#define hub_lock(hub) AcquireSRWLockExclusive(&(hub)->lock)
+#define hub_unlock(hub) ReleaseSRWLockExclusive(&(hub)->lock)
+#define hub_wait(hub) SleepConditionVariableSRW(&(hub)->cond, &(hub)->lock, INFINITE, 0)
+#define hub_broadcast(hub) WakeAllConditionVariable(&(hub)->cond)
+#else
+#define hub_lock(hub) pthread_mutex_lock(&(hub)->lock)
+#define hub_unlock(hub) pthread_mutex_unlock(&(hub)->lock)
+#define hub_wait(hub) pthread_cond_wait(&(hub)->cond, &(hub)->lock)
+#define hub_broadcast(hub) pthread_cond_broadcast(&(hub)->cond)
+#endif
+
+static void frame_ref(tofis_hub_frame_t *frame) {
+  atomic_fetch_add_explicit(&frame->refs, 1, memory_order_relaxed);
+}
+
+static void frame_unref(tofis_hub_frame_t *frame) {
+  atomic_fetch_sub_explicit(&frame->refs, 1, memory_order_acq_rel);
+}
+
+static size_t queue_length(tofis_consumer_t *consumer) {
+  return atomic_load_explicit(&consumer->head, memory_order_acquire) -
+         atomic_load_explicit(&consumer->tail, memory_order_acquire);
+}
+
+// 取出最舊的 frame，與另一端同時取出時以 CAS 決定誰拿到
+static tofis_hub_frame_t *queue_pop(tofis_consumer_t *consumer) {
+  size_t tail = atomic_load_explicit(&consumer->tail, memory_order_acquire);
+
+  while (tail != atomic_load_explicit(&consumer->head, memory_order_acquire)) {
+    tofis_hub_frame_t *item = atomic_load_explicit(
+        &consumer->items[tail & QUEUE_MASK], memory_order_acquire);
+
+    // 成功推進 tail 前，slot 不會被覆寫
+    if (atomic_compare_exchange_weak_explicit(&consumer->tail, &tail, tail + 1,
+                                              memory_order_acq_rel,
+                                              memory_order_acquire)) {
+      return item;
+    }
+  }
+
+  return NULL;
+}
+
+void tofis_hub_init(tofis_frame_hub_t *hub) {
+  memset(hub, 0, sizeof(*hub));
+  for (int i = 0; i < TOFIS_HUB_POOL_SIZE; i++) {
+    atomic_init(&hub->pool[i].refs, 0);
+  }
+#ifdef _WIN32
+  InitializeSRWLock(&hub->lock);
+  InitializeConditionVariable(&hub->cond);
+#else
+  pthread_mutex_init(&hub->lock, NULL);
+  pthread_cond_init(&hub->cond, NULL);
+#endif
+}
+
+void tofis_hub_close(tofis_frame_hub_t *hub) {
+  hub_lock(hub);
+  hub->closed = 1;
+  hub_broadcast(hub);
+  hub_unlock(hub);
+}
+
+void tofis_hub_destroy(tofis_frame_hub_t *hub) {
+#ifndef _WIN32
+  pthread_cond_destroy(&hub->cond);
+  pthread_mutex_destroy(&hub->lock);
+#else
+  (void)hub;
+#endif
+}
+
+tofis_frame_t *tofis_hub_reserve(tofis_frame_hub_t *hub) {
+  if (hub->writing != NULL) {
+    return &hub->writing->frame;
+  }
+
+  for (int i = 0; i < TOFIS_HUB_POOL_SIZE; i++) {
+    if (atomic_load_explicit(&hub->pool[i].refs, memory_order_acquire) == 0) {
+      hub->writing = &hub->pool[i];
+      return &hub->writing->frame;
+    }
+  }
+
+  return NULL;
+}
+
+// 將 frame 放入消費者的 ring 並為它加一個引用，依 policy 處理已滿的情況，
+// hub->lock 已鎖定。等待時鎖會釋放，消費者可能在其間取消訂閱或重新訂閱
+static void queue_push(tofis_frame_hub_t *hub, tofis_consumer_t *consumer,
+                       tofis_hub_frame_t *frame) {
+  size_t head = atomic_load_explicit(&consumer->head, memory_order_relaxed);
+
+  while (head - atomic_load_explicit(&consumer->tail, memory_order_acquire) >=
+         TOFIS_HUB_QUEUE_DEPTH) {
+    if (consumer->policy == TOFIS_POLICY_BLOCK) {
+      atomic_fetch_add_explicit(&consumer->blocked, 1, memory_order_relaxed);
+      hub_wait(hub);
+      if (hub->closed || !consumer->active) {
+        return;
+      }
+      // 重新訂閱時 ring 已清空
+      head = atomic_load_explicit(&consumer->head, memory_order_relaxed);
+      continue;
+    }
+
+    // 消費者可能同時取走最舊的 frame，只有取出成功才算丟棄
+    tofis_hub_frame_t *oldest = queue_pop(consumer);
+    if (oldest != NULL) {
+      frame_unref(oldest);
+      atomic_fetch_add_explicit(&consumer->dropped, 1, memory_order_relaxed);
+    }
+  }
+
+  // 消費者可能在 head 推進後立刻歸還
+  frame_ref(frame);
+  atomic_store_explicit(&consumer->items[head & QUEUE_MASK], frame,
+                        memory_order_release);
+  atomic_store_explicit(&consumer->head, head + 1, memory_order_release);
+
+  uint32_t lag = (uint32_t)queue_length(consumer);
+  if (lag > atomic_load_explicit(&consumer->max_lag, memory_order_relaxed)) {
+    atomic_store_explicit(&consumer->max_lag, lag, memory_order_relaxed);
+  }
+}
+
+void tofis_hub_publish(tofis_frame_hub_t *hub) {
+  tofis_hub_frame_t *frame = hub->writing;
+
+  if (frame == NULL) {
+    return;
+  }
+  hub->writing = NULL;
+
+  // 接收線程持有一個引用直到分發完，等待 BLOCK 消費者時訂閱可能改變，
+  // 引用數只依實際放入的消費者計算
+  atomic_store_explicit(&frame->refs, 1, memory_order_relaxed);
+  hub_lock(hub);
+  for (int i = 0; i < TOFIS_HUB_MAX_CONSUMERS && !hub->closed; i++) {
+    if (hub->consumers[i].active) {
+      queue_push(hub, &hub->consumers[i], frame);
+    }
+  }
+  hub_broadcast(hub);
+  hub_unlock(hub);
+  frame_unref(frame);
+}
+
+tofis_consumer_t *tofis_hub_subscribe(tofis_frame_hub_t *hub,
+                                      tofis_policy_t policy) {
+  tofis_consumer_t *consumer = NULL;
+
+  hub_lock(hub);
+  for (int i = 0; i < TOFIS_HUB_MAX_CONSUMERS; i++) {
+    if (!hub->consumers[i].active) {
+      consumer = &hub->consumers[i];
+      memset(consumer, 0, sizeof(*consumer));
+      consumer->policy = policy;
+      consumer->active = 1;
+      break;
+    }
+  }
+  hub_unlock(hub);
+
+  return consumer;
+}
+
+void tofis_hub_unsubscribe(tofis_frame_hub_t *hub,
+                           tofis_consumer_t *consumer) {
+  tofis_hub_frame_t *frame;
+
+  hub_lock(hub);
+  consumer->active = 0;
+  while ((frame = queue_pop(consumer)) != NULL) {
+    frame_unref(frame);
+  }
+  if (consumer->borrowed != NULL) {
+    frame_unref(consumer->borrowed);
+    consumer->borrowed = NULL;
+  }
+  // 接收線程可能正等待這個 BLOCK 消費者
+  hub_broadcast(hub);
+  hub_unlock(hub);
+}
+
+const tofis_frame_t *tofis_hub_borrow(tofis_frame_hub_t *hub,
+                                      tofis_consumer_t *consumer, int wait) {
+  tofis_hub_frame_t *frame;
+
+  tofis_hub_release(hub, consumer);
+
+  while ((frame = queue_pop(consumer)) == NULL) {
+    if (!wait) {
+      return NULL;
+    }
+    hub_lock(hub);
+    while (queue_length(consumer) == 0 && !hub->closed) {
+      hub_wait(hub);
+    }
+    int closed = hub->closed;
+    hub_unlock(hub);
+    if (closed) {
+      return NULL;
+    }
+  }
+
+  // LATEST_ONLY 略過較舊的 frame
+  if (consumer->policy == TOFIS_POLICY_LATEST_ONLY) {
+    tofis_hub_frame_t *newer;
+    while ((newer = queue_pop(consumer)) != NULL) {
+      frame_unref(frame);
+      frame = newer;
+      atomic_fetch_add_explicit(&consumer->dropped, 1, memory_order_relaxed);
+    }
+  }
+
+  if (consumer->policy == TOFIS_POLICY_BLOCK) {
+    // 接收線程可能在等待空間
+    hub_lock(hub);
+    hub_broadcast(hub);
+    hub_unlock(hub);
+  }
+
+  atomic_fetch_add_explicit(&consumer->delivered, 1, memory_order_relaxed);
+  consumer->borrowed = frame;
+  return &frame->frame;
+}
+
+void tofis_hub_release(tofis_frame_hub_t *hub, tofis_consumer_t *consumer) {
+  (void)hub;
+  if (consumer->borrowed != NULL) {
+    frame_unref(consumer->borrowed);
+    consumer->borrowed = NULL;
+  }
+}
+
+void tofis_hub_get_stats(const tofis_consumer_t *consumer,
+                         tofis_consumer_stats_t *stats) {
+  tofis_consumer_t *c = (tofis_consumer_t *)consumer;
+
+  stats->delivered = atomic_load(&c->delivered);
+  stats->dropped = atomic_load(&c->dropped);
+  stats->blocked = atomic_load(&c->blocked);
+  stats->lag = (uint32_t)queue_length(c);
+  stats->max_lag = atomic_load(&c->max_lag);
+}
@@ -0,0 +1,103 @@
+// tofis_frame_hub.h
+#pragma once
+
+#include "tofis_data.h"
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#define TOFIS_HUB_MAX_CONSUMERS 8
+// 每個消費者最多排隊的 frame 數（2 的次方）
+#define TOFIS_HUB_QUEUE_DEPTH 16
+// 排隊中的 frame 都在最近 QUEUE_DEPTH 個之內，再加上每個消費者借用一個、
+// 接收線程寫入一個，frame 池永遠有空的 frame
+#define TOFIS_HUB_POOL_SIZE (TOFIS_HUB_QUEUE_DEPTH + TOFIS_HUB_MAX_CONSUMERS + 1)
+
+typedef enum {
+  TOFIS_POLICY_BLOCK,       // 佇列滿時接收線程等待此消費者（影響所有消費者）
+  TOFIS_POLICY_DROP_OLDEST, // 佇列滿時丟棄此消費者最舊的 frame
+  TOFIS_POLICY_LATEST_ONLY, // 每次只取最新的 frame，其餘略過
+} tofis_policy_t;
+
+typedef struct {
+  uint64_t delivered; // 已借出的 frame
+  uint64_t dropped;   // 丟棄或略過的 frame
+  uint64_t blocked;   // 讓接收線程等待的次數（BLOCK）
+  uint32_t lag;       // 已發布但尚未取走的 frame
+  uint32_t max_lag;
+} tofis_consumer_stats_t;
+
+// frame 池中的 frame，refs 為仍持有它的消費者數
+typedef struct {
+  tofis_frame_t frame;
+  _Atomic int refs;
+} tofis_hub_frame_t;
+
+// 每個消費者一個 frame 指標的 ring，接收線程寫入 head，
+// 消費者與 DROP_OLDEST 的接收線程以 CAS 推進 tail
+typedef struct {
+  int active;
+  tofis_policy_t policy;
+  _Atomic(tofis_hub_frame_t *) items[TOFIS_HUB_QUEUE_DEPTH];
+  _Atomic size_t head;
+  _Atomic size_t tail;
+  tofis_hub_frame_t *borrowed; // 只由消費者線程存取
+  _Atomic uint64_t delivered;
+  _Atomic uint64_t dropped;
+  _Atomic uint64_t blocked;
+  _Atomic uint32_t max_lag;
+} tofis_consumer_t;
+
+// 一個生產者（接收線程）、多個消費者的 frame 分發器。frame 只解碼一次，
+// 各消費者借用同一份 frame，互不複製也不互相影響（BLOCK 除外）
+typedef struct {
+  tofis_hub_frame_t pool[TOFIS_HUB_POOL_SIZE];
+  tofis_hub_frame_t *writing;
+  tofis_consumer_t consumers[TOFIS_HUB_MAX_CONSUMERS];
+  int closed;
+  // 只用於訂閱變更與等待，frame 的交付不經過鎖
+#ifdef _WIN32
+  SRWLOCK lock;
+  CONDITION_VARIABLE cond;
+#else
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+#endif
+} tofis_frame_hub_t;
+
+void tofis_hub_init(tofis_frame_hub_t *hub);
+
+// 喚醒所有等待中的線程，之後 borrow 不再等待
+void tofis_hub_close(tofis_frame_hub_t *hub);
+
+void tofis_hub_destroy(tofis_frame_hub_t *hub);
+
+// 生產者：取得可解碼的 frame
+tofis_frame_t *tofis_hub_reserve(tofis_frame_hub_t *hub);
+
+// 生產者：把 reserve 取得的 frame 交給所有消費者
+void tofis_hub_publish(tofis_frame_hub_t *hub);
+
+// 新增消費者，已滿時回傳 NULL
+tofis_consumer_t *tofis_hub_subscribe(tofis_frame_hub_t *hub,
+                                      tofis_policy_t policy);
+
+// 移除消費者並釋放它持有的 frame，呼叫前需停止使用該消費者
+void tofis_hub_unsubscribe(tofis_frame_hub_t *hub, tofis_consumer_t *consumer);
+
+// 消費者：借用下一個 frame（自動歸還上一個），wait 為 0 且沒有 frame 時、
+// 或 hub 已關閉時回傳 NULL
+const tofis_frame_t *tofis_hub_borrow(tofis_frame_hub_t *hub,
+                                      tofis_consumer_t *consumer, int wait);
+
+// 消費者：歸還借用中的 frame
+void tofis_hub_release(tofis_frame_hub_t *hub, tofis_consumer_t *consumer);
+
+void tofis_hub_get_stats(const tofis_consumer_t *consumer,
+                         tofis_consumer_stats_t *stats);
@@ -1,8 +1,12 @@
 // tofis_host_api.c
 #include "tofis_host_api.h"
 #include "checksum.h"
+#include "tofis_decoder.h"
 #include "tofis_host_serial.h"
+#include "tofis_frame_hub.h"
 #include "tofis_input_parser.h"
+#include "tofis_stream_parser.h"
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -11,23 +15,223 @@
 #include <windows.h>
 #else
 #include <pthread.h>
+#include <time.h>
 #include <unistd.h>
 #endif
 
 #include <stdbool.h>
 
-// 定義一個 mutex 和 condition variable 來同步數據
+static SerialPort serial_port;
+// frame 只解碼一次，經由 hub 交給所有消費者
+static tofis_frame_hub_t hub;
+static tofis_consumer_t *default_consumer;
+static tofis_policy_t default_policy = TOFIS_POLICY_LATEST_ONLY;
+// 每個感測器的 delta 參考 frame 各自獨立
+static tofis_decoder_t decoders[TOFIS_MAX_SENSORS];
+static tofis_parser_t parser;
+static tofis_host_stats_t stats;
+static uint16_t last_sequence;
+// 等待中的指令 (id << 8 | sequence)，-1 為沒有，收到對應的 ack 時由接收線程
+// 寫入 ack_status
+static volatile int pending_ack = -1;
+static volatile int ack_status = -1;
+// 最近一次的設定變更
+static tofis_config_desc_t config;
+static uint64_t configs_received;
+static tofis_telemetry_t telemetry;
+static uint64_t telemetry_received;
+// 前一個 telemetry 與兩者的 MCU 時間，計算讀取的 frame 率
+static tofis_telemetry_t previous_telemetry;
+static uint32_t telemetry_time_us;
+static uint32_t previous_telemetry_time_us;
+
+// Welford 累計平均與變異數
+typedef struct {
+  uint64_t count;
+  double mean;
+  double m2;
+} running_stat_t;
+
+// 每個感測器的時序，streamcount 與 irq 時間只在同一感測器內連續
+typedef struct {
+  uint64_t frames;
+  uint64_t skipped_sensor_frames;
+  uint8_t last_stream_count;
+  uint16_t last_sequence;
+  uint64_t last_received; // 上一個 frame 時的 stats.frames_received
+  uint32_t last_irq_time_us;
+  uint64_t mcu_time_us;   // 展開 32-bit 溢位後的 irq 時間
+  uint64_t first_mcu_time_us;
+  double min_offset_us;
+  uint32_t mcu_latency_max_us;
+  uint8_t config_id;
+  uint32_t config_gap_us; // 設定變更前後兩個 frame 的 irq 間隔
+  running_stat_t period;
+  running_stat_t mcu_latency;
+  running_stat_t offset;
+} sensor_timing_t;
+
+static sensor_timing_t timing[TOFIS_MAX_SENSORS];
+
+static void running_stat_add(running_stat_t *stat, double value) {
+  double delta = value - stat->mean;
+
+  stat->count++;
+  stat->mean += delta / (double)stat->count;
+  stat->m2 += delta * (value - stat->mean);
+}
+
+static double running_stat_stddev(const running_stat_t *stat) {
+  return (stat->count > 1) ? sqrt(stat->m2 / (double)(stat->count - 1)) : 0.0;
+}
+
+// host 的單調時鐘 (us)
+static uint64_t host_time_us(void) {
 #ifdef _WIN32
-static HANDLE data_mutex;
-static HANDLE data_cond;
+  LARGE_INTEGER frequency, counter;
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&counter);
+  return (uint64_t)(counter.QuadPart / frequency.QuadPart) * 1000000ULL +
+         (uint64_t)(counter.QuadPart % frequency.QuadPart) * 1000000ULL /
+             (uint64_t)frequency.QuadPart;
 #else
-static pthread_mutex_t data_mutex_p = PTHREAD_MUTEX_INITIALIZER;
-static pthread_cond_t data_cond_p = PTHREAD_COND_INITIALIZER;
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000ULL + (uint64_t)now.tv_nsec / 1000ULL;
 #endif
+}
 
-static SerialPort serial_port;
-static bool data_ready = false;
-static tofis_data_packet_t latest_packet;
+// 以 header 的 MCU 時間戳更新該感測器的時序統計
+static void update_timing(const tofis_frame_header_t *header,
+                          uint64_t received_us) {
+  sensor_timing_t *t = &timing[header->sensor];
+  uint32_t mcu_latency = header->tx_time_us - header->irq_time_us;
+
+  if (t->frames != 0) {
+    uint8_t stream_gap = (uint8_t)(header->stream_count - t->last_stream_count);
+    uint32_t elapsed = header->irq_time_us - t->last_irq_time_us;
+    // 有送出 (含 MCU 端丟棄) 的 frame 都佔一個 sequence，扣除期間收到的
+    // 其他感測器 frame 後，為此感測器最多送出的 frame 數
+    uint16_t sequence_gap =
+        (uint16_t)(header->sequence - t->last_sequence) -
+        (uint16_t)(stats.frames_received - t->last_received - 1);
+
+    // streamcount 多出來的部分是 sensor 量到但 MCU 沒處理的 frame
+    if (stream_gap > sequence_gap) {
+      t->skipped_sensor_frames += stream_gap - sequence_gap;
+    }
+    if (stream_gap != 0) {
+      running_stat_add(&t->period, (double)elapsed / stream_gap);
+    }
+    t->mcu_time_us += elapsed;
+    if (header->config_id != t->config_id) {
+      t->config_gap_us = elapsed;
+    }
+  } else {
+    t->mcu_time_us = header->irq_time_us;
+    t->first_mcu_time_us = t->mcu_time_us;
+  }
+
+  t->config_id = header->config_id;
+  t->last_stream_count = header->stream_count;
+  t->last_sequence = header->sequence;
+  t->last_received = stats.frames_received;
+  t->last_irq_time_us = header->irq_time_us;
+  t->frames++;
+
+  running_stat_add(&t->mcu_latency, (double)mcu_latency);
+  if (mcu_latency > t->mcu_latency_max_us) {
+    t->mcu_latency_max_us = mcu_latency;
+  }
+
+  // 兩邊時鐘的差值 = 固定偏移 + 延遲，最小值視為零延遲的基準
+  double offset = (double)(int64_t)(received_us - t->mcu_time_us);
+  if (t->offset.count == 0 || offset < t->min_offset_us) {
+    t->min_offset_us = offset;
+  }
+  running_stat_add(&t->offset, offset);
+}
+
+// 處理一個 CRC 正確的 frame（received_us 為讀到其最後一段資料的時間）
+static int handle_frame(const tofis_frame_header_t *header,
+                        const uint8_t *payload, uint64_t received_us,
+                        tofis_frame_t *frame) {
+  size_t padded = TOFIS_PADDED_LENGTH(header->length);
+
+  // 以 sequence 計算遺失的 frame 數
+  uint16_t sequence_gap = (uint16_t)(header->sequence - last_sequence);
+  if (stats.frames_received != 0) {
+    stats.dropped_frames += (uint16_t)(sequence_gap - 1);
+  }
+  last_sequence = header->sequence;
+  stats.frames_received++;
+
+  if (header->sensor >= TOFIS_MAX_SENSORS) {
+    stats.decode_errors++;
+    return -1;
+  }
+
+  // ack 佔用 sequence 但不是感測器的 frame，不發布
+  if (header->encoding == TOFIS_ENCODING_ACK) {
+    tofis_cmd_ack_t ack;
+    if (header->length != sizeof(ack)) {
+      stats.decode_errors++;
+      return -1;
+    }
+    memcpy(&ack, payload, sizeof(ack));
+    if (pending_ack == ((ack.id << 8) | ack.sequence)) {
+      ack_status = ack.status;
+    }
+    return -1;
+  }
+  // 設定變更的通知，其後的 frame 才使用新設定
+  if (header->encoding == TOFIS_ENCODING_CONFIG) {
+    if (header->length != sizeof(config)) {
+      stats.decode_errors++;
+      return -1;
+    }
+    memcpy(&config, payload, sizeof(config));
+    configs_received++;
+    return -1;
+  }
+  // 韌體的錯誤計數與各階段延遲
+  if (header->encoding == TOFIS_ENCODING_TELEMETRY) {
+    if (header->length != sizeof(telemetry)) {
+      stats.decode_errors++;
+      return -1;
+    }
+    previous_telemetry = telemetry;
+    previous_telemetry_time_us = telemetry_time_us;
+    memcpy(&telemetry, payload, sizeof(telemetry));
+    telemetry_time_us = header->irq_time_us;
+    telemetry_received++;
+    return -1;
+  }
+  update_timing(header, received_us);
+
+  // 遺失或損壞的 frame 由 delta 的 key_id/index 檢查發現，不必重置解碼器
+  int ret =
+      tofis_decode_payload(&decoders[header->sensor], header, payload, frame);
+  frame->host_time_us = received_us;
+  if (ret == TOFIS_DECODE_RESYNC) {
+    stats.resync_drops++;
+    return -1;
+  }
+  if (ret != TOFIS_DECODE_OK) {
+#ifdef TOFIS_API_DEBUG
+    printf("Error: Unable to decode payload (encoding 0x%02X).\n",
+           header->encoding);
+#endif
+    stats.decode_errors++;
+    return -1;
+  }
+
+  if (header->encoding < TOFIS_ENCODING_COUNT) {
+    stats.frames[header->encoding]++;
+    stats.bytes[header->encoding] += sizeof(*header) + padded;
+  }
+  return 0;
+}
 
 // 接收線程函數
 #ifdef _WIN32
@@ -35,86 +239,36 @@ DWORD WINAPI receive_thread_func(LPVOID lpParam) {
 #else
 static void *receive_thread_func(void *arg) {
 #endif
-  while (1) {
-    // 讀取 header（4 bytes）
-    uint8_t header[4];
-    int bytes_read = read_serial(&serial_port, header, 4);
-    if (bytes_read < 4) {
-#ifdef TOFIS_API_DEBUG
-      printf("Error: Unable to read header from serial port.\n");
-#endif
-      continue;
-    }
+  // frame 池耗盡時仍需解碼，delta 的參考 frame 才會連續
+  static tofis_frame_t scratch;
 
-    // 驗證 start_byte 和 end_byte
-    if (header[0] != 0xAA || header[3] != 0x55) {
+  while (1) {
+    // 一次讀入 ring buffer 所有可用的連續空間
+    size_t space;
+    uint8_t *dst = tofis_parser_write_ptr(&parser, &space);
+    int bytes_read = read_serial(&serial_port, dst, space);
+    if (bytes_read <= 0) {
 #ifdef TOFIS_API_DEBUG
-      printf("Error: Invalid start or end byte. Received: 0x%02X ... 0x%02X\n",
-             header[0], header[3]);
+      printf("Error: Unable to read from serial port.\n");
 #endif
       continue;
     }
-
-    uint8_t resolution = header[1];
-    uint8_t received_checksum = header[2];
-
-    // 根據 resolution 計算 RANGING_SENSOR_Result_t 的大小
-    size_t data_size = sizeof(RANGING_SENSOR_Result_t);
-    uint8_t *data_buffer = (uint8_t *)malloc(data_size);
-    if (data_buffer == NULL) {
-      printf("Error: Memory allocation failed.\n");
-      break;
-    }
-
-    // 讀取數據部分
-    bytes_read = read_serial(&serial_port, data_buffer, data_size);
-    if (bytes_read < data_size) {
-      printf("Error: Unable to read data from serial port.\n");
-      free(data_buffer);
-      continue;
-    }
-
-    // 計算 checksum，從 data 開始
-    uint8_t calculated_checksum = calculate_checksum(data_buffer, data_size);
-    if (calculated_checksum != received_checksum) {
-      printf("Error: Checksum mismatch. Calculated: 0x%02X, Received: 0x%02X\n",
-             calculated_checksum, received_checksum);
-      free(data_buffer);
-      continue;
+    uint64_t received_us = host_time_us();
+    tofis_parser_commit(&parser, (size_t)bytes_read);
+
+    tofis_frame_header_t header;
+    const uint8_t *payload;
+    while (tofis_parser_next(&parser, &header, &payload)) {
+      // 直接解碼進 hub 的 frame，解碼失敗的 frame 不發布並於下次重用
+      tofis_frame_t *frame = tofis_hub_reserve(&hub);
+      bool pooled = (frame != NULL);
+      if (!pooled) {
+        frame = &scratch;
+      }
+      if (handle_frame(&header, payload, received_us, frame) == 0 && pooled) {
+        tofis_hub_publish(&hub);
+      }
     }
-
-    // 將數據轉換為結構體
-    RANGING_SENSOR_Result_t result;
-    memcpy(&result, data_buffer, data_size);
-    free(data_buffer);
-
-    // 更新 Profile 參數（根據具體需求進行設置）
-    // 這裡假設您有某種方式來設置 Profile，這裡僅作示例
-    // Profile 的定義應在主程序中或全局變數中定義
-    // 此處不處理 Profile 的設定，因為 print_result 會使用全局 Profile
-
-    // 構建完整的數據包
-    tofis_data_packet_t packet;
-    packet.start_byte = header[0];
-    packet.resolution = resolution;
-    packet.checksum = received_checksum;
-    packet.end_byte = header[3];
-    memcpy(&packet.data, &result, sizeof(RANGING_SENSOR_Result_t));
-
-    // 更新最新數據包並通知主線程
-#ifdef _WIN32
-    WaitForSingleObject(data_mutex, INFINITE);
-    latest_packet = packet;
-    data_ready = true;
-    ReleaseMutex(data_mutex);
-    SetEvent(data_cond);
-#else
-    pthread_mutex_lock(&data_mutex_p);
-    latest_packet = packet;
-    data_ready = true;
-    pthread_cond_signal(&data_cond_p);
-    pthread_mutex_unlock(&data_mutex_p);
-#endif
   }
 
 #ifdef _WIN32
@@ -132,19 +286,69 @@ static pthread_t receive_thread_p;
 static pthread_t input_thread_p;
 #endif
 
+static void sleep_ms(unsigned int ms) {
 #ifdef _WIN32
-DWORD WINAPI user_input_thread_func(LPVOID lpParam) {
+  Sleep(ms);
 #else
-static void *user_input_thread_func(void *arg) {
+  usleep(ms * 1000U);
 #endif
+}
+
+int tofis_host_api_send_command(uint8_t id, const uint8_t *args,
+                                uint8_t length) {
+  // 從時間取起始值，重新執行時不會與韌體記住的上一個指令相同
+  static uint8_t sequence;
+  static bool seeded = false;
+  uint8_t frame[TOFIS_CMD_MAX_FRAME_SIZE];
+  tofis_cmd_header_t header = {{TOFIS_CMD_SYNC_BYTE_0, TOFIS_CMD_SYNC_BYTE_1},
+                               id, 0, length, {0, 0, 0}};
+
+  if (length > TOFIS_CMD_MAX_ARGS) {
+    return -1;
+  }
+  if (!seeded) {
+    sequence = (uint8_t)(host_time_us() / 1000);
+    seeded = true;
+  }
+  header.sequence = sequence++;
+
+  size_t size = sizeof(header) + TOFIS_PADDED_LENGTH(length);
+  memset(frame, 0, sizeof(frame));
+  memcpy(frame, &header, sizeof(header));
+  if (length != 0) {
+    memcpy(frame + sizeof(header), args, length);
+  }
+  uint32_t crc = crc32_update(TOFIS_CRC32_INIT, frame, size);
+  memcpy(frame + size, &crc, sizeof(crc));
+  size += sizeof(crc);
+
+  for (int attempt = 0; attempt < TOFIS_CMD_RETRIES; attempt++) {
+    ack_status = -1;
+    pending_ack = (id << 8) | header.sequence;
+    if (write_serial(&serial_port, frame, size) < 0) {
+      break;
+    }
+    for (int waited = 0; waited < TOFIS_CMD_ACK_TIMEOUT_MS; waited += 10) {
+      sleep_ms(10);
+      if (ack_status >= 0) {
+        pending_ack = -1;
+        return ack_status;
+      }
+    }
+  }
+
+  pending_ack = -1;
+  return -1;
+}
 
 #ifdef _WIN32
-  SerialPort *port = (SerialPort *)lpParam; // 傳入的串列埠結構
+DWORD WINAPI user_input_thread_func(LPVOID lpParam) {
 #else
-  SerialPort *port = (SerialPort *)arg; // 傳入的串列埠結構
+static void *user_input_thread_func(void *arg) {
 #endif
+  static const char *status_names[] = {"ok", "unknown command",
+                                       "bad arguments", "failed"};
   char user_input_section[TOFIS_USER_INPUT_BUF_SIZE];
-  uint8_t to_tofis_buf[TOFIS_USER_INPUT_BUF_SIZE];
 
   while (1) {
     printf("Enter command: ");
@@ -155,16 +359,26 @@ static void *user_input_thread_func(void *arg) {
 
     // 移除換行符
     user_input_section[strcspn(user_input_section, "\n")] = 0;
+    if (user_input_section[0] == '\0') {
+      continue;
+    }
 
-    // 解析輸入並寫入 cmd_buf
-    size_t buf_len = 0;
-    parse_to_cmd_buf(user_input_section, to_tofis_buf, &buf_len);
+    // 解析為指令 id 與參數
+    uint8_t id;
+    uint8_t args[TOFIS_CMD_MAX_ARGS];
+    uint8_t length;
+    if (parse_command(user_input_section, &id, args, &length) < 0) {
+      printf("Error: Unknown command '%s'.\n", user_input_section);
+      continue;
+    }
 
-    // 寫入串列埠
-    if (write_serial(port, to_tofis_buf, strlen((char *)to_tofis_buf)) < 0) {
-      printf("Error: Failed to write to serial port.\n");
+    int status = tofis_host_api_send_command(id, args, length);
+    if (status < 0) {
+      printf("Error: No ack for command '%s'.\n", user_input_section);
+    } else if (status < (int)(sizeof(status_names) / sizeof(status_names[0]))) {
+      printf("Command %s: %s\n", user_input_section, status_names[status]);
     } else {
-      printf("Command sent: %s\n", to_tofis_buf);
+      printf("Command %s: status %d\n", user_input_section, status);
     }
   }
 
@@ -176,48 +390,84 @@ static void *user_input_thread_func(void *arg) {
 }
 #endif
 
-int tofis_host_api_init(const char *port_name, int baud_rate) {
-  // 初始化串口
-  if (init_serial(&serial_port, port_name, baud_rate) < 0) {
-    return -1;
+// 回呼消費者
+typedef struct {
+  tofis_consumer_t *consumer;
+  tofis_frame_callback_t callback;
+  void *user_data;
+  volatile int running;
+#ifdef _WIN32
+  HANDLE thread;
+#else
+  pthread_t thread;
+#endif
+} callback_slot_t;
+
+static callback_slot_t callbacks[TOFIS_HUB_MAX_CONSUMERS];
+
+#ifdef _WIN32
+DWORD WINAPI callback_thread_func(LPVOID lpParam) {
+  callback_slot_t *slot = (callback_slot_t *)lpParam;
+#else
+static void *callback_thread_func(void *arg) {
+  callback_slot_t *slot = (callback_slot_t *)arg;
+#endif
+  const tofis_frame_t *frame;
+
+  while (slot->running &&
+         (frame = tofis_hub_borrow(&hub, slot->consumer, 1)) != NULL) {
+    slot->callback(frame, slot->user_data);
   }
+  tofis_hub_release(&hub, slot->consumer);
 
-  // 初始化 mutex 和 condition variable
 #ifdef _WIN32
-  data_mutex = CreateMutex(NULL, FALSE, NULL);
-  if (data_mutex == NULL) {
-    printf("Error: Unable to create mutex.\n");
-    close_serial(&serial_port);
-    return -1;
+  return 0;
+#else
+  return NULL;
+#endif
+}
+
+static callback_slot_t *find_callback(const tofis_consumer_t *consumer) {
+  for (int i = 0; i < TOFIS_HUB_MAX_CONSUMERS; i++) {
+    if (callbacks[i].consumer == consumer) {
+      return &callbacks[i];
+    }
   }
+  return NULL;
+}
 
-  data_cond = CreateEvent(NULL, FALSE, FALSE, NULL);
-  if (data_cond == NULL) {
-    printf("Error: Unable to create event.\n");
-    CloseHandle(data_mutex);
-    close_serial(&serial_port);
+void tofis_host_api_set_default_policy(tofis_policy_t policy) {
+  default_policy = policy;
+}
+
+int tofis_host_api_init(const char *port_name, int baud_rate) {
+  tofis_hub_init(&hub);
+  default_consumer = tofis_hub_subscribe(&hub, default_policy);
+  tofis_parser_reset(&parser);
+  for (int i = 0; i < TOFIS_MAX_SENSORS; i++) {
+    tofis_decoder_reset(&decoders[i]);
+  }
+
+  // 初始化串口
+  if (init_serial(&serial_port, port_name, baud_rate) < 0) {
     return -1;
   }
 
+#ifdef _WIN32
   // 創建接收線程
   receive_thread = CreateThread(NULL, 0, receive_thread_func, NULL, 0, NULL);
   if (receive_thread == NULL) {
     printf("Error: Unable to create receive thread.\n");
-    CloseHandle(data_cond);
-    CloseHandle(data_mutex);
     close_serial(&serial_port);
     return -1;
   }
 
   // 創建用戶輸入線程
-  input_thread = CreateThread(NULL, 0, user_input_thread_func,
-                              (LPVOID)&serial_port, 0, NULL);
+  input_thread = CreateThread(NULL, 0, user_input_thread_func, NULL, 0, NULL);
   if (input_thread == NULL) {
     printf("Error: Unable to create input thread.\n");
     TerminateThread(receive_thread, 0);
     CloseHandle(receive_thread);
-    CloseHandle(data_cond);
-    CloseHandle(data_mutex);
     close_serial(&serial_port);
     return -1;
   }
@@ -230,8 +480,8 @@ int tofis_host_api_init(const char *port_name, int baud_rate) {
   }
 
   // 創建用戶輸入線程
-  if (pthread_create(&input_thread_p, NULL, user_input_thread_func,
-                     (void *)&serial_port) != 0) {
+  if (pthread_create(&input_thread_p, NULL, user_input_thread_func, NULL) !=
+      0) {
     printf("Error: Unable to create input thread.\n");
     pthread_cancel(receive_thread_p);
     pthread_join(receive_thread_p, NULL);
@@ -249,42 +499,171 @@ int tofis_host_api_start() {
   return 0;
 }
 
-int tofis_host_api_wait_for_data(tofis_data_packet_t *packet) {
-  // 等待數據到來
-#ifdef _WIN32
-  WaitForSingleObject(data_cond, INFINITE);
-  WaitForSingleObject(data_mutex, INFINITE);
-  if (data_ready) {
-    *packet = latest_packet;
-    data_ready = false;
+const tofis_frame_t *tofis_host_api_borrow_frame(void) {
+  return tofis_hub_borrow(&hub, default_consumer, 1);
+}
+
+void tofis_host_api_release_frame(void) {
+  tofis_hub_release(&hub, default_consumer);
+}
+
+int tofis_host_api_wait_for_data(tofis_frame_t *frame) {
+  const tofis_frame_t *borrowed = tofis_host_api_borrow_frame();
+
+  if (borrowed == NULL) {
+    return -1;
+  }
+  *frame = *borrowed;
+  tofis_host_api_release_frame();
+  return 0;
+}
+
+void tofis_host_api_get_default_stats(tofis_consumer_stats_t *out) {
+  tofis_hub_get_stats(default_consumer, out);
+}
+
+tofis_consumer_t *tofis_host_api_subscribe(tofis_policy_t policy) {
+  return tofis_hub_subscribe(&hub, policy);
+}
+
+const tofis_frame_t *tofis_host_api_consumer_borrow(tofis_consumer_t *consumer) {
+  return tofis_hub_borrow(&hub, consumer, 1);
+}
+
+void tofis_host_api_consumer_release(tofis_consumer_t *consumer) {
+  tofis_hub_release(&hub, consumer);
+}
+
+tofis_consumer_t *tofis_host_api_subscribe_callback(tofis_policy_t policy,
+                                                    tofis_frame_callback_t cb,
+                                                    void *user_data) {
+  callback_slot_t *slot = find_callback(NULL);
+  if (slot == NULL) {
+    return NULL;
   }
-  ReleaseMutex(data_mutex);
+
+  tofis_consumer_t *consumer = tofis_hub_subscribe(&hub, policy);
+  if (consumer == NULL) {
+    return NULL;
+  }
+
+  slot->consumer = consumer;
+  slot->callback = cb;
+  slot->user_data = user_data;
+  slot->running = 1;
+#ifdef _WIN32
+  slot->thread = CreateThread(NULL, 0, callback_thread_func, slot, 0, NULL);
+  if (slot->thread == NULL) {
 #else
-  pthread_mutex_lock(&data_mutex_p);
-  while (!data_ready) {
-    pthread_cond_wait(&data_cond_p, &data_mutex_p);
+  if (pthread_create(&slot->thread, NULL, callback_thread_func, slot) != 0) {
+#endif
+    printf("Error: Unable to create callback thread.\n");
+    tofis_hub_unsubscribe(&hub, consumer);
+    slot->consumer = NULL;
+    return NULL;
+  }
+
+  return consumer;
+}
+
+// 停止回呼線程，hub 已關閉時線程已自行結束
+static void stop_callback(callback_slot_t *slot) {
+  slot->running = 0;
+#ifdef _WIN32
+  // 以暫時關閉 hub 的方式喚醒等待中的線程會影響其他消費者，改為輪詢結束
+  while (WaitForSingleObject(slot->thread, 10) == WAIT_TIMEOUT) {
   }
-  *packet = latest_packet;
-  data_ready = false;
-  pthread_mutex_unlock(&data_mutex_p);
+  CloseHandle(slot->thread);
+#else
+  pthread_join(slot->thread, NULL);
 #endif
-  return 0;
+  slot->consumer = NULL;
+}
+
+void tofis_host_api_unsubscribe(tofis_consumer_t *consumer) {
+  callback_slot_t *slot = find_callback(consumer);
+
+  if (slot != NULL) {
+    stop_callback(slot);
+  }
+  tofis_hub_unsubscribe(&hub, consumer);
+}
+
+void tofis_host_api_get_consumer_stats(const tofis_consumer_t *consumer,
+                                       tofis_consumer_stats_t *out) {
+  tofis_hub_get_stats(consumer, out);
+}
+
+void tofis_host_api_get_stats(tofis_host_stats_t *out) {
+  // 僅供顯示，不需與接收線程同步
+  *out = stats;
+  out->crc_errors = parser.stats.crc_errors;
+  out->header_errors = parser.stats.header_errors;
+  out->skipped_bytes = parser.stats.skipped_bytes;
+  out->bytes_received = parser.stats.bytes;
+}
+
+void tofis_host_api_get_timing(uint8_t sensor, tofis_host_timing_t *out) {
+  memset(out, 0, sizeof(*out));
+  if (sensor >= TOFIS_MAX_SENSORS) {
+    return;
+  }
+
+  // 僅供顯示，不需與接收線程同步
+  const sensor_timing_t *t = &timing[sensor];
+  uint64_t span_us = t->mcu_time_us - t->first_mcu_time_us;
+
+  out->frames = t->frames;
+  out->skipped_sensor_frames = t->skipped_sensor_frames;
+  out->frame_rate =
+      (span_us != 0) ? (double)(t->frames - 1) * 1e6 / (double)span_us : 0.0;
+  out->period_us = t->period.mean;
+  out->period_jitter_us = running_stat_stddev(&t->period);
+  out->mcu_latency_us = t->mcu_latency.mean;
+  out->mcu_latency_max_us = t->mcu_latency_max_us;
+  out->link_latency_us = t->offset.mean - t->min_offset_us;
+  out->link_jitter_us = running_stat_stddev(&t->offset);
+  out->config_id = t->config_id;
+  out->config_gap_us = t->config_gap_us;
+}
+
+int tofis_host_api_get_config(tofis_config_desc_t *out) {
+  // 僅供顯示，不需與接收線程同步
+  *out = config;
+  return (configs_received != 0) ? 1 : 0;
+}
+
+int tofis_host_api_get_telemetry(tofis_telemetry_t *out) {
+  // 僅供顯示，不需與接收線程同步
+  *out = telemetry;
+  return (telemetry_received != 0) ? 1 : 0;
+}
+
+int tofis_host_api_get_read_rates(double rates[TOFIS_MAX_SENSORS]) {
+  // 僅供顯示，不需與接收線程同步；計數與時間皆會溢位，取 32-bit 差值
+  uint32_t span_us = telemetry_time_us - previous_telemetry_time_us;
+
+  if (telemetry_received < 2 || span_us == 0) {
+    return 0;
+  }
+  for (int i = 0; i < TOFIS_MAX_SENSORS; i++) {
+    uint32_t frames =
+        telemetry.sensor[i].frames - previous_telemetry.sensor[i].frames;
+    rates[i] = (double)frames * 1e6 / (double)span_us;
+  }
+  return 1;
 }
 
 void tofis_host_api_cleanup() {
   // 關閉串口
   close_serial(&serial_port);
 
-  // 關閉 mutex 和 condition variable
 #ifdef _WIN32
   // 終止接收線程和輸入線程（可選，需更完善的終止機制）
   TerminateThread(receive_thread, 0);
   CloseHandle(receive_thread);
   TerminateThread(input_thread, 0);
   CloseHandle(input_thread);
-
-  CloseHandle(data_cond);
-  CloseHandle(data_mutex);
 #else
   // 停止接收線程和輸入線程（需要更完善的終止機制，例如使用全局變量來通知線程退出）
   // 目前無法直接停止 pthread，僅示範
@@ -292,8 +671,14 @@ void tofis_host_api_cleanup() {
   pthread_join(receive_thread_p, NULL);
   pthread_cancel(input_thread_p);
   pthread_join(input_thread_p, NULL);
-
-  pthread_cond_destroy(&data_cond_p);
-  pthread_mutex_destroy(&data_mutex_p);
 #endif
-}
\ No newline at end of file
+
+  // 喚醒所有等待中的消費者，回呼線程隨之結束
+  tofis_hub_close(&hub);
+  for (int i = 0; i < TOFIS_HUB_MAX_CONSUMERS; i++) {
+    if (callbacks[i].consumer != NULL) {
+      stop_callback(&callbacks[i]);
+    }
+  }
+  tofis_hub_destroy(&hub);
+}
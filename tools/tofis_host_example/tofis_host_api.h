@@ -4,17 +4,115 @@
 #include "tofis_main.h"
 
 #include "tofis_data.h"
+#include "tofis_frame_hub.h"
 
 #define TOFIS_USER_INPUT_BUF_SIZE (256)
 
+// 指令等待 ack 的時間與重送次數
+#define TOFIS_CMD_ACK_TIMEOUT_MS 300
+#define TOFIS_CMD_RETRIES 3
+
+// 依編碼統計（index 為 TOFIS_ENCODING_*）
+#define TOFIS_ENCODING_COUNT 6
+
+typedef struct {
+  uint64_t frames[TOFIS_ENCODING_COUNT]; // 成功解碼的 frame 數
+  uint64_t bytes[TOFIS_ENCODING_COUNT];  // 含 header 的總位元組
+  uint64_t frames_received;              // CRC 正確的 frame 數
+  uint64_t dropped_frames;               // 依 sequence 跳號計算
+  uint64_t bytes_received;               // 串口讀到的總位元組
+  uint64_t skipped_bytes;                // 重新同步時丟棄的位元組
+  uint64_t header_errors;                // sync 正確但 header 不合理
+  uint64_t crc_errors;
+  uint64_t decode_errors;
+  uint64_t resync_drops; // 因缺少參考 frame 而丟棄的 delta
+} tofis_host_stats_t;
+
+// 以 frame 內的 MCU 時間戳計算的單一感測器時序統計 (平均與標準差為累計值)
+typedef struct {
+  uint64_t frames;                // 參與統計的 frame 數
+  uint64_t skipped_sensor_frames; // streamcount 跳號但 sequence 連續的 frame
+  double frame_rate;              // 收到的 frame 率 [Hz]，以 irq 時間計算
+  double period_us;               // sensor 週期 (相鄰 irq_time_us 差)
+  double period_jitter_us;        // sensor 週期標準差
+  double mcu_latency_us;          // irq 到開始傳送 (tx_time_us - irq_time_us)
+  uint32_t mcu_latency_max_us;
+  double link_latency_us;         // 收到時間 - irq，扣除觀察到的最小值
+  double link_jitter_us;          // 上者標準差，含 UART 與排程延遲
+  uint8_t config_id;              // 最近 frame 的 config_id
+  uint32_t config_gap_us;         // 最近一次設定變更前後的 irq 間隔
+} tofis_host_timing_t;
+
+// 回呼消費者，在自己的線程中依序收到借用的 frame，回呼返回後 frame 即歸還
+typedef void (*tofis_frame_callback_t)(const tofis_frame_t *frame,
+                                       void *user_data);
+
+// 設定預設消費者（borrow_frame / wait_for_data）的策略，
+// 需在 tofis_host_api_init 之前呼叫（預設 TOFIS_POLICY_LATEST_ONLY）
+void tofis_host_api_set_default_policy(tofis_policy_t policy);
+
 // 初始化 Host API
 int tofis_host_api_init(const char *port_name, int baud_rate);
 
 // 啟動接收線程
 int tofis_host_api_start();
 
-// 等待並獲取最新的數據包
-int tofis_host_api_wait_for_data(tofis_data_packet_t *packet);
+// 等待並借用預設消費者的下一個 frame（不複製），用完後呼叫
+// tofis_host_api_release_frame，只能由單一線程使用
+const tofis_frame_t *tofis_host_api_borrow_frame(void);
+
+// 歸還 tofis_host_api_borrow_frame 取得的 frame
+void tofis_host_api_release_frame(void);
+
+// 等待並複製下一個 frame
+int tofis_host_api_wait_for_data(tofis_frame_t *frame);
+
+// 取得預設消費者的統計
+void tofis_host_api_get_default_stats(tofis_consumer_stats_t *stats);
+
+// 新增游標消費者，以 tofis_host_api_consumer_borrow/release 在自己的線程
+// 取得 frame，上限 TOFIS_HUB_MAX_CONSUMERS（含預設消費者與回呼消費者）
+tofis_consumer_t *tofis_host_api_subscribe(tofis_policy_t policy);
+
+// 等待並借用此消費者的下一個 frame（自動歸還上一個），關閉時回傳 NULL
+const tofis_frame_t *tofis_host_api_consumer_borrow(tofis_consumer_t *consumer);
+
+// 歸還此消費者借用的 frame
+void tofis_host_api_consumer_release(tofis_consumer_t *consumer);
+
+// 新增回呼消費者，回呼在專屬線程中執行，不會拖慢接收線程與其他消費者
+// （TOFIS_POLICY_BLOCK 除外）
+tofis_consumer_t *tofis_host_api_subscribe_callback(tofis_policy_t policy,
+                                                    tofis_frame_callback_t cb,
+                                                    void *user_data);
+
+// 移除游標消費者（需先停止使用）或回呼消費者（等待回呼線程結束）
+void tofis_host_api_unsubscribe(tofis_consumer_t *consumer);
+
+// 取得消費者的交付、丟棄與延遲 (lag) 統計
+void tofis_host_api_get_consumer_stats(const tofis_consumer_t *consumer,
+                                       tofis_consumer_stats_t *stats);
+
+// 取得接收統計（頻寬報告用）
+void tofis_host_api_get_stats(tofis_host_stats_t *stats);
+
+// 取得感測器 (tofis_frame_t.sensor) 的時序統計
+void tofis_host_api_get_timing(uint8_t sensor, tofis_host_timing_t *timing);
+
+// 取得最近一次的設定變更通知，尚未收到時回傳 0
+int tofis_host_api_get_config(tofis_config_desc_t *config);
+
+// 取得最近一次的韌體 telemetry，尚未收到時回傳 0
+int tofis_host_api_get_telemetry(tofis_telemetry_t *telemetry);
+
+// 取得最近兩個 telemetry 之間每個感測器讀取的 frame 率 (fps)，包含未送出的
+// frame，尚未收到兩個 telemetry 時回傳 0
+int tofis_host_api_get_read_rates(double rates[TOFIS_MAX_SENSORS]);
+
+// 送出指令 (TOFIS_CMD_*) 並等待韌體的 ack，逾時以相同 sequence 重送，
+// 回傳 TOFIS_CMD_STATUS_*，重送 TOFIS_CMD_RETRIES 次仍無 ack 時回傳 -1
+int tofis_host_api_send_command(uint8_t id, const uint8_t *args,
+                                uint8_t length);
 
 // 清理 Host API
 void tofis_host_api_cleanup();
@@ -6,10 +6,14 @@
 #ifdef _WIN32
 #include <windows.h>
 #else
+#include <asm/termbits.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <linux/serial.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
 #include <unistd.h>
-
 #endif
 
 int init_serial(SerialPort *port, const char *port_name, int baud_rate) {
@@ -57,64 +61,77 @@ int init_serial(SerialPort *port, const char *port_name, int baud_rate) {
 
   return 0;
 #else
-  // Linux 串口初始化
-  port->handle = open(port_name, O_RDWR | O_NOCTTY | O_SYNC);
+  // Linux 串口初始化：非阻塞 fd，由 epoll 等待資料
+  port->handle = open(port_name, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
   if (port->handle < 0) {
     printf("Error: Unable to open serial port %s\n", port_name);
     return -1;
   }
 
-  struct termios tty;
-  memset(&tty, 0, sizeof(tty));
-  if (tcgetattr(port->handle, &tty) != 0) {
+  // termios2 + BOTHER 可設定任意波特率（例如 460800、2000000）
+  struct termios2 tty;
+  if (ioctl(port->handle, TCGETS2, &tty) != 0) {
     printf("Error: Getting serial attributes\n");
     close(port->handle);
     return -1;
   }
 
-  speed_t speed;
-  switch (baud_rate) {
-  case 9600:
-    speed = B9600;
-    break;
-  case 19200:
-    speed = B19200;
-    break;
-  case 38400:
-    speed = B38400;
-    break;
-  case 57600:
-    speed = B57600;
-    break;
-  case 115200:
-    speed = B115200;
-    break;
-  default:
-    speed = B9600;
-  }
-
-  cfsetospeed(&tty, speed);
-  cfsetispeed(&tty, speed);
+  tty.c_cflag &= ~(CBAUD | (CBAUD << IBSHIFT));
+  tty.c_cflag |= BOTHER | (BOTHER << IBSHIFT);
+  tty.c_ispeed = (speed_t)baud_rate;
+  tty.c_ospeed = (speed_t)baud_rate;
 
   tty.c_cflag = (tty.c_cflag & ~CSIZE) | CS8; // 8 bits
-  tty.c_iflag &= ~IGNBRK;                     // Disable break processing
-  tty.c_lflag = 0;      // No signaling chars, no echo, no canonical processing
-  tty.c_oflag = 0;      // No remapping, no delays
-  tty.c_cc[VMIN] = 1;   // Read doesn't block
-  tty.c_cc[VTIME] = 10; // 1 second read timeout
+  tty.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL |
+                   IXON | IXOFF | IXANY); // Raw input, no XON/XOFF
+  tty.c_lflag = 0;    // No signaling chars, no echo, no canonical processing
+  tty.c_oflag = 0;    // No remapping, no delays
+  tty.c_cc[VMIN] = 0; // 非阻塞，由 epoll 決定何時讀取
+  tty.c_cc[VTIME] = 0;
 
-  tty.c_iflag &= ~(IXON | IXOFF | IXANY); // Disable XON/XOFF
   tty.c_cflag |= (CLOCAL | CREAD);   // Ignore modem controls, enable reading
   tty.c_cflag &= ~(PARENB | PARODD); // No parity
   tty.c_cflag &= ~CSTOPB;            // One stop bit
   tty.c_cflag &= ~CRTSCTS;           // No hardware flow control
 
-  if (tcsetattr(port->handle, TCSANOW, &tty) != 0) {
+  if (ioctl(port->handle, TCSETS2, &tty) != 0) {
     printf("Error: Setting serial attributes\n");
     close(port->handle);
     return -1;
   }
 
+  // 讀回確認驅動程式接受的波特率
+  if (ioctl(port->handle, TCGETS2, &tty) == 0 &&
+      tty.c_ospeed != (speed_t)baud_rate) {
+    printf("Warning: %s runs at %u baud instead of %d\n", port_name,
+           (unsigned)tty.c_ospeed, baud_rate);
+  }
+
+  // FTDI 等 USB 轉串口預設延遲 16 ms，驅動不支援時（如 pty）忽略
+  struct serial_struct serial;
+  if (ioctl(port->handle, TIOCGSERIAL, &serial) == 0) {
+    serial.flags |= ASYNC_LOW_LATENCY;
+    ioctl(port->handle, TIOCSSERIAL, &serial);
+  }
+
+  port->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  if (port->epoll_fd < 0) {
+    printf("Error: Creating epoll instance\n");
+    close(port->handle);
+    return -1;
+  }
+
+  struct epoll_event event;
+  memset(&event, 0, sizeof(event));
+  event.events = EPOLLIN;
+  event.data.fd = port->handle;
+  if (epoll_ctl(port->epoll_fd, EPOLL_CTL_ADD, port->handle, &event) != 0) {
+    printf("Error: Registering serial port to epoll\n");
+    close(port->epoll_fd);
+    close(port->handle);
+    return -1;
+  }
+
   return 0;
 #endif
 }
@@ -123,6 +140,7 @@ void close_serial(SerialPort *port) {
 #ifdef _WIN32
   CloseHandle(port->handle);
 #else
+  close(port->epoll_fd);
   close(port->handle);
 #endif
 }
@@ -135,11 +153,26 @@ int read_serial(SerialPort *port, uint8_t *buffer, size_t size) {
   }
   return (int)bytes_read;
 #else
-  int bytes_read = read(port->handle, buffer, size);
-  if (bytes_read < 0) {
-    return -1;
+  // 一次讀取所有可用資料，沒有資料時在 epoll 上等待
+  while (1) {
+    ssize_t bytes_read = read(port->handle, buffer, size);
+    if (bytes_read > 0) {
+      return (int)bytes_read;
+    }
+    if (bytes_read < 0 && errno != EAGAIN && errno != EINTR) {
+      return -1;
+    }
+
+    struct epoll_event event;
+    int ready = epoll_wait(port->epoll_fd, &event, 1,
+                           TOFIS_SERIAL_READ_TIMEOUT_MS);
+    if (ready == 0) {
+      return 0; // timeout
+    }
+    if (ready < 0 && errno != EINTR) {
+      return -1;
+    }
   }
-  return bytes_read;
 #endif
 }
 
@@ -151,10 +184,23 @@ int write_serial(SerialPort *port, const uint8_t *buffer, size_t size) {
   }
   return (int)bytes_written;
 #else
-  int bytes_written = write(port->handle, buffer, size);
-  if (bytes_written < 0) {
-    return -1;
+  // fd 為非阻塞，輸出緩衝區滿時等待再寫入剩餘部分
+  size_t total = 0;
+  while (total < size) {
+    ssize_t bytes_written = write(port->handle, buffer + total, size - total);
+    if (bytes_written > 0) {
+      total += (size_t)bytes_written;
+      continue;
+    }
+    if (bytes_written < 0 && errno != EAGAIN && errno != EINTR) {
+      return -1;
+    }
+
+    struct pollfd pfd = {.fd = port->handle, .events = POLLOUT};
+    if (poll(&pfd, 1, TOFIS_SERIAL_READ_TIMEOUT_MS) <= 0) {
+      return (total > 0) ? (int)total : -1;
+    }
   }
-  return bytes_written;
+  return (int)total;
 #endif
 }
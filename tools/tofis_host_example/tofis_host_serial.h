@@ -9,12 +9,17 @@
 #include <windows.h>
 typedef HANDLE serial_handle_t;
 #else
-#include <termios.h>
 typedef int serial_handle_t;
 #endif
 
+// read_serial 沒有資料時最多等待的時間
+#define TOFIS_SERIAL_READ_TIMEOUT_MS 1000
+
 typedef struct {
   serial_handle_t handle;
+#ifndef _WIN32
+  int epoll_fd; // 等待 handle 可讀
+#endif
 } SerialPort;
 
 // 初始化串口
@@ -23,7 +28,7 @@ int init_serial(SerialPort *port, const char *port_name, int baud_rate);
 // 關閉串口
 void close_serial(SerialPort *port);
 
-// 串口接收數據
+// 串口接收數據，最多 size bytes，回傳讀到的位元組數，逾時回傳 0
 int read_serial(SerialPort *port, uint8_t *buffer, size_t size);
 
 // 串口傳輸數據
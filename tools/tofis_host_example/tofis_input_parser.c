@@ -1,13 +1,58 @@
 #include "tofis_input_parser.h"
 #include "tofis_host_api.h"
 
+#include <ctype.h>
+#include <stdlib.h>
 #include <string.h>
 
-void parse_to_cmd_buf(char *user_input_section, uint8_t *to_tofis_buf,
-                      size_t *buf_len) {
-  size_t len = strlen(user_input_section);
-  for (size_t i = 0; i < len && i < 256; i++) {
-    to_tofis_buf[i] = (uint8_t)user_input_section[i];
+// 按鍵與參數的十六進位位數，與韌體 tofis_cmd.c 相同
+// 清除校正資料不用單一按鍵，需輸入 "erase"
+static const struct {
+  char key;
+  uint8_t id;
+  uint8_t digits;
+} keys[] = {
+    {'r', TOFIS_CMD_RESOLUTION, 0},   {'s', TOFIS_CMD_SIGNAL_AMBIENT, 0},
+    {'f', TOFIS_CMD_FIELDS, 2},       {'n', TOFIS_CMD_TARGETS, 1},
+    {'t', TOFIS_CMD_TARGET_ORDER, 0}, {'i', TOFIS_CMD_I2C_USAGE, 0},
+    {'m', TOFIS_CMD_SENSORS, 1},      {'p', TOFIS_CMD_FRAME_RATES, 0},
+    {'c', TOFIS_CMD_CLEAR_SCREEN, 0}, {'a', TOFIS_CMD_ADAPTIVE_RATE, 1},
+};
+
+int parse_command(const char *line, uint8_t *id, uint8_t *args,
+                  uint8_t *length) {
+  while (isspace((unsigned char)*line)) {
+    line++;
+  }
+
+  if (strcmp(line, "erase") == 0) {
+    *id = TOFIS_CMD_ERASE_CALIB;
+    *length = 0;
+    return 0;
+  }
+
+  for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); i++) {
+    if (keys[i].key != line[0]) {
+      continue;
+    }
+
+    *id = keys[i].id;
+    *length = 0;
+    if (keys[i].digits == 0) {
+      return (line[1] == '\0') ? 0 : -1;
+    }
+
+    // 參數需為剛好 digits 位的十六進位數
+    const char *digits = line + 1;
+    size_t count = strlen(digits);
+    if (count != keys[i].digits ||
+        strspn(digits, "0123456789abcdefABCDEF") != count) {
+      return -1;
+    }
+    args[0] = (uint8_t)strtoul(digits, NULL, 16);
+    *length = 1;
+    return 0;
   }
-  *buf_len = len;
-}
\ No newline at end of file
+
+  return -1;
+}
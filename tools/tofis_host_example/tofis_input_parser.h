@@ -1,6 +1,10 @@
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 
-void parse_to_cmd_buf(char *user_input_section, uint8_t *to_tofis_buf,
-                      size_t *buf_len);
\ No newline at end of file
+// 將輸入的一行 (韌體終端機的按鍵加上十六進位參數，如 "r"、"f3f"、"n2"、
+// "m7"，或 "erase") 轉為指令 id 與參數，成功回傳 0，未知的按鍵或參數錯誤
+// 回傳 -1
+int parse_command(const char *line, uint8_t *id, uint8_t *args,
+                  uint8_t *length);
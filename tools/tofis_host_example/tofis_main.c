@@ -33,6 +33,10 @@ typedef struct {
 // 全局 Profile 變數
 Profile_t Profile = {0};
 
+// tofis_frame_t.sensor 的名稱 (VL53L8A1_DEV_*)
+static const char *sensor_names[TOFIS_MAX_SENSORS] = {"left", "center",
+                                                      "right"};
+
 // 顯示命令橫幅
 static void display_commands_banner(void) {
   static const int col_len = 40;
@@ -78,8 +82,167 @@ void calculate_time_diff() {
 
 static void clear_rest() { printf("\033[J"); }
 
-// 打印結果函數
-static void print_result(RANGING_SENSOR_Result_t *Result) {
+// 各編碼的平均 frame 大小
+static void print_bandwidth(double frame_rate) {
+  static const char *names[TOFIS_ENCODING_COUNT] = {
+      "", "compact", "key", "delta", "raw", "raw be"};
+  tofis_host_stats_t stats;
+  uint64_t frames = 0;
+  uint64_t bytes = 0;
+
+  tofis_host_api_get_stats(&stats);
+
+  printf("Bandwidth:");
+  for (int i = 0; i < TOFIS_ENCODING_COUNT; i++) {
+    frames += stats.frames[i];
+    bytes += stats.bytes[i];
+    if (stats.frames[i] != 0) {
+      printf(" %s %.1f B/frame,", names[i],
+             (double)stats.bytes[i] / stats.frames[i]);
+    }
+  }
+  if (frames != 0) {
+    printf(" avg %.1f B/frame (%.0f B/s)", (double)bytes / frames,
+           (double)bytes / frames * frame_rate);
+  }
+  printf("\033[K\n");
+  printf("Errors: dropped %llu, crc %llu, decode %llu, delta resync "
+         "%llu\033[K\n",
+         (unsigned long long)stats.dropped_frames,
+         (unsigned long long)stats.crc_errors,
+         (unsigned long long)stats.decode_errors,
+         (unsigned long long)stats.resync_drops);
+  tofis_consumer_stats_t consumer;
+  tofis_host_api_get_default_stats(&consumer);
+  printf("Consumer: delivered %llu, dropped %llu, lag %u (max %u)\033[K\n",
+         (unsigned long long)consumer.delivered,
+         (unsigned long long)consumer.dropped, consumer.lag,
+         consumer.max_lag);
+  printf("Stream: %llu bytes, resync skipped %llu bytes, bad header "
+         "%llu\033[K\n",
+         (unsigned long long)stats.bytes_received,
+         (unsigned long long)stats.skipped_bytes,
+         (unsigned long long)stats.header_errors);
+}
+
+// 打印以 MCU 時間戳計算的時序，以及各感測器與合計的 frame 率
+static void print_timing(const tofis_frame_t *frame) {
+  tofis_host_timing_t timing;
+  double aggregate = 0.0;
+  double single = 0.0;
+  int sensors = 0;
+
+  tofis_host_api_get_timing(frame->sensor, &timing);
+  printf("Sensor %s: stream %3u, period %.2f ms (jitter %.0f us), skipped "
+         "%llu\033[K\n",
+         sensor_names[frame->sensor], frame->stream_count,
+         timing.period_us / 1000.0, timing.period_jitter_us,
+         (unsigned long long)timing.skipped_sensor_frames);
+  printf("Latency: irq->tx %u us (avg %.0f, max %u), link +%.0f us (jitter "
+         "%.0f us)\033[K\n",
+         frame->tx_time_us - frame->irq_time_us, timing.mcu_latency_us,
+         timing.mcu_latency_max_us, timing.link_latency_us,
+         timing.link_jitter_us);
+
+  // 單一感測器的速率為其量測週期，合計為各感測器收到的 frame 率之和
+  printf("Frame rate:");
+  for (uint8_t i = 0; i < TOFIS_MAX_SENSORS; i++) {
+    tofis_host_api_get_timing(i, &timing);
+    if (timing.frames == 0) {
+      continue;
+    }
+    printf(" %s %.2f,", sensor_names[i], timing.frame_rate);
+    aggregate += timing.frame_rate;
+    if (timing.period_us > 0.0 && 1e6 / timing.period_us > single) {
+      single = 1e6 / timing.period_us;
+    }
+    sensors++;
+  }
+  printf(" aggregate %.2f fps from %d sensors", aggregate, sensors);
+  if (single > 0.0) {
+    printf(" (%.2f x one sensor at %.2f Hz)", aggregate / single, single);
+  }
+  printf("\033[K\n");
+}
+
+// 打印 frame 帶有的欄位
+static void print_fields(const tofis_frame_t *frame) {
+  printf("Fields: 0x%02X", frame->fields);
+  if (frame->fields & TOFIS_FIELD_TEMPERATURE) {
+    printf(", temperature %d degC", frame->temperature);
+  }
+  printf("\033[K\n");
+}
+
+// 打印韌體最近一次的設定變更，與顯示中感測器在變更前後的 frame 間隔
+static void print_config(const tofis_frame_t *frame) {
+  tofis_config_desc_t config;
+  tofis_host_timing_t timing;
+
+  if (!tofis_host_api_get_config(&config)) {
+    return;
+  }
+  tofis_host_api_get_timing(frame->sensor, &timing);
+  printf("Config #%u: %ux%u, fields 0x%02X, %u targets, %s, sensors 0x%X, "
+         "%u Hz (%s), %u ms, stopped %.1f ms, gap %.1f ms\033[K\n",
+         config.config_id, config.resolution, config.resolution,
+         config.fields, config.targets,
+         (config.target_order == 2) ? "strongest" : "closest", config.sensors,
+         config.frequency_hz, config.adaptive ? "adaptive" : "fixed",
+         config.integration_ms, config.stopped_us / 1000.0,
+         timing.config_gap_us / 1000.0);
+  printf("Link: %s frames, headroom %d %%\033[K\n",
+         (config.encoding == TOFIS_ENCODING_RAW)       ? "raw"
+         : (config.encoding == TOFIS_ENCODING_COMPACT) ? "compact"
+         : (config.encoding == TOFIS_ENCODING_DELTA)   ? "delta"
+                                                       : "unknown",
+         config.headroom_percent);
+}
+
+// 打印韌體的 telemetry，計數為開機以來的累計值，延遲為最近一秒
+static void print_telemetry(void) {
+  static const char *stages[TOFIS_STAGE_COUNT] = {"read", "process", "queue",
+                                                  "total"};
+  tofis_telemetry_t telemetry;
+  double rates[TOFIS_MAX_SENSORS] = {0};
+
+  if (!tofis_host_api_get_telemetry(&telemetry)) {
+    return;
+  }
+  tofis_host_api_get_read_rates(rates);
+  printf("MCU: sent %u, dropped %u, tx errors %u, events lost %u, queue max "
+         "%u, idle %u %%, config errors %u\033[K\n",
+         telemetry.frames_sent, telemetry.frames_dropped, telemetry.tx_errors,
+         telemetry.events_lost, telemetry.queue_high_water,
+         telemetry.idle_percent, telemetry.config_errors);
+  printf("MCU sensors:");
+  for (uint8_t i = 0; i < TOFIS_MAX_SENSORS; i++) {
+    const tofis_sensor_counters_t *sensor = &telemetry.sensor[i];
+    printf(" %s gaps %u overruns %u corrupted %u i2c %u,", sensor_names[i],
+           sensor->stream_gaps, sensor->overruns, sensor->corrupted,
+           sensor->i2c_errors);
+  }
+  printf("\033[K\n");
+  // 讀取的 frame 率包含未送出的 frame，I2C 為每個 frame 的傳輸數與 bytes
+  printf("MCU reads:");
+  for (uint8_t i = 0; i < TOFIS_MAX_SENSORS; i++) {
+    const tofis_sensor_counters_t *sensor = &telemetry.sensor[i];
+    printf(" %s %.2f fps i2c %u/%u B,", sensor_names[i], rates[i],
+           sensor->frame_transfers, sensor->frame_bytes);
+  }
+  printf("\033[K\n");
+  printf("MCU latency (us, min/avg/max):");
+  for (int i = 0; i < TOFIS_STAGE_COUNT; i++) {
+    const tofis_latency_desc_t *latency = &telemetry.latency[i];
+    printf(" %s %u/%u/%u,", stages[i], latency->min_us, latency->avg_us,
+           latency->max_us);
+  }
+  printf("\033[K\n");
+}
+
+// 打印結果函數，每個 zone 最多 targets 個 target
+static void print_result(const RANGING_SENSOR_Result_t *Result,
+                         uint8_t targets) {
   int8_t i, j, k, l;
   uint8_t zones_per_line;
 
@@ -89,7 +252,7 @@ static void print_result(RANGING_SENSOR_Result_t *Result) {
   display_commands_banner();
 
   printf("Cell Format :\033[K\n\033[K\n");
-  for (l = 0; l < RANGING_SENSOR_NB_TARGET_PER_ZONE; l++) {
+  for (l = 0; l < targets; l++) {
     printf(" \033[38;5;10m%20s\033[0m : %20s\033[K\n", "Distance [mm]",
            "Status");
     if ((Profile.EnableAmbient != 0) || (Profile.EnableSignal != 0)) {
@@ -114,7 +277,7 @@ static void print_result(RANGING_SENSOR_Result_t *Result) {
     }
     printf("|\033[K\n");
 
-    for (l = 0; l < RANGING_SENSOR_NB_TARGET_PER_ZONE; l++) {
+    for (l = 0; l < targets; l++) {
       /* Print distance and status */
       for (k = (zones_per_line - 1); k >= 0; k--) {
         if (j + k >= Result->NumberOfZones) {
@@ -122,7 +285,7 @@ static void print_result(RANGING_SENSOR_Result_t *Result) {
           continue;
         }
 
-        if (Result->ZoneResult[j + k].NumberOfTargets > 0)
+        if (Result->ZoneResult[j + k].NumberOfTargets > l)
           printf("| \033[38;5;10m%5ld\033[0m  :  %5ld ",
                  (long)Result->ZoneResult[j + k].Distance[l],
                  (long)Result->ZoneResult[j + k].Status[l]);
@@ -139,7 +302,7 @@ static void print_result(RANGING_SENSOR_Result_t *Result) {
             continue;
           }
 
-          if (Result->ZoneResult[j + k].NumberOfTargets > 0) {
+          if (Result->ZoneResult[j + k].NumberOfTargets > l) {
             if (Profile.EnableSignal != 0) {
               printf("| %5ld  :  ", (long)Result->ZoneResult[j + k].Signal[l]);
             } else
@@ -167,20 +330,24 @@ static void print_result(RANGING_SENSOR_Result_t *Result) {
 
 int main(int argc, char *argv[]) {
   if (argc < 2) {
-    printf("Usage: %s <serial_port>\n", argv[0]);
+    printf("Usage: %s <serial_port> [baud_rate] [sensor]\n", argv[0]);
+    printf("  sensor: matrix shown, 0 left, 1 center (default), 2 right\n");
     printf("Example:\n");
 #ifdef _WIN32
     printf("  %s COM3\n", argv[0]);
 #else
-    printf("  %s /dev/ttyUSB0\n", argv[0]);
+    printf("  %s /dev/ttyUSB0 2000000\n", argv[0]);
 #endif
     return -1;
   }
 
   const char *port_name = argv[1];
+  // 預設 460800，需與韌體 USART2 設定一致
+  int baud_rate = (argc > 2) ? atoi(argv[2]) : 460800;
+  // 只顯示一個感測器的矩陣，其他感測器的 frame 僅計入統計
+  int display_sensor = (argc > 3) ? atoi(argv[3]) : 1;
 
-  // 初始化 Host API，波特率設為 460800
-  if (tofis_host_api_init(port_name, 460800) < 0) {
+  if (tofis_host_api_init(port_name, baud_rate) < 0) {
     return -1;
   }
 
@@ -191,19 +358,33 @@ int main(int argc, char *argv[]) {
   printf("Waiting for data on %s...\n", port_name);
 
   while (1) {
-    tofis_data_packet_t packet;
-    if (tofis_host_api_wait_for_data(&packet) == 0) {
-      calculate_time_diff();
-
-      print_result(&packet.data);
-      printf("Packet frequency: %6.2f Hz\033[K\n", 1.0 / time_diff);
-
-      // 更新 Profile 參數
-      Profile.RangingProfile = (packet.resolution == 8) ? 8 : 4;
-      Profile.EnableAmbient = 1; // 假設啟用 Ambient
-      Profile.EnableSignal = 1;  // 假設啟用 Signal
-      clear_rest();
+    // 借用佇列中的 frame，顯示完才歸還，不需複製
+    const tofis_frame_t *frame = tofis_host_api_borrow_frame();
+    if (frame == NULL) {
+      break;
+    }
+    if (frame->sensor != display_sensor) {
+      tofis_host_api_release_frame();
+      continue;
     }
+    calculate_time_diff();
+
+    // 更新 Profile 參數
+    Profile.RangingProfile = (frame->resolution == 8) ? 8 : 4;
+    Profile.EnableAmbient = (frame->fields & TOFIS_FIELD_AMBIENT) ? 1 : 0;
+    Profile.EnableSignal = (frame->fields & TOFIS_FIELD_SIGNAL) ? 1 : 0;
+
+    print_result(&frame->data, frame->targets);
+    printf("Packet frequency: %6.2f Hz (protocol v%u, seq %u)\033[K\n",
+           1.0 / time_diff, frame->version, frame->sequence);
+    print_fields(frame);
+    print_config(frame);
+    print_timing(frame);
+    print_telemetry();
+    tofis_host_api_release_frame();
+
+    print_bandwidth(1.0 / time_diff);
+    clear_rest();
   }
 
   // 清理 Host API
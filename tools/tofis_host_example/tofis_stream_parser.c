@@ -0,0 +1,149 @@
+// tofis_stream_parser.c
+#include "tofis_stream_parser.h"
+#include "checksum.h"
+#include <string.h>
+
+#define RING_MASK (TOFIS_PARSER_RING_SIZE - 1U)
+
+static size_t ring_used(const tofis_parser_t *parser) {
+  return parser->head - parser->tail;
+}
+
+// 從 tail 之後 offset 處複製 length bytes（處理繞回）
+static void ring_copy(const tofis_parser_t *parser, size_t offset,
+                      uint8_t *dst, size_t length) {
+  size_t index = (parser->tail + offset) & RING_MASK;
+  size_t first = TOFIS_PARSER_RING_SIZE - index;
+
+  if (first > length) {
+    first = length;
+  }
+  memcpy(dst, &parser->ring[index], first);
+  memcpy(dst + first, parser->ring, length - first);
+}
+
+static void ring_skip(tofis_parser_t *parser, size_t length) {
+  parser->tail += length;
+}
+
+void tofis_parser_reset(tofis_parser_t *parser) {
+  parser->head = 0;
+  parser->tail = 0;
+  memset(&parser->stats, 0, sizeof(parser->stats));
+}
+
+uint8_t *tofis_parser_write_ptr(tofis_parser_t *parser, size_t *space) {
+  size_t index = parser->head & RING_MASK;
+  size_t free_space = TOFIS_PARSER_RING_SIZE - ring_used(parser);
+  size_t contiguous = TOFIS_PARSER_RING_SIZE - index;
+
+  *space = (contiguous < free_space) ? contiguous : free_space;
+  return &parser->ring[index];
+}
+
+void tofis_parser_commit(tofis_parser_t *parser, size_t length) {
+  parser->head += length;
+  parser->stats.bytes += length;
+}
+
+size_t tofis_parser_feed(tofis_parser_t *parser, const uint8_t *data,
+                         size_t length) {
+  size_t written = 0;
+
+  while (written < length) {
+    size_t space;
+    uint8_t *dst = tofis_parser_write_ptr(parser, &space);
+
+    if (space == 0) {
+      break;
+    }
+    if (space > length - written) {
+      space = length - written;
+    }
+    memcpy(dst, data + written, space);
+    tofis_parser_commit(parser, space);
+    written += space;
+  }
+
+  return written;
+}
+
+// 丟棄第一個 sync byte 之前的資料，回傳是否找到
+static int find_sync(tofis_parser_t *parser) {
+  while (ring_used(parser) > 0) {
+    size_t index = parser->tail & RING_MASK;
+    size_t contiguous = TOFIS_PARSER_RING_SIZE - index;
+    size_t used = ring_used(parser);
+    size_t length = (contiguous < used) ? contiguous : used;
+    const uint8_t *start = &parser->ring[index];
+    const uint8_t *sync = memchr(start, TOFIS_SYNC_BYTE_0, length);
+
+    if (sync != NULL) {
+      size_t skipped = (size_t)(sync - start);
+      parser->stats.skipped_bytes += skipped;
+      ring_skip(parser, skipped);
+      return 1;
+    }
+
+    parser->stats.skipped_bytes += length;
+    ring_skip(parser, length);
+  }
+
+  return 0;
+}
+
+// 目前位置不是 frame，只略過一個 byte，frame 可能從下一個 byte 開始
+static void backtrack(tofis_parser_t *parser) {
+  parser->stats.skipped_bytes++;
+  ring_skip(parser, 1);
+}
+
+int tofis_parser_next(tofis_parser_t *parser, tofis_frame_header_t *header,
+                      const uint8_t **payload) {
+  while (find_sync(parser)) {
+    if (ring_used(parser) < sizeof(*header)) {
+      return 0;
+    }
+
+    ring_copy(parser, 0, (uint8_t *)header, sizeof(*header));
+
+    if (header->sync[1] != TOFIS_SYNC_BYTE_1) {
+      backtrack(parser);
+      continue;
+    }
+    // 雜訊中的假 sync 多半在這裡被排除，不必等待整個 payload
+    if (header->version != TOFIS_PROTOCOL_VERSION ||
+        header->encoding < TOFIS_ENCODING_COMPACT ||
+        header->encoding > TOFIS_ENCODING_TELEMETRY ||
+        header->sensor >= TOFIS_MAX_SENSORS || header->reserved != 0 ||
+        header->length > TOFIS_MAX_PAYLOAD_SIZE) {
+      parser->stats.header_errors++;
+      backtrack(parser);
+      continue;
+    }
+
+    size_t padded = TOFIS_PADDED_LENGTH(header->length);
+    if (ring_used(parser) < sizeof(*header) + padded) {
+      return 0;
+    }
+
+    ring_copy(parser, sizeof(*header), parser->payload, padded);
+
+    // CRC 涵蓋 header 前段與補齊後的 payload
+    uint32_t crc = crc32_update(TOFIS_CRC32_INIT, (const uint8_t *)header,
+                                TOFIS_FRAME_HEADER_CRC_SIZE);
+    crc = crc32_update(crc, parser->payload, padded);
+    if (crc != header->crc32) {
+      parser->stats.crc_errors++;
+      backtrack(parser);
+      continue;
+    }
+
+    ring_skip(parser, sizeof(*header) + padded);
+    parser->stats.frames++;
+    *payload = parser->payload;
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,51 @@
+// tofis_stream_parser.h
+#pragma once
+
+#include "tofis_data.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// ring buffer 大小（2 的次方），需容納最大的 frame
+#define TOFIS_PARSER_RING_SIZE (1U << 16)
+
+
+typedef struct {
+  uint64_t bytes;         // 寫入的總位元組
+  uint64_t frames;        // CRC 正確的 frame 數
+  uint64_t skipped_bytes; // 重新同步時丟棄的位元組
+  uint64_t header_errors; // sync 正確但版本、編碼或長度不合理
+  uint64_t crc_errors;
+} tofis_parser_stats_t;
+
+// 串流解析器：在任意位置尋找 sync，驗證 header 與 CRC，
+// 失敗時只退回一個 byte 繼續尋找
+typedef struct {
+  uint8_t ring[TOFIS_PARSER_RING_SIZE];
+  size_t head; // 寫入位置（單調遞增，取餘數為 index）
+  size_t tail; // 讀取位置
+  uint8_t payload[TOFIS_PADDED_LENGTH(TOFIS_MAX_PAYLOAD_SIZE)];
+  tofis_parser_stats_t stats;
+} tofis_parser_t;
+
+_Static_assert(TOFIS_PARSER_RING_SIZE >=
+                   sizeof(tofis_frame_header_t) +
+                       TOFIS_PADDED_LENGTH(TOFIS_MAX_PAYLOAD_SIZE),
+               "TOFIS_PARSER_RING_SIZE is smaller than the largest frame");
+
+// 清空解析器與統計
+void tofis_parser_reset(tofis_parser_t *parser);
+
+// 取得可直接寫入的連續空間，讓 read() 一次讀進 ring buffer
+uint8_t *tofis_parser_write_ptr(tofis_parser_t *parser, size_t *space);
+
+// 確認 write_ptr 寫入了 length bytes
+void tofis_parser_commit(tofis_parser_t *parser, size_t length);
+
+// 複製資料進 ring buffer，空間不足時只寫入部分，回傳寫入的位元組數
+size_t tofis_parser_feed(tofis_parser_t *parser, const uint8_t *data,
+                         size_t length);
+
+// 取出下一個完整且 CRC 正確的 frame，回傳 1；資料不足回傳 0。
+// payload 指向解析器內部緩衝區，下一次呼叫前有效
+int tofis_parser_next(tofis_parser_t *parser, tofis_frame_header_t *header,
+                      const uint8_t **payload);